@@ -180,14 +180,14 @@ void Textures::gInit(const char* title) {
 } // gInit
 
 void Textures::gRender(bool auto_redraw) {
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    GLState::current().clearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
     
     // привязка текструры
-    glBindTexture(GL_TEXTURE_2D, texture);
+    GLState::current().bindTexture(GL_TEXTURE_2D, texture);
     m_Shaders->use();
     // рисуем прямоугольник
-    glBindVertexArray(VAO);
+    GLState::current().bindVertexArray(VAO);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
     base::gRender(auto_redraw);
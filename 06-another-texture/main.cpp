@@ -121,24 +121,21 @@ void Textures::gInit(const char* title) {
 } // gInit
 
 void Textures::gRender(bool auto_redraw) {
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    GLState::current().clearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
     m_Shaders->use();
     
     // Рисование текстурного блока
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture_1);
+    GLState::current().bindTextureUnit(0, GL_TEXTURE_2D, texture_1);
     m_Shaders->setInt("ourTexture1",0);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, texture_2);
+    GLState::current().bindTextureUnit(1, GL_TEXTURE_2D, texture_2);
     m_Shaders->setInt("ourTexture2",1);
     // устанавливаем коэффициент смешения двух текстур (нажимайте стрелки "вверх" и "вниз")
     m_Shaders->setFloat("mixValue", mixValue);
     
     // Рисование
-    glBindVertexArray(VAO);
+    GLState::current().bindVertexArray(VAO);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
     
     base::gRender(auto_redraw);
 } // gRender
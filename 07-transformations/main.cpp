@@ -52,7 +52,7 @@
 
 #include "application.h"
 #include "shader.h"
-#include <SOIL/SOIL.h>
+#include "texture_manager.h"
 
 #include <iostream>
 //-------------------
@@ -145,37 +145,19 @@ void Transformations::gInit(const char* title) {
     //=====================================
     // Загрузка текстуры
     //=====================================
-    int width, height;
-    unsigned char *data;
-    glGenTextures(1, &texture_box);
-    glBindTexture(GL_TEXTURE_2D, texture_box);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    data = SOIL_load_image(TEXTURE_PATH_PREFIX"/box.jpg", &width, &height, 0, SOIL_LOAD_RGB);
-    if (data) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else {
-        std::cout << "Failed loading of the texture" << std::endl;
-    }
-    glBindTexture(GL_TEXTURE_2D, 0);
-    SOIL_free_image_data(data);
+    texture_box = TextureManager::current().gAcquire(TEXTURE_PATH_PREFIX"/box.jpg");
     
     // Мы устанавливаем интервал смены буферов побольше, чтобы анимация проигрывалась более плавно
     glfwSwapInterval(8);
 } // gInit
 
 void Transformations::gRender(bool auto_redraw) {
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    GLState::current().clearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
     m_Shaders->use();
     
     // подготовка текстуры
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture_box);
+    GLState::current().bindTextureUnit(0, GL_TEXTURE_2D, texture_box);
     // передача текстуры во фрагментный шейдер
     m_Shaders->setInt("ourTexture",0);
     
@@ -212,9 +194,8 @@ void Transformations::gRender(bool auto_redraw) {
      * Это делается для того, чтобы преобразовать значения в матрице к виду, который требует OpenGL.
      */
     // Рисование
-    glBindVertexArray(VAO);
+    GLState::current().bindVertexArray(VAO);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
     
     base::gRender();
 } // gRender
@@ -223,8 +204,10 @@ void Transformations::gFinalize() {
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
+    TextureManager::current().gRelease(texture_box);
     if (m_Shaders)
         delete m_Shaders;
+    TextureManager::current().gFinalize();
     base::gFinalize();
 } // gFinalize
 
@@ -12,8 +12,7 @@
 
 #include "application.h"
 #include "shader.h"
-//#include "SOIL.h"
-#include <SOIL/SOIL.h>
+#include "texture_manager.h"
 
 #include <iostream>
 #include <glm/glm.hpp>
@@ -119,31 +118,14 @@ void Cube::gInit(const char* title) {
     //---------------------------
     // Загрузка текстуры
     //---------------------------
-    int width, height;
-    unsigned char *data;
-    glGenTextures(1, &texture_box);
-    glBindTexture(GL_TEXTURE_2D, texture_box);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    data = SOIL_load_image(TEXTURE_PATH_PREFIX"/box.jpg", &width, &height, 0, SOIL_LOAD_RGB);
-    if (data) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else {
-        std::cout << "Failed loading of the texture" << std::endl;
-    }
-    glBindTexture(GL_TEXTURE_2D, 0);
-    SOIL_free_image_data(data);
+    texture_box = TextureManager::current().gAcquire(TEXTURE_PATH_PREFIX"/box.jpg");
     
     // Модель коробки готова
     
 } // gInit
 
 void Cube::gRender(bool auto_redraw) {
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    GLState::current().clearColor(0.2f, 0.3f, 0.3f, 1.0f);
     /*
      * Буфер глубины
      * -----------------------
@@ -155,12 +137,11 @@ void Cube::gRender(bool auto_redraw) {
      * На практике при использовании буфера глубины на каждой новой итерации он должен быть предварительно очищен, чтобы OpenGL не использовал
      * результаты предыдущей перерисовки. Также на каждой итерации буфер глубины должен быть активизирован, через вызов glEnable().
      */
-    glEnable(GL_DEPTH_TEST);                                // активизируем буфер глубины
+    GLState::current().enable(GL_DEPTH_TEST);               // активизируем буфер глубины (повторный вызов кэш пропустит)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);     // очищаем буфер цветов и буфер глубины
     m_Shaders->use();
     // подготовка текстуры
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture_box);
+    GLState::current().bindTextureUnit(0, GL_TEXTURE_2D, texture_box);
     // передача текстуры во фрагментный шейдер
     m_Shaders->setInt("ourTexture",0);
     // матрицы 
@@ -178,9 +159,8 @@ void Cube::gRender(bool auto_redraw) {
     glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection)); 
     
     // Рисование
-    glBindVertexArray(VAO);
+    GLState::current().bindVertexArray(VAO);
     glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
     
     base::gRender(auto_redraw);
 } // gRender
@@ -188,8 +168,10 @@ void Cube::gRender(bool auto_redraw) {
 void Cube::gFinalize() {
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
+    TextureManager::current().gRelease(texture_box);
     if (m_Shaders)
         delete m_Shaders;
+    TextureManager::current().gFinalize();
     base::gFinalize();
 } // gFinalize
 
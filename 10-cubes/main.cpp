@@ -7,14 +7,18 @@
 
 #include "application.h"
 #include "shader.h"
-#include <SOIL/SOIL.h>
+#include "texture_manager.h"
 #include "model_cube.h"    // вершины для куба мы берем здесь
+#include "vertex_layout.h"
 
 #include <iostream>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+// позиция - три числа GLfloat, текстурные координаты - два
+typedef VertexLayout< VertexAttr<0, vfmt::Float3>, VertexAttr<2, vfmt::Float2> > CubeLayout;
+
 BEGIN_APP_DECLARATION(Cube)
     virtual void gInit(const char* title = NULL);
     virtual void gRender(bool auto_redraw = true);
@@ -27,7 +31,7 @@ BEGIN_APP_DECLARATION(Cube)
     {}
 protected:
     Shader* m_Shaders;
-    GLuint VBO, VAO;
+    GLuint VBO, EBO, VAO;
     GLuint texture_box;
     GLfloat rotate_angle;
 END_APP_DECLARATION()
@@ -49,45 +53,27 @@ void Cube::gInit(const char* title) {
     //---------------------------
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
     glBindVertexArray(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(models::cube_vertices), models::cube_vertices, GL_STATIC_DRAW);
-    
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)0);
-    glEnableVertexAttribArray(0);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(models::cube_indexed_vertices), models::cube_indexed_vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(models::cube_indices), models::cube_indices, GL_STATIC_DRAW);
     
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(2);
+    CubeLayout::setup();
     
     glBindVertexArray(0);
     //---------------------------
     // Загрузка текстуры
     //---------------------------
-    int width, height;
-    unsigned char *data;
-    glGenTextures(1, &texture_box);
-    glBindTexture(GL_TEXTURE_2D, texture_box);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    data = SOIL_load_image(TEXTURE_PATH_PREFIX"/box.jpg", &width, &height, 0, SOIL_LOAD_RGB);
-    if (data) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else {
-        std::cout << "Failed loading of the texture" << std::endl;
-    }
-    glBindTexture(GL_TEXTURE_2D, 0);
-    SOIL_free_image_data(data);
+    texture_box = TextureManager::current().gAcquire(TEXTURE_PATH_PREFIX"/box.jpg");
     
     // Модель коробки готова
     
 } // gInit
 
 void Cube::gRender(bool auto_redraw) {
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    GLState::current().clearColor(0.2f, 0.3f, 0.3f, 1.0f);
     /*
      * Буфер глубины
      * -----------------------
@@ -99,12 +85,11 @@ void Cube::gRender(bool auto_redraw) {
      * На практике при использовании буфера глубины на каждой новой итерации он должен быть предварительно очищен, чтобы OpenGL не использовал
      * результаты предыдущей перерисовки. Также на каждой итерации буфер глубины должен быть активизирован, через вызов glEnable().
      */
-    glEnable(GL_DEPTH_TEST);                                // активизируем буфер глубины
+    GLState::current().enable(GL_DEPTH_TEST);               // активизируем буфер глубины (повторный вызов кэш пропустит)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);     // очищаем буфер цветов и буфер глубины
     m_Shaders->use();
     // подготовка текстуры
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture_box);
+    GLState::current().bindTextureUnit(0, GL_TEXTURE_2D, texture_box);
     // передача текстуры во фрагментный шейдер
     m_Shaders->setInt("ourTexture",0);
     /* 
@@ -141,7 +126,7 @@ void Cube::gRender(bool auto_redraw) {
     glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
     
     // Рисование
-    glBindVertexArray(VAO);
+    GLState::current().bindVertexArray(VAO);
     for (uint i = 0; i < sizeof cubePositions / sizeof *cubePositions; i++) {
         // каждый ящик находится на своей позиции
         model = glm::translate(model, cubePositions[i]);
@@ -152,9 +137,8 @@ void Cube::gRender(bool auto_redraw) {
             angle = 20.0f * i;
         model = glm::rotate(model, glm::radians(angle), glm::vec3(0.3f, 1.0f, 0.5f));
         glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        glDrawElements(GL_TRIANGLES, models::cube_index_count, GL_UNSIGNED_INT, 0);
     }
-    glBindVertexArray(0);
     
     base::gRender(auto_redraw);
 } // gRender
@@ -162,8 +146,11 @@ void Cube::gRender(bool auto_redraw) {
 void Cube::gFinalize() {
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    TextureManager::current().gRelease(texture_box);
     if (m_Shaders)
         delete m_Shaders;
+    TextureManager::current().gFinalize();
     base::gFinalize();
 } // gFinalize
 
@@ -0,0 +1,232 @@
+/*
+ * В этом примере сцена состоит из нескольких тысяч ящиков с разными текстурами. Если рисовать их в том порядке,
+ * в котором они лежат в памяти, то перед каждым вызовом glDrawArrays пришлось бы заново привязывать текстуру,
+ * потому что соседние ящики почти всегда отличаются. Смена состояния OpenGL (программы, текстуры, VAO) стоит
+ * драйверу намного дороже, чем сам вызов отрисовки.
+ *
+ * Поэтому в gRender мы не рисуем сразу, а складываем описания вызовов (DrawPacket) в очередь RenderQueue.
+ * Очередь кодирует каждый пакет в 64-битный ключ, сортирует ключи и только потом рисует, переключая состояние
+ * лишь при его действительной смене. Нажмите Q, чтобы переключиться между очередью и "наивным" рисованием
+ * и сравнить количество смен состояния, которое печатается в консоль.
+ */
+
+#include "application.h"
+#include "shader.h"
+#include "texture_manager.h"
+#include "model_cube.h"
+#include "vertex_layout.h"
+#include "camera.h"
+#include "render_queue.h"
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// позиция в половинной точности, текстурные координаты - нормированные 16-битные целые:
+// 12 байт на вершину вместо 20
+typedef VertexLayout< VertexAttr<0, vfmt::Half3>, VertexAttr<2, vfmt::UNorm16x2> > CubeLayout;
+
+#define CUBES_COUNT     4000
+
+BEGIN_APP_DECLARATION(Cube)
+    virtual void gInit(const char* title = NULL);
+    virtual void gRender(bool auto_redraw = true);
+    virtual void gFinalize();
+    void onKey(int key, int scancode, int action, int mods);
+    void onMouseMove(double xpos, double ypos);
+    void onMouseScroll(double xoffset, double yoffset);
+    Cube()
+    : base(),
+    m_Shaders(nullptr),
+    m_bUseQueue(true)
+    {}
+protected:
+    Shader* m_Shaders;
+    GLuint VBO, EBO, VAO;
+    GLuint textures[2];
+    RenderQueue m_Queue;
+    bool m_bUseQueue;
+END_APP_DECLARATION()
+
+DEFINE_APP(Cube, "Render queue")
+
+#define SHADER_PATH_PREFIX    "../shaders"
+#define TEXTURE_PATH_PREFIX   "../textures"
+
+//----------------------------------------------------------------------------
+// Настройка камеры
+Camera m_Camera(glm::vec3(0.0f, 0.0f, 3.0f));
+bool firstMouse = true;
+float lastX =  800.0f / 2.0;
+float lastY =  600.0f / 2.0;
+
+// timing
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastReport = 0.0f;
+
+struct SceneObject {
+    glm::mat4 model;
+    GLuint    texture;
+};
+std::vector<SceneObject> objects;
+//----------------------------------------------------------------------------
+
+void Cube::gInit(const char* title) {
+    base::gInit(title);
+
+    glfwSetInputMode(m_pWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    if (!(m_Shaders = new Shader(SHADER_PATH_PREFIX"/3.3.shader09.vs.glsl",
+                                 SHADER_PATH_PREFIX"/3.3.shader05.fs.glsl"))) {
+        throw std::logic_error("something wrong with shaders");
+    }
+    //---------------------------
+    // Загрузка модели
+    //---------------------------
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    std::vector<unsigned char> cube;
+    CubeLayout::pack(models::cube_indexed_vertices, models::cube_vertex_count, cube);
+    glBufferData(GL_ARRAY_BUFFER, cube.size(), cube.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(models::cube_indices), models::cube_indices, GL_STATIC_DRAW);
+
+    CubeLayout::setup();
+
+    glBindVertexArray(0);
+    //---------------------------
+    // Загрузка текстур
+    //---------------------------
+    textures[0] = TextureManager::current().gAcquireAsync(TEXTURE_PATH_PREFIX"/box.jpg");
+    textures[1] = TextureManager::current().gAcquireAsync(TEXTURE_PATH_PREFIX"/wood.jpg");
+    //---------------------------
+    // Сцена: ящики вперемешку с разными текстурами
+    //---------------------------
+    srand(42);
+    objects.resize(CUBES_COUNT);
+    for (size_t i = 0; i < objects.size(); i++) {
+        glm::vec3 position((rand() % 200 - 100) * 0.25f,
+                           (rand() % 200 - 100) * 0.25f,
+                           -(rand() % 400) * 0.25f);
+        objects[i].model = glm::translate(glm::mat4(1.0f), position);
+        objects[i].model = glm::rotate(objects[i].model, glm::radians(20.0f * i), glm::vec3(0.3f, 1.0f, 0.5f));
+        objects[i].texture = textures[rand() % 2];
+    }
+} // gInit
+
+void Cube::gRender(bool auto_redraw) {
+    float currentFrame = glfwGetTime();
+    deltaTime = currentFrame - lastFrame;
+    lastFrame = currentFrame;
+    //------------------------------------------------------------
+    TextureManager::current().gUpdate();        // текстуры догружаются в фоне
+    GLState::current().clearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    GLState::current().enable(GL_DEPTH_TEST);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glm::mat4 view = m_Camera.GetViewMatrix();
+    glm::mat4 projection = glm::perspective(glm::radians(m_Camera.Zoom), (float)800 / (float)600, 0.1f, 100.0f);
+    // матрицы вида и проекции общие для всех ящиков
+    m_Shaders->use();
+    m_Shaders->setInt("ourTexture", 0);
+    m_Shaders->setMat4("view", view);
+    m_Shaders->setMat4("projection", projection);
+    GLint modelLoc = glGetUniformLocation(m_Shaders->ID, "model");
+
+    GLuint draws = 0, textureSwitches = 0;
+    if (m_bUseQueue) {
+        m_Queue.begin(0.1f, 100.0f);
+        for (size_t i = 0; i < objects.size(); i++) {
+            DrawPacket packet;
+            packet.program = m_Shaders->ID;
+            packet.vao = VAO;
+            packet.textures[0] = objects[i].texture;
+            packet.count = models::cube_index_count;
+            packet.indexType = GL_UNSIGNED_INT;
+            // глубина нужна, чтобы внутри одной текстуры рисовать от ближних к дальним
+            packet.depth = -(view * objects[i].model[3]).z;
+            UniformValue model = UniformValue::mat4(modelLoc, glm::value_ptr(objects[i].model));
+            m_Queue.submit(packet, &model, 1);
+        }
+        m_Queue.flush();
+        draws = m_Queue.getStats().draws;
+        textureSwitches = m_Queue.getStats().textureSwitches;
+    }
+    else {
+        // наивный вариант: рисуем в порядке хранения
+        GLState::current().bindVertexArray(VAO);
+        for (size_t i = 0; i < objects.size(); i++) {
+            GLState::current().bindTextureUnit(0, GL_TEXTURE_2D, objects[i].texture);
+            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(objects[i].model));
+            glDrawElements(GL_TRIANGLES, models::cube_index_count, GL_UNSIGNED_INT, 0);
+            draws++;
+            if (i == 0 || objects[i].texture != objects[i - 1].texture)
+                textureSwitches++;
+        }
+    }
+    if (currentFrame - lastReport > 1.0f) {
+        lastReport = currentFrame;
+        std::cout << (m_bUseQueue ? "queue" : "naive")
+                  << ": draws " << draws
+                  << ", texture switches " << textureSwitches
+                  << ", GL calls issued/skipped " << GLState::current().frameStats().issued
+                  << "/" << GLState::current().frameStats().skipped
+                  << ", frame " << deltaTime * 1000.0f << " ms" << std::endl;
+    }
+
+    base::gRender(auto_redraw);
+} // gRender
+
+void Cube::gFinalize() {
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    TextureManager::current().gRelease(textures[0]);
+    TextureManager::current().gRelease(textures[1]);
+    if (m_Shaders)
+        delete m_Shaders;
+    TextureManager::current().gFinalize();
+    base::gFinalize();
+} // gFinalize
+
+void Cube::onKey(int key, int scancode, int action, int mods) {
+    if (key == GLFW_KEY_W && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(FORWARD, deltaTime);
+    else if (key == GLFW_KEY_S && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(BACKWARD, deltaTime);
+    else if (key == GLFW_KEY_A && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(LEFT, deltaTime);
+    else if (key == GLFW_KEY_D && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(RIGHT, deltaTime);
+    else if (key == GLFW_KEY_Q && action == GLFW_PRESS)
+        m_bUseQueue = !m_bUseQueue;
+} // onKey
+
+//---------------------------------------------------------------------
+void Cube::onMouseMove(double xpos, double ypos) {
+    if (firstMouse)
+    {
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false;
+    }
+
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+
+    lastX = xpos;
+    lastY = ypos;
+
+    m_Camera.ProcessMouseMovement(xoffset, yoffset);
+} // mouse_callback
+
+void Cube::onMouseScroll(double xoffset, double yoffset) {
+    m_Camera.ProcessMouseScroll(yoffset);
+} // scroll_callback
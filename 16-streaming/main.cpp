@@ -0,0 +1,232 @@
+/*
+ * В этом примере каждый кадр заново вычисляются матрицы модели для десяти тысяч вращающихся ящиков.
+ * До сих пор все буферы заполнялись один раз в gInit через glBufferData(..., GL_STATIC_DRAW). Для данных,
+ * которые меняются каждый кадр, такой путь не годится: если писать в буфер, который GPU еще читает для
+ * предыдущего кадра, драйвер будет вынужден ждать.
+ *
+ * Поэтому матрицы пишутся в потоковый буфер StreamBuffer (см. include/stream_buffer.h). Он делит память на
+ * несколько сегментов и пишет каждый кадр в свой сегмент, а барьеры glFenceSync говорят, когда сегмент
+ * можно использовать снова. Ящики рисуются одним вызовом glDrawElementsInstanced: матрица модели приходит
+ * в вершинный шейдер как атрибут экземпляра (glVertexAttribDivisor).
+ *
+ * Клавиша M переключает режим работы буфера: постоянное отображение (если поддерживается),
+ * GL_MAP_UNSYNCHRONIZED_BIT и "осиротение" буфера.
+ */
+
+#include "application.h"
+#include "shader.h"
+#include "texture_manager.h"
+#include "model_cube.h"
+#include "vertex_layout.h"
+#include "camera.h"
+#include "stream_buffer.h"
+
+#include <iostream>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// позиция в половинной точности, текстурные координаты - нормированные 16-битные целые:
+// 12 байт на вершину вместо 20
+typedef VertexLayout< VertexAttr<0, vfmt::Half3>, VertexAttr<2, vfmt::UNorm16x2> > CubeLayout;
+
+#define CUBES_COUNT     10000
+
+BEGIN_APP_DECLARATION(Cube)
+    virtual void gInit(const char* title = NULL);
+    virtual void gRender(bool auto_redraw = true);
+    virtual void gFinalize();
+    void onKey(int key, int scancode, int action, int mods);
+    void onMouseMove(double xpos, double ypos);
+    void onMouseScroll(double xoffset, double yoffset);
+    Cube()
+    : base(),
+    m_Shaders(nullptr),
+    m_Stream(nullptr),
+    m_StreamMode(StreamBuffer::AUTO)
+    {}
+protected:
+    Shader* m_Shaders;
+    GLuint VBO, EBO, VAO;
+    GLuint texture_box;
+    StreamBuffer* m_Stream;
+    int m_StreamMode;
+END_APP_DECLARATION()
+
+DEFINE_APP(Cube, "Streaming")
+
+#define SHADER_PATH_PREFIX    "../shaders"
+#define TEXTURE_PATH_PREFIX   "../textures"
+
+//----------------------------------------------------------------------------
+// Настройка камеры
+Camera m_Camera(glm::vec3(0.0f, 0.0f, 3.0f));
+bool firstMouse = true;
+float lastX =  800.0f / 2.0;
+float lastY =  600.0f / 2.0;
+
+// timing
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastReport = 0.0f;
+
+std::vector<glm::vec3> positions;
+//----------------------------------------------------------------------------
+static const char* modeName(StreamBuffer::Mode mode) {
+    switch (mode) {
+        case StreamBuffer::PERSISTENT:      return "persistent";
+        case StreamBuffer::UNSYNCHRONIZED:  return "unsynchronized";
+        case StreamBuffer::ORPHAN:          return "orphan";
+        default:                            return "auto";
+    }
+}
+
+void Cube::gInit(const char* title) {
+    base::gInit(title);
+
+    glfwSetInputMode(m_pWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    if (!(m_Shaders = new Shader(SHADER_PATH_PREFIX"/3.3.shader10.vs.glsl",
+                                 SHADER_PATH_PREFIX"/3.3.shader05.fs.glsl"))) {
+        throw std::logic_error("something wrong with shaders");
+    }
+    //---------------------------
+    // Загрузка модели
+    //---------------------------
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    std::vector<unsigned char> cube;
+    CubeLayout::pack(models::cube_indexed_vertices, models::cube_vertex_count, cube);
+    glBufferData(GL_ARRAY_BUFFER, cube.size(), cube.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(models::cube_indices), models::cube_indices, GL_STATIC_DRAW);
+
+    CubeLayout::setup();
+
+    // атрибуты экземпляра: по одному столбцу матрицы в каждом слоте, один раз на экземпляр
+    for (int i = 0; i < 4; i++) {
+        glEnableVertexAttribArray(3 + i);
+        glVertexAttribDivisor(3 + i, 1);
+    }
+    glBindVertexArray(0);
+    //---------------------------
+    // Загрузка текстуры
+    //---------------------------
+    texture_box = TextureManager::current().gAcquireAsync(TEXTURE_PATH_PREFIX"/box.jpg");
+    //---------------------------
+    // Потоковый буфер для матриц
+    //---------------------------
+    m_Stream = new StreamBuffer(GL_ARRAY_BUFFER, CUBES_COUNT * sizeof(glm::mat4));
+    std::cout << "stream buffer mode: " << modeName(m_Stream->getMode()) << std::endl;
+
+    positions.resize(CUBES_COUNT);
+    for (size_t i = 0; i < positions.size(); i++) {
+        positions[i] = glm::vec3((float)(i % 100) - 50.0f,
+                                 (float)((i / 100) % 10) * 2.0f - 10.0f,
+                                 -(float)(i / 1000) * 3.0f - 5.0f);
+    }
+} // gInit
+
+void Cube::gRender(bool auto_redraw) {
+    float currentFrame = glfwGetTime();
+    deltaTime = currentFrame - lastFrame;
+    lastFrame = currentFrame;
+    //------------------------------------------------------------
+    TextureManager::current().gUpdate();        // текстуры догружаются в фоне
+    GLState::current().clearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    GLState::current().enable(GL_DEPTH_TEST);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    m_Shaders->use();
+    GLState::current().bindTextureUnit(0, GL_TEXTURE_2D, texture_box);
+    m_Shaders->setInt("ourTexture", 0);
+    m_Shaders->setMat4("view", m_Camera.GetViewMatrix());
+    m_Shaders->setMat4("projection", glm::perspective(glm::radians(m_Camera.Zoom), (float)800 / (float)600, 0.1f, 100.0f));
+
+    // пишем матрицы этого кадра прямо в память буфера
+    GLintptr offset;
+    glm::mat4* instances = (glm::mat4*)m_Stream->map(positions.size() * sizeof(glm::mat4), sizeof(glm::vec4), &offset);
+    for (size_t i = 0; i < positions.size(); i++) {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), positions[i]);
+        instances[i] = glm::rotate(model, currentFrame + 0.01f * i, glm::vec3(0.3f, 1.0f, 0.5f));
+    }
+    m_Stream->unmap();
+
+    // атрибуты экземпляра указывают на участок текущего кадра
+    GLState::current().bindVertexArray(VAO);
+    GLState::current().bindBuffer(GL_ARRAY_BUFFER, m_Stream->getBuffer());
+    for (int i = 0; i < 4; i++) {
+        glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                              (GLvoid*)(offset + i * sizeof(glm::vec4)));
+    }
+    glDrawElementsInstanced(GL_TRIANGLES, models::cube_index_count, GL_UNSIGNED_INT, 0, (GLsizei)positions.size());
+    m_Stream->endFrame();
+
+    if (currentFrame - lastReport > 1.0f) {
+        lastReport = currentFrame;
+        const StreamBufferStats& stats = m_Stream->getStats();
+        std::cout << modeName(m_Stream->getMode())
+                  << ": " << stats.bytes / 1024 << " KiB/frame"
+                  << ", stalls " << stats.stalls
+                  << ", frame " << deltaTime * 1000.0f << " ms" << std::endl;
+    }
+
+    base::gRender(auto_redraw);
+} // gRender
+
+void Cube::gFinalize() {
+    if (m_Stream)
+        delete m_Stream;
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    TextureManager::current().gRelease(texture_box);
+    if (m_Shaders)
+        delete m_Shaders;
+    TextureManager::current().gFinalize();
+    base::gFinalize();
+} // gFinalize
+
+void Cube::onKey(int key, int scancode, int action, int mods) {
+    if (key == GLFW_KEY_W && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(FORWARD, deltaTime);
+    else if (key == GLFW_KEY_S && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(BACKWARD, deltaTime);
+    else if (key == GLFW_KEY_A && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(LEFT, deltaTime);
+    else if (key == GLFW_KEY_D && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(RIGHT, deltaTime);
+    else if (key == GLFW_KEY_M && action == GLFW_PRESS) {
+        // пересоздаем буфер в следующем режиме
+        m_StreamMode = m_StreamMode % 3 + 1;
+        delete m_Stream;
+        m_Stream = new StreamBuffer(GL_ARRAY_BUFFER, CUBES_COUNT * sizeof(glm::mat4), (StreamBuffer::Mode)m_StreamMode);
+        std::cout << "stream buffer mode: " << modeName(m_Stream->getMode()) << std::endl;
+    }
+} // onKey
+
+//---------------------------------------------------------------------
+void Cube::onMouseMove(double xpos, double ypos) {
+    if (firstMouse)
+    {
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false;
+    }
+
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+
+    lastX = xpos;
+    lastY = ypos;
+
+    m_Camera.ProcessMouseMovement(xoffset, yoffset);
+} // mouse_callback
+
+void Cube::onMouseScroll(double xoffset, double yoffset) {
+    m_Camera.ProcessMouseScroll(yoffset);
+} // scroll_callback
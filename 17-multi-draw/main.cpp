@@ -0,0 +1,250 @@
+/*
+ * Инстансинг из предыдущего примера рисует много копий одного меша одним вызовом. Но в настоящей сцене
+ * меши разные, и каждый из них по-прежнему требует своего вызова glDrawElements. В этом примере сцена
+ * состоит из трех тысяч объектов трех видов: ящиков, пирамид и плит.
+ *
+ * Все меши складываются в общие буферы вершин и индексов пакета MeshBatch (см. include/mesh_batch.h),
+ * а для каждого объекта в список добавляется команда DrawElementsIndirectCommand. На GL 4.3+ весь список
+ * рисуется одним вызовом glMultiDrawElementsIndirect, на GL 3.3 - циклом glDrawElementsInstancedBaseVertex.
+ * Матрицы моделей лежат в текстурном буфере, а вершинный шейдер достает свою матрицу по номеру объекта.
+ *
+ * Перед загрузкой в пакет каждый меш проходит обработку meshopt::optimizeMesh (см. include/mesh_optimizer.h):
+ * куб берется в неиндексированном виде, из 36 вершин после сварки остается 16. В консоль выводятся ACMR и ATVR
+ * до и после обработки. Затем вершины сжимаются в формат MeshLayout (см. include/vertex_layout.h).
+ *
+ * Клавиша I включает и выключает косвенную отрисовку (если она поддерживается).
+ */
+
+#include "application.h"
+#include "shader.h"
+#include "texture_manager.h"
+#include "model_cube.h"
+#include "camera.h"
+#include "mesh_batch.h"
+#include "mesh_optimizer.h"
+#include "vertex_layout.h"
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#define OBJECTS_COUNT   3000
+
+// формат вершин в пакете: исходные меши задаются числами GLfloat (позиция 3, координаты 2)
+typedef VertexLayout< VertexAttr<0, vfmt::Half3>, VertexAttr<2, vfmt::UNorm16x2> > MeshLayout;
+
+BEGIN_APP_DECLARATION(Scene)
+    virtual void gInit(const char* title = NULL);
+    virtual void gRender(bool auto_redraw = true);
+    virtual void gFinalize();
+    void onKey(int key, int scancode, int action, int mods);
+    void onMouseMove(double xpos, double ypos);
+    void onMouseScroll(double xoffset, double yoffset);
+    Scene()
+    : base(),
+    m_Shaders(nullptr),
+    m_Batch(nullptr),
+    m_bIndirect(true)
+    {}
+protected:
+    Shader* m_Shaders;
+    MeshBatch* m_Batch;
+    GLuint meshes[3];
+    GLuint TBO, texture_models;
+    GLuint texture_box;
+    bool m_bIndirect;
+END_APP_DECLARATION()
+
+DEFINE_APP(Scene, "Multi-draw indirect")
+
+#define SHADER_PATH_PREFIX    "../shaders"
+#define TEXTURE_PATH_PREFIX   "../textures"
+
+//----------------------------------------------------------------------------
+// Настройка камеры
+Camera m_Camera(glm::vec3(0.0f, 0.0f, 3.0f));
+bool firstMouse = true;
+float lastX =  800.0f / 2.0;
+float lastY =  600.0f / 2.0;
+
+// timing
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastReport = 0.0f;
+
+std::vector<GLuint> objectMesh;         // вид меша для каждого объекта
+
+//----------------------------------------------------------------------------
+// Пирамида: квадратное основание и четыре грани
+GLfloat pyramid_vertices[] = {
+    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+     0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
+     0.5f, -0.5f,  0.5f,  1.0f, 1.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f, 1.0f,
+     0.0f,  0.5f,  0.0f,  0.5f, 0.5f
+};
+GLuint pyramid_indices[] = {
+    0, 1, 2,  2, 3, 0,
+    0, 4, 1,  1, 4, 2,  2, 4, 3,  3, 4, 0
+};
+// Плита: один плоский прямоугольник
+GLfloat plate_vertices[] = {
+    -1.0f, 0.0f, -1.0f,  0.0f, 0.0f,
+     1.0f, 0.0f, -1.0f,  1.0f, 0.0f,
+     1.0f, 0.0f,  1.0f,  1.0f, 1.0f,
+    -1.0f, 0.0f,  1.0f,  0.0f, 1.0f
+};
+GLuint plate_indices[] = {
+    0, 1, 2,  2, 3, 0
+};
+//----------------------------------------------------------------------------
+// Обрабатывает меш (indices == nullptr - неиндексированный), сжимает вершины и добавляет меш в пакет
+static GLuint addOptimizedMesh(MeshBatch* batch, const char* name, const GLfloat* vertices, size_t vertexCount,
+                               const GLuint* indices, size_t indexCount) {
+    const size_t stride = 5 * sizeof(GLfloat);
+    std::vector<unsigned char> v((const unsigned char*)vertices, (const unsigned char*)vertices + vertexCount * stride);
+    std::vector<GLuint> i;
+    if (indices)
+        i.assign(indices, indices + indexCount);
+    meshopt::OptimizeReport report = meshopt::optimizeMesh(v, stride, i);
+    std::cout << name << ": vertices " << report.vertexCountBefore << " -> " << report.vertexCountAfter
+              << ", ACMR " << report.before.acmr << " -> " << report.after.acmr
+              << ", ATVR " << report.before.atvr << " -> " << report.after.atvr << std::endl;
+    std::vector<unsigned char> packed;
+    MeshLayout::pack((const GLfloat*)v.data(), report.vertexCountAfter, packed);
+    return batch->addMesh(packed.data(), (GLsizei)report.vertexCountAfter, i.data(), (GLsizei)i.size());
+} // addOptimizedMesh
+
+void Scene::gInit(const char* title) {
+    base::gInit(title);
+
+    glfwSetInputMode(m_pWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    if (!(m_Shaders = new Shader(SHADER_PATH_PREFIX"/3.3.shader11.vs.glsl",
+                                 SHADER_PATH_PREFIX"/3.3.shader05.fs.glsl"))) {
+        throw std::logic_error("something wrong with shaders");
+    }
+    //---------------------------
+    // Пакет мешей
+    //---------------------------
+    m_Batch = new MeshBatch(MeshLayout::stride, OBJECTS_COUNT);
+    MeshLayout::describe(*m_Batch);
+    m_Batch->enableObjectId(3);
+
+    meshes[0] = addOptimizedMesh(m_Batch, "cube", models::cube_vertices, 36, nullptr, 0);
+    meshes[1] = addOptimizedMesh(m_Batch, "pyramid", pyramid_vertices, 5, pyramid_indices, 18);
+    meshes[2] = addOptimizedMesh(m_Batch, "plate", plate_vertices, 4, plate_indices, 6);
+    m_Batch->build();
+    //---------------------------
+    // Сцена: матрицы моделей в текстурном буфере
+    //---------------------------
+    srand(7);
+    std::vector<glm::mat4> models(OBJECTS_COUNT);
+    objectMesh.resize(OBJECTS_COUNT);
+    for (size_t i = 0; i < models.size(); i++) {
+        glm::vec3 position((rand() % 200 - 100) * 0.25f,
+                           (rand() % 200 - 100) * 0.25f,
+                           -(rand() % 400) * 0.25f);
+        models[i] = glm::translate(glm::mat4(1.0f), position);
+        models[i] = glm::rotate(models[i], glm::radians(20.0f * i), glm::vec3(0.3f, 1.0f, 0.5f));
+        objectMesh[i] = meshes[rand() % 3];
+    }
+    glGenBuffers(1, &TBO);
+    glBindBuffer(GL_TEXTURE_BUFFER, TBO);
+    glBufferData(GL_TEXTURE_BUFFER, models.size() * sizeof(glm::mat4), glm::value_ptr(models[0]), GL_STATIC_DRAW);
+    glGenTextures(1, &texture_models);
+    glBindTexture(GL_TEXTURE_BUFFER, texture_models);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, TBO);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    //---------------------------
+    // Загрузка текстуры
+    //---------------------------
+    texture_box = TextureManager::current().gAcquireAsync(TEXTURE_PATH_PREFIX"/box.jpg");
+} // gInit
+
+void Scene::gRender(bool auto_redraw) {
+    float currentFrame = glfwGetTime();
+    deltaTime = currentFrame - lastFrame;
+    lastFrame = currentFrame;
+    //------------------------------------------------------------
+    TextureManager::current().gUpdate();        // текстуры догружаются в фоне
+    GLState::current().clearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    GLState::current().enable(GL_DEPTH_TEST);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    m_Shaders->use();
+    GLState::current().bindTextureUnit(0, GL_TEXTURE_2D, texture_box);
+    GLState::current().bindTextureUnit(1, GL_TEXTURE_BUFFER, texture_models);
+    m_Shaders->setInt("ourTexture", 0);
+    m_Shaders->setInt("models", 1);
+    m_Shaders->setMat4("view", m_Camera.GetViewMatrix());
+    m_Shaders->setMat4("projection", glm::perspective(glm::radians(m_Camera.Zoom), (float)800 / (float)600, 0.1f, 100.0f));
+
+    // номер объекта, который получит шейдер, совпадает с порядком вызовов draw()
+    m_Batch->setIndirectEnabled(m_bIndirect);
+    m_Batch->begin();
+    for (size_t i = 0; i < objectMesh.size(); i++)
+        m_Batch->draw(objectMesh[i]);
+    m_Batch->submit();
+
+    if (currentFrame - lastReport > 1.0f) {
+        lastReport = currentFrame;
+        const MeshBatchStats& stats = m_Batch->getStats();
+        std::cout << (stats.indirect ? "indirect" : "base vertex loop")
+                  << ": commands " << stats.commands
+                  << ", draw API calls " << stats.apiCalls
+                  << ", frame " << deltaTime * 1000.0f << " ms" << std::endl;
+    }
+
+    base::gRender(auto_redraw);
+} // gRender
+
+void Scene::gFinalize() {
+    if (m_Batch)
+        delete m_Batch;
+    glDeleteBuffers(1, &TBO);
+    glDeleteTextures(1, &texture_models);
+    TextureManager::current().gRelease(texture_box);
+    if (m_Shaders)
+        delete m_Shaders;
+    TextureManager::current().gFinalize();
+    base::gFinalize();
+} // gFinalize
+
+void Scene::onKey(int key, int scancode, int action, int mods) {
+    if (key == GLFW_KEY_W && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(FORWARD, deltaTime);
+    else if (key == GLFW_KEY_S && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(BACKWARD, deltaTime);
+    else if (key == GLFW_KEY_A && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(LEFT, deltaTime);
+    else if (key == GLFW_KEY_D && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(RIGHT, deltaTime);
+    else if (key == GLFW_KEY_I && action == GLFW_PRESS)
+        m_bIndirect = !m_bIndirect;
+} // onKey
+
+//---------------------------------------------------------------------
+void Scene::onMouseMove(double xpos, double ypos) {
+    if (firstMouse)
+    {
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false;
+    }
+
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+
+    lastX = xpos;
+    lastY = ypos;
+
+    m_Camera.ProcessMouseMovement(xoffset, yoffset);
+} // mouse_callback
+
+void Scene::onMouseScroll(double xoffset, double yoffset) {
+    m_Camera.ProcessMouseScroll(yoffset);
+} // scroll_callback
@@ -0,0 +1,190 @@
+/*
+ * До сих пор вся геометрия была зашита в программу массивами вроде models::cube_vertices. Настоящие модели
+ * хранятся в файлах, и разбирать текстовый OBJ с миллионами треугольников при каждом запуске долго.
+ *
+ * Поэтому модели заранее переводятся утилитой tools/mesh-cooker в двоичный формат .mesh (см. include/mesh_file.h):
+ * заголовок с описанием атрибутов, габаритами и уровнями детализации, затем выровненные блоки вершин и индексов.
+ * Загрузчик MeshFile отображает файл в память через mmap и отдает блоки прямо в glBufferData.
+ *
+ * Пример загружает ../models/torus.mesh. Если файла нет, тор с двумя миллионами треугольников создается
+ * прямо здесь (models::make_torus) и записывается в этот файл. В консоль выводится время загрузки.
+ * Свой меш можно подготовить командой
+ *
+ *   bin/mesh-cooker --bench model.obj models/torus.mesh
+ */
+
+#include "application.h"
+#include "shader.h"
+#include "texture_manager.h"
+#include "camera.h"
+#include "mesh_file.h"
+#include "model_torus.h"
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <unistd.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+BEGIN_APP_DECLARATION(Scene)
+    virtual void gInit(const char* title = NULL);
+    virtual void gRender(bool auto_redraw = true);
+    virtual void gFinalize();
+    void onKey(int key, int scancode, int action, int mods);
+    void onMouseMove(double xpos, double ypos);
+    void onMouseScroll(double xoffset, double yoffset);
+    Scene()
+    : base(),
+    m_Shaders(nullptr)
+    {}
+protected:
+    Shader* m_Shaders;
+    MeshFile m_Mesh;
+    GLuint texture_box;
+END_APP_DECLARATION()
+
+DEFINE_APP(Scene, "Mesh file")
+
+#define SHADER_PATH_PREFIX    "../shaders"
+#define TEXTURE_PATH_PREFIX   "../textures"
+#define MESH_PATH_PREFIX      "../models"
+
+//----------------------------------------------------------------------------
+// Настройка камеры
+Camera m_Camera(glm::vec3(0.0f, 0.0f, 3.0f));
+bool firstMouse = true;
+float lastX =  800.0f / 2.0;
+float lastY =  600.0f / 2.0;
+
+// timing
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+//----------------------------------------------------------------------------
+
+// Записывает тор в файл .mesh (так же, как это делает mesh-cooker без обработки)
+static bool cookTorus(const char* path) {
+    std::vector<GLfloat> vertices;
+    MeshData mesh;
+    models::make_torus(1000, 1000, 1.0f, 0.3f, vertices, mesh.indices);
+    MeshAttribute position = { 0, 3, GL_FLOAT, GL_FALSE, 0 };
+    MeshAttribute normal   = { 1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat) };
+    MeshAttribute texCoord = { 2, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat) };
+    mesh.attributes.push_back(position);
+    mesh.attributes.push_back(normal);
+    mesh.attributes.push_back(texCoord);
+    mesh.vertexStride = 8 * sizeof(GLfloat);
+    mesh.vertices.resize(vertices.size() * sizeof(GLfloat));
+    memcpy(mesh.vertices.data(), vertices.data(), mesh.vertices.size());
+    mesh.computeBounds();
+    return writeMeshFile(path, mesh);
+} // cookTorus
+
+void Scene::gInit(const char* title) {
+    base::gInit(title);
+
+    glfwSetInputMode(m_pWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    if (!(m_Shaders = new Shader(SHADER_PATH_PREFIX"/3.3.shader09.vs.glsl",
+                                 SHADER_PATH_PREFIX"/3.3.shader05.fs.glsl"))) {
+        throw std::logic_error("something wrong with shaders");
+    }
+    //---------------------------
+    // Загрузка модели
+    //---------------------------
+    const char* path = MESH_PATH_PREFIX"/torus.mesh";
+    if (access(path, R_OK) != 0) {
+        std::cout << "Cooking " << path << std::endl;
+        if (!cookTorus(path)) {
+            throw std::logic_error("can't prepare the mesh file");
+        }
+    }
+    // время от открытия файла до готовых буферов на GPU
+    glFinish();
+    double start = glfwGetTime();
+    if (!m_Mesh.open(path)) {
+        throw std::logic_error("can't open the mesh file");
+    }
+    m_Mesh.upload();
+    glFinish();
+    double loadTime = glfwGetTime() - start;
+    size_t size = m_Mesh.fileSize();
+    const MeshFileHeader& header = m_Mesh.header();
+    std::cout << path << ": " << header.indexCount / 3 << " triangles, " << header.vertexCount << " vertices, "
+              << size / (1024 * 1024) << " MB, open + upload " << loadTime * 1000.0 << " ms ("
+              << size / (1024.0 * 1024.0) / loadTime << " MB/s)" << std::endl;
+    m_Mesh.close();     // данные уже на GPU
+
+    // камера отодвигается так, чтобы меш целиком попал в кадр
+    glm::vec3 lo = glm::make_vec3(header.boundsMin), hi = glm::make_vec3(header.boundsMax);
+    m_Camera.Position = (lo + hi) * 0.5f + glm::vec3(0.0f, 0.0f, glm::length(hi - lo) * 1.2f);
+    //---------------------------
+    // Загрузка текстуры
+    //---------------------------
+    texture_box = TextureManager::current().gAcquireAsync(TEXTURE_PATH_PREFIX"/box.jpg", TextureOptions(GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR));
+} // gInit
+
+void Scene::gRender(bool auto_redraw) {
+    float currentFrame = glfwGetTime();
+    deltaTime = currentFrame - lastFrame;
+    lastFrame = currentFrame;
+    //------------------------------------------------------------
+    TextureManager::current().gUpdate();        // текстуры догружаются в фоне
+    GLState::current().clearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    GLState::current().enable(GL_DEPTH_TEST);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    m_Shaders->use();
+    GLState::current().bindTextureUnit(0, GL_TEXTURE_2D, texture_box);
+    m_Shaders->setInt("ourTexture", 0);
+    glm::mat4 model = glm::rotate(glm::mat4(1.0f), currentFrame * 0.5f, glm::vec3(1.0f, 0.3f, 0.0f));
+    m_Shaders->setMat4("model", model);
+    m_Shaders->setMat4("view", m_Camera.GetViewMatrix());
+    m_Shaders->setMat4("projection", glm::perspective(glm::radians(m_Camera.Zoom), (float)800 / (float)600, 0.1f, 100.0f));
+    m_Mesh.draw();
+
+    base::gRender(auto_redraw);
+} // gRender
+
+void Scene::gFinalize() {
+    m_Mesh.release();
+    TextureManager::current().gRelease(texture_box);
+    if (m_Shaders)
+        delete m_Shaders;
+    TextureManager::current().gFinalize();
+    base::gFinalize();
+} // gFinalize
+
+void Scene::onKey(int key, int scancode, int action, int mods) {
+    if (key == GLFW_KEY_W && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(FORWARD, deltaTime);
+    else if (key == GLFW_KEY_S && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(BACKWARD, deltaTime);
+    else if (key == GLFW_KEY_A && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(LEFT, deltaTime);
+    else if (key == GLFW_KEY_D && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(RIGHT, deltaTime);
+} // onKey
+
+//---------------------------------------------------------------------
+void Scene::onMouseMove(double xpos, double ypos) {
+    if (firstMouse)
+    {
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false;
+    }
+
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+
+    lastX = xpos;
+    lastY = ypos;
+
+    m_Camera.ProcessMouseMovement(xoffset, yoffset);
+} // mouse_callback
+
+void Scene::onMouseScroll(double xoffset, double yoffset) {
+    m_Camera.ProcessMouseScroll(yoffset);
+} // scroll_callback
@@ -0,0 +1,260 @@
+/*
+ * Уровни детализации (LOD). Далекий объект занимает на экране несколько пикселей, но рисуется
+ * всеми своими треугольниками. Утилита mesh-cooker с ключом --lods строит для меша цепочку
+ * упрощенных копий (см. include/mesh_simplify.h) и записывает их диапазонами в общий буфер
+ * индексов файла .mesh. Во время отрисовки для каждого объекта выбирается самый грубый уровень,
+ * ошибка которого на экране не больше пикселя (см. include/lod_selector.h).
+ *
+ * Пример рисует поле из 16 x 64 торов, уходящее вдаль. Если ../models/torus_lod.mesh нет,
+ * он создается при запуске. Раз в секунду в консоль выводится, сколько треугольников
+ * нарисовано и сколько было бы без LOD.
+ *
+ * Клавиши:
+ *   L - включить/выключить выбор уровней (без него все рисуется уровнем 0);
+ *   F - включить/выключить плавный переход между уровнями (дизеринг, шейдер 3.3.shader12.fs.glsl).
+ */
+
+#include "application.h"
+#include "shader.h"
+#include "texture_manager.h"
+#include "camera.h"
+#include "mesh_file.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplify.h"
+#include "lod_selector.h"
+#include "model_torus.h"
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <unistd.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#define FIELD_WIDTH     16
+#define FIELD_DEPTH     64
+#define FIELD_SPACING   4.0f
+#define FADE_TIME       0.3f
+
+BEGIN_APP_DECLARATION(Scene)
+    virtual void gInit(const char* title = NULL);
+    virtual void gRender(bool auto_redraw = true);
+    virtual void gFinalize();
+    void onKey(int key, int scancode, int action, int mods);
+    void onMouseMove(double xpos, double ypos);
+    void onMouseScroll(double xoffset, double yoffset);
+    Scene()
+    : base(),
+    m_Shaders(nullptr),
+    m_Selector(1.0f, 0.25f, FADE_TIME),
+    m_bUseLods(true),
+    m_TrianglesDrawn(0),
+    m_TrianglesFull(0),
+    m_LastReport(0.0)
+    {}
+protected:
+    Shader* m_Shaders;
+    MeshFile m_Mesh;
+    LodSelector m_Selector;
+    std::vector<LodState> m_States;
+    std::vector<glm::vec3> m_Positions;
+    GLfloat m_MeshSize;
+    bool m_bUseLods;
+    size_t m_TrianglesDrawn;
+    size_t m_TrianglesFull;
+    double m_LastReport;
+    GLuint texture_box;
+
+    void drawLod(GLuint lod, GLfloat from, GLfloat to);
+END_APP_DECLARATION()
+
+DEFINE_APP(Scene, "Mesh LOD")
+
+#define SHADER_PATH_PREFIX    "../shaders"
+#define TEXTURE_PATH_PREFIX   "../textures"
+#define MESH_PATH_PREFIX      "../models"
+
+//----------------------------------------------------------------------------
+// Настройка камеры
+Camera m_Camera(glm::vec3(0.0f, 3.0f, 6.0f));
+bool firstMouse = true;
+float lastX =  800.0f / 2.0;
+float lastY =  600.0f / 2.0;
+
+// timing
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+//----------------------------------------------------------------------------
+
+// Записывает тор с цепочкой LOD в файл .mesh (так же, как mesh-cooker --lods 8)
+static bool cookTorus(const char* path) {
+    std::vector<GLfloat> vertices;
+    MeshData mesh;
+    models::make_torus(400, 400, 1.0f, 0.3f, vertices, mesh.indices);
+    MeshAttribute position = { 0, 3, GL_FLOAT, GL_FALSE, 0 };
+    MeshAttribute normal   = { 1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat) };
+    MeshAttribute texCoord = { 2, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat) };
+    mesh.attributes.push_back(position);
+    mesh.attributes.push_back(normal);
+    mesh.attributes.push_back(texCoord);
+    mesh.vertexStride = 8 * sizeof(GLfloat);
+    mesh.vertices.resize(vertices.size() * sizeof(GLfloat));
+    memcpy(mesh.vertices.data(), vertices.data(), mesh.vertices.size());
+    meshopt::optimizeMesh(mesh.vertices, mesh.vertexStride, mesh.indices);
+    size_t levels = meshopt::generateLods(mesh);
+    for (size_t i = 0; i < levels; i++) {
+        std::cout << "  LOD " << i << ": " << mesh.lods[i].indexCount / 3 << " triangles, error "
+                  << mesh.lods[i].error << std::endl;
+    }
+    mesh.computeBounds();
+    return writeMeshFile(path, mesh);
+} // cookTorus
+
+void Scene::gInit(const char* title) {
+    base::gInit(title);
+
+    glfwSetInputMode(m_pWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    if (!(m_Shaders = new Shader(SHADER_PATH_PREFIX"/3.3.shader09.vs.glsl",
+                                 SHADER_PATH_PREFIX"/3.3.shader12.fs.glsl"))) {
+        throw std::logic_error("something wrong with shaders");
+    }
+    //---------------------------
+    // Загрузка модели
+    //---------------------------
+    const char* path = MESH_PATH_PREFIX"/torus_lod.mesh";
+    if (access(path, R_OK) != 0) {
+        std::cout << "Cooking " << path << std::endl;
+        if (!cookTorus(path)) {
+            throw std::logic_error("can't prepare the mesh file");
+        }
+    }
+    if (!m_Mesh.open(path)) {
+        throw std::logic_error("can't open the mesh file");
+    }
+    m_Mesh.upload();
+    m_Mesh.close();     // заголовок с уровнями остается в m_Mesh
+
+    const MeshFileHeader& header = m_Mesh.header();
+    glm::vec3 lo = glm::make_vec3(header.boundsMin), hi = glm::make_vec3(header.boundsMax);
+    m_MeshSize = glm::length(hi - lo);
+    for (GLuint i = 0; i < header.lodCount; i++) {
+        std::cout << "LOD " << i << ": " << header.lods[i].indexCount / 3 << " triangles" << std::endl;
+    }
+
+    // поле торов перед камерой
+    for (int z = 0; z < FIELD_DEPTH; z++) {
+        for (int x = 0; x < FIELD_WIDTH; x++) {
+            m_Positions.push_back(glm::vec3((x - FIELD_WIDTH / 2) * FIELD_SPACING, 0.0f, -z * FIELD_SPACING));
+        }
+    }
+    m_States.resize(m_Positions.size());
+    //---------------------------
+    // Загрузка текстуры
+    //---------------------------
+    texture_box = TextureManager::current().gAcquireAsync(TEXTURE_PATH_PREFIX"/box.jpg", TextureOptions(GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR));
+} // gInit
+
+// рисует уровень lod, оставляя пиксели с порогом дизеринга в [from, to)
+void Scene::drawLod(GLuint lod, GLfloat from, GLfloat to) {
+    m_Shaders->setVec2("lodDither", from, to);
+    m_Mesh.draw(lod);
+    m_TrianglesDrawn += m_Mesh.header().lods[lod].indexCount / 3;
+}
+
+void Scene::gRender(bool auto_redraw) {
+    float currentFrame = glfwGetTime();
+    deltaTime = currentFrame - lastFrame;
+    lastFrame = currentFrame;
+    //------------------------------------------------------------
+    TextureManager::current().gUpdate();        // текстуры догружаются в фоне
+    GLState::current().clearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    GLState::current().enable(GL_DEPTH_TEST);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    m_Shaders->use();
+    GLState::current().bindTextureUnit(0, GL_TEXTURE_2D, texture_box);
+    m_Shaders->setInt("ourTexture", 0);
+    m_Shaders->setMat4("view", m_Camera.GetViewMatrix());
+    m_Shaders->setMat4("projection", glm::perspective(glm::radians(m_Camera.Zoom), (float)800 / (float)600, 0.1f, 500.0f));
+    m_Selector.setViewport(600.0f, glm::radians(m_Camera.Zoom));
+
+    const MeshFileHeader& header = m_Mesh.header();
+    for (size_t i = 0; i < m_Positions.size(); i++) {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), m_Positions[i]);
+        model = glm::rotate(model, currentFrame * 0.5f + i, glm::vec3(1.0f, 0.3f, 0.0f));
+        m_Shaders->setMat4("model", model);
+        m_TrianglesFull += header.lods[0].indexCount / 3;
+        if (!m_bUseLods) {
+            drawLod(0, 0.0f, 1.0f);
+            continue;
+        }
+        LodState& state = m_States[i];
+        GLfloat distance = glm::length(m_Positions[i] - m_Camera.Position);
+        m_Selector.select(state, header.lods, header.lodCount, m_MeshSize, distance, deltaTime);
+        if (state.isFading()) {
+            drawLod(state.lod, 0.0f, state.fade);
+            drawLod(state.previousLod, state.fade, 1.0f);
+        }
+        else {
+            drawLod(state.lod, 0.0f, 1.0f);
+        }
+    }
+
+    if (currentFrame - m_LastReport >= 1.0) {
+        std::cout << "triangles: " << m_TrianglesDrawn << " of " << m_TrianglesFull << " ("
+                  << 100.0 * m_TrianglesDrawn / m_TrianglesFull << "%), LOD " << (m_bUseLods ? "on" : "off")
+                  << ", fade " << (m_Selector.getFadeTime() > 0.0f ? "on" : "off") << std::endl;
+        m_LastReport = currentFrame;
+    }
+    m_TrianglesDrawn = m_TrianglesFull = 0;
+
+    base::gRender(auto_redraw);
+} // gRender
+
+void Scene::gFinalize() {
+    m_Mesh.release();
+    TextureManager::current().gRelease(texture_box);
+    if (m_Shaders)
+        delete m_Shaders;
+    TextureManager::current().gFinalize();
+    base::gFinalize();
+} // gFinalize
+
+void Scene::onKey(int key, int scancode, int action, int mods) {
+    if (key == GLFW_KEY_W && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(FORWARD, deltaTime);
+    else if (key == GLFW_KEY_S && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(BACKWARD, deltaTime);
+    else if (key == GLFW_KEY_A && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(LEFT, deltaTime);
+    else if (key == GLFW_KEY_D && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(RIGHT, deltaTime);
+    else if (key == GLFW_KEY_L && action == GLFW_PRESS)
+        m_bUseLods = !m_bUseLods;
+    else if (key == GLFW_KEY_F && action == GLFW_PRESS)
+        m_Selector.setFadeTime(m_Selector.getFadeTime() > 0.0f ? 0.0f : FADE_TIME);
+} // onKey
+
+//---------------------------------------------------------------------
+void Scene::onMouseMove(double xpos, double ypos) {
+    if (firstMouse)
+    {
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false;
+    }
+
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+
+    lastX = xpos;
+    lastY = ypos;
+
+    m_Camera.ProcessMouseMovement(xoffset, yoffset);
+} // mouse_callback
+
+void Scene::onMouseScroll(double xoffset, double yoffset) {
+    m_Camera.ProcessMouseScroll(yoffset);
+} // scroll_callback
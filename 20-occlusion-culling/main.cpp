@@ -0,0 +1,230 @@
+/*
+ * Отсечение невидимых объектов на CPU (occlusion culling). За стенами стоит поле из 1600 ящиков.
+ * Видеокарта отбросила бы их пиксели тестом глубины, но вершины и вызовы glDrawElements для всех
+ * ящиков все равно бы обработала.
+ *
+ * Каждый кадр стены рисуются программным растеризатором OcclusionCuller (см. include/occlusion_culler.h)
+ * в буфер глубины 256 x 128, и по нему проверяются габариты ящиков. Рисуются только те ящики, которые
+ * могут быть видны. Раз в секунду в консоль выводится, сколько ящиков нарисовано и сколько времени
+ * ушло на растеризацию и проверку.
+ *
+ * Клавиши: O - включить/выключить отсечение.
+ */
+
+#include "application.h"
+#include "shader.h"
+#include "texture_manager.h"
+#include "model_cube.h"
+#include "vertex_layout.h"
+#include "camera.h"
+#include "occlusion_culler.h"
+
+#include <iostream>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#define FIELD_SIZE  40
+
+// позиция - три числа GLfloat, текстурные координаты - два
+typedef VertexLayout< VertexAttr<0, vfmt::Float3>, VertexAttr<2, vfmt::Float2> > CubeLayout;
+
+BEGIN_APP_DECLARATION(Scene)
+    virtual void gInit(const char* title = NULL);
+    virtual void gRender(bool auto_redraw = true);
+    virtual void gFinalize();
+    void onKey(int key, int scancode, int action, int mods);
+    void onMouseMove(double xpos, double ypos);
+    void onMouseScroll(double xoffset, double yoffset);
+    Scene()
+    : base(),
+    m_Shaders(nullptr),
+    m_bCulling(true),
+    m_Frames(0),
+    m_Drawn(0),
+    m_CullMs(0.0),
+    m_LastReport(0.0)
+    {}
+protected:
+    Shader* m_Shaders;
+    GLuint VBO, EBO, VAO;
+    GLuint texture_box;
+    OcclusionCuller m_Culler;
+    std::vector<glm::mat4> m_Walls;
+    std::vector<glm::vec3> m_Boxes;
+    std::vector<GLfloat> m_Bounds;          // габариты ящиков для проверки
+    std::vector<unsigned char> m_Visible;
+    bool m_bCulling;
+    size_t m_Frames;
+    size_t m_Drawn;
+    double m_CullMs;
+    double m_LastReport;
+END_APP_DECLARATION()
+
+DEFINE_APP(Scene, "Occlusion culling")
+
+#define SHADER_PATH_PREFIX    "../shaders"
+#define TEXTURE_PATH_PREFIX   "../textures"
+
+//----------------------------------------------------------------------------
+// Настройка камеры
+Camera m_Camera(glm::vec3(0.0f, 1.5f, 8.0f));
+bool firstMouse = true;
+float lastX =  800.0f / 2.0;
+float lastY =  600.0f / 2.0;
+
+// timing
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+//----------------------------------------------------------------------------
+
+void Scene::gInit(const char* title) {
+    base::gInit(title);
+
+    glfwSetInputMode(m_pWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    if (!(m_Shaders = new Shader(SHADER_PATH_PREFIX"/3.3.shader09.vs.glsl",
+                                 SHADER_PATH_PREFIX"/3.3.shader05.fs.glsl"))) {
+        throw std::logic_error("something wrong with shaders");
+    }
+    //---------------------------
+    // Загрузка модели
+    //---------------------------
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(models::cube_indexed_vertices), models::cube_indexed_vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(models::cube_indices), models::cube_indices, GL_STATIC_DRAW);
+    CubeLayout::setup();
+    glBindVertexArray(0);
+
+    //---------------------------
+    // Сцена: три стены с проходами между ними и поле ящиков за ними
+    //---------------------------
+    for (int i = -1; i <= 1; i++) {
+        glm::mat4 wall = glm::translate(glm::mat4(1.0f), glm::vec3(i * 14.0f, 2.0f, 0.0f));
+        m_Walls.push_back(glm::scale(wall, glm::vec3(12.0f, 6.0f, 0.5f)));
+    }
+    for (int z = 0; z < FIELD_SIZE; z++) {
+        for (int x = 0; x < FIELD_SIZE; x++) {
+            glm::vec3 p((x - FIELD_SIZE / 2) * 2.0f, 0.0f, -4.0f - z * 2.0f);
+            m_Boxes.push_back(p);
+            // ящик поворачивается, поэтому габариты берутся с запасом: половина диагонали куба
+            GLfloat box[6] = { p.x - 0.87f, p.y - 0.87f, p.z - 0.87f, p.x + 0.87f, p.y + 0.87f, p.z + 0.87f };
+            m_Bounds.insert(m_Bounds.end(), box, box + 6);
+        }
+    }
+    m_Visible.assign(m_Boxes.size(), 1);
+    //---------------------------
+    // Загрузка текстуры
+    //---------------------------
+    texture_box = TextureManager::current().gAcquireAsync(TEXTURE_PATH_PREFIX"/box.jpg", TextureOptions(GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR));
+} // gInit
+
+void Scene::gRender(bool auto_redraw) {
+    float currentFrame = glfwGetTime();
+    deltaTime = currentFrame - lastFrame;
+    lastFrame = currentFrame;
+    //------------------------------------------------------------
+    TextureManager::current().gUpdate();        // текстуры догружаются в фоне
+    GLState::current().clearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    GLState::current().enable(GL_DEPTH_TEST);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glm::mat4 view = m_Camera.GetViewMatrix();
+    glm::mat4 projection = glm::perspective(glm::radians(m_Camera.Zoom), (float)800 / (float)600, 0.1f, 100.0f);
+
+    // видимость ящиков по стенам
+    if (m_bCulling) {
+        m_Culler.beginFrame(projection * view);
+        for (size_t i = 0; i < m_Walls.size(); i++) {
+            m_Culler.addOccluder(models::cube_indexed_vertices, 5 * sizeof(GLfloat), models::cube_indices,
+                                 models::cube_index_count, m_Walls[i]);
+        }
+        m_Culler.rasterize();
+        m_Culler.testBoxes(m_Bounds.data(), m_Boxes.size(), m_Visible.data());
+        m_CullMs += m_Culler.getStats().rasterizeMs + m_Culler.getStats().testMs;
+    }
+
+    m_Shaders->use();
+    GLState::current().bindTextureUnit(0, GL_TEXTURE_2D, texture_box);
+    m_Shaders->setInt("ourTexture", 0);
+    m_Shaders->setMat4("view", view);
+    m_Shaders->setMat4("projection", projection);
+    GLState::current().bindVertexArray(VAO);
+    for (size_t i = 0; i < m_Walls.size(); i++) {
+        m_Shaders->setMat4("model", m_Walls[i]);
+        glDrawElements(GL_TRIANGLES, models::cube_index_count, GL_UNSIGNED_INT, 0);
+    }
+    for (size_t i = 0; i < m_Boxes.size(); i++) {
+        if (m_bCulling && !m_Visible[i])
+            continue;
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), m_Boxes[i]);
+        model = glm::rotate(model, currentFrame + i, glm::vec3(0.3f, 1.0f, 0.5f));
+        m_Shaders->setMat4("model", model);
+        glDrawElements(GL_TRIANGLES, models::cube_index_count, GL_UNSIGNED_INT, 0);
+        m_Drawn++;
+    }
+
+    m_Frames++;
+    if (currentFrame - m_LastReport >= 1.0) {
+        std::cout << "boxes drawn: " << m_Drawn / m_Frames << " of " << m_Boxes.size()
+                  << ", culling " << (m_bCulling ? "on" : "off") << ", " << m_CullMs / m_Frames
+                  << " ms/frame on CPU (" << (OcclusionCuller::hasAvx2() ? "AVX2" : "scalar") << ")" << std::endl;
+        m_LastReport = currentFrame;
+        m_Frames = m_Drawn = 0;
+        m_CullMs = 0.0;
+    }
+
+    base::gRender(auto_redraw);
+} // gRender
+
+void Scene::gFinalize() {
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    TextureManager::current().gRelease(texture_box);
+    if (m_Shaders)
+        delete m_Shaders;
+    TextureManager::current().gFinalize();
+    base::gFinalize();
+} // gFinalize
+
+void Scene::onKey(int key, int scancode, int action, int mods) {
+    if (key == GLFW_KEY_W && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(FORWARD, deltaTime);
+    else if (key == GLFW_KEY_S && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(BACKWARD, deltaTime);
+    else if (key == GLFW_KEY_A && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(LEFT, deltaTime);
+    else if (key == GLFW_KEY_D && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(RIGHT, deltaTime);
+    else if (key == GLFW_KEY_O && action == GLFW_PRESS)
+        m_bCulling = !m_bCulling;
+} // onKey
+
+//---------------------------------------------------------------------
+void Scene::onMouseMove(double xpos, double ypos) {
+    if (firstMouse)
+    {
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false;
+    }
+
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+
+    lastX = xpos;
+    lastY = ypos;
+
+    m_Camera.ProcessMouseMovement(xoffset, yoffset);
+} // mouse_callback
+
+void Scene::onMouseScroll(double xoffset, double yoffset) {
+    m_Camera.ProcessMouseScroll(yoffset);
+} // scroll_callback
@@ -0,0 +1,225 @@
+/*
+ * Динамическое разрешение. Поле ящиков рисуется нарочно тяжелым фрагментным шейдером, и время
+ * кадра растет с числом пикселей. DynamicResolution (см. include/dynamic_resolution.h) измеряет
+ * время GPU и уменьшает разрешение, в котором рисуется сцена, пока кадр не уложится в бюджет
+ * 16 мс; затем кадр растягивается на окно. Буфер кадра берется из пула RenderTargetPool
+ * (см. include/render_target_pool.h), который откладывает пересоздание буферов, пока тянут
+ * рамку окна. Раз в секунду в консоль выводится масштаб, размер кадра и время GPU, а при
+ * выходе - наибольший объем памяти под буферы кадра.
+ *
+ * Клавиши: R - включить/выключить подстройку, U - билинейное растяжение или с повышением
+ * резкости, стрелки вверх/вниз - сложность шейдера.
+ */
+
+#include "application.h"
+#include "shader.h"
+#include "texture_manager.h"
+#include "model_cube.h"
+#include "vertex_layout.h"
+#include "camera.h"
+#include "dynamic_resolution.h"
+#include "render_target_pool.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#define FIELD_SIZE      12
+#define FRAME_BUDGET    16.0f   // мс
+
+// позиция - три числа GLfloat, текстурные координаты - два
+typedef VertexLayout< VertexAttr<0, vfmt::Float3>, VertexAttr<2, vfmt::Float2> > CubeLayout;
+
+BEGIN_APP_DECLARATION(Scene)
+    virtual void gInit(const char* title = NULL);
+    virtual void gRender(bool auto_redraw = true);
+    virtual void gFinalize();
+    virtual void gResize(int width, int height);
+    void onKey(int key, int scancode, int action, int mods);
+    void onMouseMove(double xpos, double ypos);
+    void onMouseScroll(double xoffset, double yoffset);
+    Scene()
+    : base(),
+    m_Shaders(nullptr),
+    m_Resolution(FRAME_BUDGET, 0.5f, 1.0f),
+    m_Workload(64),
+    m_Frames(0),
+    m_LastReport(0.0)
+    {}
+protected:
+    Shader* m_Shaders;
+    GLuint VBO, EBO, VAO;
+    GLuint texture_box;
+    RenderTargetPool m_Targets;
+    DynamicResolution m_Resolution;
+    std::vector<glm::vec3> m_Boxes;
+    int m_Workload;
+    size_t m_Frames;
+    double m_LastReport;
+END_APP_DECLARATION()
+
+DEFINE_APP(Scene, "Dynamic resolution")
+
+#define SHADER_PATH_PREFIX    "../shaders"
+#define TEXTURE_PATH_PREFIX   "../textures"
+
+//----------------------------------------------------------------------------
+// Настройка камеры
+Camera m_Camera(glm::vec3(0.0f, 2.0f, 6.0f));
+bool firstMouse = true;
+float lastX =  800.0f / 2.0;
+float lastY =  600.0f / 2.0;
+
+// timing
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+//----------------------------------------------------------------------------
+
+void Scene::gInit(const char* title) {
+    base::gInit(title);
+
+    glfwSetInputMode(m_pWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    if (!(m_Shaders = new Shader(SHADER_PATH_PREFIX"/3.3.shader09.vs.glsl",
+                                 SHADER_PATH_PREFIX"/3.3.shader14.fs.glsl"))) {
+        throw std::logic_error("something wrong with shaders");
+    }
+    m_Resolution.gInit(SHADER_PATH_PREFIX, m_Targets);
+    //---------------------------
+    // Загрузка модели
+    //---------------------------
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(models::cube_indexed_vertices), models::cube_indexed_vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(models::cube_indices), models::cube_indices, GL_STATIC_DRAW);
+    CubeLayout::setup();
+    glBindVertexArray(0);
+
+    for (int z = 0; z < FIELD_SIZE; z++) {
+        for (int x = 0; x < FIELD_SIZE; x++)
+            m_Boxes.push_back(glm::vec3((x - FIELD_SIZE / 2) * 1.5f, 0.0f, -z * 1.5f));
+    }
+    //---------------------------
+    // Загрузка текстуры
+    //---------------------------
+    texture_box = TextureManager::current().gAcquireAsync(TEXTURE_PATH_PREFIX"/box.jpg", TextureOptions(GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR));
+} // gInit
+
+void Scene::gResize(int width, int height) {
+    base::gResize(width, height);
+    m_Targets.gResize(width, height);
+    m_Resolution.gResize(width, height);
+} // gResize
+
+void Scene::gRender(bool auto_redraw) {
+    float currentFrame = glfwGetTime();
+    deltaTime = currentFrame - lastFrame;
+    lastFrame = currentFrame;
+    //------------------------------------------------------------
+    TextureManager::current().gUpdate();        // текстуры догружаются в фоне
+    m_Targets.gBeginFrame();
+    m_Resolution.gBeginFrame();
+    GLState::current().clearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    GLState::current().enable(GL_DEPTH_TEST);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glm::mat4 view = m_Camera.GetViewMatrix();
+    glm::mat4 projection = glm::perspective(glm::radians(m_Camera.Zoom),
+                                            (float)getWindowWidth() / (float)getWindowHeight(), 0.1f, 100.0f);
+
+    m_Shaders->use();
+    GLState::current().bindTextureUnit(0, GL_TEXTURE_2D, texture_box);
+    m_Shaders->setInt("ourTexture", 0);
+    m_Shaders->setInt("workload", m_Workload);
+    m_Shaders->setMat4("view", view);
+    m_Shaders->setMat4("projection", projection);
+    GLState::current().bindVertexArray(VAO);
+    for (size_t i = 0; i < m_Boxes.size(); i++) {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), m_Boxes[i]);
+        model = glm::rotate(model, currentFrame + i, glm::vec3(0.3f, 1.0f, 0.5f));
+        m_Shaders->setMat4("model", model);
+        glDrawElements(GL_TRIANGLES, models::cube_index_count, GL_UNSIGNED_INT, 0);
+    }
+    m_Resolution.gEndFrame();
+    m_Targets.gEndFrame();
+
+    m_Frames++;
+    if (currentFrame - m_LastReport >= 1.0) {
+        std::cout << m_Frames << " fps, scale " << m_Resolution.getController().getScale()
+                  << " (" << m_Resolution.getRenderWidth() << "x" << m_Resolution.getRenderHeight() << ")"
+                  << ", GPU " << m_Resolution.getGpuMs() << " ms, smoothed "
+                  << m_Resolution.getController().getSmoothedMs() << " ms, workload " << m_Workload
+                  << (m_Resolution.isEnabled() ? "" : ", scaling off")
+                  << (m_Resolution.getUpscale() == DynamicResolution::SHARPEN ? ", sharpen" : ", bilinear")
+                  << std::endl;
+        m_LastReport = currentFrame;
+        m_Frames = 0;
+    }
+
+    base::gRender(auto_redraw);
+} // gRender
+
+void Scene::gFinalize() {
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    TextureManager::current().gRelease(texture_box);
+    m_Resolution.gFinalize();
+    std::cout << "render targets: " << m_Targets.getStats().allocations << " allocated, "
+              << m_Targets.getStats().reuses << " reused, peak "
+              << m_Targets.getStats().peakBytes / (1024.0 * 1024.0) << " MB" << std::endl;
+    m_Targets.gFinalize();
+    if (m_Shaders)
+        delete m_Shaders;
+    TextureManager::current().gFinalize();
+    base::gFinalize();
+} // gFinalize
+
+void Scene::onKey(int key, int scancode, int action, int mods) {
+    if (key == GLFW_KEY_W && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(FORWARD, deltaTime);
+    else if (key == GLFW_KEY_S && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(BACKWARD, deltaTime);
+    else if (key == GLFW_KEY_A && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(LEFT, deltaTime);
+    else if (key == GLFW_KEY_D && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(RIGHT, deltaTime);
+    else if (key == GLFW_KEY_R && action == GLFW_PRESS)
+        m_Resolution.setEnabled(!m_Resolution.isEnabled());
+    else if (key == GLFW_KEY_U && action == GLFW_PRESS)
+        m_Resolution.setUpscale(m_Resolution.getUpscale() == DynamicResolution::BILINEAR ?
+                                DynamicResolution::SHARPEN : DynamicResolution::BILINEAR);
+    else if (key == GLFW_KEY_UP && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Workload = std::min(m_Workload * 2, 4096);
+    else if (key == GLFW_KEY_DOWN && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Workload = std::max(m_Workload / 2, 1);
+} // onKey
+
+//---------------------------------------------------------------------
+void Scene::onMouseMove(double xpos, double ypos) {
+    if (firstMouse)
+    {
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false;
+    }
+
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+
+    lastX = xpos;
+    lastY = ypos;
+
+    m_Camera.ProcessMouseMovement(xoffset, yoffset);
+} // mouse_callback
+
+void Scene::onMouseScroll(double xoffset, double yoffset) {
+    m_Camera.ProcessMouseScroll(yoffset);
+} // scroll_callback
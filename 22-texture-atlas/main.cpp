@@ -0,0 +1,272 @@
+/*
+ * В этом примере ящики обтянуты четырьмя разными изображениями. Даже с очередью отрисовки (пример 15-render-queue)
+ * текстура переключается при каждой смене изображения, а ящики с разными изображениями нельзя рисовать вперемешку
+ * от ближних к дальним. TexturePacker (см. include/texture_packer.h) собирает изображения в одну текстуру -
+ * массив текстур (GL_TEXTURE_2D_ARRAY) или атлас с рамками вокруг изображений, - и тогда все ящики рисуются с одной
+ * привязкой, а изображение выбирает uniform-переменная: номер слоя или прямоугольник в атласе.
+ *
+ * Нажмите T, чтобы переключаться между отдельными текстурами, массивом и атласом; в консоль печатается количество
+ * смен текстур за кадр и время кадра.
+ */
+
+#include "application.h"
+#include "shader.h"
+#include "texture_manager.h"
+#include "texture_packer.h"
+#include "model_cube.h"
+#include "vertex_layout.h"
+#include "camera.h"
+#include "render_queue.h"
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+typedef VertexLayout< VertexAttr<0, vfmt::Half3>, VertexAttr<2, vfmt::UNorm16x2> > CubeLayout;
+
+#define CUBES_COUNT     4000
+#define IMAGES_COUNT    4
+
+enum TextureMode {
+    SEPARATE,           // по текстуре на изображение
+    ARRAY,              // слои одного массива
+    ATLAS               // прямоугольники одного атласа
+};
+
+static const char* modeNames[] = { "separate textures", "texture array", "texture atlas" };
+
+BEGIN_APP_DECLARATION(Cube)
+    virtual void gInit(const char* title = NULL);
+    virtual void gRender(bool auto_redraw = true);
+    virtual void gFinalize();
+    void onKey(int key, int scancode, int action, int mods);
+    void onMouseMove(double xpos, double ypos);
+    void onMouseScroll(double xoffset, double yoffset);
+    Cube()
+    : base(),
+    m_Array(TexturePacker::ARRAY),
+    m_Atlas(TexturePacker::ATLAS),
+    m_Mode(ARRAY)
+    {
+        m_Shaders[0] = m_Shaders[1] = m_Shaders[2] = nullptr;
+    }
+protected:
+    Shader* m_Shaders[3];               // по программе на режим
+    GLuint VBO, EBO, VAO;
+    GLuint textures[IMAGES_COUNT];
+    int regions[IMAGES_COUNT];          // номера изображений в m_Array и m_Atlas
+    TexturePacker m_Array;
+    TexturePacker m_Atlas;
+    RenderQueue m_Queue;
+    TextureMode m_Mode;
+END_APP_DECLARATION()
+
+DEFINE_APP(Cube, "Texture array and atlas")
+
+#define SHADER_PATH_PREFIX    "../shaders"
+#define TEXTURE_PATH_PREFIX   "../textures"
+
+static const char* images[IMAGES_COUNT] = {
+    TEXTURE_PATH_PREFIX"/box.jpg",
+    TEXTURE_PATH_PREFIX"/wood.jpg",
+    TEXTURE_PATH_PREFIX"/wall.jpg",
+    TEXTURE_PATH_PREFIX"/attention_label.jpg"
+};
+
+//----------------------------------------------------------------------------
+// Настройка камеры
+Camera m_Camera(glm::vec3(0.0f, 0.0f, 3.0f));
+bool firstMouse = true;
+float lastX =  800.0f / 2.0;
+float lastY =  600.0f / 2.0;
+
+// timing
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastReport = 0.0f;
+
+struct SceneObject {
+    glm::mat4 model;
+    int       image;
+};
+std::vector<SceneObject> objects;
+//----------------------------------------------------------------------------
+
+void Cube::gInit(const char* title) {
+    base::gInit(title);
+
+    glfwSetInputMode(m_pWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    const char* fragmentShaders[3] = {
+        SHADER_PATH_PREFIX"/3.3.shader05.fs.glsl",
+        SHADER_PATH_PREFIX"/3.3.shader15.fs.glsl",
+        SHADER_PATH_PREFIX"/3.3.shader16.fs.glsl"
+    };
+    for (int i = 0; i < 3; i++) {
+        if (!(m_Shaders[i] = new Shader(SHADER_PATH_PREFIX"/3.3.shader09.vs.glsl", fragmentShaders[i]))) {
+            throw std::logic_error("something wrong with shaders");
+        }
+    }
+    //---------------------------
+    // Загрузка модели
+    //---------------------------
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    std::vector<unsigned char> cube;
+    CubeLayout::pack(models::cube_indexed_vertices, models::cube_vertex_count, cube);
+    glBufferData(GL_ARRAY_BUFFER, cube.size(), cube.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(models::cube_indices), models::cube_indices, GL_STATIC_DRAW);
+
+    CubeLayout::setup();
+
+    glBindVertexArray(0);
+    //---------------------------
+    // Загрузка текстур: отдельные, массив и атлас из одних и тех же изображений
+    //---------------------------
+    for (int i = 0; i < IMAGES_COUNT; i++) {
+        textures[i] = TextureManager::current().gAcquire(images[i], TextureOptions(GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR));
+        regions[i] = m_Array.add(images[i]);
+        m_Atlas.add(images[i]);
+    }
+    m_Array.gBuild();
+    m_Atlas.gBuild();
+    const TexturePackerStats& array = m_Array.getStats();
+    const TexturePackerStats& atlas = m_Atlas.getStats();
+    std::cout << "array: " << array.layers << " layers " << array.width << " x " << array.height
+              << ", " << array.bytes / 1024 << " KB" << std::endl;
+    std::cout << "atlas: " << atlas.width << " x " << atlas.height << ", " << atlas.bytes / 1024 << " KB, "
+              << atlas.occupancy * 100.0f << "% occupied" << std::endl;
+    //---------------------------
+    // Сцена: ящики вперемешку с разными изображениями
+    //---------------------------
+    srand(42);
+    objects.resize(CUBES_COUNT);
+    for (size_t i = 0; i < objects.size(); i++) {
+        glm::vec3 position((rand() % 200 - 100) * 0.25f,
+                           (rand() % 200 - 100) * 0.25f,
+                           -(rand() % 400) * 0.25f);
+        objects[i].model = glm::translate(glm::mat4(1.0f), position);
+        objects[i].model = glm::rotate(objects[i].model, glm::radians(20.0f * i), glm::vec3(0.3f, 1.0f, 0.5f));
+        objects[i].image = rand() % IMAGES_COUNT;
+    }
+} // gInit
+
+void Cube::gRender(bool auto_redraw) {
+    float currentFrame = glfwGetTime();
+    deltaTime = currentFrame - lastFrame;
+    lastFrame = currentFrame;
+    //------------------------------------------------------------
+    GLState::current().clearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    GLState::current().enable(GL_DEPTH_TEST);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glm::mat4 view = m_Camera.GetViewMatrix();
+    glm::mat4 projection = glm::perspective(glm::radians(m_Camera.Zoom), (float)800 / (float)600, 0.1f, 100.0f);
+    Shader* shader = m_Shaders[m_Mode];
+    shader->use();
+    shader->setInt(m_Mode == SEPARATE ? "ourTexture" : (m_Mode == ARRAY ? "ourTextures" : "atlas"), 0);
+    shader->setMat4("view", view);
+    shader->setMat4("projection", projection);
+    GLint modelLoc = glGetUniformLocation(shader->ID, "model");
+    GLint layerLoc = glGetUniformLocation(shader->ID, "layer");
+    GLint regionLoc = glGetUniformLocation(shader->ID, "region");
+
+    m_Queue.begin(0.1f, 100.0f);
+    for (size_t i = 0; i < objects.size(); i++) {
+        DrawPacket packet;
+        packet.program = shader->ID;
+        packet.vao = VAO;
+        packet.count = models::cube_index_count;
+        packet.indexType = GL_UNSIGNED_INT;
+        packet.depth = -(view * objects[i].model[3]).z;
+        UniformValue uniforms[2];
+        uniforms[0] = UniformValue::mat4(modelLoc, glm::value_ptr(objects[i].model));
+        if (m_Mode == SEPARATE) {
+            packet.textures[0] = textures[objects[i].image];
+        }
+        else if (m_Mode == ARRAY) {
+            // у всех пакетов одна текстура: очередь сортирует их только по глубине
+            packet.textures[0] = m_Array.getTexture();
+            packet.textureTargets[0] = m_Array.getTarget();
+            uniforms[1] = UniformValue::float1(layerLoc, (GLfloat)m_Array.getRegion(regions[objects[i].image]).layer);
+        }
+        else {
+            const TextureRegion& region = m_Atlas.getRegion(regions[objects[i].image]);
+            GLfloat rect[4] = { region.offset[0], region.offset[1], region.scale[0], region.scale[1] };
+            packet.textures[0] = m_Atlas.getTexture();
+            uniforms[1] = UniformValue::float4(regionLoc, rect);
+        }
+        m_Queue.submit(packet, uniforms, m_Mode == SEPARATE ? 1 : 2);
+    }
+    m_Queue.flush();
+
+    if (currentFrame - lastReport > 1.0f) {
+        lastReport = currentFrame;
+        std::cout << modeNames[m_Mode]
+                  << ": draws " << m_Queue.getStats().draws
+                  << ", texture switches " << m_Queue.getStats().textureSwitches
+                  << ", frame " << deltaTime * 1000.0f << " ms" << std::endl;
+    }
+
+    base::gRender(auto_redraw);
+} // gRender
+
+void Cube::gFinalize() {
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    for (int i = 0; i < IMAGES_COUNT; i++)
+        TextureManager::current().gRelease(textures[i]);
+    m_Array.gFinalize();
+    m_Atlas.gFinalize();
+    for (int i = 0; i < 3; i++) {
+        if (m_Shaders[i])
+            delete m_Shaders[i];
+    }
+    TextureManager::current().gFinalize();
+    base::gFinalize();
+} // gFinalize
+
+void Cube::onKey(int key, int scancode, int action, int mods) {
+    if (key == GLFW_KEY_W && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(FORWARD, deltaTime);
+    else if (key == GLFW_KEY_S && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(BACKWARD, deltaTime);
+    else if (key == GLFW_KEY_A && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(LEFT, deltaTime);
+    else if (key == GLFW_KEY_D && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(RIGHT, deltaTime);
+    else if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+        m_Mode = (TextureMode)((m_Mode + 1) % 3);
+        std::cout << "mode: " << modeNames[m_Mode] << std::endl;
+    }
+} // onKey
+
+//---------------------------------------------------------------------
+void Cube::onMouseMove(double xpos, double ypos) {
+    if (firstMouse)
+    {
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false;
+    }
+
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+
+    lastX = xpos;
+    lastY = ypos;
+
+    m_Camera.ProcessMouseMovement(xoffset, yoffset);
+} // mouse_callback
+
+void Cube::onMouseScroll(double xoffset, double yoffset) {
+    m_Camera.ProcessMouseScroll(yoffset);
+} // scroll_callback
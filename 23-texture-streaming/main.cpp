@@ -0,0 +1,244 @@
+/*
+ * В этом примере две тысячи ящиков уходят вдаль на двести единиц, и ближние из них видны крупно, а дальние - в несколько
+ * пикселей. Обычная текстура держит в видеопамяти все mip-уровни, хотя дальним ящикам хватает мелких. TextureStreamer
+ * (см. include/texture_streamer.h) сначала загружает только мелкие уровни, каждый кадр по размеру ящиков на экране
+ * решает, какие уровни нужны, и догружает их в фоне, а при нехватке бюджета памяти выгружает уровни, которые дольше всех
+ * не были нужны.
+ *
+ * Текстуры читаются из файлов .ktx со всеми mip-уровнями. Их готовит утилита tools/texture-cook:
+ *
+ *   cd bin && for f in box wood wall attention_label; do ./texture-cook ../textures/$f.jpg ../textures/$f.ktx; done
+ *
+ * Нажмите B, чтобы уменьшить бюджет видеопамяти (и вернуть обратно); раз в секунду в консоль печатается, сколько памяти
+ * занято и какие уровни каждой текстуры загружены.
+ */
+
+#include "application.h"
+#include "shader.h"
+#include "texture_streamer.h"
+#include "model_cube.h"
+#include "vertex_layout.h"
+#include "camera.h"
+#include "render_queue.h"
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+typedef VertexLayout< VertexAttr<0, vfmt::Half3>, VertexAttr<2, vfmt::UNorm16x2> > CubeLayout;
+
+#define CUBES_COUNT     2000
+#define IMAGES_COUNT    4
+#define BUDGETS_COUNT   3
+
+static const size_t budgets[BUDGETS_COUNT] = { TEXTURE_STREAMING_BUDGET, 512 << 10, 128 << 10 };
+
+BEGIN_APP_DECLARATION(Cube)
+    virtual void gInit(const char* title = NULL);
+    virtual void gRender(bool auto_redraw = true);
+    virtual void gFinalize();
+    void onKey(int key, int scancode, int action, int mods);
+    void onMouseMove(double xpos, double ypos);
+    void onMouseScroll(double xoffset, double yoffset);
+    Cube()
+    : base(),
+    m_Shaders(nullptr),
+    m_Budget(0)
+    {
+        for (int i = 0; i < IMAGES_COUNT; i++)
+            textures[i] = 0;
+    }
+protected:
+    Shader* m_Shaders;
+    GLuint VBO, EBO, VAO;
+    GLuint textures[IMAGES_COUNT];
+    RenderQueue m_Queue;
+    int m_Budget;                       // номер в budgets
+END_APP_DECLARATION()
+
+DEFINE_APP(Cube, "Texture streaming")
+
+#define SHADER_PATH_PREFIX    "../shaders"
+#define TEXTURE_PATH_PREFIX   "../textures"
+
+static const char* images[IMAGES_COUNT] = {
+    TEXTURE_PATH_PREFIX"/box.ktx",
+    TEXTURE_PATH_PREFIX"/wood.ktx",
+    TEXTURE_PATH_PREFIX"/wall.ktx",
+    TEXTURE_PATH_PREFIX"/attention_label.ktx"
+};
+
+//----------------------------------------------------------------------------
+// Настройка камеры
+Camera m_Camera(glm::vec3(0.0f, 0.0f, 3.0f));
+bool firstMouse = true;
+float lastX =  800.0f / 2.0;
+float lastY =  600.0f / 2.0;
+
+// timing
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastReport = 0.0f;
+
+struct SceneObject {
+    glm::mat4 model;
+    glm::vec3 position;
+    int       image;
+};
+std::vector<SceneObject> objects;
+//----------------------------------------------------------------------------
+
+void Cube::gInit(const char* title) {
+    base::gInit(title);
+
+    glfwSetInputMode(m_pWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    if (!(m_Shaders = new Shader(SHADER_PATH_PREFIX"/3.3.shader09.vs.glsl", SHADER_PATH_PREFIX"/3.3.shader05.fs.glsl"))) {
+        throw std::logic_error("something wrong with shaders");
+    }
+    //---------------------------
+    // Загрузка модели
+    //---------------------------
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    std::vector<unsigned char> cube;
+    CubeLayout::pack(models::cube_indexed_vertices, models::cube_vertex_count, cube);
+    glBufferData(GL_ARRAY_BUFFER, cube.size(), cube.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(models::cube_indices), models::cube_indices, GL_STATIC_DRAW);
+
+    CubeLayout::setup();
+
+    glBindVertexArray(0);
+    //---------------------------
+    // Загрузка текстур: пока только мелкие уровни
+    //---------------------------
+    for (int i = 0; i < IMAGES_COUNT; i++) {
+        if (!(textures[i] = TextureStreamer::current().gAcquire(images[i]))) {
+            std::cout << "Prepare the textures with tools/texture-cook (see 23-texture-streaming/main.cpp)" << std::endl;
+            throw std::logic_error("something wrong with textures");
+        }
+    }
+    //---------------------------
+    // Сцена: ящики вдоль длинного коридора
+    //---------------------------
+    srand(42);
+    objects.resize(CUBES_COUNT);
+    for (size_t i = 0; i < objects.size(); i++) {
+        glm::vec3 position((rand() % 80 - 40) * 0.25f,
+                           (rand() % 24 - 12) * 0.25f,
+                           -(rand() % 800) * 0.25f);
+        objects[i].position = position;
+        objects[i].model = glm::translate(glm::mat4(1.0f), position);
+        objects[i].model = glm::rotate(objects[i].model, glm::radians(20.0f * i), glm::vec3(0.3f, 1.0f, 0.5f));
+        objects[i].image = rand() % IMAGES_COUNT;
+    }
+} // gInit
+
+void Cube::gRender(bool auto_redraw) {
+    float currentFrame = glfwGetTime();
+    deltaTime = currentFrame - lastFrame;
+    lastFrame = currentFrame;
+    //------------------------------------------------------------
+    GLState::current().clearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    GLState::current().enable(GL_DEPTH_TEST);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glm::mat4 view = m_Camera.GetViewMatrix();
+    glm::mat4 projection = glm::perspective(glm::radians(m_Camera.Zoom), (float)800 / (float)600, 0.1f, 250.0f);
+    m_Shaders->use();
+    m_Shaders->setInt("ourTexture", 0);
+    m_Shaders->setMat4("view", view);
+    m_Shaders->setMat4("projection", projection);
+    GLint modelLoc = glGetUniformLocation(m_Shaders->ID, "model");
+
+    // каждый ящик сообщает, какой уровень его текстуры нужен на таком расстоянии
+    TextureStreamer& streamer = TextureStreamer::current();
+    streamer.setViewport(600.0f, glm::radians(m_Camera.Zoom));
+    m_Queue.begin(0.1f, 250.0f);
+    for (size_t i = 0; i < objects.size(); i++) {
+        GLfloat depth = -(view * objects[i].model[3]).z;
+        if (depth > 0.0f)
+            streamer.request(textures[objects[i].image], 1.0f, glm::distance(m_Camera.Position, objects[i].position));
+        DrawPacket packet;
+        packet.program = m_Shaders->ID;
+        packet.vao = VAO;
+        packet.count = models::cube_index_count;
+        packet.indexType = GL_UNSIGNED_INT;
+        packet.depth = depth;
+        packet.textures[0] = textures[objects[i].image];
+        UniformValue uniforms[1];
+        uniforms[0] = UniformValue::mat4(modelLoc, glm::value_ptr(objects[i].model));
+        m_Queue.submit(packet, uniforms, 1);
+    }
+    m_Queue.flush();
+    streamer.gUpdate();
+
+    if (currentFrame - lastReport > 1.0f) {
+        lastReport = currentFrame;
+        const TextureStreamerStats& stats = streamer.getStats();
+        std::cout << "resident " << stats.residentBytes / 1024 << " KB of " << streamer.getBudget() / 1024
+                  << " KB (wanted " << stats.wantedBytes / 1024 << " KB), levels:";
+        for (int i = 0; i < IMAGES_COUNT; i++)
+            std::cout << " " << streamer.getResidentLevel(textures[i]);
+        std::cout << ", loads " << stats.loads << ", evictions " << stats.evictions << std::endl;
+    }
+
+    base::gRender(auto_redraw);
+} // gRender
+
+void Cube::gFinalize() {
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    for (int i = 0; i < IMAGES_COUNT; i++)
+        TextureStreamer::current().gRelease(textures[i]);
+    TextureStreamer::current().gFinalize();
+    if (m_Shaders)
+        delete m_Shaders;
+    base::gFinalize();
+} // gFinalize
+
+void Cube::onKey(int key, int scancode, int action, int mods) {
+    if (key == GLFW_KEY_W && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(FORWARD, deltaTime);
+    else if (key == GLFW_KEY_S && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(BACKWARD, deltaTime);
+    else if (key == GLFW_KEY_A && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(LEFT, deltaTime);
+    else if (key == GLFW_KEY_D && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(RIGHT, deltaTime);
+    else if (key == GLFW_KEY_B && action == GLFW_PRESS) {
+        m_Budget = (m_Budget + 1) % BUDGETS_COUNT;
+        TextureStreamer::current().setBudget(budgets[m_Budget]);
+        std::cout << "budget: " << budgets[m_Budget] / 1024 << " KB" << std::endl;
+    }
+} // onKey
+
+//---------------------------------------------------------------------
+void Cube::onMouseMove(double xpos, double ypos) {
+    if (firstMouse)
+    {
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false;
+    }
+
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+
+    lastX = xpos;
+    lastY = ypos;
+
+    m_Camera.ProcessMouseMovement(xoffset, yoffset);
+} // mouse_callback
+
+void Cube::onMouseScroll(double xoffset, double yoffset) {
+    m_Camera.ProcessMouseScroll(yoffset);
+} // scroll_callback
@@ -0,0 +1,209 @@
+/*
+ * В этом примере показывается изображение, которое не помещается ни в одну текстуру: множество Мандельброта размером
+ * TILED_IMAGE_WIDTH x TILED_IMAGE_HEIGHT пикселей. Оно хранится на диске пирамидой плиток (см. include/tile_pyramid.h),
+ * а TiledImage (см. include/tiled_image.h) каждый кадр выбирает видимые плитки нужного уровня и догружает их в фоне в
+ * кэш плиток - слои одного массива текстур. Пока плитка грузится, на ее месте рисуется увеличенный кусок более грубой.
+ *
+ * При первом запуске пирамида строится в bin/tiled-image.tiles (больше полугигабайта, от нескольких секунд на многоядерном
+ * процессоре до полуминуты на одном ядре), дальше только открывается. Вместо нее можно подставить свой скан, приготовив
+ * его утилитой tools/tile-cook:
+ *
+ *   cd bin && ./tile-cook scan.jpg tiled-image.tiles
+ *
+ * Управление камерой обычное: W и S приближают и отдаляют, A и D сдвигают вбок, мышь поворачивает камеру, колесо меняет
+ * угол обзора. Скорость камеры пропорциональна расстоянию до изображения, поэтому приближать можно до отдельных
+ * пикселей. Раз в секунду в консоль печатается, сколько плиток выбрано и сколько занято в кэше: сколько бы ни было
+ * пикселей в изображении, видеопамяти уходит не больше TILED_IMAGE_CACHE_SLOTS плиток.
+ */
+
+#include "application.h"
+#include "shader.h"
+#include "tiled_image.h"
+#include "camera.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#define TILED_IMAGE_WIDTH       16384
+#define TILED_IMAGE_HEIGHT      8192
+#define TILED_IMAGE_PATH        "tiled-image.tiles"
+#define IMAGE_WORLD_WIDTH       16.0f
+#define MANDELBROT_ITERATIONS   256
+
+BEGIN_APP_DECLARATION(Viewer)
+    virtual void gInit(const char* title = NULL);
+    virtual void gRender(bool auto_redraw = true);
+    virtual void gFinalize();
+    void onKey(int key, int scancode, int action, int mods);
+    void onMouseMove(double xpos, double ypos);
+    void onMouseScroll(double xoffset, double yoffset);
+    Viewer()
+    : base(),
+    m_Shaders(nullptr)
+    {}
+protected:
+    Shader* m_Shaders;
+    TiledImage m_Image;
+END_APP_DECLARATION()
+
+DEFINE_APP(Viewer, "Tiled image")
+
+#define SHADER_PATH_PREFIX    "../shaders"
+
+//----------------------------------------------------------------------------
+// Настройка камеры
+Camera m_Camera(glm::vec3(0.0f, 0.0f, 12.0f));
+bool firstMouse = true;
+float lastX =  800.0f / 2.0;
+float lastY =  600.0f / 2.0;
+
+// timing
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastReport = 0.0f;
+//----------------------------------------------------------------------------
+
+/*
+ * Уровень 0 пирамиды: прямоугольник множества Мандельброта. Точки главной кардиоиды и круга слева от нее заведомо
+ * внутри множества и не итерируются, остальные раскрашиваются по сглаженному числу итераций.
+ */
+static void drawMandelbrot(int x, int y, int width, int height, unsigned char* pixels) {
+    const double scale = 3.5 / TILED_IMAGE_WIDTH;
+    for (int j = 0; j < height; j++) {
+        double ci = -0.875 + (y + j + 0.5) * scale;
+        for (int i = 0; i < width; i++, pixels += 3) {
+            double cr = -2.5 + (x + i + 0.5) * scale;
+            double q = (cr - 0.25) * (cr - 0.25) + ci * ci;
+            if (q * (q + cr - 0.25) < 0.25 * ci * ci || (cr + 1.0) * (cr + 1.0) + ci * ci < 0.0625) {
+                pixels[0] = pixels[1] = pixels[2] = 0;
+                continue;
+            }
+            double zr = 0.0, zi = 0.0;
+            int n = 0;
+            while (n < MANDELBROT_ITERATIONS && zr * zr + zi * zi < 256.0) {
+                double t = zr * zr - zi * zi + cr;
+                zi = 2.0 * zr * zi + ci;
+                zr = t;
+                n++;
+            }
+            if (n == MANDELBROT_ITERATIONS) {
+                pixels[0] = pixels[1] = pixels[2] = 0;
+                continue;
+            }
+            double smooth = n + 1.0 - log2(log2(zr * zr + zi * zi) * 0.5);
+            for (int c = 0; c < 3; c++)
+                pixels[c] = (unsigned char)(127.5 + 127.5 * cos(0.15 * smooth + 0.8 + c * 0.6));
+        }
+    }
+} // drawMandelbrot
+
+void Viewer::gInit(const char* title) {
+    base::gInit(title);
+
+    glfwSetInputMode(m_pWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    if (!(m_Shaders = new Shader(SHADER_PATH_PREFIX"/3.3.shader17.vs.glsl", SHADER_PATH_PREFIX"/3.3.shader17.fs.glsl"))) {
+        throw std::logic_error("something wrong with shaders");
+    }
+    //---------------------------
+    // Пирамида плиток: строится один раз, потом только открывается
+    //---------------------------
+    TilePyramid existing;
+    if (!existing.open(TILED_IMAGE_PATH)) {
+        std::cout << "Building " << TILED_IMAGE_WIDTH << " x " << TILED_IMAGE_HEIGHT << " tile pyramid..." << std::endl;
+        float start = glfwGetTime();
+        if (!buildTilePyramid(TILED_IMAGE_PATH, TILED_IMAGE_WIDTH, TILED_IMAGE_HEIGHT, 3, drawMandelbrot)) {
+            throw std::logic_error("something wrong with the tiled image");
+        }
+        std::cout << "Built in " << glfwGetTime() - start << " s" << std::endl;
+    }
+    existing.close();
+    if (!m_Image.gOpen(TILED_IMAGE_PATH)) {
+        throw std::logic_error("something wrong with the tiled image");
+    }
+    const TilePyramid& pyramid = m_Image.getPyramid();
+    std::cout << pyramid.getWidth() << " x " << pyramid.getHeight() << ", " << pyramid.getLevelCount()
+              << " levels" << std::endl;
+    // изображение шириной IMAGE_WORLD_WIDTH с центром в начале координат
+    GLfloat pixelSize = IMAGE_WORLD_WIDTH / pyramid.getWidth();
+    m_Image.setPlacement(glm::vec2(-0.5f * IMAGE_WORLD_WIDTH, 0.5f * pyramid.getHeight() * pixelSize), pixelSize);
+} // gInit
+
+void Viewer::gRender(bool auto_redraw) {
+    float currentFrame = glfwGetTime();
+    deltaTime = currentFrame - lastFrame;
+    lastFrame = currentFrame;
+    //------------------------------------------------------------
+    GLState::current().clearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    // чем ближе изображение, тем медленнее камера; ближний план тоже зависит от расстояния
+    GLfloat distance = std::max(fabsf(m_Camera.Position.z), 0.001f);
+    m_Camera.MovementSpeed = 1.5f * distance;
+    glm::mat4 view = m_Camera.GetViewMatrix();
+    glm::mat4 projection = glm::perspective(glm::radians(m_Camera.Zoom), (float)800 / (float)600,
+                                            0.1f * distance, 1000.0f);
+
+    m_Image.setViewport(600.0f, glm::radians(m_Camera.Zoom));
+    m_Image.gUpdate(projection * view, m_Camera.Position);
+    m_Shaders->use();
+    m_Shaders->setInt("tiles", 0);
+    m_Shaders->setMat4("view", view);
+    m_Shaders->setMat4("projection", projection);
+    m_Image.gDraw();
+
+    if (currentFrame - lastReport > 1.0f) {
+        lastReport = currentFrame;
+        const TiledImageStats& stats = m_Image.getStats();
+        std::cout << "tiles " << stats.selected << " (coarser " << stats.fallbacks << "), finest level "
+                  << stats.finestLevel << ", cached " << stats.resident << " of " << TILED_IMAGE_CACHE_SLOTS
+                  << ", loading " << stats.pending << ", loads " << stats.loads << ", evictions "
+                  << stats.evictions << std::endl;
+    }
+
+    base::gRender(auto_redraw);
+} // gRender
+
+void Viewer::gFinalize() {
+    m_Image.gClose();
+    if (m_Shaders)
+        delete m_Shaders;
+    base::gFinalize();
+} // gFinalize
+
+void Viewer::onKey(int key, int scancode, int action, int mods) {
+    if (key == GLFW_KEY_W && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(FORWARD, deltaTime);
+    else if (key == GLFW_KEY_S && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(BACKWARD, deltaTime);
+    else if (key == GLFW_KEY_A && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(LEFT, deltaTime);
+    else if (key == GLFW_KEY_D && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        m_Camera.ProcessKeyboard(RIGHT, deltaTime);
+} // onKey
+
+//---------------------------------------------------------------------
+void Viewer::onMouseMove(double xpos, double ypos) {
+    if (firstMouse)
+    {
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false;
+    }
+
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+
+    lastX = xpos;
+    lastY = ypos;
+
+    m_Camera.ProcessMouseMovement(xoffset, yoffset);
+} // mouse_callback
+
+void Viewer::onMouseScroll(double xoffset, double yoffset) {
+    m_Camera.ProcessMouseScroll(yoffset);
+} // scroll_callback
@@ -0,0 +1,216 @@
+/*
+ * Видео на текстуре
+ *
+ * До этого текстуры загружались один раз, а здесь картинка на прямоугольнике из примеров 05-08 меняется
+ * каждый кадр: это кадры несжатого видео Y4M, которые VideoTexture (см. include/video_texture.h) читает
+ * с диска в фоне через кольцо буферов GL_PIXEL_UNPACK_BUFFER. Кадр приходит тремя плоскостями YUV 4:2:0
+ * в трех текстурах, а в RGB его переводит фрагментный шейдер 3.3.shader18.fs.glsl. Процессору остается
+ * только читать файл, поэтому даже 4K при 60 кадрах в секунду упирается лишь в скорость диска
+ * (проверить ее можно утилитой tools/video-bench).
+ *
+ * При первом запуске в bin/video-texture.y4m записывается короткий ролик, дальше он только читается.
+ * Вместо него можно подставить свое видео:
+ *
+ *   ffmpeg -i movie.mp4 -pix_fmt yuv420p bin/video-texture.y4m
+ *
+ * или записать любой пример: ./13-advanced-camera-with-class-camera --record video-texture.y4m
+ *
+ * Видео идет со своей частотой, независимо от частоты окна. Раз в секунду в консоль печатается, сколько
+ * кадров показано и пропущено и с какой скоростью читается файл. Пробел ставит вращение на паузу.
+ */
+
+#include "application.h"
+#include "shader.h"
+#include "video_texture.h"
+#include "image_write.h"
+
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include <unistd.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#define VIDEO_PATH          "video-texture.y4m"
+#define VIDEO_WIDTH         640
+#define VIDEO_HEIGHT        360
+#define VIDEO_FPS           30
+#define VIDEO_FRAMES        150
+
+BEGIN_APP_DECLARATION(Video)
+    virtual void gInit(const char* title = NULL);
+    virtual void gRender(bool auto_redraw = true);
+    virtual void gFinalize();
+    void onKey(int key, int scancode, int action, int mods);
+    Video()
+    : base(),
+    m_Shaders(nullptr),
+    m_bRotate(true),
+    m_Angle(0.0f)
+    {}
+protected:
+    Shader* m_Shaders;
+    GLuint VBO, VAO, EBO;
+    VideoTexture m_Video;
+    bool m_bRotate;
+    GLfloat m_Angle;
+END_APP_DECLARATION()
+
+DEFINE_APP(Video, "Video texture")
+
+#define SHADER_PATH_PREFIX    "../shaders"
+
+// timing
+float lastFrame = 0.0f;
+float lastReport = 0.0f;
+VideoTextureStats lastStats;
+
+/*
+ * Ролик по умолчанию: цветные полосы, по которым бегут круг и номер кадра в двоичном виде (белые
+ * квадраты внизу), чтобы пропуски кадров было видно глазом.
+ */
+static bool writeDefaultVideo(const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file)
+        return false;
+    bool ok = writeY4MHeader(file, VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_FPS);
+    std::vector<unsigned char> pixels((size_t)VIDEO_WIDTH * VIDEO_HEIGHT * 3);
+    for (int frame = 0; ok && frame < VIDEO_FRAMES; frame++) {
+        float t = (float)frame / VIDEO_FRAMES;
+        float cx = VIDEO_WIDTH * (0.5f + 0.35f * cosf(6.2831853f * t));
+        float cy = VIDEO_HEIGHT * (0.45f + 0.3f * sinf(6.2831853f * t));
+        unsigned char* p = pixels.data();
+        for (int y = 0; y < VIDEO_HEIGHT; y++) {
+            for (int x = 0; x < VIDEO_WIDTH; x++, p += 3) {
+                int bar = (x * 8 / VIDEO_WIDTH + frame / 10) % 8;
+                p[0] = bar & 1 ? 220 : 40;
+                p[1] = bar & 2 ? 220 : 40;
+                p[2] = bar & 4 ? 220 : 40;
+                if ((x - cx) * (x - cx) + (y - cy) * (y - cy) < 40.0f * 40.0f)
+                    p[0] = p[1] = p[2] = 250;
+                // номер кадра: 8 бит, старший слева
+                int bit = (x - 16) / 24;
+                if (y >= VIDEO_HEIGHT - 32 && y < VIDEO_HEIGHT - 12 && x >= 16 && bit < 8 && (x - 16) % 24 < 20)
+                    p[0] = p[1] = p[2] = (frame >> (7 - bit)) & 1 ? 255 : 0;
+            }
+        }
+        ok = writeY4MFrame(file, pixels.data(), VIDEO_WIDTH, VIDEO_HEIGHT, 3, false);
+    }
+    return fclose(file) == 0 && ok;
+} // writeDefaultVideo
+
+void Video::gInit(const char* title) {
+    base::gInit(title);
+    if (!(m_Shaders = new Shader(SHADER_PATH_PREFIX"/3.3.shader08.vs.glsl",
+                                SHADER_PATH_PREFIX"/3.3.shader18.fs.glsl"))) {
+        throw std::logic_error("something wrong with shaders");
+    }
+    //---------------------------
+    // Видео: ролик по умолчанию записывается один раз
+    //---------------------------
+    if (access(VIDEO_PATH, R_OK) != 0) {
+        std::cout << "Writing " << VIDEO_PATH << "..." << std::endl;
+        if (!writeDefaultVideo(VIDEO_PATH)) {
+            throw std::logic_error("something wrong with the video");
+        }
+    }
+    if (!m_Video.gOpen(VIDEO_PATH)) {
+        throw std::logic_error("something wrong with the video");
+    }
+    const Y4MFile& file = m_Video.getFile();
+    std::cout << file.getWidth() << " x " << file.getHeight() << ", " << file.getFps() << " fps, "
+              << file.getFrameCount() << " frames, " << file.getFrameBytes() / 1024 << " KB per frame" << std::endl;
+
+    // прямоугольник с пропорциями кадра
+    GLfloat w = 0.8f * file.getWidth() / file.getHeight(), h = 0.8f;
+    GLfloat vertices[] = {
+        // Positions          // Colors           // Texture Coords
+            w,     h, 0.0f,   1.0f, 1.0f, 1.0f,   1.0f, 1.0f, // Top Right
+            w,    -h, 0.0f,   1.0f, 1.0f, 1.0f,   1.0f, 0.0f, // Bottom Right
+           -w,    -h, 0.0f,   1.0f, 1.0f, 1.0f,   0.0f, 0.0f, // Bottom Left
+           -w,     h, 0.0f,   1.0f, 1.0f, 1.0f,   0.0f, 1.0f  // Top Left
+    };
+    GLuint indices[] = {
+        0, 1, 3, // Первый полигон
+        1, 2, 3  // Второй полигон
+    };
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    glBindVertexArray(VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (GLvoid*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (GLvoid*)(6 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+} // gInit
+
+void Video::gRender(bool auto_redraw) {
+    float currentFrame = glfwGetTime();
+    float deltaTime = currentFrame - lastFrame;
+    lastFrame = currentFrame;
+    if (m_bRotate)
+        m_Angle += 20.0f * deltaTime;
+    //------------------------------------------------------------
+    GLState::current().clearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    // новый кадр видео, если пришло его время
+    m_Video.gUpdate(glfwGetTime());
+    m_Video.gBind(0);
+    m_Shaders->use();
+    m_Shaders->setInt("lumaTexture", 0);
+    m_Shaders->setInt("chromaU", 1);
+    m_Shaders->setInt("chromaV", 2);
+    m_Shaders->setBool("fullRange", m_Video.getFile().isFullRange());
+
+    glm::mat4 model;
+    model = glm::rotate(model, glm::radians(25.0f * sinf(glm::radians(m_Angle))), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 view = glm::translate(glm::mat4(), glm::vec3(0.0f, 0.0f, -3.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (GLfloat)800 / (GLfloat)600, 0.1f, 100.0f);
+    m_Shaders->setMat4("model", model);
+    m_Shaders->setMat4("view", view);
+    m_Shaders->setMat4("projection", projection);
+
+    GLState::current().bindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+    if (currentFrame - lastReport > 1.0f) {
+        const VideoTextureStats& stats = m_Video.getStats();
+        float seconds = currentFrame - lastReport;
+        std::cout << "frame " << stats.frame << ", shown " << (stats.presented - lastStats.presented) / seconds
+                  << " fps, dropped " << stats.dropped << ", stalls " << stats.stalls << ", read ahead "
+                  << stats.pending << ", reading " << (stats.bytesRead - lastStats.bytesRead) / seconds / 1048576.0
+                  << " MB/s" << std::endl;
+        lastReport = currentFrame;
+        lastStats = stats;
+    }
+
+    base::gRender(auto_redraw);
+} // gRender
+
+void Video::gFinalize() {
+    m_Video.gClose();
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    if (m_Shaders)
+        delete m_Shaders;
+    base::gFinalize();
+} // gFinalize
+
+void Video::onKey(int key, int scancode, int action, int mods) {
+    if (key == GLFW_KEY_SPACE && action == GLFW_PRESS)
+        m_bRotate = !m_bRotate;
+} // onKey
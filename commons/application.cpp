@@ -5,8 +5,17 @@
  */
  
 #include "application.h"
+#include "frame_capture.h"
+#include "image_cache.h"
+#include "image_decoder.h"
+#include "vfs.h"
+#include <climits>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
+#include <unistd.h>
 
 /* 
  * void Application::run() реализован в заголовке
@@ -29,6 +38,8 @@ void APIENTRY debugCallbackARB(GLenum /* source */,
 #define G_DEFAULT_WIN_WIDTH_  800               // default width of main window
 #define G_DEFAULT_WIN_HEIGHT_ 600               // default height of main window
 #define G_DEFAULT_WIN_TITLE   "OpenGL Application"
+#define G_DEFAULT_ASSETS_PAK  "assets.pak"      // пакет ресурсов рядом с исполняемым файлом
+#define G_DEFAULT_IMAGE_CACHE "image-cache"     // кэш декодированных изображений рядом с ним же
 
 
 //-------- CALLBACKS ---------------------------------------------------
@@ -61,6 +72,45 @@ void Application::scroll_callback(GLFWwindow* window, double xoffset, double yof
     pThis->onMouseScroll(xoffset, yoffset);
 } // scroll_callback
 //-----------------------------------------------------------------------
+void Application::setCommandLine(int argc, char** argv) {
+    // ресурсы ищутся и от каталога над bin, где лежат shaders и textures, а не только от текущего
+    char exe[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (length > 0) {
+        exe[length] = '\0';
+        std::string directory(exe, strrchr(exe, '/'));
+        Vfs::current().mountDirectory((directory + "/..").c_str());
+        std::string pak = directory + "/" G_DEFAULT_ASSETS_PAK;
+        if (access(pak.c_str(), R_OK) == 0 && Vfs::current().mountPak(pak.c_str()))
+            std::cout << "Info: " << "assets are loaded from " << pak << std::endl;
+        ImageCache::current().setDirectory(directory + "/" G_DEFAULT_IMAGE_CACHE);
+    }
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            m_pRecordPath = argv[++i];
+        else if (strcmp(argv[i], "--record-frames") == 0 && i + 1 < argc)
+            m_RecordFrames = atol(argv[++i]);
+        else if (strcmp(argv[i], "--pak") == 0 && i + 1 < argc)
+            Vfs::current().mountPak(argv[++i]);
+        else if (strcmp(argv[i], "--no-image-cache") == 0)
+            ImageCache::current().setDirectory("");
+        else if (strcmp(argv[i], "--image-decoder") == 0 && i + 1 < argc) {
+            if (!setPreferredImageDecoder(argv[++i]))
+                std::cout << "Image decoder " << argv[i] << " is not available" << std::endl;
+        }
+    }
+} // setCommandLine
+
+void Application::gCaptureFrame() {
+    if (!m_pCapture)
+        return;
+    int width, height;
+    glfwGetFramebufferSize(m_pWindow, &width, &height);
+    m_pCapture->gCapture(0, width, height);
+    if (m_RecordFrames > 0 && m_pCapture->getStats().captured >= (size_t)m_RecordFrames)
+        glfwSetWindowShouldClose(m_pWindow, GLFW_TRUE);
+} // gCaptureFrame
+
 void Application::gInit(const char* title) {
     if (!glfwInit()) {
         throw std::logic_error("GLFW init error");
@@ -113,9 +163,26 @@ void Application::gInit(const char* title) {
             std::cout << "Warning: " << "debug output is not enabled" << std::endl;
         #endif
     }
+    /*** запись кадров ***/
+    if (m_pRecordPath) {
+        m_pCapture = new FrameCapture();
+        if (!m_pCapture->start(m_pRecordPath)) {
+            delete m_pCapture;
+            m_pCapture = nullptr;
+        }
+    }
 } // gInit
 
 void Application::gFinalize() {
+    if (m_pCapture) {
+        m_pCapture->gStop();
+        FrameCaptureStats stats = m_pCapture->getStats();
+        std::cout << "Info: " << stats.written << " frame(s) recorded to " << m_pCapture->getPath()
+                  << ", " << (stats.captured ? stats.captureMs / stats.captured : 0.0) << " ms/frame in capture, "
+                  << stats.gpuStalls << " GPU stall(s), " << stats.encoderStalls << " encoder stall(s)" << std::endl;
+        delete m_pCapture;
+        m_pCapture = nullptr;
+    }
     if (m_pWindow) {
         glfwDestroyWindow(m_pWindow);
     }
@@ -0,0 +1,218 @@
+/*
+ * Реализация динамического разрешения (см. include/dynamic_resolution.h).
+ */
+
+#include "dynamic_resolution.h"
+#include "gl_state.h"
+#include "render_target_pool.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#define SCALE_STEP          (1.0f / 64.0f)  // масштаб меняется ступенями, чтобы не дрожать на мелочах
+#define SMOOTHING           0.25f           // вес нового измерения в сглаженном времени
+#define TARGET_LOAD         0.9f            // к какой доле бюджета стремимся
+#define GROW_THRESHOLD      0.75f           // увеличивать масштаб, только если время меньше этой доли
+#define MAX_GROW            1.1f            // наибольшее увеличение стороны за один шаг
+#define MAX_SHRINK          0.75f           // наибольшее уменьшение стороны за один шаг
+#define GROW_DELAY          12              // измерений после смены масштаба, прежде чем снова увеличивать
+
+//-------- ResolutionController ----------------------------------------
+ResolutionController::ResolutionController(GLfloat budgetMs, GLfloat minScale, GLfloat maxScale)
+    : m_BudgetMs(budgetMs),
+      m_MinScale(minScale),
+      m_MaxScale(maxScale),
+      m_Scale(maxScale),
+      m_SmoothedMs(0.0f),
+      m_Cooldown(0),
+      m_GrowDelay(0) {
+    setScaleRange(minScale, maxScale);
+}
+
+void ResolutionController::setScaleRange(GLfloat minScale, GLfloat maxScale) {
+    if (minScale <= 0.0f || minScale > maxScale)
+        throw std::logic_error("bad resolution scale range");
+    m_MinScale = minScale;
+    m_MaxScale = maxScale;
+    m_Scale = std::min(m_MaxScale, std::max(m_MinScale, m_Scale));
+}
+
+void ResolutionController::reset(GLfloat scale) {
+    m_Scale = std::min(m_MaxScale, std::max(m_MinScale, scale));
+    m_SmoothedMs = 0.0f;
+    m_Cooldown = 0;
+    m_GrowDelay = 0;
+}
+
+/*
+ * Время считается пропорциональным площади кадра, то есть квадрату масштаба. Отсюда нужный
+ * масштаб - текущий, умноженный на корень из отношения желаемого времени к измеренному.
+ * После смены масштаба сглаженное время пересчитывается по той же пропорции, а измерения,
+ * которые еще относятся к кадрам старого размера, пропускаются.
+ */
+GLfloat ResolutionController::update(GLfloat gpuMs) {
+    if (gpuMs <= 0.0f)
+        return m_Scale;
+    if (m_Cooldown > 0) {
+        m_Cooldown--;
+        return m_Scale;
+    }
+    m_SmoothedMs = m_SmoothedMs > 0.0f ? m_SmoothedMs + (gpuMs - m_SmoothedMs) * SMOOTHING : gpuMs;
+    if (m_GrowDelay > 0)
+        m_GrowDelay--;
+
+    GLfloat scale = m_Scale;
+    if (m_SmoothedMs > m_BudgetMs) {
+        GLfloat target = m_Scale * sqrtf(m_BudgetMs * TARGET_LOAD / m_SmoothedMs);
+        scale = floorf(std::max(target, m_Scale * MAX_SHRINK) / SCALE_STEP) * SCALE_STEP;
+    }
+    else if (m_SmoothedMs < m_BudgetMs * GROW_THRESHOLD && m_GrowDelay == 0) {
+        GLfloat target = m_Scale * sqrtf(m_BudgetMs * TARGET_LOAD / m_SmoothedMs);
+        scale = std::max(m_Scale, floorf(std::min(target, m_Scale * MAX_GROW) / SCALE_STEP) * SCALE_STEP);
+    }
+    scale = std::min(m_MaxScale, std::max(m_MinScale, scale));
+    if (scale != m_Scale) {
+        m_SmoothedMs *= (scale * scale) / (m_Scale * m_Scale);
+        m_Scale = scale;
+        m_Cooldown = RESOLUTION_TIMER_QUERIES;
+        m_GrowDelay = GROW_DELAY;
+    }
+    return m_Scale;
+} // update
+
+//-------- DynamicResolution -------------------------------------------
+DynamicResolution::DynamicResolution(GLfloat budgetMs, GLfloat minScale, GLfloat maxScale)
+    : m_Controller(budgetMs, minScale, maxScale),
+      m_MaxScale(maxScale),
+      m_bEnabled(true),
+      m_Upscale(BILINEAR),
+      m_Sharpness(0.5f),
+      m_pShader(nullptr),
+      m_pTargets(nullptr),
+      m_pTarget(nullptr),
+      m_Vao(0),
+      m_WindowWidth(0),
+      m_WindowHeight(0),
+      m_RenderWidth(0),
+      m_RenderHeight(0),
+      m_Query(0),
+      m_GpuMs(0.0f) {
+    for (GLuint i = 0; i < RESOLUTION_TIMER_QUERIES; i++) {
+        m_Queries[i] = 0;
+        m_QueryPending[i] = false;
+    }
+}
+
+DynamicResolution::~DynamicResolution() {
+    if (m_pShader)
+        delete m_pShader;
+}
+
+void DynamicResolution::gInit(const char* shaderDir, RenderTargetPool& targets) {
+    m_pTargets = &targets;
+    std::string dir(shaderDir);
+    m_pShader = new Shader((dir + "/3.3.shader13.vs.glsl").c_str(), (dir + "/3.3.shader13.fs.glsl").c_str());
+    // полноэкранный треугольник строится из gl_VertexID, но пустой VAO профилю core все равно нужен
+    glGenVertexArrays(1, &m_Vao);
+    glGenQueries(RESOLUTION_TIMER_QUERIES, m_Queries);
+} // gInit
+
+void DynamicResolution::gResize(int width, int height) {
+    m_WindowWidth = std::max(1, width);
+    m_WindowHeight = std::max(1, height);
+}
+
+void DynamicResolution::setEnabled(bool enabled) {
+    m_bEnabled = enabled;
+    m_Controller.reset(enabled ? m_Controller.getScale() : m_MaxScale);
+}
+
+/*
+ * Результаты запросов приходят по порядку, поэтому читаем, начиная с самого старого,
+ * до первого еще не готового. Ожидания здесь нет.
+ */
+void DynamicResolution::gReadTimers() {
+    for (GLuint k = 0; k < RESOLUTION_TIMER_QUERIES; k++) {
+        GLuint i = (m_Query + k) % RESOLUTION_TIMER_QUERIES;
+        if (!m_QueryPending[i])
+            continue;
+        GLint available = 0;
+        glGetQueryObjectiv(m_Queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(m_Queries[i], GL_QUERY_RESULT, &elapsed);
+        m_QueryPending[i] = false;
+        m_GpuMs = (GLfloat)(elapsed / 1e6);
+        if (m_bEnabled)
+            m_Controller.update(m_GpuMs);
+    }
+} // gReadTimers
+
+void DynamicResolution::gBeginFrame() {
+    if (!m_pTargets || !m_WindowWidth)
+        throw std::logic_error("DynamicResolution::gInit or gResize was not called");
+    gReadTimers();
+    // пока рамку окна тянут, пул еще не применил новый размер - рисуем под старый
+    int width = m_pTargets->getWidth(), height = m_pTargets->getHeight();
+    RenderTargetDesc desc = { std::max(1, (int)ceilf(width * m_MaxScale)), std::max(1, (int)ceilf(height * m_MaxScale)),
+                              GL_RGBA8, GL_DEPTH24_STENCIL8, 1 };
+    m_pTarget = m_pTargets->gAcquire(desc);
+    GLfloat scale = m_bEnabled ? m_Controller.getScale() : m_MaxScale;
+    m_RenderWidth = std::min(desc.width, std::max(1, (int)(width * scale + 0.5f)));
+    m_RenderHeight = std::min(desc.height, std::max(1, (int)(height * scale + 0.5f)));
+
+    GLState::current().bindFramebuffer(GL_FRAMEBUFFER, m_pTarget->framebuffer);
+    GLState::current().viewport(0, 0, m_RenderWidth, m_RenderHeight);
+    // если GPU отстал на весь круг запросов, этот кадр просто не измеряется
+    if (!m_QueryPending[m_Query])
+        glBeginQuery(GL_TIME_ELAPSED, m_Queries[m_Query]);
+} // gBeginFrame
+
+void DynamicResolution::gEndFrame() {
+    if (!m_QueryPending[m_Query]) {
+        glEndQuery(GL_TIME_ELAPSED);
+        m_QueryPending[m_Query] = true;
+        m_Query = (m_Query + 1) % RESOLUTION_TIMER_QUERIES;
+    }
+
+    GLState::current().bindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::current().viewport(0, 0, m_WindowWidth, m_WindowHeight);
+    GLState::current().disable(GL_DEPTH_TEST);
+    GLState::current().disable(GL_BLEND);
+    m_pShader->use();
+    m_pShader->setInt("source", 0);
+    const RenderTargetDesc& desc = m_pTarget->desc;
+    m_pShader->setVec2("uvScale", (GLfloat)m_RenderWidth / desc.width, (GLfloat)m_RenderHeight / desc.height);
+    m_pShader->setVec2("texelSize", 1.0f / desc.width, 1.0f / desc.height);
+    m_pShader->setFloat("sharpness", m_Upscale == SHARPEN ? m_Sharpness : 0.0f);
+    GLState::current().bindTextureUnit(0, GL_TEXTURE_2D, m_pTarget->color);
+    GLState::current().bindVertexArray(m_Vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    m_pTargets->release(m_pTarget);
+    m_pTarget = nullptr;
+} // gEndFrame
+
+void DynamicResolution::gFinalize() {
+    if (m_Vao) {
+        GLState::current().deleteVertexArrays(1, &m_Vao);
+        m_Vao = 0;
+    }
+    if (m_Queries[0]) {
+        // незавершенный запрос удалять можно, его результат просто пропадет
+        glDeleteQueries(RESOLUTION_TIMER_QUERIES, m_Queries);
+        for (GLuint i = 0; i < RESOLUTION_TIMER_QUERIES; i++) {
+            m_Queries[i] = 0;
+            m_QueryPending[i] = false;
+        }
+    }
+    if (m_pShader) {
+        GLState::current().deleteProgram(m_pShader->ID);
+        delete m_pShader;
+        m_pShader = nullptr;
+    }
+    m_pTargets = nullptr;
+} // gFinalize
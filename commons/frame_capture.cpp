@@ -0,0 +1,268 @@
+/*
+ * Реализация записи кадров (см. include/frame_capture.h).
+ */
+
+#include "frame_capture.h"
+#include "gl_state.h"
+#include "image_write.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <strings.h>
+
+static double millisecondsSince(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// шаблон имени файла допускает ровно одну подстановку вида %d или %05d
+static bool isFramePattern(const std::string& path) {
+    size_t percent = path.find('%');
+    if (percent == std::string::npos || path.find('%', percent + 1) != std::string::npos)
+        return false;
+    size_t i = percent + 1;
+    while (i < path.size() && path[i] >= '0' && path[i] <= '9')
+        i++;
+    return i < path.size() && path[i] == 'd';
+}
+
+FrameCapture::FrameCapture()
+    : m_Format(PNG),
+      m_Fps(60),
+      m_bRecording(false),
+      m_pStream(nullptr),
+      m_StreamWidth(0),
+      m_StreamHeight(0),
+      m_Next(0),
+      m_Oldest(0),
+      m_Index(0),
+      m_Frames(CAPTURE_MAX_QUEUED),
+      m_bWriteFailed(false),
+      m_Encoder(1) {
+    for (unsigned i = 0; i < CAPTURE_RING_SIZE; i++) {
+        Slot slot = { 0, 0, 0, 0, 0, false };
+        m_Slots[i] = slot;
+    }
+    FrameCaptureStats stats = { 0, 0, 0, 0, 0, 0.0 };
+    m_Stats = stats;
+}
+
+FrameCapture::~FrameCapture() {
+    // без контекста OpenGL можно только дописать то, что уже в очереди кодировщика
+    m_Encoder.wait();
+    if (m_pStream)
+        fclose(m_pStream);
+}
+
+bool FrameCapture::start(const char* path, int fps) {
+    if (m_bRecording)
+        throw std::logic_error("frame capture is already started");
+    const char* ext = strrchr(path, '.');
+    if (ext && strcasecmp(ext, ".png") == 0)
+        m_Format = PNG;
+    else if (ext && strcasecmp(ext, ".ppm") == 0)
+        m_Format = PPM;
+    else if (ext && strcasecmp(ext, ".y4m") == 0)
+        m_Format = Y4M;
+    else {
+        std::cout << "Unknown capture format of " << path << " (expected .png, .ppm or .y4m)" << std::endl;
+        return false;
+    }
+
+    m_Path = path;
+    bool hasPattern = m_Path.find('%') != std::string::npos;
+    if (hasPattern && (m_Format == Y4M || !isFramePattern(m_Path))) {
+        std::cout << "Bad frame number pattern in " << path << " (expected one %d)" << std::endl;
+        return false;
+    }
+    bool perFrame = m_Format == PNG || (m_Format == PPM && hasPattern);
+    if (m_Format == PNG && !hasPattern)
+        m_Path.insert(m_Path.size() - strlen(ext), "_%05d");
+    if (!perFrame) {
+        m_pStream = fopen(path, "wb");
+        if (!m_pStream) {
+            std::cout << "Failed opening of the capture file " << path << std::endl;
+            return false;
+        }
+    }
+    m_Fps = fps > 0 ? fps : 60;
+    m_StreamWidth = m_StreamHeight = 0;
+    m_Index = 0;
+    m_bWriteFailed = false;
+    m_FreeFrames.clear();
+    for (size_t i = 0; i < m_Frames.size(); i++)
+        m_FreeFrames.push_back(i);
+    FrameCaptureStats stats = { 0, 0, 0, 0, 0, 0.0 };
+    m_Stats = stats;
+    m_bRecording = true;
+    return true;
+} // start
+
+FrameCaptureStats FrameCapture::getStats() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Stats;
+}
+
+// свободный буфер для кодировщика; если все заняты - ждем, пока он освободит хотя бы один
+size_t FrameCapture::acquireFrame() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    if (m_FreeFrames.empty()) {
+        m_Stats.encoderStalls++;
+        m_FrameFreed.wait(lock, [this]() { return !m_FreeFrames.empty(); });
+    }
+    size_t frame = m_FreeFrames.back();
+    m_FreeFrames.pop_back();
+    return frame;
+}
+
+/*
+ * Отображает буфер слота в память и отдает кадр кодировщику. Барьер к этому времени обычно
+ * уже пройден; если нет - GPU отстал на весь круг буферов, и ждать все равно придется.
+ */
+void FrameCapture::gRetrieve(Slot& slot) {
+    GLenum result = glClientWaitSync(slot.fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stats.gpuStalls++;
+        }
+        do {
+            result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);   // 1 мс
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+    slot.pending = false;
+
+    size_t frame = acquireFrame();
+    size_t size = (size_t)slot.width * slot.height * 4;
+    m_Frames[frame].resize(size);
+    GLState::current().bindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (pixels) {
+        memcpy(m_Frames[frame].data(), pixels, size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    GLState::current().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!pixels) {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_FreeFrames.push_back(frame);
+        return;
+    }
+
+    int width = slot.width, height = slot.height;
+    size_t index = m_Index++;
+    m_Encoder.submit([this, frame, width, height, index]() { encode(frame, width, height, index); });
+} // gRetrieve
+
+// выполняется в потоке кодировщика
+void FrameCapture::encode(size_t frame, int width, int height, size_t index) {
+    const unsigned char* pixels = m_Frames[frame].data();
+    bool ok = true, skipped = false;
+    if (m_Format == Y4M) {
+        if (m_StreamWidth == 0) {
+            m_StreamWidth = width;
+            m_StreamHeight = height;
+            ok = writeY4MHeader(m_pStream, width, height, m_Fps);
+        }
+        if (width != m_StreamWidth || height != m_StreamHeight)
+            skipped = true;
+        else if (ok)
+            ok = writeY4MFrame(m_pStream, pixels, width, height, 4, true);
+    }
+    else if (m_pStream) {
+        ok = writePPM(m_pStream, pixels, width, height, 4, true);
+    }
+    else {
+        char path[4096];
+        snprintf(path, sizeof(path), m_Path.c_str(), (int)index);
+        if (m_Format == PNG) {
+            ok = writePNG(path, pixels, width, height, 4, true);
+        }
+        else {
+            FILE* file = fopen(path, "wb");
+            ok = file && writePPM(file, pixels, width, height, 4, true);
+            if (file)
+                ok = fclose(file) == 0 && ok;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (!ok && !m_bWriteFailed) {
+        std::cout << "Failed writing of the captured frame " << index << std::endl;
+        m_bWriteFailed = true;
+    }
+    if (skipped)
+        m_Stats.skipped++;
+    else if (ok)
+        m_Stats.written++;
+    m_FreeFrames.push_back(frame);
+    m_FrameFreed.notify_one();
+} // encode
+
+void FrameCapture::gCapture(GLuint framebuffer, int width, int height) {
+    if (!m_bRecording || width <= 0 || height <= 0)
+        return;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Slot& slot = m_Slots[m_Next];
+    // круг замкнулся раньше, чем GPU успел скопировать кадр
+    if (slot.pending) {
+        gRetrieve(slot);
+        m_Oldest = (m_Oldest + 1) % CAPTURE_RING_SIZE;
+    }
+
+    GLsizeiptr size = (GLsizeiptr)width * height * 4;
+    if (!slot.buffer)
+        glGenBuffers(1, &slot.buffer);
+    GLState::current().bindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (slot.capacity < size) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        slot.capacity = size;
+    }
+    GLState::current().bindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    GLState::current().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.width = width;
+    slot.height = height;
+    slot.pending = true;
+    m_Next = (m_Next + 1) % CAPTURE_RING_SIZE;
+
+    // забираем по порядку все кадры, которые GPU уже скопировал
+    while (m_Slots[m_Oldest].pending) {
+        GLenum result = glClientWaitSync(m_Slots[m_Oldest].fence, 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+            break;
+        gRetrieve(m_Slots[m_Oldest]);
+        m_Oldest = (m_Oldest + 1) % CAPTURE_RING_SIZE;
+    }
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stats.captured++;
+    m_Stats.captureMs += millisecondsSince(start);
+} // gCapture
+
+void FrameCapture::gStop() {
+    if (!m_bRecording)
+        return;
+    for (unsigned i = 0; i < CAPTURE_RING_SIZE; i++) {
+        Slot& slot = m_Slots[m_Oldest];
+        if (slot.pending)
+            gRetrieve(slot);
+        m_Oldest = (m_Oldest + 1) % CAPTURE_RING_SIZE;
+    }
+    m_Encoder.wait();
+    for (unsigned i = 0; i < CAPTURE_RING_SIZE; i++) {
+        if (m_Slots[i].buffer)
+            GLState::current().deleteBuffers(1, &m_Slots[i].buffer);
+        m_Slots[i].buffer = 0;
+        m_Slots[i].capacity = 0;
+    }
+    if (m_pStream) {
+        if (fclose(m_pStream) != 0 && !m_bWriteFailed)
+            std::cout << "Failed writing of the capture file " << m_Path << std::endl;
+        m_pStream = nullptr;
+    }
+    m_Next = m_Oldest = 0;
+    m_bRecording = false;
+} // gStop
@@ -0,0 +1,65 @@
+
+/*
+ * Загрузка функций OpenGL, которых нет в нашем профиле GLAD.
+ */
+
+#include "gl_ext.h"
+#include "texture_compress.h"
+#include "using_gl.h"
+
+#include <cstring>
+
+static bool versionAtLeast(int major, int minor) {
+    return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+bool glHasExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (ext && strcmp(ext, name) == 0)
+            return true;
+    }
+    return false;
+} // glHasExtension
+
+static void loadExtensions(GLExtensions& ext) {
+    memset(&ext, 0, sizeof(ext));
+
+    if (versionAtLeast(4, 4) || glHasExtension("GL_ARB_buffer_storage")) {
+        ext.BufferStorage = (PFNGLBUFFERSTORAGEPROC)glfwGetProcAddress("glBufferStorage");
+        ext.bufferStorage = ext.BufferStorage != nullptr;
+    }
+    if (versionAtLeast(4, 3) || glHasExtension("GL_ARB_multi_draw_indirect")) {
+        ext.MultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)glfwGetProcAddress("glMultiDrawElementsIndirect");
+        ext.multiDrawIndirect = ext.MultiDrawElementsIndirect != nullptr;
+    }
+    ext.textureCompressionS3TC = glHasExtension("GL_EXT_texture_compression_s3tc");
+    ext.textureCompressionBPTC = versionAtLeast(4, 2) || glHasExtension("GL_ARB_texture_compression_bptc");
+    ext.textureCompressionETC2 = versionAtLeast(4, 3) || glHasExtension("GL_ARB_ES3_compatibility");
+} // loadExtensions
+
+const GLExtensions& glExtensions() {
+    static GLExtensions s_ext;
+    static bool s_loaded = false;
+    if (!s_loaded) {
+        loadExtensions(s_ext);
+        s_loaded = true;
+    }
+    return s_ext;
+} // glExtensions
+
+bool glSupportsCompressedFormat(GLenum format) {
+    const GLExtensions& ext = glExtensions();
+    switch (format) {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            return ext.textureCompressionS3TC;
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+            return ext.textureCompressionBPTC;
+        case GL_COMPRESSED_RGB8_ETC2:
+            return ext.textureCompressionETC2;
+    }
+    return false;
+}
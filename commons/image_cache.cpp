@@ -0,0 +1,286 @@
+/*
+ * Реализация кэша декодированных изображений (см. include/image_cache.h).
+ */
+
+#include "image_cache.h"
+#include "image_decoder.h"
+#include "vfs.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static GLuint64 alignUp(GLuint64 offset) {
+    return (offset + IMAGE_CACHE_ALIGNMENT - 1) & ~(GLuint64)(IMAGE_CACHE_ALIGNMENT - 1);
+}
+
+GLuint64 hashBytes(const unsigned char* data, size_t size, GLuint64 seed) {
+    const GLuint64 m = 0xC6A4A7935BD1E995ull;
+    const int r = 47;
+    GLuint64 h = seed ^ (size * m);
+    size_t blocks = size / 8;
+    for (size_t i = 0; i < blocks; i++) {
+        GLuint64 k;
+        memcpy(&k, data + i * 8, 8);
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    const unsigned char* tail = data + blocks * 8;
+    size_t left = size & 7;
+    if (left) {
+        for (size_t i = left; i-- > 0; )
+            h ^= (GLuint64)tail[i] << (8 * i);
+        h *= m;
+    }
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+} // hashBytes
+
+//-------- CachedImage -------------------------------------------------
+CachedImage::CachedImage()
+    : m_Width(0),
+      m_Height(0),
+      m_pMapping(nullptr),
+      m_MappingSize(0),
+      m_Hit(false) {}
+
+CachedImage::~CachedImage() {
+    close();
+}
+
+void CachedImage::close() {
+    if (m_pMapping)
+        munmap(m_pMapping, m_MappingSize);
+    m_pMapping = nullptr;
+    m_MappingSize = 0;
+    std::vector<unsigned char>().swap(m_Pixels);
+    m_Levels.clear();
+    m_Width = m_Height = 0;
+    m_Hit = false;
+}
+
+//-------- ImageCache --------------------------------------------------
+ImageCache& ImageCache::current() {
+    static ImageCache s_cache;
+    return s_cache;
+}
+
+ImageCache::ImageCache() {
+    ImageCacheStats stats = { 0, 0, 0, 0 };
+    m_Stats = stats;
+}
+
+void ImageCache::setDirectory(const std::string& directory) {
+    m_Directory = directory;
+}
+
+ImageCacheStats ImageCache::getStats() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Stats;
+}
+
+std::string ImageCache::getPath(GLuint64 hash, size_t size, int channels) const {
+    char name[64];
+    snprintf(name, sizeof(name), "/%016llx-%llx-%d.img", (unsigned long long)hash, (unsigned long long)size,
+             channels);
+    return m_Directory + name;
+}
+
+bool ImageCache::find(GLuint64 hash, size_t size, int channels, CachedImage& image) {
+    image.close();
+    std::string path = getPath(hash, size, channels);
+    void* mapping = MAP_FAILED;
+    struct stat st;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(ImageCacheHeader))
+            mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+    }
+    if (mapping == MAP_FAILED) {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stats.misses++;
+        return false;
+    }
+
+    // запись проверяется целиком: поврежденная считается промахом и будет перезаписана
+    size_t fileSize = st.st_size;
+    const unsigned char* base = (const unsigned char*)mapping;
+    const ImageCacheHeader* header = (const ImageCacheHeader*)base;
+    bool ok = header->magic == IMAGE_CACHE_MAGIC && header->version == IMAGE_CACHE_VERSION
+           && header->sourceHash == hash && header->sourceSize == size && header->channels == (GLuint)channels
+           && header->width > 0 && header->height > 0 && header->levelCount > 0 && header->levelCount <= 32
+           && sizeof(ImageCacheHeader) + header->levelCount * sizeof(ImageCacheLevel) <= fileSize;
+    const ImageCacheLevel* levels = (const ImageCacheLevel*)(base + sizeof(ImageCacheHeader));
+    // размеры уровней - та же цепочка, что строит store: от размера изображения делением пополам
+    // до 1 x 1, иначе загрузчик прочитал бы за концом уровня или буфера
+    GLuint width = ok ? header->width : 0, height = ok ? header->height : 0;
+    for (GLuint i = 0; ok && i < header->levelCount; i++) {
+        bool last = i + 1 == header->levelCount;
+        ok = levels[i].width == width && levels[i].height == height && (width == 1 && height == 1) == last
+          && levels[i].size == (GLuint64)levels[i].width * levels[i].height * channels
+          && levels[i].offset <= fileSize && levels[i].size <= fileSize - levels[i].offset;
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+        if (ok) {
+            CachedLevel level = { (int)levels[i].width, (int)levels[i].height, base + levels[i].offset,
+                                  (size_t)levels[i].size };
+            image.m_Levels.push_back(level);
+        }
+    }
+    if (!ok) {
+        munmap(mapping, fileSize);
+        image.m_Levels.clear();
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stats.misses++;
+        return false;
+    }
+    image.m_pMapping = mapping;
+    image.m_MappingSize = fileSize;
+    image.m_Width = header->width;
+    image.m_Height = header->height;
+    image.m_Hit = true;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stats.hits++;
+    return true;
+} // find
+
+// следующий mip-уровень: среднее 2 x 2, у нечетного размера последний столбец или строка повторяются
+static void downsample(const unsigned char* src, int width, int height, int channels, unsigned char* dst) {
+    int w = std::max(1, width / 2), h = std::max(1, height / 2);
+    for (int y = 0; y < h; y++) {
+        const unsigned char* row0 = src + (size_t)std::min(2 * y, height - 1) * width * channels;
+        const unsigned char* row1 = src + (size_t)std::min(2 * y + 1, height - 1) * width * channels;
+        for (int x = 0; x < w; x++) {
+            int x0 = std::min(2 * x, width - 1) * channels, x1 = std::min(2 * x + 1, width - 1) * channels;
+            for (int c = 0; c < channels; c++)
+                *dst++ = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+        }
+    }
+} // downsample
+
+static bool writePadding(FILE* file, GLuint64 from, GLuint64 to) {
+    static const unsigned char zeros[IMAGE_CACHE_ALIGNMENT] = { 0 };
+    return from == to || fwrite(zeros, (size_t)(to - from), 1, file) == 1;
+}
+
+void ImageCache::store(GLuint64 hash, size_t size, int channels, std::vector<unsigned char>& pixels,
+                       int width, int height, CachedImage& image) {
+    image.close();
+    // уровни строятся в том же векторе друг за другом
+    std::vector<ImageCacheLevel> levels;
+    size_t total = 0;
+    for (int w = width, h = height; ; w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+        ImageCacheLevel level = { (GLuint)w, (GLuint)h, total, (GLuint64)w * h * channels };
+        levels.push_back(level);
+        total += level.size;
+        if (w == 1 && h == 1)
+            break;
+    }
+    pixels.resize(total);
+    for (size_t i = 1; i < levels.size(); i++)
+        downsample(pixels.data() + levels[i - 1].offset, levels[i - 1].width, levels[i - 1].height, channels,
+                   pixels.data() + levels[i].offset);
+    image.m_Pixels.swap(pixels);
+    image.m_Width = width;
+    image.m_Height = height;
+    for (size_t i = 0; i < levels.size(); i++) {
+        CachedLevel level = { (int)levels[i].width, (int)levels[i].height,
+                              image.m_Pixels.data() + levels[i].offset, (size_t)levels[i].size };
+        image.m_Levels.push_back(level);
+    }
+    if (!isEnabled())
+        return;
+
+    ImageCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = IMAGE_CACHE_MAGIC;
+    header.version = IMAGE_CACHE_VERSION;
+    header.sourceHash = hash;
+    header.sourceSize = size;
+    header.width = width;
+    header.height = height;
+    header.channels = channels;
+    header.levelCount = (GLuint)levels.size();
+    GLuint64 offset = alignUp(sizeof(header) + levels.size() * sizeof(ImageCacheLevel));
+    for (size_t i = 0; i < levels.size(); i++) {
+        levels[i].offset = offset;
+        offset = alignUp(offset + levels[i].size);
+    }
+
+    // каталог создается при первой записи; ошибку покажет fopen
+    if (mkdir(m_Directory.c_str(), 0755) != 0 && errno != EEXIST)
+        return;
+    std::string path = getPath(hash, size, channels);
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), ".%d.%zx.tmp", (int)getpid(), std::hash<std::thread::id>()(std::this_thread::get_id()));
+    std::string temporary = path + suffix;
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (!file) {
+        std::cout << "Failed writing of the image cache " << temporary << std::endl;
+        return;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+           && fwrite(levels.data(), levels.size() * sizeof(ImageCacheLevel), 1, file) == 1;
+    GLuint64 written = sizeof(header) + levels.size() * sizeof(ImageCacheLevel);
+    for (size_t i = 0; ok && i < levels.size(); i++) {
+        ok = writePadding(file, written, levels[i].offset)
+          && fwrite(image.m_Levels[i].data, image.m_Levels[i].size, 1, file) == 1;
+        written = levels[i].offset + levels[i].size;
+    }
+    ok = writePadding(file, written, offset) && ok;
+    ok = (fclose(file) == 0) && ok;
+    if (!ok || rename(temporary.c_str(), path.c_str()) != 0) {
+        std::cout << "Failed writing of the image cache " << path << std::endl;
+        unlink(temporary.c_str());
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stats.stores++;
+    m_Stats.bytesStored += offset;
+} // store
+
+bool loadCachedImage(const char* path, int channels, CachedImage& image) {
+    image.close();
+    VfsFile file;
+    if (!Vfs::current().read(path, file))
+        return false;
+    ImageCache& cache = ImageCache::current();
+    GLuint64 hash = 0;
+    if (cache.isEnabled()) {
+        hash = hashBytes(file.data(), file.size());
+        if (cache.find(hash, file.size(), channels, image))
+            return true;
+    }
+    ImageInfo info;
+    if (!getImageInfo(file.data(), file.size(), info))
+        return false;
+    std::vector<unsigned char> pixels((size_t)info.width * info.height * channels);
+    if (!decodeImage(file.data(), file.size(), channels, pixels.data()))
+        return false;
+    if (cache.isEnabled()) {
+        cache.store(hash, file.size(), channels, pixels, info.width, info.height, image);
+        return true;
+    }
+    // без кэша mip-уровни строить незачем: это сделает glGenerateMipmap
+    image.m_Pixels.swap(pixels);
+    image.m_Width = info.width;
+    image.m_Height = info.height;
+    CachedLevel level = { info.width, info.height, image.m_Pixels.data(), image.m_Pixels.size() };
+    image.m_Levels.push_back(level);
+    return true;
+} // loadCachedImage
@@ -0,0 +1,301 @@
+/*
+ * Реализация декодеров изображений (см. include/image_decoder.h).
+ */
+
+#include "image_decoder.h"
+#include "vfs.h"
+#include <SOIL/SOIL.h>
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include <dlfcn.h>
+
+// своя копия stb_image: static, чтобы не столкнуться с функциями stbi_* внутри libSOIL
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#include "stb_image.h"
+#pragma GCC diagnostic pop
+
+#if defined(__has_include)
+#if __has_include(<jpeglib.h>)
+#define IMAGE_DECODER_LIBJPEG
+#endif
+#endif
+
+#ifdef IMAGE_DECODER_LIBJPEG
+#include <csetjmp>
+#include <jpeglib.h>
+#endif
+
+//-------- stb_image ---------------------------------------------------
+class StbDecoder : public ImageDecoder {
+public:
+    const char* getName() const {
+        return "stb_image";
+    }
+
+    bool getInfo(const unsigned char* data, size_t size, ImageInfo& info) const {
+        return size <= INT_MAX && stbi_info_from_memory(data, (int)size, &info.width, &info.height, &info.channels);
+    }
+
+    bool decode(const unsigned char* data, size_t size, int channels, unsigned char* pixels) const {
+        if (size > INT_MAX)
+            return false;
+        int width, height, fileChannels;
+        stbi_uc* decoded = stbi_load_from_memory(data, (int)size, &width, &height, &fileChannels, channels);
+        if (!decoded)
+            return false;
+        memcpy(pixels, decoded, (size_t)width * height * channels);
+        stbi_image_free(decoded);
+        return true;
+    }
+}; // class StbDecoder
+
+//-------- SOIL --------------------------------------------------------
+class SoilDecoder : public ImageDecoder {
+public:
+    const char* getName() const {
+        return "SOIL";
+    }
+
+    // у SOIL нет чтения одного заголовка, а форматы у него те же, что у stb_image
+    bool getInfo(const unsigned char* data, size_t size, ImageInfo& info) const {
+        return size <= INT_MAX && stbi_info_from_memory(data, (int)size, &info.width, &info.height, &info.channels);
+    }
+
+    bool decode(const unsigned char* data, size_t size, int channels, unsigned char* pixels) const {
+        if (size > INT_MAX)
+            return false;
+        int width, height;
+        // SOIL_LOAD_L, SOIL_LOAD_LA, SOIL_LOAD_RGB и SOIL_LOAD_RGBA - это 1, 2, 3 и 4
+        unsigned char* decoded = SOIL_load_image_from_memory(data, (int)size, &width, &height, 0, channels);
+        if (!decoded)
+            return false;
+        memcpy(pixels, decoded, (size_t)width * height * channels);
+        SOIL_free_image_data(decoded);
+        return true;
+    }
+}; // class SoilDecoder
+
+//-------- libjpeg-turbo -----------------------------------------------
+#ifdef IMAGE_DECODER_LIBJPEG
+
+struct JpegError {
+    jpeg_error_mgr  manager;
+    jmp_buf         jump;
+};
+
+static void jpegErrorExit(j_common_ptr cinfo) {
+    longjmp(((JpegError*)cinfo->err)->jump, 1);
+}
+
+// предупреждения о поврежденных данных не печатаются: stb_image молчит о том же
+static void jpegOutputMessage(j_common_ptr) {}
+
+/*
+ * Функции библиотеки берутся через dlsym, поэтому примеры не зависят от libjpeg при сборке.
+ * Заголовок jpeglib.h задает размеры структур, и jpeg_CreateDecompress сверяет их с
+ * загруженной библиотекой: при несовпадении версий декодер просто откажется работать.
+ */
+class JpegDecoder : public ImageDecoder {
+public:
+    JpegDecoder()
+        : m_pLibrary(nullptr) {
+        char name[32];
+        snprintf(name, sizeof(name), "libjpeg.so.%d", JPEG_LIB_VERSION % 10 ? JPEG_LIB_VERSION : JPEG_LIB_VERSION / 10);
+        void* library = dlopen(name, RTLD_NOW | RTLD_LOCAL);
+        if (!library)
+            return;
+        bool ok = load(library, "jpeg_std_error", m_StdError)
+               && load(library, "jpeg_CreateDecompress", m_CreateDecompress)
+               && load(library, "jpeg_mem_src", m_MemSrc)
+               && load(library, "jpeg_read_header", m_ReadHeader)
+               && load(library, "jpeg_start_decompress", m_StartDecompress)
+               && load(library, "jpeg_read_scanlines", m_ReadScanlines)
+               && load(library, "jpeg_finish_decompress", m_FinishDecompress)
+               && load(library, "jpeg_destroy_decompress", m_DestroyDecompress);
+        if (ok)
+            m_pLibrary = library;
+        else
+            dlclose(library);
+    }
+
+    bool isAvailable() const {
+        return m_pLibrary != nullptr;
+    }
+
+    const char* getName() const {
+#ifdef LIBJPEG_TURBO_VERSION
+        return "libjpeg-turbo";
+#else
+        return "libjpeg";
+#endif
+    }
+
+    bool getInfo(const unsigned char* data, size_t size, ImageInfo& info) const {
+        return run(data, size, 0, nullptr, &info);
+    }
+
+    bool decode(const unsigned char* data, size_t size, int channels, unsigned char* pixels) const {
+        return run(data, size, channels, pixels, nullptr);
+    }
+
+private:
+    template <typename F>
+    static bool load(void* library, const char* name, F& function) {
+        function = (F)dlsym(library, name);
+        return function != nullptr;
+    }
+
+    /*
+     * Между setjmp и longjmp здесь нет объектов с деструкторами: ошибка в библиотеке
+     * возвращает управление к setjmp, и остается только освободить декомпрессор.
+     */
+    bool run(const unsigned char* data, size_t size, int channels, unsigned char* pixels, ImageInfo* info) const {
+        // SOI-маркер: остальные форматы даже не пытаемся разбирать
+        if (size < 4 || data[0] != 0xFF || data[1] != 0xD8 || (pixels && channels != 1 && channels != 3 && channels != 4))
+            return false;
+        jpeg_decompress_struct cinfo;
+        JpegError error;
+        memset(&cinfo, 0, sizeof(cinfo));
+        cinfo.err = m_StdError(&error.manager);
+        error.manager.error_exit = jpegErrorExit;
+        error.manager.output_message = jpegOutputMessage;
+        if (setjmp(error.jump)) {
+            m_DestroyDecompress(&cinfo);
+            return false;
+        }
+        m_CreateDecompress(&cinfo, JPEG_LIB_VERSION, sizeof(cinfo));
+        m_MemSrc(&cinfo, (unsigned char*)data, (unsigned long)size);
+        m_ReadHeader(&cinfo, TRUE);
+        if (info) {
+            info->width = cinfo.image_width;
+            info->height = cinfo.image_height;
+            info->channels = cinfo.num_components == 1 ? 1 : 3;
+            m_DestroyDecompress(&cinfo);
+            return true;
+        }
+        // без JCS_EXT_RGBA строка декодируется в RGB и расширяется до RGBA на месте
+        bool expand = false;
+        if (channels == 1)
+            cinfo.out_color_space = JCS_GRAYSCALE;
+        else if (channels == 3)
+            cinfo.out_color_space = JCS_RGB;
+        else {
+#ifdef JCS_ALPHA_EXTENSIONS
+            cinfo.out_color_space = JCS_EXT_RGBA;
+#else
+            cinfo.out_color_space = JCS_RGB;
+            expand = true;
+#endif
+        }
+        m_StartDecompress(&cinfo);
+        size_t pitch = (size_t)cinfo.output_width * channels;
+        if (cinfo.output_components != (expand ? 3 : channels)) {
+            m_DestroyDecompress(&cinfo);
+            return false;
+        }
+        while (cinfo.output_scanline < cinfo.output_height) {
+            JSAMPROW rows[4];
+            JDIMENSION first = cinfo.output_scanline;
+            JDIMENSION count = std::min<JDIMENSION>(4, cinfo.output_height - first);
+            for (JDIMENSION k = 0; k < count; k++)
+                rows[k] = pixels + (first + k) * pitch;
+            count = m_ReadScanlines(&cinfo, rows, count);
+            for (JDIMENSION k = 0; expand && k < count; k++) {
+                for (JDIMENSION x = cinfo.output_width; x-- > 0; ) {
+                    rows[k][x * 4 + 3] = 255;
+                    rows[k][x * 4 + 2] = rows[k][x * 3 + 2];
+                    rows[k][x * 4 + 1] = rows[k][x * 3 + 1];
+                    rows[k][x * 4 + 0] = rows[k][x * 3 + 0];
+                }
+            }
+        }
+        m_FinishDecompress(&cinfo);
+        m_DestroyDecompress(&cinfo);
+        return true;
+    } // run
+
+    void*                                       m_pLibrary;
+    decltype(&jpeg_std_error)                   m_StdError;
+    decltype(&jpeg_CreateDecompress)            m_CreateDecompress;
+    decltype(&jpeg_mem_src)                     m_MemSrc;
+    decltype(&jpeg_read_header)                 m_ReadHeader;
+    decltype(&jpeg_start_decompress)            m_StartDecompress;
+    decltype(&jpeg_read_scanlines)              m_ReadScanlines;
+    decltype(&jpeg_finish_decompress)           m_FinishDecompress;
+    decltype(&jpeg_destroy_decompress)          m_DestroyDecompress;
+}; // class JpegDecoder
+
+#endif // IMAGE_DECODER_LIBJPEG
+
+//-------- выбор декодера ----------------------------------------------
+/*
+ * Порядок - по скорости на textures/ (tools/image-bench): libjpeg-turbo на JPEG примерно
+ * в 1.3 раза быстрее stb_image 2.19. SOIL последний: внутри него stb_image 1.x без SIMD.
+ */
+static std::vector<ImageDecoder*> createDecoders() {
+    std::vector<ImageDecoder*> decoders;
+#ifdef IMAGE_DECODER_LIBJPEG
+    static JpegDecoder jpeg;
+    if (jpeg.isAvailable())
+        decoders.push_back(&jpeg);
+#endif
+    static StbDecoder stb;
+    static SoilDecoder soil;
+    decoders.push_back(&stb);
+    decoders.push_back(&soil);
+    return decoders;
+}
+
+static std::vector<ImageDecoder*>& registry() {
+    static std::vector<ImageDecoder*> s_decoders = createDecoders();
+    return s_decoders;
+}
+
+const std::vector<ImageDecoder*>& imageDecoders() {
+    return registry();
+}
+
+bool setPreferredImageDecoder(const char* name) {
+    std::vector<ImageDecoder*>& decoders = registry();
+    for (size_t i = 0; i < decoders.size(); i++) {
+        if (strcmp(decoders[i]->getName(), name) == 0) {
+            std::rotate(decoders.begin(), decoders.begin() + i, decoders.begin() + i + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool getImageInfo(const unsigned char* data, size_t size, ImageInfo& info) {
+    const std::vector<ImageDecoder*>& decoders = registry();
+    for (size_t i = 0; i < decoders.size(); i++) {
+        if (decoders[i]->getInfo(data, size, info))
+            return true;
+    }
+    return false;
+}
+
+bool decodeImage(const unsigned char* data, size_t size, int channels, unsigned char* pixels) {
+    const std::vector<ImageDecoder*>& decoders = registry();
+    ImageInfo info;
+    for (size_t i = 0; i < decoders.size(); i++) {
+        if (decoders[i]->getInfo(data, size, info) && decoders[i]->decode(data, size, channels, pixels))
+            return true;
+    }
+    return false;
+}
+
+bool loadImage(const char* path, int channels, std::vector<unsigned char>& pixels, ImageInfo& info) {
+    VfsFile file;
+    if (!Vfs::current().read(path, file) || !getImageInfo(file.data(), file.size(), info))
+        return false;
+    pixels.resize((size_t)info.width * info.height * channels);
+    return decodeImage(file.data(), file.size(), channels, pixels.data());
+}
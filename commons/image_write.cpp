@@ -0,0 +1,196 @@
+/*
+ * Реализация записи изображений (см. include/image_write.h).
+ */
+
+#include "image_write.h"
+
+#include <algorithm>
+#include <vector>
+
+//-------- контрольные суммы PNG ---------------------------------------
+static unsigned long crcTable[256];
+
+static void makeCrcTable() {
+    for (unsigned n = 0; n < 256; n++) {
+        unsigned long c = n;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320UL ^ (c >> 1) : c >> 1;
+        crcTable[n] = c;
+    }
+}
+
+static unsigned long updateCrc(unsigned long crc, const unsigned char* data, size_t size) {
+    for (size_t i = 0; i < size; i++)
+        crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static void updateAdler(unsigned long& a, unsigned long& b, const unsigned char* data, size_t size) {
+    // 5552 - наибольшая длина, на которой сумма еще помещается в 32 бита
+    while (size > 0) {
+        size_t block = size < 5552 ? size : 5552;
+        for (size_t i = 0; i < block; i++) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += block;
+        size -= block;
+    }
+}
+
+static void putBigEndian(unsigned char* out, unsigned long value) {
+    out[0] = (unsigned char)(value >> 24);
+    out[1] = (unsigned char)(value >> 16);
+    out[2] = (unsigned char)(value >> 8);
+    out[3] = (unsigned char)value;
+}
+
+// строка row файла (сверху вниз) в памяти
+static const unsigned char* sourceRow(const unsigned char* pixels, int width, int height, int channels,
+                                      bool bottomUp, int row) {
+    return pixels + (size_t)(bottomUp ? height - 1 - row : row) * width * channels;
+}
+
+static void toRGB(const unsigned char* src, int width, int channels, unsigned char* dst) {
+    for (int x = 0; x < width; x++, src += channels, dst += 3) {
+        dst[0] = src[0];
+        dst[1] = src[channels > 1 ? 1 : 0];
+        dst[2] = src[channels > 2 ? 2 : 0];
+    }
+}
+
+//-------- PNG ---------------------------------------------------------
+bool writePNG(const char* path, const unsigned char* pixels, int width, int height, int channels, bool bottomUp) {
+    static bool tableReady = (makeCrcTable(), true);
+    (void)tableReady;
+
+    FILE* file = fopen(path, "wb");
+    if (!file)
+        return false;
+
+    // IDAT: zlib-поток из stored-блоков по 65535 байт, каждая строка - байт фильтра 0 и RGB
+    const size_t rowSize = (size_t)width * 3 + 1;
+    const size_t rawSize = rowSize * height;
+    const size_t blocks = (rawSize + 65534) / 65535;
+    const size_t idatSize = 2 + rawSize + blocks * 5 + 4;
+
+    static const unsigned char signature[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+    unsigned char header[8 + 25];
+    std::copy(signature, signature + 8, header);
+    putBigEndian(header + 8, 13);
+    std::copy("IHDR", "IHDR" + 4, header + 12);
+    putBigEndian(header + 16, width);
+    putBigEndian(header + 20, height);
+    header[24] = 8;         // бит на канал
+    header[25] = 2;         // RGB
+    header[26] = header[27] = header[28] = 0;
+    putBigEndian(header + 29, updateCrc(0xFFFFFFFFUL, header + 12, 17) ^ 0xFFFFFFFFUL);
+    fwrite(header, 1, sizeof(header), file);
+
+    unsigned char chunk[8] = { 0, 0, 0, 0, 'I', 'D', 'A', 'T' };
+    putBigEndian(chunk, (unsigned long)idatSize);
+    fwrite(chunk, 1, 8, file);
+    unsigned long crc = updateCrc(0xFFFFFFFFUL, chunk + 4, 4);
+    unsigned long adlerA = 1, adlerB = 0;
+
+    // данные собираются в буфер блока и пишутся блоками deflate
+    std::vector<unsigned char> row(rowSize);
+    std::vector<unsigned char> block(5 + 65535);
+    size_t blockUsed = 0, written = 0;
+    const unsigned char zlibHeader[2] = { 0x78, 0x01 };
+    fwrite(zlibHeader, 1, 2, file);
+    crc = updateCrc(crc, zlibHeader, 2);
+    for (int y = 0; y < height; y++) {
+        row[0] = 0;
+        toRGB(sourceRow(pixels, width, height, channels, bottomUp, y), width, channels, &row[1]);
+        updateAdler(adlerA, adlerB, row.data(), rowSize);
+        size_t offset = 0;
+        while (offset < rowSize) {
+            size_t take = std::min(rowSize - offset, (size_t)65535 - blockUsed);
+            std::copy(row.begin() + offset, row.begin() + offset + take, block.begin() + 5 + blockUsed);
+            blockUsed += take;
+            offset += take;
+            if (blockUsed == 65535 || written + blockUsed == rawSize) {
+                bool last = written + blockUsed == rawSize;
+                block[0] = last ? 1 : 0;
+                block[1] = (unsigned char)blockUsed;
+                block[2] = (unsigned char)(blockUsed >> 8);
+                block[3] = (unsigned char)~block[1];
+                block[4] = (unsigned char)~block[2];
+                fwrite(block.data(), 1, blockUsed + 5, file);
+                crc = updateCrc(crc, block.data(), blockUsed + 5);
+                written += blockUsed;
+                blockUsed = 0;
+            }
+        }
+    }
+    unsigned char tail[4 + 4 + 12];
+    putBigEndian(tail, (adlerB << 16) | adlerA);
+    crc = updateCrc(crc, tail, 4);
+    putBigEndian(tail + 4, crc ^ 0xFFFFFFFFUL);
+    putBigEndian(tail + 8, 0);
+    std::copy("IEND", "IEND" + 4, tail + 12);
+    putBigEndian(tail + 16, updateCrc(0xFFFFFFFFUL, tail + 12, 4) ^ 0xFFFFFFFFUL);
+    fwrite(tail, 1, sizeof(tail), file);
+
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+} // writePNG
+
+//-------- PPM ---------------------------------------------------------
+bool writePPM(FILE* file, const unsigned char* pixels, int width, int height, int channels, bool bottomUp) {
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    std::vector<unsigned char> row((size_t)width * 3);
+    for (int y = 0; y < height; y++) {
+        toRGB(sourceRow(pixels, width, height, channels, bottomUp, y), width, channels, row.data());
+        fwrite(row.data(), 1, row.size(), file);
+    }
+    return !ferror(file);
+} // writePPM
+
+//-------- Y4M ---------------------------------------------------------
+bool writeY4MHeader(FILE* file, int width, int height, int fps) {
+    fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, fps);
+    return !ferror(file);
+}
+
+bool writeY4MFrame(FILE* file, const unsigned char* pixels, int width, int height, int channels, bool bottomUp) {
+    const int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    std::vector<unsigned char> rgb((size_t)width * height * 3);
+    for (int y = 0; y < height; y++)
+        toRGB(sourceRow(pixels, width, height, channels, bottomUp, y), width, channels, &rgb[(size_t)y * width * 3]);
+
+    std::vector<unsigned char> luma((size_t)width * height);
+    std::vector<unsigned char> u((size_t)chromaWidth * chromaHeight), v(u.size());
+    for (size_t i = 0; i < luma.size(); i++) {
+        const unsigned char* p = &rgb[i * 3];
+        luma[i] = (unsigned char)(((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) >> 8) + 16);
+    }
+    // цвет усредняется по квадрату 2 x 2, у нечетного края квадрат неполный
+    for (int cy = 0; cy < chromaHeight; cy++) {
+        for (int cx = 0; cx < chromaWidth; cx++) {
+            int r = 0, g = 0, b = 0, count = 0;
+            for (int y = cy * 2; y < std::min(height, cy * 2 + 2); y++) {
+                for (int x = cx * 2; x < std::min(width, cx * 2 + 2); x++) {
+                    const unsigned char* p = &rgb[((size_t)y * width + x) * 3];
+                    r += p[0];
+                    g += p[1];
+                    b += p[2];
+                    count++;
+                }
+            }
+            r /= count;
+            g /= count;
+            b /= count;
+            u[cy * chromaWidth + cx] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            v[cy * chromaWidth + cx] = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+    fputs("FRAME\n", file);
+    fwrite(luma.data(), 1, luma.size(), file);
+    fwrite(u.data(), 1, u.size(), file);
+    fwrite(v.data(), 1, v.size(), file);
+    return !ferror(file);
+} // writeY4MFrame
@@ -0,0 +1,166 @@
+/*
+ * Запись и чтение файлов KTX (см. include/ktx_file.h).
+ */
+
+#include "ktx_file.h"
+#include "texture_compress.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+static const GLubyte ktxIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+static size_t alignUp(size_t value) {
+    return (value + 3) & ~(size_t)3;
+}
+
+// размер уровня, который требует формат: у сжатых - блоки 4 x 4, у остальных строки
+// пикселей, выровненные на 4 байта. 0 - формат неизвестен, и размер проверить нельзя
+static size_t levelSize(const KtxHeader& h, GLuint width, GLuint height) {
+    if (isCompressedFormat(h.glInternalFormat))
+        return h.glFormat == 0 && h.glType == 0 ? compressedSize(h.glInternalFormat, width, height) : 0;
+    size_t components = 0, bytes = 0;
+    switch (h.glFormat) {
+    case GL_RED:  components = 1; break;
+    case GL_RG:   components = 2; break;
+    case GL_RGB:
+    case GL_BGR:  components = 3; break;
+    case GL_RGBA:
+    case GL_BGRA: components = 4; break;
+    }
+    switch (h.glType) {
+    case GL_UNSIGNED_BYTE:
+    case GL_BYTE:           bytes = 1; break;
+    case GL_UNSIGNED_SHORT:
+    case GL_SHORT:
+    case GL_HALF_FLOAT:     bytes = 2; break;
+    case GL_UNSIGNED_INT:
+    case GL_INT:
+    case GL_FLOAT:          bytes = 4; break;
+    }
+    return alignUp(width * components * bytes) * height;
+} // levelSize
+
+bool writeKtxFile(const char* path, const KtxImage& image) {
+    KtxHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.identifier, ktxIdentifier, sizeof(ktxIdentifier));
+    header.endianness = KTX_ENDIANNESS;
+    header.glType = image.type;
+    header.glTypeSize = 1;                      // GL_UNSIGNED_BYTE; для сжатых форматов спецификация требует 1
+    header.glFormat = image.format;
+    header.glInternalFormat = image.internalFormat;
+    header.glBaseInternalFormat = image.baseFormat;
+    header.pixelWidth = image.levels.empty() ? 0 : image.levels[0].width;
+    header.pixelHeight = image.levels.empty() ? 0 : image.levels[0].height;
+    header.numberOfFaces = 1;
+    header.numberOfMipmapLevels = (GLuint)image.levels.size();
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        std::cout << "Failed writing of the texture " << path << std::endl;
+        return false;
+    }
+    static const unsigned char zeros[4] = { 0 };
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (size_t i = 0; ok && i < image.levels.size(); i++) {
+        const std::vector<unsigned char>& data = image.levels[i].data;
+        GLuint imageSize = (GLuint)data.size();
+        ok = fwrite(&imageSize, sizeof(imageSize), 1, file) == 1;
+        if (!data.empty())
+            ok = ok && fwrite(data.data(), data.size(), 1, file) == 1;
+        size_t padding = alignUp(data.size()) - data.size();
+        if (padding)
+            ok = ok && fwrite(zeros, padding, 1, file) == 1;
+    }
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        std::cout << "Failed writing of the texture " << path << std::endl;
+    }
+    return ok;
+} // writeKtxFile
+
+bool parseKtx(const unsigned char* data, size_t size, KtxView& view) {
+    view.levels.clear();
+    if (size < sizeof(KtxHeader))
+        return false;
+    KtxHeader h;
+    memcpy(&h, data, sizeof(h));
+    bool ok = memcmp(h.identifier, ktxIdentifier, sizeof(ktxIdentifier)) == 0 && h.endianness == KTX_ENDIANNESS
+           && h.pixelWidth > 0 && h.pixelHeight > 0 && h.pixelDepth == 0 && h.numberOfArrayElements == 0
+           && h.numberOfFaces == 1 && h.bytesOfKeyValueData <= size - sizeof(KtxHeader);
+    size_t offset = sizeof(KtxHeader) + (ok ? h.bytesOfKeyValueData : 0);
+    // 0 уровней означает "построить mip-уровни при загрузке": в файле тогда только уровень 0.
+    // Уровней не больше, чем делений пополам до 1 x 1, - так и сдвиг ниже не выходит за 32 бита
+    GLuint levels = std::max(1u, h.numberOfMipmapLevels), fullChain = 1;
+    for (GLuint side = ok ? std::max(h.pixelWidth, h.pixelHeight) : 1; side > 1; side /= 2)
+        fullChain++;
+    ok = ok && levels <= fullChain;
+    for (GLuint i = 0; ok && i < levels; i++) {
+        GLuint imageSize = 0;
+        ok = offset + sizeof(imageSize) <= size;
+        if (!ok)
+            break;
+        memcpy(&imageSize, data + offset, sizeof(imageSize));
+        offset += sizeof(imageSize);
+        KtxLevelView level;
+        level.width = std::max(1u, h.pixelWidth >> i);
+        level.height = std::max(1u, h.pixelHeight >> i);
+        // иначе загрузчик прочитал бы за концом уровня
+        size_t expected = levelSize(h, level.width, level.height);
+        ok = expected != 0 && imageSize == expected && imageSize <= size - offset;
+        if (!ok)
+            break;
+        level.data = data + offset;
+        level.size = imageSize;
+        view.levels.push_back(level);
+        // выравнивание после последнего уровня может отсутствовать
+        offset = std::min(size, offset + alignUp(imageSize));
+    }
+    if (!ok) {
+        view.levels.clear();
+        return false;
+    }
+    view.internalFormat = h.glInternalFormat;
+    view.baseFormat = h.glBaseInternalFormat;
+    view.format = h.glFormat;
+    view.type = h.glType;
+    return true;
+} // parseKtx
+
+bool readKtxFile(const char* path, KtxImage& image) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        std::cout << "Failed loading of the texture " << path << std::endl;
+        return false;
+    }
+    std::vector<unsigned char> data;
+    bool ok = fseek(file, 0, SEEK_END) == 0;
+    long size = ok ? ftell(file) : -1;
+    ok = size >= 0 && fseek(file, 0, SEEK_SET) == 0;
+    if (ok) {
+        data.resize(size);
+        ok = size == 0 || fread(data.data(), size, 1, file) == 1;
+    }
+    fclose(file);
+    KtxView view;
+    image.levels.clear();
+    if (!ok || !parseKtx(data.data(), data.size(), view)) {
+        std::cout << "Failed loading of the texture " << path << ": bad KTX file" << std::endl;
+        return false;
+    }
+    for (size_t i = 0; i < view.levels.size(); i++) {
+        KtxLevel level;
+        level.width = view.levels[i].width;
+        level.height = view.levels[i].height;
+        image.levels.push_back(level);
+        image.levels.back().data.assign(view.levels[i].data, view.levels[i].data + view.levels[i].size);
+    }
+    image.internalFormat = view.internalFormat;
+    image.baseFormat = view.baseFormat;
+    image.format = view.format;
+    image.type = view.type;
+    return true;
+} // readKtxFile
@@ -0,0 +1,57 @@
+/*
+ * Реализация выбора уровня детализации (см. include/lod_selector.h).
+ */
+
+#include "lod_selector.h"
+
+#include <cmath>
+
+LodSelector::LodSelector(GLfloat pixelError, GLfloat hysteresis, GLfloat fadeTime)
+    : m_PixelError(pixelError),
+      m_Hysteresis(hysteresis),
+      m_FadeTime(fadeTime),
+      m_PixelsPerUnit(0.0f) {
+    setViewport(600.0f, 0.785398f);
+}
+
+void LodSelector::setViewport(GLfloat height, GLfloat fovY) {
+    m_PixelsPerUnit = height / (2.0f * tanf(fovY * 0.5f));
+}
+
+GLfloat LodSelector::projectedError(GLfloat error, GLfloat size, GLfloat distance) const {
+    // вплотную к камере ошибка считается бесконечной: нужен самый подробный уровень
+    if (distance <= 1e-4f)
+        return error > 0.0f ? HUGE_VALF : 0.0f;
+    return error * size / distance * m_PixelsPerUnit;
+}
+
+GLuint LodSelector::select(LodState& state, const MeshLod* lods, GLuint lodCount,
+                           GLfloat size, GLfloat distance, GLfloat deltaTime) const {
+    if (lodCount == 0)
+        return 0;
+    GLuint lod = state.lod < lodCount ? state.lod : lodCount - 1;
+    if (projectedError(lods[lod].error, size, distance) > m_PixelError * (1.0f + m_Hysteresis)) {
+        // текущий уровень слишком грубый
+        while (lod > 0 && projectedError(lods[lod].error, size, distance) > m_PixelError)
+            lod--;
+    }
+    else {
+        while (lod + 1 < lodCount
+               && projectedError(lods[lod + 1].error, size, distance) <= m_PixelError * (1.0f - m_Hysteresis))
+            lod++;
+    }
+
+    if (lod != state.lod) {
+        // новый переход начинается с уровня, который был виден полностью
+        if (!state.isFading() || state.fade >= 0.5f)
+            state.previousLod = state.lod;
+        state.lod = lod;
+        state.fade = m_FadeTime > 0.0f ? 0.0f : 1.0f;
+    }
+    else if (state.isFading()) {
+        state.fade = m_FadeTime > 0.0f ? state.fade + deltaTime / m_FadeTime : 1.0f;
+        if (state.fade > 1.0f)
+            state.fade = 1.0f;
+    }
+    return state.lod;
+} // select
@@ -0,0 +1,173 @@
+
+/*
+ * Реализация пакета мешей MeshBatch.
+ */
+
+#include "mesh_batch.h"
+#include "stream_buffer.h"
+#include "gl_ext.h"
+#include "gl_state.h"
+
+#include <cstring>
+#include <stdexcept>
+
+MeshBatch::MeshBatch(GLsizei vertexStride, GLuint maxObjects)
+    : m_Stride(vertexStride),
+      m_MaxObjects(maxObjects),
+      m_ObjectIdIndex(-1),
+      m_Objects(0),
+      m_Vao(0),
+      m_Vbo(0),
+      m_Ebo(0),
+      m_ObjectIdBuffer(0),
+      m_pIndirect(nullptr),
+      m_bIndirectEnabled(true) {
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+MeshBatch::~MeshBatch() {
+    GLState& gl = GLState::current();
+    if (m_pIndirect)
+        delete m_pIndirect;
+    if (m_Vao)
+        gl.deleteVertexArrays(1, &m_Vao);
+    GLuint buffers[] = { m_Vbo, m_Ebo, m_ObjectIdBuffer };
+    gl.deleteBuffers(3, buffers);
+} // ~MeshBatch
+
+void MeshBatch::setAttribute(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei offset) {
+    Attribute attr = { index, size, type, normalized, offset };
+    m_Attributes.push_back(attr);
+}
+
+void MeshBatch::enableObjectId(GLuint index) {
+    m_ObjectIdIndex = index;
+}
+
+GLuint MeshBatch::addMesh(const void* vertices, GLsizei vertexCount, const GLuint* indices, GLsizei indexCount) {
+    if (m_Vao) {
+        throw std::logic_error("mesh batch is already built");
+    }
+    Mesh mesh;
+    mesh.firstIndex = (GLuint)m_Indices.size();
+    mesh.indexCount = indexCount;
+    mesh.baseVertex = (GLint)(m_Vertices.size() / m_Stride);
+    const unsigned char* bytes = (const unsigned char*)vertices;
+    m_Vertices.insert(m_Vertices.end(), bytes, bytes + (size_t)vertexCount * m_Stride);
+    m_Indices.insert(m_Indices.end(), indices, indices + indexCount);
+    m_Meshes.push_back(mesh);
+    return (GLuint)m_Meshes.size() - 1;
+} // addMesh
+
+void MeshBatch::build() {
+    GLState& gl = GLState::current();
+    glGenVertexArrays(1, &m_Vao);
+    glGenBuffers(1, &m_Vbo);
+    glGenBuffers(1, &m_Ebo);
+    gl.bindVertexArray(m_Vao);
+
+    gl.bindBuffer(GL_ARRAY_BUFFER, m_Vbo);
+    glBufferData(GL_ARRAY_BUFFER, m_Vertices.size(), m_Vertices.data(), GL_STATIC_DRAW);
+    gl.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_Ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_Indices.size() * sizeof(GLuint), m_Indices.data(), GL_STATIC_DRAW);
+
+    for (size_t i = 0; i < m_Attributes.size(); i++) {
+        const Attribute& a = m_Attributes[i];
+        glVertexAttribPointer(a.index, a.size, a.type, a.normalized, m_Stride, (GLvoid*)(size_t)a.offset);
+        glEnableVertexAttribArray(a.index);
+    }
+
+    if (m_ObjectIdIndex >= 0) {
+        // номера объектов 0, 1, 2, ... - атрибут экземпляра со смещением baseInstance
+        std::vector<GLuint> ids(m_MaxObjects);
+        for (GLuint i = 0; i < m_MaxObjects; i++)
+            ids[i] = i;
+        glGenBuffers(1, &m_ObjectIdBuffer);
+        gl.bindBuffer(GL_ARRAY_BUFFER, m_ObjectIdBuffer);
+        glBufferData(GL_ARRAY_BUFFER, ids.size() * sizeof(GLuint), ids.data(), GL_STATIC_DRAW);
+        glVertexAttribIPointer(m_ObjectIdIndex, 1, GL_UNSIGNED_INT, 0, (GLvoid*)0);
+        glVertexAttribDivisor(m_ObjectIdIndex, 1);
+        glEnableVertexAttribArray(m_ObjectIdIndex);
+    }
+
+    if (glExtensions().multiDrawIndirect) {
+        m_pIndirect = new StreamBuffer(GL_DRAW_INDIRECT_BUFFER, m_MaxObjects * sizeof(DrawElementsIndirectCommand));
+    }
+
+    // данные уже на GPU, копии в памяти больше не нужны
+    std::vector<unsigned char>().swap(m_Vertices);
+    std::vector<GLuint>().swap(m_Indices);
+} // build
+
+void MeshBatch::begin() {
+    m_Commands.clear();
+    m_Objects = 0;
+} // begin
+
+GLuint MeshBatch::draw(GLuint mesh, GLuint instanceCount) {
+    if (mesh >= m_Meshes.size()) {
+        throw std::logic_error("unknown mesh in the batch");
+    }
+    if (m_Objects + instanceCount > m_MaxObjects) {
+        throw std::logic_error("too many objects in the batch");
+    }
+    const Mesh& m = m_Meshes[mesh];
+    DrawElementsIndirectCommand cmd;
+    cmd.count = m.indexCount;
+    cmd.instanceCount = instanceCount;
+    cmd.firstIndex = m.firstIndex;
+    cmd.baseVertex = m.baseVertex;
+    cmd.baseInstance = m_Objects;
+    m_Commands.push_back(cmd);
+    m_Objects += instanceCount;
+    return cmd.baseInstance;
+} // draw
+
+void MeshBatch::submit(GLenum mode) {
+    memset(&m_Stats, 0, sizeof(m_Stats));
+    m_Stats.commands = (GLuint)m_Commands.size();
+    if (m_Commands.empty())
+        return;
+
+    GLState& gl = GLState::current();
+    gl.bindVertexArray(m_Vao);
+
+    if (m_pIndirect && m_bIndirectEnabled) {
+        GLintptr offset;
+        GLsizeiptr size = m_Commands.size() * sizeof(DrawElementsIndirectCommand);
+        void* dst = m_pIndirect->map(size, sizeof(GLuint), &offset);
+        memcpy(dst, m_Commands.data(), size);
+        m_pIndirect->unmap();
+        if (m_ObjectIdIndex >= 0) {
+            // смещение атрибута могло остаться от запасного пути
+            gl.bindBuffer(GL_ARRAY_BUFFER, m_ObjectIdBuffer);
+            glVertexAttribIPointer(m_ObjectIdIndex, 1, GL_UNSIGNED_INT, 0, (GLvoid*)0);
+            m_Stats.apiCalls++;
+        }
+        gl.bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_pIndirect->getBuffer());
+        glExtensions().MultiDrawElementsIndirect(mode, GL_UNSIGNED_INT, (GLvoid*)offset, (GLsizei)m_Commands.size(), 0);
+        m_pIndirect->endFrame();
+        m_Stats.apiCalls++;
+        m_Stats.indirect = true;
+        return;
+    }
+
+    /*
+     * GL 3.3: baseInstance не поддерживается, поэтому номер первого объекта
+     * передается сдвигом указателя на атрибут объекта.
+     */
+    if (m_ObjectIdIndex >= 0)
+        gl.bindBuffer(GL_ARRAY_BUFFER, m_ObjectIdBuffer);
+    for (size_t i = 0; i < m_Commands.size(); i++) {
+        const DrawElementsIndirectCommand& cmd = m_Commands[i];
+        if (m_ObjectIdIndex >= 0) {
+            glVertexAttribIPointer(m_ObjectIdIndex, 1, GL_UNSIGNED_INT, 0,
+                                   (GLvoid*)(cmd.baseInstance * sizeof(GLuint)));
+            m_Stats.apiCalls++;
+        }
+        glDrawElementsInstancedBaseVertex(mode, cmd.count, GL_UNSIGNED_INT,
+                                          (GLvoid*)(cmd.firstIndex * sizeof(GLuint)),
+                                          cmd.instanceCount, cmd.baseVertex);
+        m_Stats.apiCalls++;
+    }
+} // submit
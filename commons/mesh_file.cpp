@@ -0,0 +1,259 @@
+
+/*
+ * Запись и загрузка двоичных мешей (см. include/mesh_file.h).
+ */
+
+#include "mesh_file.h"
+#include "gl_state.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cfloat>
+#include <iostream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static GLuint64 alignUp(GLuint64 value) {
+    return (value + MESH_FILE_ALIGNMENT - 1) & ~(GLuint64)(MESH_FILE_ALIGNMENT - 1);
+}
+
+// байт, которые атрибут занимает в вершине; 0 - тип, который glVertexAttribPointer не примет
+static GLuint64 attributeBytes(const MeshAttribute& a) {
+    if (a.size < 1 || a.size > 4)
+        return 0;
+    switch (a.type) {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:          return a.size;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:             return 2 * a.size;
+    case GL_INT:
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:                  return 4 * a.size;
+    case GL_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+        return a.size == 4 ? 4 : 0;
+    }
+    return 0;
+} // attributeBytes
+
+//-------- MeshData ----------------------------------------------------
+MeshData::MeshData()
+    : vertexStride(0) {
+    for (int k = 0; k < 3; k++) {
+        boundsMin[k] = 0.0f;
+        boundsMax[k] = 0.0f;
+    }
+}
+
+void MeshData::computeBounds() {
+    const MeshAttribute* position = nullptr;
+    for (size_t i = 0; i < attributes.size(); i++)
+        if (attributes[i].index == 0)
+            position = &attributes[i];
+    if (!position || position->type != GL_FLOAT || position->size < 3) {
+        throw std::logic_error("mesh bounds need a float position in attribute 0");
+    }
+    for (int k = 0; k < 3; k++) {
+        boundsMin[k] = FLT_MAX;
+        boundsMax[k] = -FLT_MAX;
+    }
+    size_t count = vertexCount();
+    for (size_t v = 0; v < count; v++) {
+        const GLfloat* p = (const GLfloat*)&vertices[v * vertexStride + position->offset];
+        for (int k = 0; k < 3; k++) {
+            if (p[k] < boundsMin[k])
+                boundsMin[k] = p[k];
+            if (p[k] > boundsMax[k])
+                boundsMax[k] = p[k];
+        }
+    }
+} // computeBounds
+
+//-------- запись ------------------------------------------------------
+bool writeMeshFile(const char* path, const MeshData& mesh) {
+    if (mesh.attributes.size() > MESH_MAX_ATTRIBUTES || mesh.lods.size() > MESH_MAX_LODS) {
+        throw std::logic_error("too many mesh attributes or LODs");
+    }
+    MeshFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = MESH_FILE_MAGIC;
+    header.version = MESH_FILE_VERSION;
+    header.vertexStride = mesh.vertexStride;
+    header.vertexCount = (GLuint)mesh.vertexCount();
+    header.indexCount = (GLuint)mesh.indices.size();
+    header.indexType = header.vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    header.attributeCount = (GLuint)mesh.attributes.size();
+    for (size_t i = 0; i < mesh.attributes.size(); i++)
+        header.attributes[i] = mesh.attributes[i];
+    if (mesh.lods.empty()) {
+        header.lodCount = 1;
+        header.lods[0].indexCount = header.indexCount;
+    }
+    else {
+        header.lodCount = (GLuint)mesh.lods.size();
+        for (size_t i = 0; i < mesh.lods.size(); i++)
+            header.lods[i] = mesh.lods[i];
+    }
+    memcpy(header.boundsMin, mesh.boundsMin, sizeof(header.boundsMin));
+    memcpy(header.boundsMax, mesh.boundsMax, sizeof(header.boundsMax));
+
+    size_t indexSize = header.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    header.vertexOffset = alignUp(sizeof(header));
+    header.vertexSize = mesh.vertices.size();
+    header.indexOffset = alignUp(header.vertexOffset + header.vertexSize);
+    header.indexSize = (GLuint64)mesh.indices.size() * indexSize;
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        std::cout << "Failed writing of the mesh " << path << std::endl;
+        return false;
+    }
+    static const unsigned char zeros[MESH_FILE_ALIGNMENT] = { 0 };
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && fwrite(zeros, header.vertexOffset - sizeof(header), 1, file) == 1;
+    if (header.vertexSize)
+        ok = ok && fwrite(mesh.vertices.data(), header.vertexSize, 1, file) == 1;
+    size_t padding = header.indexOffset - header.vertexOffset - header.vertexSize;
+    if (padding)
+        ok = ok && fwrite(zeros, padding, 1, file) == 1;
+    if (header.indexType == GL_UNSIGNED_SHORT) {
+        std::vector<GLushort> shorts(mesh.indices.begin(), mesh.indices.end());
+        if (!shorts.empty())
+            ok = ok && fwrite(shorts.data(), header.indexSize, 1, file) == 1;
+    }
+    else if (header.indexSize) {
+        ok = ok && fwrite(mesh.indices.data(), header.indexSize, 1, file) == 1;
+    }
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        std::cout << "Failed writing of the mesh " << path << std::endl;
+    }
+    return ok;
+} // writeMeshFile
+
+//-------- MeshFile ----------------------------------------------------
+MeshFile::MeshFile()
+    : m_pData(nullptr),
+      m_Size(0),
+      m_Vao(0),
+      m_Vbo(0),
+      m_Ebo(0) {
+    memset(&m_Header, 0, sizeof(m_Header));
+}
+
+MeshFile::~MeshFile() {
+    close();
+    release();
+} // ~MeshFile
+
+bool MeshFile::open(const char* path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        std::cout << "Failed loading of the mesh " << path << std::endl;
+        return false;
+    }
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(MeshFileHeader))
+        data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);        // отображение остается действительным и без дескриптора
+    if (data == MAP_FAILED) {
+        std::cout << "Failed loading of the mesh " << path << std::endl;
+        return false;
+    }
+    m_pData = (const unsigned char*)data;
+    m_Size = st.st_size;
+    memcpy(&m_Header, m_pData, sizeof(m_Header));
+
+    const MeshFileHeader& h = m_Header;
+    GLuint64 indexBytes = h.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    bool valid = h.magic == MESH_FILE_MAGIC && h.version == MESH_FILE_VERSION
+              && h.attributeCount <= MESH_MAX_ATTRIBUTES && h.lodCount >= 1 && h.lodCount <= MESH_MAX_LODS
+              && (h.indexType == GL_UNSIGNED_SHORT || h.indexType == GL_UNSIGNED_INT)
+              && h.indexSize == h.indexCount * indexBytes
+              && h.vertexSize == (GLuint64)h.vertexCount * h.vertexStride;
+    // смещения из файла произвольны: offset + size могло бы переполниться, поэтому сравнивается
+    // с остатком файла
+    valid = valid && h.vertexOffset <= m_Size && h.vertexSize <= m_Size - h.vertexOffset
+                  && h.indexOffset <= m_Size && h.indexSize <= m_Size - h.indexOffset;
+    // атрибут целиком внутри вершины; 16 - наименьшее GL_MAX_VERTEX_ATTRIBS в OpenGL 3.3
+    for (GLuint i = 0; valid && i < h.attributeCount; i++) {
+        const MeshAttribute& a = h.attributes[i];
+        GLuint64 bytes = attributeBytes(a);
+        valid = bytes != 0 && a.index < 16 && (GLuint64)a.offset + bytes <= h.vertexStride;
+    }
+    for (GLuint i = 0; valid && i < h.lodCount; i++)
+        valid = (GLuint64)h.lods[i].firstIndex + h.lods[i].indexCount <= h.indexCount;
+    if (!valid) {
+        std::cout << "Failed loading of the mesh " << path << ": bad header" << std::endl;
+        close();
+        return false;
+    }
+    // блоки будут читаться подряд один раз (MADV_* - не битовые флаги, каждый совет отдельно)
+    madvise((void*)m_pData, m_Size, MADV_SEQUENTIAL);
+    madvise((void*)m_pData, m_Size, MADV_WILLNEED);
+    return true;
+} // open
+
+void MeshFile::close() {
+    if (m_pData) {
+        munmap((void*)m_pData, m_Size);
+        m_pData = nullptr;
+        m_Size = 0;
+    }
+} // close
+
+void MeshFile::upload() {
+    if (!m_pData) {
+        throw std::logic_error("mesh file is not opened");
+    }
+    release();
+    GLState& gl = GLState::current();
+    glGenVertexArrays(1, &m_Vao);
+    glGenBuffers(1, &m_Vbo);
+    glGenBuffers(1, &m_Ebo);
+    gl.bindVertexArray(m_Vao);
+
+    gl.bindBuffer(GL_ARRAY_BUFFER, m_Vbo);
+    glBufferData(GL_ARRAY_BUFFER, m_Header.vertexSize, vertexData(), GL_STATIC_DRAW);
+    gl.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_Ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_Header.indexSize, indexData(), GL_STATIC_DRAW);
+
+    for (GLuint i = 0; i < m_Header.attributeCount; i++) {
+        const MeshAttribute& a = m_Header.attributes[i];
+        glVertexAttribPointer(a.index, a.size, a.type, a.normalized ? GL_TRUE : GL_FALSE,
+                              m_Header.vertexStride, (GLvoid*)(size_t)a.offset);
+        glEnableVertexAttribArray(a.index);
+    }
+} // upload
+
+void MeshFile::draw(GLuint lod, GLsizei instanceCount) const {
+    if (!m_Vao) {
+        throw std::logic_error("mesh is not uploaded");
+    }
+    if (lod >= m_Header.lodCount)
+        lod = m_Header.lodCount - 1;
+    const MeshLod& l = m_Header.lods[lod];
+    size_t indexSize = m_Header.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    GLState::current().bindVertexArray(m_Vao);
+    glDrawElementsInstanced(GL_TRIANGLES, l.indexCount, m_Header.indexType,
+                            (GLvoid*)(l.firstIndex * indexSize), instanceCount);
+} // draw
+
+void MeshFile::release() {
+    GLState& gl = GLState::current();
+    if (m_Vao) {
+        gl.deleteVertexArrays(1, &m_Vao);
+        m_Vao = 0;
+    }
+    GLuint buffers[] = { m_Vbo, m_Ebo };
+    if (m_Vbo || m_Ebo)
+        gl.deleteBuffers(2, buffers);
+    m_Vbo = m_Ebo = 0;
+} // release
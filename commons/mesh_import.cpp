@@ -0,0 +1,1022 @@
+
+/*
+ * Импорт OBJ и glTF (см. include/mesh_import.h).
+ */
+
+#include "mesh_import.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//-------- общие функции -----------------------------------------------
+static bool readFile(const std::string& path, std::vector<char>& data) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data.resize(size > 0 ? size : 0);
+    bool ok = size >= 0 && (size == 0 || fread(data.data(), size, 1, file) == 1);
+    fclose(file);
+    return ok;
+} // readFile
+
+static void setImportAttributes(MeshData& mesh) {
+    MeshAttribute position = { 0, 3, GL_FLOAT, GL_FALSE, 0 };
+    MeshAttribute normal   = { 1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat) };
+    MeshAttribute texCoord = { 2, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat) };
+    mesh.vertexStride = MESH_IMPORT_STRIDE;
+    mesh.attributes.clear();
+    mesh.attributes.push_back(position);
+    mesh.attributes.push_back(normal);
+    mesh.attributes.push_back(texCoord);
+    mesh.lods.clear();
+}
+
+/*
+ * Сглаженные нормали: сумма нормалей треугольников (с весом площади) в каждой вершине.
+ * Вычисляются только у вершин, отмеченных в missing; нормали из файла остаются как есть.
+ */
+static void generateNormals(MeshData& mesh, const std::vector<char>& missing) {
+    const size_t count = mesh.vertexCount();
+    GLfloat* v = (GLfloat*)mesh.vertices.data();
+    for (size_t i = 0; i < count; i++)
+        if (missing[i])
+            v[i * 8 + 3] = v[i * 8 + 4] = v[i * 8 + 5] = 0.0f;
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        if (!missing[mesh.indices[i]] && !missing[mesh.indices[i + 1]] && !missing[mesh.indices[i + 2]])
+            continue;
+        GLfloat* a = v + mesh.indices[i] * 8;
+        GLfloat* b = v + mesh.indices[i + 1] * 8;
+        GLfloat* c = v + mesh.indices[i + 2] * 8;
+        GLfloat e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        GLfloat e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        GLfloat n[3] = { e1[1] * e2[2] - e1[2] * e2[1],
+                         e1[2] * e2[0] - e1[0] * e2[2],
+                         e1[0] * e2[1] - e1[1] * e2[0] };
+        GLfloat* corners[3] = { a, b, c };
+        for (int j = 0; j < 3; j++)
+            if (missing[mesh.indices[i + j]])
+                for (int k = 0; k < 3; k++)
+                    corners[j][3 + k] += n[k];
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!missing[i])
+            continue;
+        GLfloat* n = v + i * 8 + 3;
+        GLfloat len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len > 0.0f) {
+            n[0] /= len;
+            n[1] /= len;
+            n[2] /= len;
+        }
+    }
+} // generateNormals
+
+static std::string extensionOf(const char* path) {
+    std::string p(path);
+    size_t dot = p.rfind('.');
+    std::string ext = dot == std::string::npos ? std::string() : p.substr(dot + 1);
+    for (size_t i = 0; i < ext.size(); i++)
+        ext[i] = (char)tolower(ext[i]);
+    return ext;
+}
+
+//-------- OBJ ---------------------------------------------------------
+namespace {
+
+/*
+ * Файл, отображенный в память только для чтения.
+ */
+class MappedFile {
+public:
+    MappedFile() : m_pData(nullptr), m_Size(0) {}
+    ~MappedFile() {
+        if (m_pData)
+            munmap((void*)m_pData, m_Size);
+    }
+
+    bool open(const char* path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                m_pData = (const char*)data;
+                m_Size = st.st_size;
+                // порядок чтения и подкачка заранее - два разных совета
+                madvise(data, m_Size, MADV_SEQUENTIAL);
+                madvise(data, m_Size, MADV_WILLNEED);
+            }
+        }
+        ::close(fd);
+        return m_pData != nullptr;
+    }
+
+    const char* data() const {
+        return m_pData;
+    }
+    size_t size() const {
+        return m_Size;
+    }
+
+private:
+    const char* m_pData;
+    size_t      m_Size;
+};
+
+struct ObjKey {
+    int v, t, n;
+    bool operator==(const ObjKey& other) const {
+        return v == other.v && t == other.t && n == other.n;
+    }
+};
+
+inline size_t hashKey(const ObjKey& k) {
+    size_t h = ((size_t)(unsigned)k.v * 73856093u) ^ ((size_t)(unsigned)k.t * 19349663u) ^ ((size_t)(unsigned)k.n * 83492791u);
+    return h ^ (h >> 15);
+}
+
+// Отрицательные индексы OBJ отсчитываются от конца: до разрешения они хранятся относительно начала куска
+#define OBJ_RELATIVE_V  1
+#define OBJ_RELATIVE_T  2
+#define OBJ_RELATIVE_N  4
+
+/*
+ * Результат разбора одного куска файла. Вершины треугольников (углы) хранят индексы с 0;
+ * -1 означает, что компоненты нет.
+ */
+struct ObjChunk {
+    const char*                 begin;
+    const char*                 end;
+    std::vector<GLfloat>        positions;
+    std::vector<GLfloat>        texCoords;
+    std::vector<GLfloat>        normals;
+    std::vector<ObjKey>         corners;
+    std::vector<unsigned char>  relative;
+    bool                        ok;
+};
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && isSpace(*p))
+        p++;
+    return p;
+}
+
+/*
+ * Быстрый разбор десятичного числа в духе std::from_chars (его нет в C++11): цифры копятся в 64-битной
+ * мантиссе, затем умножаются на степень десяти из таблицы. Для чисел, которые пишут в OBJ (до 19 значащих
+ * цифр), результат совпадает с strtof или отличается от него на одну единицу младшего разряда float.
+ * \return Указатель на символ после числа или p, если числа нет
+ */
+const char* parseFloat(const char* p, const char* end, GLfloat& out) {
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    unsigned long long mantissa = 0;
+    int exponent = 0, digits = 0;
+    bool any = false;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, any = true) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        }
+        else {
+            exponent++;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, any = true) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+        }
+    }
+    if (!any) {
+        // inf, nan и прочая экзотика - через стандартную функцию
+        char buffer[32];
+        size_t n = 0;
+        for (p = start; p < end && n + 1 < sizeof(buffer) && !isSpace(*p) && *p != '\n'; p++)
+            buffer[n++] = *p;
+        buffer[n] = '\0';
+        char* tail;
+        out = strtof(buffer, &tail);
+        return tail == buffer ? start : start + (tail - buffer);
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool negativeExp = false;
+        if (q < end && (*q == '-' || *q == '+'))
+            negativeExp = *q++ == '-';
+        if (q < end && *q >= '0' && *q <= '9') {
+            int e = 0;
+            for (; q < end && *q >= '0' && *q <= '9'; q++)
+                if (e < 10000)
+                    e = e * 10 + (*q - '0');
+            exponent += negativeExp ? -e : e;
+            p = q;
+        }
+    }
+    double value = (double)mantissa;
+    if (exponent < 0)
+        value = exponent >= -22 ? value / powers[-exponent] : value * pow(10.0, exponent);
+    else if (exponent > 0)
+        value = exponent <= 22 ? value * powers[exponent] : value * pow(10.0, exponent);
+    out = (GLfloat)(negative ? -value : value);
+    return p;
+} // parseFloat
+
+const char* parseInt(const char* p, const char* end, long& out) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    const char* digits = p;
+    long value = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+        value = value * 10 + (*p - '0');
+    out = negative ? -value : value;
+    return p == digits ? nullptr : p;
+}
+
+// читает count чисел подряд; недостающие остаются нулями
+inline void parseFloats(const char* p, const char* end, int count, std::vector<GLfloat>& out) {
+    for (int k = 0; k < count; k++) {
+        GLfloat value = 0.0f;
+        p = skipSpaces(p, end);
+        const char* next = parseFloat(p, end, value);
+        out.push_back(next == p ? 0.0f : value);
+        p = next;
+    }
+}
+
+// номер из OBJ в номер с 0; отрицательный остается относительным (флаг в relative)
+inline int objIndex(long value, size_t localCount, unsigned char flag, unsigned char& relative) {
+    if (value > 0)
+        return (int)(value - 1);
+    if (value < 0) {
+        relative |= flag;
+        return (int)((long)localCount + value);
+    }
+    return -1;
+}
+
+void parseObjChunk(ObjChunk* chunk) {
+    const char* p = chunk->begin;
+    const char* end = chunk->end;
+    std::vector<ObjKey> polygon;
+    std::vector<unsigned char> polygonRelative;
+    chunk->ok = true;
+    while (p < end) {
+        const char* eol = (const char*)memchr(p, '\n', end - p);
+        if (!eol)
+            eol = end;
+        p = skipSpaces(p, eol);
+        if (p + 1 < eol && p[0] == 'v' && isSpace(p[1])) {
+            parseFloats(p + 1, eol, 3, chunk->positions);
+        }
+        else if (p + 2 < eol && p[0] == 'v' && p[1] == 't' && isSpace(p[2])) {
+            parseFloats(p + 2, eol, 2, chunk->texCoords);
+        }
+        else if (p + 2 < eol && p[0] == 'v' && p[1] == 'n' && isSpace(p[2])) {
+            parseFloats(p + 2, eol, 3, chunk->normals);
+        }
+        else if (p + 1 < eol && p[0] == 'f' && isSpace(p[1])) {
+            polygon.clear();
+            polygonRelative.clear();
+            const char* q = p + 1;
+            while (true) {
+                q = skipSpaces(q, eol);
+                if (q >= eol || *q == '#')
+                    break;
+                long value = 0;
+                unsigned char relative = 0;
+                ObjKey key = { -1, -1, -1 };
+                const char* next = parseInt(q, eol, value);
+                if (!next || value == 0) {
+                    chunk->ok = false;
+                    return;
+                }
+                key.v = objIndex(value, chunk->positions.size() / 3, OBJ_RELATIVE_V, relative);
+                if (next < eol && *next == '/') {
+                    next++;
+                    if (next < eol && *next != '/') {
+                        const char* t = parseInt(next, eol, value);
+                        if (t) {
+                            key.t = objIndex(value, chunk->texCoords.size() / 2, OBJ_RELATIVE_T, relative);
+                            next = t;
+                        }
+                    }
+                    if (next < eol && *next == '/') {
+                        const char* n = parseInt(next + 1, eol, value);
+                        if (n) {
+                            key.n = objIndex(value, chunk->normals.size() / 3, OBJ_RELATIVE_N, relative);
+                            next = n;
+                        }
+                        else {
+                            next++;
+                        }
+                    }
+                }
+                polygon.push_back(key);
+                polygonRelative.push_back(relative);
+                q = next;
+            }
+            // многоугольник веером разбивается на треугольники
+            for (size_t i = 2; i < polygon.size(); i++) {
+                size_t corners[3] = { 0, i - 1, i };
+                for (int k = 0; k < 3; k++) {
+                    chunk->corners.push_back(polygon[corners[k]]);
+                    chunk->relative.push_back(polygonRelative[corners[k]]);
+                }
+            }
+        }
+        p = eol + 1;
+    }
+} // parseObjChunk
+
+/*
+ * Часть общей хэш-таблицы уникальных вершин. Ключ попадает в часть hashKey(key) % shards,
+ * поэтому части заполняются параллельно без блокировок.
+ */
+struct ObjShard {
+    std::vector<ObjKey>     keys;
+    std::vector<GLuint>     table;      // номер в keys + 1, 0 - пусто
+
+    GLuint insert(const ObjKey& key, size_t hash) {
+        if ((keys.size() + 1) * 2 > table.size())
+            grow();
+        size_t mask = table.size() - 1;
+        size_t slot = (hash >> 8) & mask;
+        while (table[slot]) {
+            if (keys[table[slot] - 1] == key)
+                return table[slot] - 1;
+            slot = (slot + 1) & mask;
+        }
+        keys.push_back(key);
+        table[slot] = (GLuint)keys.size();
+        return (GLuint)keys.size() - 1;
+    }
+
+    void grow() {
+        std::vector<GLuint> old;
+        old.swap(table);
+        table.assign(old.empty() ? 1024 : old.size() * 2, 0);
+        size_t mask = table.size() - 1;
+        for (size_t i = 0; i < old.size(); i++) {
+            if (!old[i])
+                continue;
+            size_t slot = (hashKey(keys[old[i] - 1]) >> 8) & mask;
+            while (table[slot])
+                slot = (slot + 1) & mask;
+            table[slot] = old[i];
+        }
+    }
+};
+
+// элемент массива array по сквозному номеру index: base - номера первых элементов кусков
+inline const GLfloat* chunkItem(const std::vector<ObjChunk>& chunks, const std::vector<size_t>& base,
+                                std::vector<GLfloat> ObjChunk::*array, size_t index, size_t components) {
+    size_t i = std::upper_bound(base.begin(), base.end(), index) - base.begin() - 1;
+    return &(chunks[i].*array)[(index - base[i]) * components];
+}
+
+// f(i) для i от 0 до threads - 1, каждый вызов в своем потоке
+template <typename Function>
+void parallelFor(unsigned threads, Function f) {
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; i++)
+        workers.push_back(std::thread(f, i));
+    f(0);
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+} // namespace
+
+bool importObj(const char* path, MeshData& mesh, unsigned threads, MeshImportStats* stats) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cout << "Failed loading of the mesh " << path << std::endl;
+        return false;
+    }
+
+    //---------------------------
+    // 1. Разбор кусков, границы кусков - по концам строк
+    //---------------------------
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    // кусок не меньше мегабайта: на маленьких файлах потоки не окупаются
+    threads = (unsigned)std::max<size_t>(1, std::min<size_t>(threads, file.size() / (1 << 20)));
+    std::vector<ObjChunk> chunks(threads);
+    const char* data = file.data();
+    const char* end = data + file.size();
+    const char* p = data;
+    for (unsigned i = 0; i < threads; i++) {
+        const char* chunkEnd = i + 1 == threads ? end : data + file.size() / threads * (i + 1);
+        if (chunkEnd < p)
+            chunkEnd = p;
+        const char* eol = (const char*)memchr(chunkEnd, '\n', end - chunkEnd);
+        chunkEnd = eol ? eol + 1 : end;
+        chunks[i].begin = p;
+        chunks[i].end = chunkEnd;
+        p = chunkEnd;
+    }
+    parallelFor(threads, [&](unsigned i) { parseObjChunk(&chunks[i]); });
+
+    //---------------------------
+    // 2. Сквозная нумерация: смещения кусков и разрешение относительных индексов
+    //---------------------------
+    std::vector<size_t> positionBase(threads + 1, 0), texCoordBase(threads + 1, 0);
+    std::vector<size_t> normalBase(threads + 1, 0), cornerBase(threads + 1, 0);
+    for (unsigned i = 0; i < threads; i++) {
+        if (!chunks[i].ok) {
+            std::cout << "Failed loading of the mesh " << path << ": bad face" << std::endl;
+            return false;
+        }
+        positionBase[i + 1] = positionBase[i] + chunks[i].positions.size() / 3;
+        texCoordBase[i + 1] = texCoordBase[i] + chunks[i].texCoords.size() / 2;
+        normalBase[i + 1] = normalBase[i] + chunks[i].normals.size() / 3;
+        cornerBase[i + 1] = cornerBase[i] + chunks[i].corners.size();
+    }
+    const long positionCount = positionBase[threads], texCoordCount = texCoordBase[threads];
+    const long normalCount = normalBase[threads];
+    const size_t cornerCount = cornerBase[threads];
+    std::vector<unsigned short> shardOf(cornerCount);
+    std::vector<char> bad(threads, 0);
+    parallelFor(threads, [&](unsigned i) {
+        ObjChunk& chunk = chunks[i];
+        for (size_t c = 0; c < chunk.corners.size(); c++) {
+            ObjKey& key = chunk.corners[c];
+            unsigned char relative = chunk.relative[c];
+            if (relative & OBJ_RELATIVE_V)
+                key.v += (int)positionBase[i];
+            if (relative & OBJ_RELATIVE_T)
+                key.t += (int)texCoordBase[i];
+            if (relative & OBJ_RELATIVE_N)
+                key.n += (int)normalBase[i];
+            if (key.v < 0 || key.v >= positionCount)
+                bad[i] = 1;
+            if (key.t >= texCoordCount || key.t < -1)
+                key.t = -1;
+            if (key.n >= normalCount || key.n < -1)
+                key.n = -1;
+            shardOf[cornerBase[i] + c] = (unsigned short)(hashKey(key) % threads);
+        }
+        std::vector<unsigned char>().swap(chunk.relative);
+    });
+    for (unsigned i = 0; i < threads; i++) {
+        if (bad[i]) {
+            std::cout << "Failed loading of the mesh " << path << ": bad face" << std::endl;
+            return false;
+        }
+    }
+
+    //---------------------------
+    // 3. Слияние одинаковых вершин: каждый поток отвечает за свою часть хэш-таблицы
+    //---------------------------
+    std::vector<GLuint> ids(cornerCount);
+    std::vector<ObjShard> shards(threads);
+    parallelFor(threads, [&](unsigned s) {
+        ObjShard& shard = shards[s];
+        for (unsigned i = 0; i < threads; i++) {
+            const std::vector<ObjKey>& corners = chunks[i].corners;
+            const unsigned short* owner = &shardOf[cornerBase[i]];
+            for (size_t c = 0; c < corners.size(); c++)
+                if (owner[c] == s)
+                    ids[cornerBase[i] + c] = shard.insert(corners[c], hashKey(corners[c]));
+        }
+        std::vector<GLuint>().swap(shard.table);
+    });
+    std::vector<size_t> shardBase(threads + 1, 0);
+    for (unsigned s = 0; s < threads; s++)
+        shardBase[s + 1] = shardBase[s] + shards[s].keys.size();
+    parallelFor(threads, [&](unsigned t) {
+        for (size_t c = cornerCount * t / threads; c < cornerCount * (t + 1) / threads; c++)
+            ids[c] += (GLuint)shardBase[shardOf[c]];
+    });
+    std::vector<unsigned short>().swap(shardOf);
+
+    // вершины нумеруются в порядке первого использования - так же, как при разборе в один поток
+    const size_t uniqueCount = shardBase[threads];
+    const GLuint UNUSED = ~0u;
+    std::vector<GLuint> remap(uniqueCount, UNUSED);
+    std::vector<const ObjKey*> order;
+    order.reserve(uniqueCount);
+    mesh.indices.resize(cornerCount);
+    for (unsigned i = 0; i < threads; i++) {
+        const std::vector<ObjKey>& corners = chunks[i].corners;
+        for (size_t c = 0; c < corners.size(); c++) {
+            GLuint& id = remap[ids[cornerBase[i] + c]];
+            if (id == UNUSED) {
+                id = (GLuint)order.size();
+                order.push_back(&corners[c]);
+            }
+            mesh.indices[cornerBase[i] + c] = id;
+        }
+    }
+    std::vector<GLuint>().swap(ids);
+
+    //---------------------------
+    // 4. Сборка вершин
+    //---------------------------
+    setImportAttributes(mesh);
+    mesh.vertices.assign(order.size() * MESH_IMPORT_STRIDE, 0);
+    // vn бывает не у всех граней: без нормали остаются только вершины граней без vn
+    std::vector<char> missing(order.size(), 0), anyMissing(threads, 0);
+    parallelFor(threads, [&](unsigned t) {
+        size_t first = order.size() * t / threads, last = order.size() * (t + 1) / threads;
+        GLfloat* v = (GLfloat*)mesh.vertices.data() + first * 8;
+        for (size_t i = first; i < last; i++, v += 8) {
+            const ObjKey& key = *order[i];
+            memcpy(v, chunkItem(chunks, positionBase, &ObjChunk::positions, key.v, 3), 3 * sizeof(GLfloat));
+            if (key.n >= 0)
+                memcpy(v + 3, chunkItem(chunks, normalBase, &ObjChunk::normals, key.n, 3), 3 * sizeof(GLfloat));
+            else
+                missing[i] = anyMissing[t] = 1;
+            if (key.t >= 0)
+                memcpy(v + 6, chunkItem(chunks, texCoordBase, &ObjChunk::texCoords, key.t, 2), 2 * sizeof(GLfloat));
+        }
+    });
+    if (std::find(anyMissing.begin(), anyMissing.end(), 1) != anyMissing.end())
+        generateNormals(mesh, missing);
+    mesh.computeBounds();
+
+    if (stats) {
+        stats->bytes = file.size();
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stats->threads = threads;
+    }
+    return true;
+} // importObj
+
+//-------- JSON --------------------------------------------------------
+namespace {
+
+/*
+ * Минимальный разборщик JSON, которого достаточно для glTF.
+ */
+struct Json {
+    enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+    Type                                        type;
+    double                                      number;
+    std::string                                 string;
+    std::vector<Json>                           items;
+    std::vector<std::pair<std::string, Json> >  members;
+
+    Json() : type(NUL), number(0.0) {}
+
+    const Json& operator[](const char* key) const {
+        for (size_t i = 0; i < members.size(); i++)
+            if (members[i].first == key)
+                return members[i].second;
+        return null();
+    }
+    const Json& operator[](size_t i) const {
+        return i < items.size() ? items[i] : null();
+    }
+    bool has(const char* key) const {
+        return (*this)[key].type != NUL;
+    }
+    size_t size() const {
+        return items.size();
+    }
+    long asInt(long def = 0) const {
+        return type == NUMBER ? (long)number : def;
+    }
+    static const Json& null() {
+        static Json value;
+        return value;
+    }
+};
+
+class JsonParser {
+public:
+    JsonParser(const char* begin, const char* end) : m_p(begin), m_End(end) {}
+
+    bool parse(Json& value) {
+        if (!parseValue(value, 0))
+            return false;
+        skip();
+        return m_p == m_End || *m_p == '\0';
+    }
+
+private:
+    void skip() {
+        while (m_p < m_End && (*m_p == ' ' || *m_p == '\t' || *m_p == '\n' || *m_p == '\r'))
+            m_p++;
+    }
+
+    bool parseValue(Json& value, int depth) {
+        skip();
+        if (m_p >= m_End || depth > 64)
+            return false;
+        char c = *m_p;
+        if (c == '{') {
+            value.type = Json::OBJECT;
+            m_p++;
+            skip();
+            if (m_p < m_End && *m_p == '}') {
+                m_p++;
+                return true;
+            }
+            while (true) {
+                std::pair<std::string, Json> member;
+                skip();
+                if (!parseString(member.first))
+                    return false;
+                skip();
+                if (m_p >= m_End || *m_p++ != ':')
+                    return false;
+                if (!parseValue(member.second, depth + 1))
+                    return false;
+                value.members.push_back(member);
+                skip();
+                if (m_p < m_End && *m_p == ',') {
+                    m_p++;
+                    continue;
+                }
+                return m_p < m_End && *m_p++ == '}';
+            }
+        }
+        if (c == '[') {
+            value.type = Json::ARRAY;
+            m_p++;
+            skip();
+            if (m_p < m_End && *m_p == ']') {
+                m_p++;
+                return true;
+            }
+            while (true) {
+                value.items.push_back(Json());
+                if (!parseValue(value.items.back(), depth + 1))
+                    return false;
+                skip();
+                if (m_p < m_End && *m_p == ',') {
+                    m_p++;
+                    continue;
+                }
+                return m_p < m_End && *m_p++ == ']';
+            }
+        }
+        if (c == '"') {
+            value.type = Json::STRING;
+            return parseString(value.string);
+        }
+        if (literal("true")) {
+            value.type = Json::BOOLEAN;
+            value.number = 1.0;
+            return true;
+        }
+        if (literal("false")) {
+            value.type = Json::BOOLEAN;
+            return true;
+        }
+        if (literal("null"))
+            return true;
+        // число: strtod остановится на первом символе после него
+        std::string token;
+        while (m_p < m_End && *m_p && strchr("+-0123456789.eE", *m_p))
+            token += *m_p++;
+        if (token.empty())
+            return false;
+        value.type = Json::NUMBER;
+        value.number = strtod(token.c_str(), nullptr);
+        return true;
+    }
+
+    bool literal(const char* word) {
+        size_t n = strlen(word);
+        if ((size_t)(m_End - m_p) >= n && strncmp(m_p, word, n) == 0) {
+            m_p += n;
+            return true;
+        }
+        return false;
+    }
+
+    bool parseString(std::string& out) {
+        if (m_p >= m_End || *m_p != '"')
+            return false;
+        m_p++;
+        while (m_p < m_End && *m_p != '"') {
+            char c = *m_p++;
+            if (c == '\\' && m_p < m_End) {
+                char e = *m_p++;
+                switch (e) {
+                    case 'n': out += '\n'; break;
+                    case 't': out += '\t'; break;
+                    case 'r': out += '\r'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'u': {
+                        // в путях и именах glTF встречается редко: сохраняем только ASCII
+                        unsigned code = 0;
+                        for (int i = 0; i < 4 && m_p < m_End; i++, m_p++) {
+                            char h = (char)tolower(*m_p);
+                            code = code * 16 + (unsigned)(h >= 'a' ? h - 'a' + 10 : h - '0');
+                        }
+                        out += code < 0x80 ? (char)code : '?';
+                        break;
+                    }
+                    default: out += e; break;
+                }
+            }
+            else {
+                out += c;
+            }
+        }
+        return m_p < m_End && *m_p++ == '"';
+    }
+
+    const char* m_p;
+    const char* m_End;
+};
+
+//-------- glTF --------------------------------------------------------
+bool decodeBase64(const char* p, const char* end, std::vector<char>& out) {
+    static const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    unsigned buffer = 0;
+    int bits = 0;
+    for (; p < end && *p != '='; p++) {
+        const char* c = strchr(alphabet, *p);
+        if (!c || !*p)
+            return false;
+        buffer = (buffer << 6) | (unsigned)(c - alphabet);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back((char)((buffer >> bits) & 0xff));
+        }
+    }
+    return true;
+} // decodeBase64
+
+struct GltfContext {
+    Json                                json;
+    std::vector<std::vector<char> >     buffers;
+};
+
+size_t componentSize(long componentType) {
+    switch (componentType) {
+        case GL_BYTE: case GL_UNSIGNED_BYTE:    return 1;
+        case GL_SHORT: case GL_UNSIGNED_SHORT:  return 2;
+        case GL_UNSIGNED_INT: case GL_FLOAT:    return 4;
+    }
+    return 0;
+}
+
+size_t componentCount(const std::string& type) {
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2")   return 2;
+    if (type == "VEC3")   return 3;
+    if (type == "VEC4")   return 4;
+    return 0;
+}
+
+/*
+ * Читает аксессор в числа GLfloat (components на элемент); нормированные целые переводятся в [0, 1].
+ */
+bool readAccessor(const GltfContext& ctx, long index, size_t components, std::vector<GLfloat>& out, size_t& count) {
+    const Json& accessor = ctx.json["accessors"][(size_t)index];
+    if (accessor.type != Json::OBJECT || accessor.has("sparse") || !accessor.has("bufferView"))
+        return false;
+    const Json& view = ctx.json["bufferViews"][(size_t)accessor["bufferView"].asInt()];
+    long buffer = view["buffer"].asInt(-1);
+    if (buffer < 0 || (size_t)buffer >= ctx.buffers.size())
+        return false;
+    long type = accessor["componentType"].asInt();
+    size_t n = componentCount(accessor["type"].string);
+    size_t size = componentSize(type);
+    if (n < components || size == 0)
+        return false;
+    count = accessor["count"].asInt();
+    size_t stride = view["byteStride"].asInt(n * size);
+    size_t offset = view["byteOffset"].asInt() + accessor["byteOffset"].asInt();
+    const std::vector<char>& data = ctx.buffers[buffer];
+    if (count && offset + (count - 1) * stride + n * size > data.size())
+        return false;
+
+    out.resize(count * components);
+    for (size_t i = 0; i < count; i++) {
+        const char* src = data.data() + offset + i * stride;
+        for (size_t k = 0; k < components; k++) {
+            GLfloat value;
+            switch (type) {
+                case GL_FLOAT:          memcpy(&value, src + k * 4, 4); break;
+                case GL_UNSIGNED_BYTE:  value = (unsigned char)src[k] / 255.0f; break;
+                case GL_UNSIGNED_SHORT: { GLushort s; memcpy(&s, src + k * 2, 2); value = s / 65535.0f; break; }
+                default: return false;
+            }
+            out[i * components + k] = value;
+        }
+    }
+    return true;
+} // readAccessor
+
+bool readIndices(const GltfContext& ctx, long index, std::vector<GLuint>& out) {
+    const Json& accessor = ctx.json["accessors"][(size_t)index];
+    if (accessor.type != Json::OBJECT || accessor.has("sparse") || !accessor.has("bufferView"))
+        return false;
+    const Json& view = ctx.json["bufferViews"][(size_t)accessor["bufferView"].asInt()];
+    long buffer = view["buffer"].asInt(-1);
+    if (buffer < 0 || (size_t)buffer >= ctx.buffers.size())
+        return false;
+    long type = accessor["componentType"].asInt();
+    size_t size = componentSize(type);
+    size_t count = accessor["count"].asInt();
+    size_t stride = view["byteStride"].asInt(size);
+    size_t offset = view["byteOffset"].asInt() + accessor["byteOffset"].asInt();
+    const std::vector<char>& data = ctx.buffers[buffer];
+    if (size == 0 || (count && offset + (count - 1) * stride + size > data.size()))
+        return false;
+    out.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const char* src = data.data() + offset + i * stride;
+        switch (type) {
+            case GL_UNSIGNED_BYTE:  out[i] = (unsigned char)src[0]; break;
+            case GL_UNSIGNED_SHORT: { GLushort s; memcpy(&s, src, 2); out[i] = s; break; }
+            case GL_UNSIGNED_INT:   memcpy(&out[i], src, 4); break;
+            default: return false;
+        }
+    }
+    return true;
+} // readIndices
+
+} // namespace
+
+bool importGltf(const char* path, MeshData& mesh) {
+    std::vector<char> file;
+    if (!readFile(path, file)) {
+        std::cout << "Failed loading of the mesh " << path << std::endl;
+        return false;
+    }
+    std::string dir(path);
+    dir = dir.substr(0, dir.find_last_of('/') + 1);
+
+    GltfContext ctx;
+    const char* jsonBegin = file.data();
+    const char* jsonEnd = file.data() + file.size();
+    std::vector<char> glbBuffer;
+    bool glb = file.size() >= 12 && memcmp(file.data(), "glTF", 4) == 0;
+    if (glb) {
+        // заголовок GLB (12 байт), затем блоки [длина][тип][данные]: JSON и необязательный BIN
+        size_t pos = 12;
+        while (pos + 8 <= file.size()) {
+            GLuint length, type;
+            memcpy(&length, &file[pos], 4);
+            memcpy(&type, &file[pos + 4], 4);
+            if (pos + 8 + length > file.size())
+                break;
+            if (type == 0x4E4F534A) {           // "JSON"
+                jsonBegin = &file[pos + 8];
+                jsonEnd = jsonBegin + length;
+            }
+            else if (type == 0x004E4942) {      // "BIN"
+                glbBuffer.assign(&file[pos + 8], &file[pos + 8] + length);
+            }
+            pos += 8 + ((length + 3) & ~3u);
+        }
+    }
+    if (!JsonParser(jsonBegin, jsonEnd).parse(ctx.json) || ctx.json.type != Json::OBJECT) {
+        std::cout << "Failed loading of the mesh " << path << ": bad JSON" << std::endl;
+        return false;
+    }
+
+    const Json& buffers = ctx.json["buffers"];
+    ctx.buffers.resize(buffers.size());
+    for (size_t i = 0; i < buffers.size(); i++) {
+        const std::string& uri = buffers[i]["uri"].string;
+        bool ok;
+        if (uri.empty()) {
+            ok = glb && i == 0;
+            ctx.buffers[i].swap(glbBuffer);
+        }
+        else if (uri.compare(0, 5, "data:") == 0) {
+            size_t comma = uri.find(',');
+            ok = comma != std::string::npos
+              && decodeBase64(uri.c_str() + comma + 1, uri.c_str() + uri.size(), ctx.buffers[i]);
+        }
+        else {
+            ok = readFile(dir + uri, ctx.buffers[i]);
+        }
+        if (!ok) {
+            std::cout << "Failed loading of the mesh " << path << ": buffer " << i << std::endl;
+            return false;
+        }
+    }
+
+    setImportAttributes(mesh);
+    mesh.vertices.clear();
+    mesh.indices.clear();
+    std::vector<char> missing;          // вершины примитивов без NORMAL
+    bool anyMissing = false;
+    const Json& meshes = ctx.json["meshes"];
+    for (size_t m = 0; m < meshes.size(); m++) {
+        const Json& primitives = meshes[m]["primitives"];
+        for (size_t p = 0; p < primitives.size(); p++) {
+            const Json& primitive = primitives[p];
+            if (primitive["mode"].asInt(GL_TRIANGLES) != GL_TRIANGLES)
+                continue;
+            const Json& attributes = primitive["attributes"];
+            std::vector<GLfloat> positions, normals, texCoords;
+            size_t count = 0, n = 0;
+            if (!readAccessor(ctx, attributes["POSITION"].asInt(-1), 3, positions, count)) {
+                std::cout << "Failed loading of the mesh " << path << ": bad POSITION" << std::endl;
+                return false;
+            }
+            if (attributes.has("NORMAL") && !(readAccessor(ctx, attributes["NORMAL"].asInt(), 3, normals, n) && n == count))
+                normals.clear();
+            if (attributes.has("TEXCOORD_0") && !(readAccessor(ctx, attributes["TEXCOORD_0"].asInt(), 2, texCoords, n) && n == count))
+                texCoords.clear();
+            anyMissing = anyMissing || normals.empty();
+
+            size_t base = mesh.vertexCount();
+            mesh.vertices.resize((base + count) * MESH_IMPORT_STRIDE, 0);
+            missing.resize(base + count, normals.empty());
+            GLfloat* v = (GLfloat*)mesh.vertices.data() + base * 8;
+            for (size_t i = 0; i < count; i++, v += 8) {
+                memcpy(v, &positions[i * 3], 3 * sizeof(GLfloat));
+                if (!normals.empty())
+                    memcpy(v + 3, &normals[i * 3], 3 * sizeof(GLfloat));
+                if (!texCoords.empty()) {
+                    v[6] = texCoords[i * 2];
+                    v[7] = 1.0f - texCoords[i * 2 + 1];     // в glTF начало координат вверху
+                }
+            }
+
+            std::vector<GLuint> indices;
+            if (primitive.has("indices")) {
+                if (!readIndices(ctx, primitive["indices"].asInt(), indices)) {
+                    std::cout << "Failed loading of the mesh " << path << ": bad indices" << std::endl;
+                    return false;
+                }
+            }
+            else {
+                indices.resize(count);
+                for (size_t i = 0; i < count; i++)
+                    indices[i] = (GLuint)i;
+            }
+            for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                if (indices[i] >= count || indices[i + 1] >= count || indices[i + 2] >= count)
+                    continue;
+                for (int k = 0; k < 3; k++)
+                    mesh.indices.push_back((GLuint)base + indices[i + k]);
+            }
+        }
+    }
+    if (mesh.vertices.empty()) {
+        std::cout << "Failed loading of the mesh " << path << ": no triangles" << std::endl;
+        return false;
+    }
+    if (anyMissing)
+        generateNormals(mesh, missing);
+    mesh.computeBounds();
+    return true;
+} // importGltf
+
+bool importMesh(const char* path, MeshData& mesh, unsigned threads, MeshImportStats* stats) {
+    std::string ext = extensionOf(path);
+    if (ext == "obj")
+        return importObj(path, mesh, threads, stats);
+    if (ext == "gltf" || ext == "glb") {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (!importGltf(path, mesh))
+            return false;
+        if (stats) {
+            struct stat st;
+            stats->bytes = stat(path, &st) == 0 ? st.st_size : 0;
+            stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            stats->threads = 1;
+        }
+        return true;
+    }
+    std::cout << "Failed loading of the mesh " << path << ": unknown format" << std::endl;
+    return false;
+} // importMesh
@@ -0,0 +1,378 @@
+
+/*
+ * Реализация обработки мешей (см. include/mesh_optimizer.h).
+ */
+
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace meshopt {
+
+//-------- моделирование кэша ------------------------------------------
+/*
+ * FIFO-кэш вершин. Время вершины - номер "вызова шейдера", на котором она попала
+ * в кэш; вершина в кэше, если с того момента прошло меньше cacheSize вызовов.
+ */
+class FifoCache {
+public:
+    FifoCache(size_t vertexCount, size_t cacheSize)
+        : m_Timestamps(vertexCount, 0),
+          m_Time(cacheSize + 1),
+          m_CacheSize(cacheSize) {}
+
+    // возвращает 1, если вершины не было в кэше
+    unsigned touch(GLuint v) {
+        if (m_Time - m_Timestamps[v] > m_CacheSize) {
+            m_Timestamps[v] = m_Time++;
+            return 1;
+        }
+        return 0;
+    }
+
+    // все вершины вытесняются из кэша
+    void flush() {
+        m_Time += m_CacheSize + 1;
+    }
+
+private:
+    std::vector<size_t> m_Timestamps;
+    size_t              m_Time;
+    size_t              m_CacheSize;
+};
+
+CacheStats analyzeVertexCache(const GLuint* indices, size_t indexCount, size_t vertexCount, size_t cacheSize) {
+    CacheStats stats = { 0.0f, 0.0f };
+    if (indexCount < 3 || vertexCount == 0)
+        return stats;
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> used(vertexCount, false);
+    size_t misses = 0, unique = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        misses += cache.touch(indices[i]);
+        if (!used[indices[i]]) {
+            used[indices[i]] = true;
+            unique++;
+        }
+    }
+    stats.acmr = (float)misses / (float)(indexCount / 3);
+    stats.atvr = (float)misses / (float)unique;
+    return stats;
+} // analyzeVertexCache
+
+//-------- сварка вершин -----------------------------------------------
+static size_t hashBytes(const unsigned char* data, size_t size) {
+    // FNV-1a
+    size_t h = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        h ^= data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+size_t weldVertices(const void* vertices, size_t vertexCount, size_t stride,
+                    const GLuint* indices, size_t indexCount,
+                    std::vector<unsigned char>& outVertices, std::vector<GLuint>& outIndices) {
+    const unsigned char* src = (const unsigned char*)vertices;
+    if (!indices)
+        indexCount = vertexCount;
+
+    // открытая адресация, размер таблицы - степень двойки
+    size_t tableSize = 1;
+    while (tableSize < vertexCount * 2)
+        tableSize <<= 1;
+    const GLuint EMPTY = ~0u;
+    std::vector<GLuint> table(tableSize, EMPTY);
+    std::vector<GLuint> remap(vertexCount, EMPTY);
+
+    outVertices.clear();
+    outVertices.reserve(vertexCount * stride);
+    size_t unique = 0;
+    for (size_t v = 0; v < vertexCount; v++) {
+        const unsigned char* vertex = src + v * stride;
+        size_t slot = hashBytes(vertex, stride) & (tableSize - 1);
+        while (table[slot] != EMPTY && memcmp(&outVertices[table[slot] * stride], vertex, stride) != 0)
+            slot = (slot + 1) & (tableSize - 1);
+        if (table[slot] == EMPTY) {
+            table[slot] = (GLuint)unique++;
+            outVertices.insert(outVertices.end(), vertex, vertex + stride);
+        }
+        remap[v] = table[slot];
+    }
+
+    outIndices.resize(indexCount);
+    for (size_t i = 0; i < indexCount; i++)
+        outIndices[i] = remap[indices ? indices[i] : i];
+    return unique;
+} // weldVertices
+
+//-------- Tipsify -----------------------------------------------------
+namespace {
+
+struct Adjacency {
+    std::vector<GLuint> offsets;    // начало списка треугольников вершины
+    std::vector<GLuint> triangles;  // номера треугольников
+    std::vector<GLuint> live;       // сколько треугольников вершины еще не выведено
+};
+
+void buildAdjacency(Adjacency& adj, const GLuint* indices, size_t indexCount, size_t vertexCount) {
+    adj.offsets.assign(vertexCount + 1, 0);
+    adj.live.assign(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; i++)
+        adj.live[indices[i]]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        adj.offsets[v + 1] = adj.offsets[v] + adj.live[v];
+    adj.triangles.resize(indexCount);
+    std::vector<GLuint> fill(adj.offsets.begin(), adj.offsets.end() - 1);
+    for (size_t i = 0; i < indexCount; i++)
+        adj.triangles[fill[indices[i]]++] = (GLuint)(i / 3);
+}
+
+} // namespace
+
+void optimizeVertexCache(GLuint* indices, size_t indexCount, size_t vertexCount,
+                         size_t cacheSize, std::vector<size_t>* clusters) {
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+    if (clusters)
+        clusters->clear();
+
+    Adjacency adj;
+    buildAdjacency(adj, indices, indexCount, vertexCount);
+
+    std::vector<GLuint> result;
+    result.reserve(indexCount);
+    std::vector<size_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<GLuint> deadEnd;
+    std::vector<GLuint> candidates;
+    size_t time = cacheSize + 1;
+    size_t cursor = 0;
+    long fanning = indices[0];
+    bool flushed = true;
+
+    while (fanning >= 0) {
+        if (flushed && clusters)
+            clusters->push_back(result.size() / 3);
+        candidates.clear();
+        // выводим все невыведенные треугольники вокруг веера
+        for (GLuint k = adj.offsets[fanning]; k < adj.offsets[fanning + 1]; k++) {
+            GLuint t = adj.triangles[k];
+            if (emitted[t])
+                continue;
+            for (int c = 0; c < 3; c++) {
+                GLuint v = indices[t * 3 + c];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                adj.live[v]--;
+                if (time - cacheTime[v] > cacheSize)
+                    cacheTime[v] = time++;
+            }
+            emitted[t] = true;
+        }
+
+        // следующий веер: вершина из кэша, которая останется в нем после вывода своих треугольников
+        long next = -1;
+        long best = -1;
+        for (size_t c = 0; c < candidates.size(); c++) {
+            GLuint v = candidates[c];
+            if (adj.live[v] == 0)
+                continue;
+            long priority = 0;
+            if (time - cacheTime[v] + 2 * adj.live[v] <= cacheSize)
+                priority = (long)(time - cacheTime[v]);
+            if (priority > best) {
+                best = priority;
+                next = v;
+            }
+        }
+        flushed = false;
+        if (next < 0) {
+            // тупик: берем недавнюю вершину из стека, иначе первую живую по порядку
+            while (!deadEnd.empty() && next < 0) {
+                GLuint d = deadEnd.back();
+                deadEnd.pop_back();
+                if (adj.live[d] > 0)
+                    next = d;
+            }
+            while (next < 0 && cursor < indexCount) {
+                GLuint v = indices[cursor++];
+                if (adj.live[v] > 0) {
+                    next = v;
+                    flushed = true;
+                }
+            }
+        }
+        fanning = next;
+    }
+    memcpy(indices, result.data(), result.size() * sizeof(GLuint));
+} // optimizeVertexCache
+
+//-------- перерисовка -------------------------------------------------
+namespace {
+
+struct Cluster {
+    size_t  start;
+    size_t  count;      // треугольников
+    float   sortKey;
+};
+
+bool clusterGreater(const Cluster& a, const Cluster& b) {
+    return a.sortKey > b.sortKey;
+}
+
+} // namespace
+
+void optimizeOverdraw(GLuint* indices, size_t indexCount, const void* vertices, size_t vertexCount,
+                      size_t stride, size_t positionOffset, float threshold, size_t cacheSize) {
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+        return;
+    const unsigned char* base = (const unsigned char*)vertices + positionOffset;
+
+    // жесткие границы: треугольник, все три вершины которого промахнулись мимо кэша
+    std::vector<size_t> hard;
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<unsigned> misses(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+        misses[t] = cache.touch(indices[t * 3]) + cache.touch(indices[t * 3 + 1]) + cache.touch(indices[t * 3 + 2]);
+        if (t == 0 || misses[t] == 3)
+            hard.push_back(t);
+    }
+    hard.push_back(triangleCount);
+
+    /*
+     * Мягкие границы: жесткий кластер режется на части, ACMR каждой из которых (со сброшенным
+     * в начале части кэшем) не хуже threshold * ACMR всего жесткого кластера.
+     */
+    std::vector<Cluster> clusters;
+    for (size_t h = 0; h + 1 < hard.size(); h++) {
+        size_t start = hard[h], end = hard[h + 1];
+        unsigned total = 0;
+        for (size_t t = start; t < end; t++)
+            total += misses[t];
+        float limit = (float)total / (float)(end - start) * threshold;
+
+        size_t clusterStart = start;
+        unsigned clusterMisses = 0;
+        cache.flush();
+        for (size_t t = start; t < end; t++) {
+            clusterMisses += cache.touch(indices[t * 3]) + cache.touch(indices[t * 3 + 1]) + cache.touch(indices[t * 3 + 2]);
+            size_t n = t - clusterStart + 1;
+            if (t + 1 == end || (float)clusterMisses / (float)n <= limit) {
+                Cluster c = { clusterStart, n, 0.0f };
+                clusters.push_back(c);
+                clusterStart = t + 1;
+                clusterMisses = 0;
+                cache.flush();
+            }
+        }
+    }
+
+    // центр меша
+    float meshCenter[3] = { 0.0f, 0.0f, 0.0f };
+    for (size_t i = 0; i < indexCount; i++) {
+        const GLfloat* p = (const GLfloat*)(base + (size_t)indices[i] * stride);
+        for (int k = 0; k < 3; k++)
+            meshCenter[k] += p[k];
+    }
+    for (int k = 0; k < 3; k++)
+        meshCenter[k] /= (float)indexCount;
+
+    // ключ кластера: насколько его средняя нормаль смотрит от центра меша
+    for (size_t c = 0; c < clusters.size(); c++) {
+        float center[3] = { 0.0f, 0.0f, 0.0f };
+        float normal[3] = { 0.0f, 0.0f, 0.0f };
+        float area = 0.0f;
+        for (size_t t = clusters[c].start; t < clusters[c].start + clusters[c].count; t++) {
+            const GLfloat* a = (const GLfloat*)(base + (size_t)indices[t * 3] * stride);
+            const GLfloat* b = (const GLfloat*)(base + (size_t)indices[t * 3 + 1] * stride);
+            const GLfloat* d = (const GLfloat*)(base + (size_t)indices[t * 3 + 2] * stride);
+            float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            float e2[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+            float n[3] = { e1[1] * e2[2] - e1[2] * e2[1],
+                           e1[2] * e2[0] - e1[0] * e2[2],
+                           e1[0] * e2[1] - e1[1] * e2[0] };
+            float w = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int k = 0; k < 3; k++) {
+                center[k] += (a[k] + b[k] + d[k]) / 3.0f * w;
+                normal[k] += n[k];
+            }
+            area += w;
+        }
+        float len = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (area > 0.0f && len > 0.0f) {
+            float key = 0.0f;
+            for (int k = 0; k < 3; k++)
+                key += (center[k] / area - meshCenter[k]) * normal[k] / len;
+            clusters[c].sortKey = key;
+        }
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), clusterGreater);
+
+    std::vector<GLuint> result;
+    result.reserve(indexCount);
+    for (size_t c = 0; c < clusters.size(); c++)
+        result.insert(result.end(), indices + clusters[c].start * 3,
+                      indices + (clusters[c].start + clusters[c].count) * 3);
+    memcpy(indices, result.data(), result.size() * sizeof(GLuint));
+} // optimizeOverdraw
+
+//-------- выборка вершин ----------------------------------------------
+size_t optimizeVertexFetch(void* vertices, size_t vertexCount, size_t stride,
+                           GLuint* indices, size_t indexCount) {
+    const GLuint UNUSED = ~0u;
+    std::vector<GLuint> remap(vertexCount, UNUSED);
+    std::vector<unsigned char> result;
+    result.reserve(vertexCount * stride);
+    const unsigned char* src = (const unsigned char*)vertices;
+    GLuint next = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        GLuint v = indices[i];
+        if (remap[v] == UNUSED) {
+            remap[v] = next++;
+            result.insert(result.end(), src + v * stride, src + (v + 1) * stride);
+        }
+        indices[i] = remap[v];
+    }
+    if (!result.empty())
+        memcpy(vertices, result.data(), result.size());
+    return next;
+} // optimizeVertexFetch
+
+//----------------------------------------------------------------------
+OptimizeReport optimizeMesh(std::vector<unsigned char>& vertices, size_t stride,
+                            std::vector<GLuint>& indices, size_t positionOffset) {
+    OptimizeReport report;
+    size_t vertexCount = vertices.size() / stride;
+    report.vertexCountBefore = vertexCount;
+
+    std::vector<GLuint> original = indices;
+    if (original.empty()) {
+        original.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++)
+            original[i] = (GLuint)i;
+    }
+    report.before = analyzeVertexCache(original.data(), original.size(), vertexCount);
+
+    std::vector<unsigned char> welded;
+    vertexCount = weldVertices(vertices.data(), vertexCount, stride,
+                               original.data(), original.size(), welded, indices);
+    optimizeVertexCache(indices.data(), indices.size(), vertexCount);
+    optimizeOverdraw(indices.data(), indices.size(), welded.data(), vertexCount, stride, positionOffset);
+    vertexCount = optimizeVertexFetch(welded.data(), vertexCount, stride, indices.data(), indices.size());
+    welded.resize(vertexCount * stride);
+    vertices.swap(welded);
+
+    report.vertexCountAfter = vertexCount;
+    report.after = analyzeVertexCache(indices.data(), indices.size(), vertexCount);
+    return report;
+} // optimizeMesh
+
+} // namespace meshopt
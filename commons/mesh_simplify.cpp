@@ -0,0 +1,330 @@
+/*
+ * Реализация упрощения мешей (см. include/mesh_simplify.h).
+ */
+
+#include "mesh_simplify.h"
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace meshopt {
+
+//-------- квадрики ----------------------------------------------------
+/*
+ * Симметричная матрица 4x4 суммы квадратов расстояний до плоскостей ax + by + cz + d = 0
+ * и сумма весов (площадей треугольников). Ошибка - средний квадрат расстояния.
+ */
+struct Quadric {
+    double a2, b2, c2, d2, ab, ac, ad, bc, bd, cd;
+    double weight;
+
+    void add(const Quadric& q) {
+        a2 += q.a2; b2 += q.b2; c2 += q.c2; d2 += q.d2;
+        ab += q.ab; ac += q.ac; ad += q.ad;
+        bc += q.bc; bd += q.bd; cd += q.cd;
+        weight += q.weight;
+    }
+
+    void addPlane(double a, double b, double c, double d, double w) {
+        a2 += w * a * a; b2 += w * b * b; c2 += w * c * c; d2 += w * d * d;
+        ab += w * a * b; ac += w * a * c; ad += w * a * d;
+        bc += w * b * c; bd += w * b * d; cd += w * c * d;
+        weight += w;
+    }
+
+    double sum(double x, double y, double z) const {
+        return a2 * x * x + b2 * y * y + c2 * z * z + d2
+             + 2.0 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z);
+    }
+};
+
+static double collapseCost(const Quadric& qa, const Quadric& qb, const GLfloat* p) {
+    double weight = qa.weight + qb.weight;
+    if (weight <= 0.0)
+        return 0.0;
+    double error = (qa.sum(p[0], p[1], p[2]) + qb.sum(p[0], p[1], p[2])) / weight;
+    return error > 0.0 ? error : 0.0;
+}
+
+static void triangleNormal(const GLfloat* a, const GLfloat* b, const GLfloat* c, double n[3]) {
+    double e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    double e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+//-------- швы и границы -----------------------------------------------
+/*
+ * canon[v] - первая вершина с той же позицией, что и v (побайтное сравнение).
+ * Вершина с неуникальной позицией лежит на шве.
+ */
+static void buildPositionRemap(const GLfloat* const* positions, size_t vertexCount, std::vector<GLuint>& canon) {
+    size_t tableSize = 1;
+    while (tableSize < vertexCount * 2)
+        tableSize <<= 1;
+    std::vector<GLuint> table(tableSize, ~0u);
+    canon.resize(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        GLuint bits[3];
+        memcpy(bits, positions[v], sizeof(bits));
+        size_t h = (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        size_t slot = (h ^ (h >> 15)) & (tableSize - 1);
+        while (table[slot] != ~0u && memcmp(positions[table[slot]], positions[v], sizeof(bits)) != 0)
+            slot = (slot + 1) & (tableSize - 1);
+        if (table[slot] == ~0u)
+            table[slot] = (GLuint)v;
+        canon[v] = table[slot];
+    }
+}
+
+/*
+ * Неподвижные позиции: швы, границы (ребро с одним треугольником) и неманифолдные
+ * ребра (больше двух треугольников).
+ */
+static void findLockedPositions(const GLuint* indices, size_t indexCount, const std::vector<GLuint>& canon,
+                                std::vector<bool>& locked) {
+    const size_t vertexCount = canon.size();
+    locked.assign(vertexCount, false);
+    std::vector<GLuint> owner(vertexCount, ~0u);
+    for (size_t i = 0; i < indexCount; i++) {
+        GLuint v = indices[i], c = canon[v];
+        if (owner[c] == ~0u)
+            owner[c] = v;
+        else if (owner[c] != v)
+            locked[c] = true;
+    }
+    std::vector<unsigned long long> edges;
+    edges.reserve(indexCount);
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        for (int k = 0; k < 3; k++) {
+            GLuint a = canon[indices[i + k]], b = canon[indices[i + (k + 1) % 3]];
+            if (a > b)
+                std::swap(a, b);
+            edges.push_back(((unsigned long long)a << 32) | b);
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size(); ) {
+        size_t j = i + 1;
+        while (j < edges.size() && edges[j] == edges[i])
+            j++;
+        if (j - i != 2) {
+            locked[(GLuint)(edges[i] >> 32)] = true;
+            locked[(GLuint)(edges[i] & 0xffffffffu)] = true;
+        }
+        i = j;
+    }
+} // findLockedPositions
+
+//-------- упрощение ---------------------------------------------------
+namespace {
+
+struct Collapse {
+    GLuint  from;
+    GLuint  to;
+    double  cost;
+};
+
+bool collapseLess(const Collapse& a, const Collapse& b) {
+    return a.cost < b.cost;
+}
+
+} // namespace
+
+size_t simplifyMesh(const GLuint* indices, size_t indexCount, const void* vertices, size_t vertexCount,
+                    size_t stride, size_t targetIndexCount, float targetError, std::vector<GLuint>& out,
+                    float* resultError, size_t positionOffset) {
+    out.assign(indices, indices + indexCount - indexCount % 3);
+    if (resultError)
+        *resultError = 0.0f;
+    if (out.size() <= targetIndexCount || vertexCount == 0)
+        return out.size();
+
+    std::vector<const GLfloat*> positions(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        positions[v] = (const GLfloat*)((const unsigned char*)vertices + v * stride + positionOffset);
+
+    // размер меша: ошибки задаются в долях диагонали габаритов
+    GLfloat lo[3] = { positions[out[0]][0], positions[out[0]][1], positions[out[0]][2] };
+    GLfloat hi[3] = { lo[0], lo[1], lo[2] };
+    for (size_t i = 0; i < out.size(); i++) {
+        for (int k = 0; k < 3; k++) {
+            lo[k] = std::min(lo[k], positions[out[i]][k]);
+            hi[k] = std::max(hi[k], positions[out[i]][k]);
+        }
+    }
+    double extent = sqrt((double)(hi[0] - lo[0]) * (hi[0] - lo[0]) + (double)(hi[1] - lo[1]) * (hi[1] - lo[1])
+                         + (double)(hi[2] - lo[2]) * (hi[2] - lo[2]));
+    double errorLimit = (double)targetError * extent;
+    errorLimit *= errorLimit;
+
+    std::vector<GLuint> canon;
+    std::vector<bool> locked;
+    buildPositionRemap(positions.data(), vertexCount, canon);
+    findLockedPositions(out.data(), out.size(), canon, locked);
+
+    std::vector<Quadric> quadrics(vertexCount, Quadric());
+    for (size_t i = 0; i < out.size(); i += 3) {
+        const GLfloat* p0 = positions[out[i]];
+        double n[3];
+        triangleNormal(p0, positions[out[i + 1]], positions[out[i + 2]], n);
+        double len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len <= 0.0)
+            continue;
+        n[0] /= len; n[1] /= len; n[2] /= len;
+        double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+        for (int k = 0; k < 3; k++)
+            quadrics[canon[out[i + k]]].addPlane(n[0], n[1], n[2], d, len * 0.5);
+    }
+
+    //---------------------------
+    // Проходы: на каждом стягиваются самые дешевые ребра, не задевающие друг друга
+    //---------------------------
+    targetIndexCount -= targetIndexCount % 3;
+    std::vector<GLuint> offsets(vertexCount + 1), adjacency, remap(vertexCount);
+    std::vector<double> bestCost(vertexCount);
+    std::vector<GLuint> bestTarget(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    std::vector<Collapse> collapses;
+    double maxCost = 0.0;
+    for (size_t v = 0; v < vertexCount; v++)
+        remap[v] = (GLuint)v;
+    while (out.size() > targetIndexCount) {
+        // вершина -> ее треугольники
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (size_t i = 0; i < out.size(); i++)
+            offsets[out[i] + 1]++;
+        for (size_t v = 0; v < vertexCount; v++)
+            offsets[v + 1] += offsets[v];
+        adjacency.resize(out.size());
+        for (size_t i = 0; i < out.size(); i++)
+            adjacency[offsets[out[i]]++] = (GLuint)(i / 3);
+        for (size_t v = vertexCount; v > 0; v--)
+            offsets[v] = offsets[v - 1];
+        offsets[0] = 0;
+
+        // для каждой подвижной вершины - самое дешевое ребро
+        std::fill(bestCost.begin(), bestCost.end(), std::numeric_limits<double>::max());
+        for (size_t i = 0; i < out.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                for (int e = 1; e < 3; e++) {
+                    GLuint a = out[i + k], b = out[i + (k + e) % 3];
+                    if (locked[canon[a]])
+                        continue;
+                    double cost = collapseCost(quadrics[canon[a]], quadrics[canon[b]], positions[b]);
+                    if (cost < bestCost[a]) {
+                        bestCost[a] = cost;
+                        bestTarget[a] = b;
+                    }
+                }
+            }
+        }
+        collapses.clear();
+        for (size_t v = 0; v < vertexCount; v++) {
+            if (bestCost[v] <= errorLimit) {
+                Collapse c = { (GLuint)v, bestTarget[v], bestCost[v] };
+                collapses.push_back(c);
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), collapseLess);
+
+        std::fill(touched.begin(), touched.end(), false);
+        size_t triangleCount = out.size() / 3, collapsed = 0;
+        for (size_t c = 0; c < collapses.size() && triangleCount > targetIndexCount / 3; c++) {
+            GLuint a = collapses[c].from, b = collapses[c].to;
+            if (touched[a] || touched[b])
+                continue;
+            // треугольники вокруг a не должны перевернуться
+            bool flips = false;
+            size_t removed = 0;
+            for (GLuint t = offsets[a]; t < offsets[a + 1] && !flips; t++) {
+                const GLuint* tri = &out[adjacency[t] * 3];
+                if (tri[0] == b || tri[1] == b || tri[2] == b) {
+                    removed++;
+                    continue;
+                }
+                const GLfloat* p[3] = { positions[tri[0]], positions[tri[1]], positions[tri[2]] };
+                double before[3], after[3];
+                triangleNormal(p[0], p[1], p[2], before);
+                for (int k = 0; k < 3; k++)
+                    if (tri[k] == a)
+                        p[k] = positions[b];
+                triangleNormal(p[0], p[1], p[2], after);
+                flips = before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0;
+            }
+            if (flips)
+                continue;
+            // соседи a до конца прохода не трогаются: их треугольники уже изменились
+            for (GLuint t = offsets[a]; t < offsets[a + 1]; t++)
+                for (int k = 0; k < 3; k++)
+                    touched[out[adjacency[t] * 3 + k]] = true;
+            remap[a] = b;
+            quadrics[canon[b]].add(quadrics[canon[a]]);
+            maxCost = std::max(maxCost, collapses[c].cost);
+            triangleCount -= removed;
+            collapsed++;
+        }
+        if (collapsed == 0)
+            break;
+
+        // индексы переписываются, вырожденные треугольники выбрасываются
+        size_t write = 0;
+        for (size_t i = 0; i < out.size(); i += 3) {
+            GLuint a = remap[out[i]], b = remap[out[i + 1]], c = remap[out[i + 2]];
+            if (a == b || b == c || c == a)
+                continue;
+            out[write++] = a;
+            out[write++] = b;
+            out[write++] = c;
+        }
+        out.resize(write);
+    }
+    if (resultError)
+        *resultError = extent > 0.0 ? (float)(sqrt(maxCost) / extent) : 0.0f;
+    return out.size();
+} // simplifyMesh
+
+//-------- цепочка LOD -------------------------------------------------
+size_t generateLods(MeshData& mesh, size_t maxLods, float ratio, float maxError) {
+    if (mesh.attributes.empty() || mesh.attributes[0].index != 0 || mesh.attributes[0].size != 3
+        || mesh.attributes[0].type != GL_FLOAT) {
+        throw std::logic_error("generateLods: attribute 0 must be a float3 position");
+    }
+    const size_t vertexCount = mesh.vertexCount();
+    const size_t positionOffset = mesh.attributes[0].offset;
+    maxLods = std::max<size_t>(1, std::min<size_t>(maxLods, MESH_MAX_LODS));
+
+    std::vector< std::vector<GLuint> > levels(1, mesh.indices);
+    std::vector<float> errors(1, 0.0f);
+    while (levels.size() < maxLods) {
+        const std::vector<GLuint>& previous = levels.back();
+        size_t target = (size_t)(previous.size() / 3 * ratio) * 3;
+        std::vector<GLuint> simplified;
+        float error = 0.0f;
+        // ошибки уровней складываются: каждый уровень упрощает предыдущий, а не исходный меш
+        simplifyMesh(previous.data(), previous.size(), mesh.vertices.data(), vertexCount, mesh.vertexStride,
+                     target, maxError - errors.back(), simplified, &error, positionOffset);
+        // меньше 10% выигрыша - дальше упрощать не получается
+        if (simplified.empty() || simplified.size() * 10 > previous.size() * 9)
+            break;
+        optimizeVertexCache(simplified.data(), simplified.size(), vertexCount);
+        errors.push_back(errors.back() + error);
+        levels.push_back(simplified);
+    }
+
+    mesh.indices.clear();
+    mesh.lods.clear();
+    for (size_t l = 0; l < levels.size(); l++) {
+        MeshLod lod = { (GLuint)mesh.indices.size(), (GLuint)levels[l].size(), errors[l], 0 };
+        mesh.lods.push_back(lod);
+        mesh.indices.insert(mesh.indices.end(), levels[l].begin(), levels[l].end());
+    }
+    return levels.size();
+} // generateLods
+
+} // namespace meshopt
@@ -0,0 +1,281 @@
+/*
+ * Реализация программного отсечения невидимых объектов (см. include/occlusion_culler.h).
+ */
+
+#include "occlusion_culler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <immintrin.h>
+
+typedef OcclusionCuller::Triangle Triangle;
+
+static double millisecondsSince(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//-------- рисование строки треугольника -------------------------------
+/*
+ * Пиксели строки y от x0 (кратно 8) до x1 включительно. Функции ребер и глубина в центре
+ * пикселя уже учтены в коэффициентах треугольника.
+ */
+static void rasterizeRow(const Triangle& t, int y, int x0, int x1, GLfloat* row) {
+    GLfloat fy = (GLfloat)y;
+    GLfloat rowEdge[3], rowDepth = t.depth[1] * fy + t.depth[2];
+    for (int e = 0; e < 3; e++)
+        rowEdge[e] = t.edge[e][1] * fy + t.edge[e][2];
+    for (int x = x0; x <= x1; x++) {
+        GLfloat fx = (GLfloat)x;
+        if (t.edge[0][0] * fx + rowEdge[0] >= 0.0f && t.edge[1][0] * fx + rowEdge[1] >= 0.0f
+            && t.edge[2][0] * fx + rowEdge[2] >= 0.0f) {
+            GLfloat z = t.depth[0] * fx + rowDepth;
+            if (z < row[x])
+                row[x] = z;
+        }
+    }
+} // rasterizeRow
+
+// то же по восемь пикселей за раз; ширина буфера кратна 8, поэтому за конец строки запись не выходит
+__attribute__((target("avx2")))
+static void rasterizeRowAvx2(const Triangle& t, int y, int x0, int x1, GLfloat* row) {
+    const __m256 offsets = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    GLfloat fy = (GLfloat)y;
+    __m256 a[3], rowEdge[3];
+    for (int e = 0; e < 3; e++) {
+        a[e] = _mm256_set1_ps(t.edge[e][0]);
+        rowEdge[e] = _mm256_set1_ps(t.edge[e][1] * fy + t.edge[e][2]);
+    }
+    __m256 depthA = _mm256_set1_ps(t.depth[0]);
+    __m256 rowDepth = _mm256_set1_ps(t.depth[1] * fy + t.depth[2]);
+    for (int x = x0; x <= x1; x += 8) {
+        __m256 xs = _mm256_add_ps(_mm256_set1_ps((GLfloat)x), offsets);
+        __m256 e0 = _mm256_add_ps(_mm256_mul_ps(a[0], xs), rowEdge[0]);
+        __m256 e1 = _mm256_add_ps(_mm256_mul_ps(a[1], xs), rowEdge[1]);
+        __m256 e2 = _mm256_add_ps(_mm256_mul_ps(a[2], xs), rowEdge[2]);
+        __m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ),
+                                                    _mm256_cmp_ps(e1, zero, _CMP_GE_OQ)),
+                                      _mm256_cmp_ps(e2, zero, _CMP_GE_OQ));
+        if (_mm256_movemask_ps(inside) == 0)
+            continue;
+        __m256 z = _mm256_add_ps(_mm256_mul_ps(depthA, xs), rowDepth);
+        __m256 old = _mm256_loadu_ps(row + x);
+        _mm256_storeu_ps(row + x, _mm256_blendv_ps(old, _mm256_min_ps(old, z), inside));
+    }
+} // rasterizeRowAvx2
+
+bool OcclusionCuller::hasAvx2() {
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+//-------- OcclusionCuller ---------------------------------------------
+OcclusionCuller::OcclusionCuller(int width, int height, unsigned threads)
+    : m_Width((width + OCCLUSION_TILE_WIDTH - 1) / OCCLUSION_TILE_WIDTH * OCCLUSION_TILE_WIDTH),
+      m_Height((height + OCCLUSION_TILE_HEIGHT - 1) / OCCLUSION_TILE_HEIGHT * OCCLUSION_TILE_HEIGHT),
+      m_TilesX(m_Width / OCCLUSION_TILE_WIDTH),
+      m_TilesY(m_Height / OCCLUSION_TILE_HEIGHT),
+      m_ViewProjection(1.0f),
+      m_Depth(m_Width * m_Height, 1.0f),
+      m_TileMax(m_TilesX * m_TilesY, 1.0f),
+      m_Pool(threads) {
+    OcclusionStats stats = { 0, 0, 0, 0.0, 0.0 };
+    m_Stats = stats;
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4& viewProjection) {
+    m_ViewProjection = viewProjection;
+    m_Triangles.clear();
+    OcclusionStats stats = { 0, 0, 0, 0.0, 0.0 };
+    m_Stats = stats;
+}
+
+void OcclusionCuller::setupTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c, bool backfaceCulling) {
+    const glm::vec4* clip[3] = { &a, &b, &c };
+    GLfloat x[3], y[3], z[3];
+    for (int k = 0; k < 3; k++) {
+        GLfloat invW = 1.0f / clip[k]->w;
+        x[k] = (clip[k]->x * invW * 0.5f + 0.5f) * m_Width;
+        y[k] = (clip[k]->y * invW * 0.5f + 0.5f) * m_Height;
+        z[k] = clip[k]->z * invW * 0.5f + 0.5f;
+    }
+    // задние грани и вырожденные треугольники
+    GLfloat area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area < 0.0f && !backfaceCulling) {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(z[1], z[2]);
+        area = -area;
+    }
+    if (area <= 0.0f || std::min(z[0], std::min(z[1], z[2])) > 1.0f)
+        return;
+
+    Triangle t;
+    t.minX = std::max(0, (int)floorf(std::min(x[0], std::min(x[1], x[2]))));
+    t.minY = std::max(0, (int)floorf(std::min(y[0], std::min(y[1], y[2]))));
+    t.maxX = std::min(m_Width - 1, (int)floorf(std::max(x[0], std::max(x[1], x[2]))));
+    t.maxY = std::min(m_Height - 1, (int)floorf(std::max(y[0], std::max(y[1], y[2]))));
+    if (t.minX > t.maxX || t.minY > t.maxY)
+        return;
+    for (int e = 0; e < 3; e++) {
+        int i = e, j = (e + 1) % 3;
+        t.edge[e][0] = y[i] - y[j];
+        t.edge[e][1] = x[j] - x[i];
+        t.edge[e][2] = x[i] * y[j] - y[i] * x[j];
+        // функции считаются в центрах пикселей (x + 0.5, y + 0.5)
+        t.edge[e][2] += 0.5f * (t.edge[e][0] + t.edge[e][1]);
+    }
+    GLfloat dzdx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+    GLfloat dzdy = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+    t.depth[0] = dzdx;
+    t.depth[1] = dzdy;
+    t.depth[2] = z[0] - dzdx * x[0] - dzdy * y[0] + 0.5f * (dzdx + dzdy);
+    m_Triangles.push_back(t);
+} // setupTriangle
+
+void OcclusionCuller::addOccluder(const GLfloat* vertices, size_t stride, const GLuint* indices, size_t indexCount,
+                                  const glm::mat4& model, bool backfaceCulling) {
+    const glm::mat4 mvp = m_ViewProjection * model;
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        glm::vec4 clip[3];
+        int inside = 0;
+        for (int k = 0; k < 3; k++) {
+            const GLfloat* p = (const GLfloat*)((const unsigned char*)vertices + indices[i + k] * stride);
+            clip[k] = mvp * glm::vec4(p[0], p[1], p[2], 1.0f);
+            inside += clip[k].z >= -clip[k].w;
+        }
+        if (inside == 3) {
+            setupTriangle(clip[0], clip[1], clip[2], backfaceCulling);
+            continue;
+        }
+        if (inside == 0)
+            continue;
+        // отсечение ближней плоскостью z = -w: остается треугольник или четырехугольник
+        glm::vec4 polygon[4];
+        int count = 0;
+        for (int k = 0; k < 3; k++) {
+            const glm::vec4& p = clip[k];
+            const glm::vec4& q = clip[(k + 1) % 3];
+            GLfloat dp = p.z + p.w, dq = q.z + q.w;
+            if (dp >= 0.0f)
+                polygon[count++] = p;
+            if ((dp >= 0.0f) != (dq >= 0.0f))
+                polygon[count++] = p + (q - p) * (dp / (dp - dq));
+        }
+        for (int k = 2; k < count; k++)
+            setupTriangle(polygon[0], polygon[k - 1], polygon[k], backfaceCulling);
+    }
+} // addOccluder
+
+void OcclusionCuller::rasterizeBand(size_t band) {
+    const int y0 = (int)band * OCCLUSION_TILE_HEIGHT, y1 = y0 + OCCLUSION_TILE_HEIGHT - 1;
+    std::fill(m_Depth.begin() + y0 * m_Width, m_Depth.begin() + (y1 + 1) * m_Width, 1.0f);
+    const bool avx2 = hasAvx2();
+    for (size_t i = 0; i < m_Triangles.size(); i++) {
+        const Triangle& t = m_Triangles[i];
+        if (t.maxY < y0 || t.minY > y1)
+            continue;
+        int x0 = t.minX & ~(OCCLUSION_TILE_WIDTH - 1);
+        for (int y = std::max(y0, t.minY); y <= std::min(y1, t.maxY); y++) {
+            if (avx2)
+                rasterizeRowAvx2(t, y, x0, t.maxX, &m_Depth[y * m_Width]);
+            else
+                rasterizeRow(t, y, t.minX, t.maxX, &m_Depth[y * m_Width]);
+        }
+    }
+    // самая дальняя глубина в каждой плитке полосы
+    for (int tx = 0; tx < m_TilesX; tx++) {
+        GLfloat farthest = 0.0f;
+        for (int y = y0; y <= y1; y++) {
+            const GLfloat* row = &m_Depth[y * m_Width + tx * OCCLUSION_TILE_WIDTH];
+            for (int x = 0; x < OCCLUSION_TILE_WIDTH; x++)
+                farthest = std::max(farthest, row[x]);
+        }
+        m_TileMax[band * m_TilesX + tx] = farthest;
+    }
+} // rasterizeBand
+
+void OcclusionCuller::rasterize() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    m_Pool.parallelFor(m_TilesY, [this](size_t band) { rasterizeBand(band); });
+    m_Stats.occluderTriangles = m_Triangles.size();
+    m_Stats.rasterizeMs = millisecondsSince(start);
+}
+
+bool OcclusionCuller::isVisible(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const {
+    // углы получаются из одного умножения на матрицу и сложений вдоль ребер
+    const glm::vec3 size = boundsMax - boundsMin;
+    const glm::vec4 origin = m_ViewProjection * glm::vec4(boundsMin, 1.0f);
+    const glm::vec4 axis[3] = { m_ViewProjection[0] * size.x, m_ViewProjection[1] * size.y,
+                                m_ViewProjection[2] * size.z };
+    GLfloat minX = HUGE_VALF, minY = HUGE_VALF, maxX = -HUGE_VALF, maxY = -HUGE_VALF, minZ = HUGE_VALF;
+    int behind = 0;
+    for (int k = 0; k < 8; k++) {
+        glm::vec4 clip = origin;
+        for (int a = 0; a < 3; a++)
+            if (k & (1 << a))
+                clip = clip + axis[a];
+        if (clip.w <= 1e-5f || clip.z < -clip.w) {
+            behind++;
+            continue;
+        }
+        GLfloat invW = 1.0f / clip.w;
+        GLfloat x = (clip.x * invW * 0.5f + 0.5f) * m_Width;
+        GLfloat y = (clip.y * invW * 0.5f + 0.5f) * m_Height;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        minZ = std::min(minZ, clip.z * invW * 0.5f + 0.5f);
+    }
+    // целиком за камерой - не виден; пересекает ближнюю плоскость - считаем видимым
+    if (behind == 8)
+        return false;
+    if (behind > 0)
+        return true;
+    if (minZ > 1.0f)
+        return false;
+    int x0 = std::max(0, (int)floorf(minX)), x1 = std::min(m_Width - 1, (int)floorf(maxX));
+    int y0 = std::max(0, (int)floorf(minY)), y1 = std::min(m_Height - 1, (int)floorf(maxY));
+    if (x0 > x1 || y0 > y1)
+        return false;
+    for (int ty = y0 / OCCLUSION_TILE_HEIGHT; ty <= y1 / OCCLUSION_TILE_HEIGHT; ty++) {
+        for (int tx = x0 / OCCLUSION_TILE_WIDTH; tx <= x1 / OCCLUSION_TILE_WIDTH; tx++) {
+            // вся плитка ближе объекта
+            if (minZ > m_TileMax[ty * m_TilesX + tx])
+                continue;
+            int px0 = std::max(x0, tx * OCCLUSION_TILE_WIDTH), px1 = std::min(x1, tx * OCCLUSION_TILE_WIDTH + 7);
+            int py0 = std::max(y0, ty * OCCLUSION_TILE_HEIGHT), py1 = std::min(y1, ty * OCCLUSION_TILE_HEIGHT + 3);
+            for (int y = py0; y <= py1; y++)
+                for (int x = px0; x <= px1; x++)
+                    if (m_Depth[y * m_Width + x] >= minZ)
+                        return true;
+        }
+    }
+    return false;
+} // isVisible
+
+size_t OcclusionCuller::testRange(const GLfloat* bounds, size_t first, size_t last, unsigned char* visible) const {
+    size_t culled = 0;
+    for (size_t i = first; i < last; i++) {
+        const GLfloat* b = bounds + i * 6;
+        visible[i] = isVisible(glm::vec3(b[0], b[1], b[2]), glm::vec3(b[3], b[4], b[5])) ? 1 : 0;
+        culled += !visible[i];
+    }
+    return culled;
+}
+
+void OcclusionCuller::testBoxes(const GLfloat* bounds, size_t count, unsigned char* visible) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const size_t BLOCK = 256;
+    size_t blocks = (count + BLOCK - 1) / BLOCK;
+    std::vector<size_t> culled(blocks, 0);
+    m_Pool.parallelFor(blocks, [&](size_t i) {
+        culled[i] = testRange(bounds, i * BLOCK, std::min(count, (i + 1) * BLOCK), visible);
+    });
+    m_Stats.tested += count;
+    for (size_t i = 0; i < blocks; i++)
+        m_Stats.culled += culled[i];
+    m_Stats.testMs += millisecondsSince(start);
+} // testBoxes
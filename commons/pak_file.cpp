@@ -0,0 +1,190 @@
+/*
+ * Запись и чтение пакетов ресурсов (см. include/pak_file.h).
+ */
+
+#include "pak_file.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static GLuint64 alignUp(GLuint64 value) {
+    return (value + PAK_FILE_ALIGNMENT - 1) & ~(GLuint64)(PAK_FILE_ALIGNMENT - 1);
+}
+
+// дописывает нули до offset
+static bool writePadding(FILE* file, GLuint64 written, GLuint64 offset) {
+    static const unsigned char zeros[PAK_FILE_ALIGNMENT] = { 0 };
+    return offset == written || fwrite(zeros, offset - written, 1, file) == 1;
+}
+
+/*
+ * Размеры файлов известны заранее (stat), поэтому оглавление пишется первым, а файлы затем
+ * копируются кусками, не загружаясь в память целиком.
+ */
+bool writePakFile(const char* path, const std::vector<PakInput>& inputs) {
+    std::vector<const PakInput*> sorted(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++)
+        sorted[i] = &inputs[i];
+    std::sort(sorted.begin(), sorted.end(), [](const PakInput* a, const PakInput* b) {
+        return strcmp(a->name.c_str(), b->name.c_str()) < 0;
+    });
+
+    PakFileHeader header;
+    header.magic = PAK_FILE_MAGIC;
+    header.version = PAK_FILE_VERSION;
+    header.entryCount = (GLuint)sorted.size();
+    header.namesSize = 0;
+    std::vector<PakEntry> entries(sorted.size());
+    for (size_t i = 0; i < sorted.size(); i++) {
+        if (i > 0 && sorted[i]->name == sorted[i - 1]->name) {
+            std::cout << "Failed writing of the pak " << path << ": duplicate name " << sorted[i]->name << std::endl;
+            return false;
+        }
+        struct stat st;
+        if (stat(sorted[i]->path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+            std::cout << "Failed loading of the file " << sorted[i]->path << std::endl;
+            return false;
+        }
+        memset(&entries[i], 0, sizeof(entries[i]));
+        entries[i].size = st.st_size;
+        entries[i].nameOffset = header.namesSize;
+        entries[i].nameLength = (GLuint)sorted[i]->name.size();
+        header.namesSize += entries[i].nameLength + 1;
+    }
+    GLuint64 offset = alignUp(sizeof(header) + entries.size() * sizeof(PakEntry) + header.namesSize);
+    for (size_t i = 0; i < entries.size(); i++) {
+        entries[i].offset = offset;
+        offset = alignUp(offset + entries[i].size);
+    }
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        std::cout << "Failed writing of the pak " << path << std::endl;
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    if (!entries.empty())
+        ok = ok && fwrite(entries.data(), entries.size() * sizeof(PakEntry), 1, file) == 1;
+    for (size_t i = 0; ok && i < sorted.size(); i++)
+        ok = fwrite(sorted[i]->name.c_str(), sorted[i]->name.size() + 1, 1, file) == 1;
+    GLuint64 written = sizeof(header) + entries.size() * sizeof(PakEntry) + header.namesSize;
+
+    std::vector<unsigned char> chunk(1 << 20);
+    for (size_t i = 0; ok && i < sorted.size(); i++) {
+        ok = writePadding(file, written, entries[i].offset);
+        written = entries[i].offset;
+        FILE* input = fopen(sorted[i]->path.c_str(), "rb");
+        if (!input) {
+            std::cout << "Failed loading of the file " << sorted[i]->path << std::endl;
+            ok = false;
+            break;
+        }
+        GLuint64 left = entries[i].size;
+        while (ok && left > 0) {
+            size_t n = (size_t)std::min<GLuint64>(left, chunk.size());
+            ok = fread(chunk.data(), n, 1, input) == 1 && fwrite(chunk.data(), n, 1, file) == 1;
+            left -= n;
+        }
+        fclose(input);
+        written += entries[i].size;
+    }
+    ok = ok && writePadding(file, written, offset);
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        std::cout << "Failed writing of the pak " << path << std::endl;
+    }
+    return ok;
+} // writePakFile
+
+//-------- PakFile -----------------------------------------------------
+PakFile::PakFile()
+    : m_pData(nullptr),
+      m_Size(0),
+      m_pHeader(nullptr),
+      m_pEntries(nullptr),
+      m_pNames(nullptr) {}
+
+PakFile::~PakFile() {
+    close();
+}
+
+bool PakFile::open(const char* path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        std::cout << "Failed loading of the pak " << path << std::endl;
+        return false;
+    }
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(PakFileHeader))
+        data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);        // отображение остается действительным и без дескриптора
+    if (data == MAP_FAILED) {
+        std::cout << "Failed loading of the pak " << path << std::endl;
+        return false;
+    }
+    m_pData = (const unsigned char*)data;
+    m_Size = st.st_size;
+    m_pHeader = (const PakFileHeader*)m_pData;
+    m_pEntries = (const PakEntry*)(m_pData + sizeof(PakFileHeader));
+    m_pNames = (const char*)(m_pEntries + m_pHeader->entryCount);
+
+    const PakFileHeader& h = *m_pHeader;
+    GLuint64 tocSize = sizeof(PakFileHeader) + (GLuint64)h.entryCount * sizeof(PakEntry) + h.namesSize;
+    bool valid = h.magic == PAK_FILE_MAGIC && h.version == PAK_FILE_VERSION && tocSize <= m_Size
+              && (h.namesSize == 0 || m_pNames[h.namesSize - 1] == '\0');
+    for (GLuint i = 0; valid && i < h.entryCount; i++) {
+        const PakEntry& e = m_pEntries[i];
+        valid = e.offset % PAK_FILE_ALIGNMENT == 0 && e.offset >= tocSize && e.size <= m_Size
+             && e.offset <= m_Size - e.size && (GLuint64)e.nameOffset + e.nameLength < h.namesSize
+             && m_pNames[e.nameOffset + e.nameLength] == '\0'
+             && (i == 0 || strcmp(getName(i - 1), getName(i)) < 0);
+    }
+    if (!valid) {
+        std::cout << "Failed loading of the pak " << path << ": bad table of contents" << std::endl;
+        close();
+        return false;
+    }
+    m_Path = path;
+    return true;
+} // open
+
+void PakFile::close() {
+    if (m_pData) {
+        munmap((void*)m_pData, m_Size);
+        m_pData = nullptr;
+        m_Size = 0;
+    }
+    m_pHeader = nullptr;
+    m_pEntries = nullptr;
+    m_pNames = nullptr;
+    m_Path.clear();
+} // close
+
+bool PakFile::find(const char* name, const unsigned char*& data, size_t& size) const {
+    if (!m_pHeader)
+        return false;
+    GLuint first = 0, last = m_pHeader->entryCount;
+    while (first < last) {
+        GLuint middle = first + (last - first) / 2;
+        int order = strcmp(getName(middle), name);
+        if (order == 0) {
+            data = m_pData + m_pEntries[middle].offset;
+            size = (size_t)m_pEntries[middle].size;
+            return true;
+        }
+        if (order < 0)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    return false;
+} // find
@@ -0,0 +1,277 @@
+
+/*
+ * Реализация очереди отрисовки RenderQueue.
+ */
+
+#include "render_queue.h"
+#include "gl_state.h"
+
+#include <cstring>
+
+#define RQ_LAYER_BITS      4
+#define RQ_PROGRAM_BITS    11
+#define RQ_TEXTURE_BITS    12
+#define RQ_VAO_BITS        12
+#define RQ_DEPTH_BITS      24
+
+#define RQ_MASK(bits)      ((uint64_t(1) << (bits)) - 1)
+
+//-------- UniformValue ------------------------------------------------
+UniformValue UniformValue::int1(GLint location, GLint v) {
+    UniformValue u;
+    u.location = location;
+    u.type = INT1;
+    u.value.i = v;
+    return u;
+}
+
+UniformValue UniformValue::float1(GLint location, GLfloat v) {
+    UniformValue u;
+    u.location = location;
+    u.type = FLOAT1;
+    u.value.f[0] = v;
+    return u;
+}
+
+UniformValue UniformValue::float3(GLint location, const GLfloat* v) {
+    UniformValue u;
+    u.location = location;
+    u.type = FLOAT3;
+    memcpy(u.value.f, v, 3 * sizeof(GLfloat));
+    return u;
+}
+
+UniformValue UniformValue::float4(GLint location, const GLfloat* v) {
+    UniformValue u;
+    u.location = location;
+    u.type = FLOAT4;
+    memcpy(u.value.f, v, 4 * sizeof(GLfloat));
+    return u;
+}
+
+UniformValue UniformValue::mat4(GLint location, const GLfloat* m) {
+    UniformValue u;
+    u.location = location;
+    u.type = MAT4;
+    memcpy(u.value.f, m, 16 * sizeof(GLfloat));
+    return u;
+}
+
+//-------- DrawPacket --------------------------------------------------
+DrawPacket::DrawPacket()
+    : program(0),
+      vao(0),
+      mode(GL_TRIANGLES),
+      first(0),
+      count(0),
+      indexType(0),
+      indices(nullptr),
+      depth(0.0f),
+      layer(0),
+      translucent(false) {
+    for (int i = 0; i < RQ_MAX_TEXTURE_UNITS; i++) {
+        textures[i] = 0;
+        textureTargets[i] = GL_TEXTURE_2D;
+    }
+}
+
+//-------- RenderQueue -------------------------------------------------
+RenderQueue::RenderQueue()
+    : m_zNear(0.1f),
+      m_zFar(100.0f) {
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+void RenderQueue::begin(GLfloat zNear, GLfloat zFar) {
+    m_zNear = zNear;
+    m_zFar = zFar > zNear ? zFar : zNear + 1.0f;
+    m_Packets.clear();
+    m_Uniforms.clear();
+} // begin
+
+void RenderQueue::submit(const DrawPacket& packet, const UniformValue* uniforms, GLuint uniformCount) {
+    Record record;
+    record.packet = packet;
+    record.firstUniform = (uint32_t)m_Uniforms.size();
+    record.uniformCount = uniformCount;
+    if (uniforms && uniformCount)
+        m_Uniforms.insert(m_Uniforms.end(), uniforms, uniforms + uniformCount);
+    m_Packets.push_back(record);
+} // submit
+
+uint32_t RenderQueue::programIndex(GLuint program) {
+    std::map<GLuint, uint32_t>::iterator it = m_Programs.find(program);
+    if (it != m_Programs.end())
+        return it->second;
+    uint32_t index = (uint32_t)m_Programs.size();
+    m_Programs[program] = index;
+    return index;
+}
+
+uint32_t RenderQueue::vaoIndex(GLuint vao) {
+    std::map<GLuint, uint32_t>::iterator it = m_Vaos.find(vao);
+    if (it != m_Vaos.end())
+        return it->second;
+    uint32_t index = (uint32_t)m_Vaos.size();
+    m_Vaos[vao] = index;
+    return index;
+}
+
+uint32_t RenderQueue::textureSetIndex(const GLuint* textures) {
+    TextureSet set(textures, textures + RQ_MAX_TEXTURE_UNITS);
+    std::map<TextureSet, uint32_t>::iterator it = m_TextureSets.find(set);
+    if (it != m_TextureSets.end())
+        return it->second;
+    uint32_t index = (uint32_t)m_TextureSets.size();
+    m_TextureSets[set] = index;
+    return index;
+}
+
+uint32_t RenderQueue::quantizeDepth(GLfloat depth) const {
+    GLfloat t = (depth - m_zNear) / (m_zFar - m_zNear);
+    if (t < 0.0f)
+        t = 0.0f;
+    if (t > 1.0f)
+        t = 1.0f;
+    return (uint32_t)(t * (GLfloat)RQ_MASK(RQ_DEPTH_BITS));
+}
+
+/*
+ * Индексы программ, текстур и VAO, не поместившиеся в отведенные им биты,
+ * обрезаются маской. Это ухудшает группировку, но не корректность:
+ * при отрисовке состояние все равно сравнивается по настоящим именам объектов.
+ */
+uint64_t RenderQueue::makeKey(const DrawPacket& packet) {
+    uint64_t layer   = packet.layer & RQ_MASK(RQ_LAYER_BITS);
+    uint64_t program = programIndex(packet.program) & RQ_MASK(RQ_PROGRAM_BITS);
+    uint64_t texture = textureSetIndex(packet.textures) & RQ_MASK(RQ_TEXTURE_BITS);
+    uint64_t vao     = vaoIndex(packet.vao) & RQ_MASK(RQ_VAO_BITS);
+    uint64_t depth   = quantizeDepth(packet.depth);
+
+    uint64_t key = layer << 60;
+    if (!packet.translucent) {
+        key |= program << 48;
+        key |= texture << 36;
+        key |= vao << 24;
+        key |= depth;
+    }
+    else {
+        key |= uint64_t(1) << 59;
+        key |= (RQ_MASK(RQ_DEPTH_BITS) - depth) << 35;
+        key |= program << 24;
+        key |= texture << 12;
+        key |= vao;
+    }
+    return key;
+} // makeKey
+
+/*
+ * Поразрядная сортировка (LSD) по 8 бит за проход. Гистограммы всех восьми
+ * проходов считаются за один просмотр массива; проходы, в которых все ключи
+ * имеют одинаковый байт, пропускаются.
+ */
+void RenderQueue::radixSort() {
+    const size_t n = m_Entries.size();
+    if (n < 2)
+        return;
+    m_Scratch.resize(n);
+
+    uint32_t histogram[8][256];
+    memset(histogram, 0, sizeof(histogram));
+    for (size_t i = 0; i < n; i++) {
+        uint64_t key = m_Entries[i].key;
+        for (int pass = 0; pass < 8; pass++)
+            histogram[pass][(key >> (pass * 8)) & 0xFF]++;
+    }
+
+    Entry* src = &m_Entries[0];
+    Entry* dst = &m_Scratch[0];
+    for (int pass = 0; pass < 8; pass++) {
+        uint32_t* h = histogram[pass];
+        if (h[(src[0].key >> (pass * 8)) & 0xFF] == n)
+            continue;
+        uint32_t offset = 0;
+        for (int b = 0; b < 256; b++) {
+            uint32_t c = h[b];
+            h[b] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; i++)
+            dst[h[(src[i].key >> (pass * 8)) & 0xFF]++] = src[i];
+        Entry* tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    if (src != &m_Entries[0])
+        m_Entries.swap(m_Scratch);
+} // radixSort
+
+void RenderQueue::applyUniform(const UniformValue& u) const {
+    switch (u.type) {
+        case UniformValue::INT1:
+            glUniform1i(u.location, u.value.i);
+            break;
+        case UniformValue::FLOAT1:
+            glUniform1f(u.location, u.value.f[0]);
+            break;
+        case UniformValue::FLOAT3:
+            glUniform3fv(u.location, 1, u.value.f);
+            break;
+        case UniformValue::FLOAT4:
+            glUniform4fv(u.location, 1, u.value.f);
+            break;
+        case UniformValue::MAT4:
+            glUniformMatrix4fv(u.location, 1, GL_FALSE, u.value.f);
+            break;
+    }
+}
+
+void RenderQueue::flush() {
+    memset(&m_Stats, 0, sizeof(m_Stats));
+    if (m_Packets.empty())
+        return;
+
+    m_Entries.resize(m_Packets.size());
+    for (size_t i = 0; i < m_Packets.size(); i++) {
+        m_Entries[i].key = makeKey(m_Packets[i].packet);
+        m_Entries[i].index = (uint32_t)i;
+    }
+    radixSort();
+
+    GLState& gl = GLState::current();
+    GLuint currentProgram = 0;
+    GLuint currentVao = 0;
+    GLuint currentTextures[RQ_MAX_TEXTURE_UNITS] = { 0 };
+    bool first = true;
+    for (size_t i = 0; i < m_Entries.size(); i++) {
+        const Record& record = m_Packets[m_Entries[i].index];
+        const DrawPacket& p = record.packet;
+        if (first || p.program != currentProgram) {
+            gl.useProgram(p.program);
+            currentProgram = p.program;
+            m_Stats.programSwitches++;
+        }
+        for (int unit = 0; unit < RQ_MAX_TEXTURE_UNITS; unit++) {
+            if (p.textures[unit] && (first || p.textures[unit] != currentTextures[unit])) {
+                gl.bindTextureUnit(unit, p.textureTargets[unit], p.textures[unit]);
+                currentTextures[unit] = p.textures[unit];
+                m_Stats.textureSwitches++;
+            }
+        }
+        if (first || p.vao != currentVao) {
+            gl.bindVertexArray(p.vao);
+            currentVao = p.vao;
+            m_Stats.vaoSwitches++;
+        }
+        first = false;
+        for (uint32_t u = 0; u < record.uniformCount; u++)
+            applyUniform(m_Uniforms[record.firstUniform + u]);
+        if (p.indexType)
+            glDrawElements(p.mode, p.count, p.indexType, p.indices);
+        else
+            glDrawArrays(p.mode, p.first, p.count);
+        m_Stats.draws++;
+    }
+    m_Packets.clear();
+    m_Uniforms.clear();
+} // flush
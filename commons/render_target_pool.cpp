@@ -0,0 +1,227 @@
+/*
+ * Реализация пула буферов кадра (см. include/render_target_pool.h).
+ */
+
+#include "render_target_pool.h"
+#include "gl_state.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+struct TextureFormat {
+    GLenum  internalFormat;
+    GLenum  format;             // формат и тип для glTexImage2D без данных
+    GLenum  type;
+    GLuint  bytes;              // байт на сэмпл
+};
+
+static const TextureFormat formats[] = {
+    { GL_R8,                    GL_RED,             GL_UNSIGNED_BYTE,                   1 },
+    { GL_RG8,                   GL_RG,              GL_UNSIGNED_BYTE,                   2 },
+    { GL_RGB8,                  GL_RGB,             GL_UNSIGNED_BYTE,                   4 },    // драйверы выравнивают до 4 байт
+    { GL_RGBA8,                 GL_RGBA,            GL_UNSIGNED_BYTE,                   4 },
+    { GL_SRGB8_ALPHA8,          GL_RGBA,            GL_UNSIGNED_BYTE,                   4 },
+    { GL_RGB10_A2,              GL_RGBA,            GL_UNSIGNED_INT_2_10_10_10_REV,     4 },
+    { GL_R11F_G11F_B10F,        GL_RGB,             GL_FLOAT,                           4 },
+    { GL_R16F,                  GL_RED,             GL_FLOAT,                           2 },
+    { GL_RG16F,                 GL_RG,              GL_FLOAT,                           4 },
+    { GL_RGBA16F,               GL_RGBA,            GL_FLOAT,                           8 },
+    { GL_R32F,                  GL_RED,             GL_FLOAT,                           4 },
+    { GL_RG32F,                 GL_RG,              GL_FLOAT,                           8 },
+    { GL_RGBA32F,               GL_RGBA,            GL_FLOAT,                           16 },
+    { GL_DEPTH_COMPONENT16,     GL_DEPTH_COMPONENT, GL_UNSIGNED_SHORT,                  2 },
+    { GL_DEPTH_COMPONENT24,     GL_DEPTH_COMPONENT, GL_UNSIGNED_INT,                    4 },
+    { GL_DEPTH_COMPONENT32F,    GL_DEPTH_COMPONENT, GL_FLOAT,                           4 },
+    { GL_DEPTH24_STENCIL8,      GL_DEPTH_STENCIL,   GL_UNSIGNED_INT_24_8,               4 },
+    { GL_DEPTH32F_STENCIL8,     GL_DEPTH_STENCIL,   GL_FLOAT_32_UNSIGNED_INT_24_8_REV,  8 }
+};
+
+static const TextureFormat& findFormat(GLenum internalFormat) {
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        if (formats[i].internalFormat == internalFormat)
+            return formats[i];
+    }
+    throw std::logic_error("unsupported render target format");
+}
+
+static double millisecondsSince(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+RenderTargetPool::RenderTargetPool()
+    : m_Frame(0),
+      m_Width(0),
+      m_Height(0),
+      m_PendingWidth(0),
+      m_PendingHeight(0) {
+    RenderTargetPoolStats stats = { 0, 0, 0, 0, 0, 0 };
+    m_Stats = stats;
+}
+
+size_t RenderTargetPool::getSize(const RenderTargetDesc& desc) {
+    size_t bytes = 0;
+    if (desc.colorFormat)
+        bytes += findFormat(desc.colorFormat).bytes;
+    if (desc.depthFormat)
+        bytes += findFormat(desc.depthFormat).bytes;
+    return bytes * desc.width * desc.height * std::max(1, desc.samples);
+}
+
+void RenderTargetPool::gResize(int width, int height) {
+    width = std::max(1, width);
+    height = std::max(1, height);
+    if (m_Width == 0) {
+        m_Width = m_PendingWidth = width;
+        m_Height = m_PendingHeight = height;
+        return;
+    }
+    // каждый шаг перетаскивания рамки откладывает применение размера
+    m_PendingWidth = width;
+    m_PendingHeight = height;
+    m_PendingSince = std::chrono::steady_clock::now();
+}
+
+bool RenderTargetPool::gBeginFrame() {
+    if (m_PendingWidth == m_Width && m_PendingHeight == m_Height)
+        return false;
+    if (millisecondsSince(m_PendingSince) < RENDER_TARGET_RESIZE_DELAY)
+        return false;
+    m_Width = m_PendingWidth;
+    m_Height = m_PendingHeight;
+    // большинство буферов рассчитаны на старый размер. Удаляем свободные сразу, не дожидаясь
+    // RENDER_TARGET_MAX_IDLE кадров, чтобы старые и новые буферы не занимали память одновременно
+    for (std::list<Entry>::iterator it = m_Entries.begin(); it != m_Entries.end(); ) {
+        if (!it->inUse) {
+            gDestroy(*it);
+            it = m_Entries.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    return true;
+} // gBeginFrame
+
+void RenderTargetPool::gCreate(Entry& entry) {
+    RenderTarget& target = entry.target;
+    const RenderTargetDesc& desc = target.desc;
+    target.target = desc.samples > 1 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+    target.color = target.depth = 0;
+
+    GLuint* textures[2] = { &target.color, &target.depth };
+    GLenum internalFormats[2] = { desc.colorFormat, desc.depthFormat };
+    for (int i = 0; i < 2; i++) {
+        if (!internalFormats[i])
+            continue;
+        const TextureFormat& format = findFormat(internalFormats[i]);
+        glGenTextures(1, textures[i]);
+        GLState::current().bindTexture(target.target, *textures[i]);
+        if (desc.samples > 1) {
+            glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, desc.samples, format.internalFormat,
+                                    desc.width, desc.height, GL_TRUE);
+        }
+        else {
+            glTexImage2D(GL_TEXTURE_2D, 0, format.internalFormat, desc.width, desc.height, 0,
+                         format.format, format.type, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+    }
+    GLState::current().bindTexture(target.target, 0);
+
+    glGenFramebuffers(1, &target.framebuffer);
+    GLState::current().bindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    if (target.color) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target.target, target.color, 0);
+    }
+    else {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    if (target.depth) {
+        GLenum attachment = findFormat(desc.depthFormat).format == GL_DEPTH_STENCIL ?
+                            GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, target.target, target.depth, 0);
+    }
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        throw std::logic_error("render target framebuffer is not complete");
+    }
+    GLState::current().bindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    entry.bytes = getSize(desc);
+    m_Stats.allocations++;
+    m_Stats.targets++;
+    m_Stats.bytes += entry.bytes;
+    m_Stats.peakBytes = std::max(m_Stats.peakBytes, m_Stats.bytes);
+} // gCreate
+
+void RenderTargetPool::gDestroy(Entry& entry) {
+    GLState::current().deleteFramebuffers(1, &entry.target.framebuffer);
+    if (entry.target.color)
+        GLState::current().deleteTextures(1, &entry.target.color);
+    if (entry.target.depth)
+        GLState::current().deleteTextures(1, &entry.target.depth);
+    m_Stats.targets--;
+    m_Stats.bytes -= entry.bytes;
+}
+
+const RenderTarget* RenderTargetPool::gAcquire(const RenderTargetDesc& desc) {
+    if (desc.width <= 0 || desc.height <= 0 || desc.samples <= 0 || (!desc.colorFormat && !desc.depthFormat))
+        throw std::logic_error("bad render target description");
+    for (std::list<Entry>::iterator it = m_Entries.begin(); it != m_Entries.end(); ++it) {
+        if (!it->inUse && it->target.desc == desc) {
+            it->inUse = true;
+            it->lastFrame = m_Frame;
+            m_Stats.inUse++;
+            m_Stats.reuses++;
+            return &it->target;
+        }
+    }
+    Entry entry;
+    entry.target.desc = desc;
+    entry.target.framebuffer = 0;
+    entry.bytes = 0;
+    entry.lastFrame = m_Frame;
+    entry.inUse = true;
+    m_Entries.push_back(entry);
+    gCreate(m_Entries.back());
+    m_Stats.inUse++;
+    return &m_Entries.back().target;
+} // gAcquire
+
+void RenderTargetPool::release(const RenderTarget* target) {
+    for (std::list<Entry>::iterator it = m_Entries.begin(); it != m_Entries.end(); ++it) {
+        if (&it->target == target) {
+            if (!it->inUse)
+                throw std::logic_error("render target is released twice");
+            it->inUse = false;
+            m_Stats.inUse--;
+            return;
+        }
+    }
+    throw std::logic_error("render target does not belong to the pool");
+}
+
+void RenderTargetPool::gEndFrame() {
+    for (std::list<Entry>::iterator it = m_Entries.begin(); it != m_Entries.end(); ) {
+        it->inUse = false;
+        if (m_Frame - it->lastFrame >= RENDER_TARGET_MAX_IDLE) {
+            gDestroy(*it);
+            it = m_Entries.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    m_Stats.inUse = 0;
+    m_Frame++;
+} // gEndFrame
+
+void RenderTargetPool::gFinalize() {
+    for (std::list<Entry>::iterator it = m_Entries.begin(); it != m_Entries.end(); ++it)
+        gDestroy(*it);
+    m_Entries.clear();
+    m_Stats.inUse = 0;
+}
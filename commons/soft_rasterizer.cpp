@@ -0,0 +1,385 @@
+/*
+ * Реализация программного растеризатора (см. include/soft_rasterizer.h).
+ */
+
+#include "soft_rasterizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <immintrin.h>
+#include <stdexcept>
+
+typedef SoftRasterizer::Triangle Triangle;
+
+static double millisecondsSince(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//-------- SoftTexture -------------------------------------------------
+void SoftTexture::assign(const unsigned char* data, int width, int height, int channels) {
+    this->width = width;
+    this->height = height;
+    texels.resize((size_t)width * height * 4);
+    for (size_t i = 0; i < (size_t)width * height; i++) {
+        const unsigned char* src = data + i * channels;
+        unsigned char* dst = &texels[i * 4];
+        if (channels < 3) {
+            dst[0] = dst[1] = dst[2] = src[0];
+            dst[3] = channels == 2 ? src[1] : 255;
+        }
+        else {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            dst[3] = channels == 4 ? src[3] : 255;
+        }
+    }
+} // assign
+
+// GL_REPEAT для целого индекса текселя
+static inline int wrap(int i, int size) {
+    i %= size;
+    return i < 0 ? i + size : i;
+}
+
+// GL_LINEAR: четыре соседних текселя вокруг (s * width - 0.5, t * height - 0.5)
+static void sample(const SoftTexture* texture, GLfloat s, GLfloat t, unsigned char* out) {
+    if (!texture || texture->texels.empty()) {
+        // незагруженная текстура в GL читается как (0, 0, 0, 1)
+        out[0] = out[1] = out[2] = 0;
+        out[3] = 255;
+        return;
+    }
+    GLfloat u = s * texture->width - 0.5f, v = t * texture->height - 0.5f;
+    GLfloat fu = floorf(u), fv = floorf(v);
+    GLfloat a = u - fu, b = v - fv;
+    int x0 = wrap((int)fu, texture->width), x1 = wrap(x0 + 1, texture->width);
+    int y0 = wrap((int)fv, texture->height), y1 = wrap(y0 + 1, texture->height);
+    const unsigned char* t00 = &texture->texels[((size_t)y0 * texture->width + x0) * 4];
+    const unsigned char* t10 = &texture->texels[((size_t)y0 * texture->width + x1) * 4];
+    const unsigned char* t01 = &texture->texels[((size_t)y1 * texture->width + x0) * 4];
+    const unsigned char* t11 = &texture->texels[((size_t)y1 * texture->width + x1) * 4];
+    for (int c = 0; c < 4; c++) {
+        GLfloat top = t00[c] + (t10[c] - t00[c]) * a;
+        GLfloat bottom = t01[c] + (t11[c] - t01[c]) * a;
+        out[c] = (unsigned char)(top + (bottom - top) * b + 0.5f);
+    }
+} // sample
+
+//-------- рисование строки треугольника -------------------------------
+/*
+ * Обе версии считают значения в одинаковом порядке операций (a * x + (b * y + c)),
+ * поэтому кадр с AVX2 и без него совпадает побайтно.
+ */
+static inline void shade(const Triangle& t, GLfloat invW, GLfloat u, GLfloat v, unsigned char* color) {
+    GLfloat w = 1.0f / invW;
+    sample(t.texture, u * w, v * w, color);
+}
+
+static void rasterizeSpan(const Triangle& t, GLfloat fy, int x0, int x1, GLfloat* depth, unsigned char* color) {
+    GLfloat rowEdge[3];
+    for (int e = 0; e < 3; e++)
+        rowEdge[e] = t.edge[e][1] * fy + t.edge[e][2];
+    GLfloat rowDepth = t.depth[1] * fy + t.depth[2];
+    GLfloat rowInvW = t.invW[1] * fy + t.invW[2];
+    GLfloat rowU = t.u[1] * fy + t.u[2], rowV = t.v[1] * fy + t.v[2];
+    for (int x = x0; x <= x1; x++) {
+        GLfloat fx = (GLfloat)x;
+        bool inside = true;
+        for (int e = 0; e < 3 && inside; e++) {
+            GLfloat value = t.edge[e][0] * fx + rowEdge[e];
+            inside = value > 0.0f || (value == 0.0f && (t.topLeft & (1 << e)));
+        }
+        if (!inside)
+            continue;
+        GLfloat z = t.depth[0] * fx + rowDepth;
+        if (!(z < depth[x]))
+            continue;
+        depth[x] = z;
+        shade(t, t.invW[0] * fx + rowInvW, t.u[0] * fx + rowU, t.v[0] * fx + rowV, color + x * 4);
+    }
+} // rasterizeSpan
+
+// восемь пикселей от x за раз, вся восьмерка лежит внутри плитки
+__attribute__((target("avx2")))
+static void rasterizeSpanAvx2(const Triangle& t, GLfloat fy, int x0, int x1, GLfloat* depth, unsigned char* color) {
+    const __m256 offsets = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 a[3], rowEdge[3], owned[3];
+    for (int e = 0; e < 3; e++) {
+        a[e] = _mm256_set1_ps(t.edge[e][0]);
+        rowEdge[e] = _mm256_set1_ps(t.edge[e][1] * fy + t.edge[e][2]);
+        owned[e] = _mm256_castsi256_ps(_mm256_set1_epi32((t.topLeft & (1 << e)) ? -1 : 0));
+    }
+    const __m256 depthA = _mm256_set1_ps(t.depth[0]), rowDepth = _mm256_set1_ps(t.depth[1] * fy + t.depth[2]);
+    const __m256 invWA = _mm256_set1_ps(t.invW[0]), rowInvW = _mm256_set1_ps(t.invW[1] * fy + t.invW[2]);
+    const __m256 uA = _mm256_set1_ps(t.u[0]), rowU = _mm256_set1_ps(t.u[1] * fy + t.u[2]);
+    const __m256 vA = _mm256_set1_ps(t.v[0]), rowV = _mm256_set1_ps(t.v[1] * fy + t.v[2]);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    for (int x = x0; x <= x1; x += 8) {
+        __m256 xs = _mm256_add_ps(_mm256_set1_ps((GLfloat)x), offsets);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int e = 0; e < 3; e++) {
+            __m256 value = _mm256_add_ps(_mm256_mul_ps(a[e], xs), rowEdge[e]);
+            __m256 edgeMask = _mm256_or_ps(_mm256_cmp_ps(value, zero, _CMP_GT_OQ),
+                                           _mm256_and_ps(_mm256_cmp_ps(value, zero, _CMP_EQ_OQ), owned[e]));
+            inside = _mm256_and_ps(inside, edgeMask);
+        }
+        if (_mm256_movemask_ps(inside) == 0)
+            continue;
+        __m256 z = _mm256_add_ps(_mm256_mul_ps(depthA, xs), rowDepth);
+        __m256 old = _mm256_loadu_ps(depth + x);
+        __m256 pass = _mm256_and_ps(inside, _mm256_cmp_ps(z, old, _CMP_LT_OQ));
+        int mask = _mm256_movemask_ps(pass);
+        if (mask == 0)
+            continue;
+        _mm256_storeu_ps(depth + x, _mm256_blendv_ps(old, z, pass));
+
+        // перспективная коррекция для всей восьмерки, выборка из текстуры - по пикселю
+        __m256 w = _mm256_div_ps(one, _mm256_add_ps(_mm256_mul_ps(invWA, xs), rowInvW));
+        GLfloat s[8], tc[8];
+        _mm256_storeu_ps(s, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(uA, xs), rowU), w));
+        _mm256_storeu_ps(tc, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(vA, xs), rowV), w));
+        // sample() собрана без AVX: без очистки верхних половин регистров переход стоит дороже выборки
+        _mm256_zeroupper();
+        for (int k = 0; k < 8; k++)
+            if (mask & (1 << k))
+                sample(t.texture, s[k], tc[k], color + (x + k) * 4);
+    }
+} // rasterizeSpanAvx2
+
+bool SoftRasterizer::hasAvx2() {
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+//-------- SoftRasterizer ----------------------------------------------
+SoftRasterizer::SoftRasterizer(int width, int height, unsigned threads)
+    : m_Width(width),
+      m_Height(height),
+      m_TilesX((width + SOFT_TILE_SIZE - 1) / SOFT_TILE_SIZE),
+      m_TilesY((height + SOFT_TILE_SIZE - 1) / SOFT_TILE_SIZE),
+      m_Color((size_t)width * height * 4, 0),
+      m_Depth((size_t)width * height, 1.0f),
+      m_bClearPending(false),
+      m_pTexture(nullptr),
+      m_View(1.0f),
+      m_Projection(1.0f),
+      m_Bins(m_TilesX * m_TilesY),
+      m_Pool(threads) {
+    if (width <= 0 || height <= 0)
+        throw std::logic_error("SoftRasterizer: empty framebuffer");
+    m_ClearColor[0] = m_ClearColor[1] = m_ClearColor[2] = 0;
+    m_ClearColor[3] = 255;
+    SoftRasterizerStats stats = { 0, 0, 0, 0.0, 0.0 };
+    m_Pending = m_Stats = stats;
+}
+
+void SoftRasterizer::clear(GLfloat r, GLfloat g, GLfloat b, GLfloat a) {
+    const GLfloat rgba[4] = { r, g, b, a };
+    for (int c = 0; c < 4; c++)
+        m_ClearColor[c] = (unsigned char)(std::min(1.0f, std::max(0.0f, rgba[c])) * 255.0f + 0.5f);
+    m_bClearPending = true;
+    // все, что нарисовано до очистки, все равно будет стерто
+    m_Triangles.clear();
+    for (size_t i = 0; i < m_Bins.size(); i++)
+        m_Bins[i].clear();
+} // clear
+
+// коэффициенты плоскости value = a * x + b * y + c, посчитанной в центрах пикселей
+static void planeEquation(const GLfloat* x, const GLfloat* y, const GLfloat* value, GLfloat area, GLfloat* plane) {
+    GLfloat dx = ((value[1] - value[0]) * (y[2] - y[0]) - (value[2] - value[0]) * (y[1] - y[0])) / area;
+    GLfloat dy = ((value[2] - value[0]) * (x[1] - x[0]) - (value[1] - value[0]) * (x[2] - x[0])) / area;
+    plane[0] = dx;
+    plane[1] = dy;
+    plane[2] = value[0] - dx * x[0] - dy * y[0] + 0.5f * (dx + dy);
+}
+
+void SoftRasterizer::setupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c,
+                                   std::vector<Triangle>& out) const {
+    const ClipVertex* clip[3] = { &a, &b, &c };
+    GLfloat x[3], y[3], z[3], invW[3], u[3], v[3];
+    for (int k = 0; k < 3; k++) {
+        invW[k] = 1.0f / clip[k]->position.w;
+        x[k] = (clip[k]->position.x * invW[k] * 0.5f + 0.5f) * m_Width;
+        y[k] = (clip[k]->position.y * invW[k] * 0.5f + 0.5f) * m_Height;
+        z[k] = clip[k]->position.z * invW[k] * 0.5f + 0.5f;
+        u[k] = clip[k]->s * invW[k];
+        v[k] = clip[k]->t * invW[k];
+    }
+    // GL_CULL_FACE выключен: треугольник по часовой стрелке разворачивается
+    GLfloat area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area < 0.0f) {
+        GLfloat* values[6] = { x, y, z, invW, u, v };
+        for (int i = 0; i < 6; i++)
+            std::swap(values[i][1], values[i][2]);
+        area = -area;
+    }
+    if (!(area > 0.0f) || std::min(z[0], std::min(z[1], z[2])) > 1.0f)
+        return;
+
+    Triangle t;
+    t.minX = std::max(0, (int)floorf(std::min(x[0], std::min(x[1], x[2]))));
+    t.minY = std::max(0, (int)floorf(std::min(y[0], std::min(y[1], y[2]))));
+    t.maxX = std::min(m_Width - 1, (int)floorf(std::max(x[0], std::max(x[1], x[2]))));
+    t.maxY = std::min(m_Height - 1, (int)floorf(std::max(y[0], std::max(y[1], y[2]))));
+    if (t.minX > t.maxX || t.minY > t.maxY)
+        return;
+    t.topLeft = 0;
+    for (int e = 0; e < 3; e++) {
+        int i = e, j = (e + 1) % 3;
+        t.edge[e][0] = y[i] - y[j];
+        t.edge[e][1] = x[j] - x[i];
+        t.edge[e][2] = x[i] * y[j] - y[i] * x[j];
+        t.edge[e][2] += 0.5f * (t.edge[e][0] + t.edge[e][1]);
+        // левое ребро (идет вниз) или верхнее горизонтальное (идет влево) владеет своими пикселями
+        if (t.edge[e][0] > 0.0f || (t.edge[e][0] == 0.0f && t.edge[e][1] < 0.0f))
+            t.topLeft |= 1 << e;
+    }
+    planeEquation(x, y, z, area, t.depth);
+    planeEquation(x, y, invW, area, t.invW);
+    planeEquation(x, y, u, area, t.u);
+    planeEquation(x, y, v, area, t.v);
+    t.texture = m_pTexture;
+    out.push_back(t);
+} // setupTriangle
+
+void SoftRasterizer::drawElements(const GLfloat* vertices, size_t stride, size_t texCoordOffset,
+                                  const GLuint* indices, size_t indexCount, const glm::mat4& model) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (indexCount == 0)
+        return;
+    // каждая вершина преобразуется один раз, как после вершинного шейдера
+    const glm::mat4 mvp = m_Projection * m_View * model;
+    GLuint vertexCount = *std::max_element(indices, indices + indexCount) + 1;
+    std::vector<ClipVertex> transformed(vertexCount);
+    for (GLuint i = 0; i < vertexCount; i++) {
+        const unsigned char* vertex = (const unsigned char*)vertices + i * stride;
+        const GLfloat* p = (const GLfloat*)vertex;
+        const GLfloat* uv = (const GLfloat*)(vertex + texCoordOffset);
+        transformed[i].position = mvp * glm::vec4(p[0], p[1], p[2], 1.0f);
+        transformed[i].s = uv[0];
+        transformed[i].t = 1.0f - uv[1];
+    }
+
+    size_t first = m_Triangles.size();
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        const ClipVertex* clip[3] = { &transformed[indices[i]], &transformed[indices[i + 1]],
+                                      &transformed[indices[i + 2]] };
+        int inside = 0;
+        for (int k = 0; k < 3; k++)
+            inside += clip[k]->position.z >= -clip[k]->position.w;
+        m_Pending.triangles++;
+        if (inside == 3) {
+            setupTriangle(*clip[0], *clip[1], *clip[2], m_Triangles);
+            continue;
+        }
+        if (inside == 0)
+            continue;
+        // отсечение ближней плоскостью z = -w, атрибуты интерполируются вместе с позицией
+        ClipVertex polygon[4];
+        int count = 0;
+        for (int k = 0; k < 3; k++) {
+            const ClipVertex& p = *clip[k];
+            const ClipVertex& q = *clip[(k + 1) % 3];
+            GLfloat dp = p.position.z + p.position.w, dq = q.position.z + q.position.w;
+            if (dp >= 0.0f)
+                polygon[count++] = p;
+            if ((dp >= 0.0f) != (dq >= 0.0f)) {
+                GLfloat f = dp / (dp - dq);
+                ClipVertex& r = polygon[count++];
+                r.position = p.position + (q.position - p.position) * f;
+                r.s = p.s + (q.s - p.s) * f;
+                r.t = p.t + (q.t - p.t) * f;
+            }
+        }
+        for (int k = 2; k < count; k++)
+            setupTriangle(polygon[0], polygon[k - 1], polygon[k], m_Triangles);
+    }
+
+    // раскладка по плиткам в порядке отправки
+    for (size_t i = first; i < m_Triangles.size(); i++) {
+        const Triangle& t = m_Triangles[i];
+        for (int ty = t.minY / SOFT_TILE_SIZE; ty <= t.maxY / SOFT_TILE_SIZE; ty++) {
+            for (int tx = t.minX / SOFT_TILE_SIZE; tx <= t.maxX / SOFT_TILE_SIZE; tx++) {
+                m_Bins[ty * m_TilesX + tx].push_back((GLuint)i);
+                m_Pending.binned++;
+            }
+        }
+    }
+    m_Pending.rasterized += m_Triangles.size() - first;
+    m_Pending.vertexMs += millisecondsSince(start);
+} // drawElements
+
+void SoftRasterizer::rasterizeTile(size_t tile) {
+    const int x0 = (int)(tile % m_TilesX) * SOFT_TILE_SIZE, y0 = (int)(tile / m_TilesX) * SOFT_TILE_SIZE;
+    const int x1 = std::min(m_Width, x0 + SOFT_TILE_SIZE) - 1, y1 = std::min(m_Height, y0 + SOFT_TILE_SIZE) - 1;
+    if (m_bClearPending) {
+        for (int y = y0; y <= y1; y++) {
+            std::fill(m_Depth.begin() + (size_t)y * m_Width + x0, m_Depth.begin() + (size_t)y * m_Width + x1 + 1, 1.0f);
+            unsigned char* row = &m_Color[((size_t)y * m_Width + x0) * 4];
+            for (int x = x0; x <= x1; x++, row += 4)
+                std::copy(m_ClearColor, m_ClearColor + 4, row);
+        }
+    }
+
+    const bool avx2 = hasAvx2();
+    const std::vector<GLuint>& bin = m_Bins[tile];
+    for (size_t i = 0; i < bin.size(); i++) {
+        const Triangle& t = m_Triangles[bin[i]];
+        int sx0 = std::max(x0, t.minX), sx1 = std::min(x1, t.maxX);
+        for (int y = std::max(y0, t.minY); y <= std::min(y1, t.maxY); y++) {
+            GLfloat* depth = &m_Depth[(size_t)y * m_Width];
+            unsigned char* color = &m_Color[(size_t)y * m_Width * 4];
+            int x = sx0;
+            if (avx2) {
+                // восьмерки выровнены от начала плитки, хвост у правого края экрана - обычным циклом
+                int blocks = x0 + ((sx0 - x0) & ~7);
+                int last = blocks;
+                while (last + 8 <= x1 + 1 && last <= sx1)
+                    last += 8;
+                if (last > blocks) {
+                    rasterizeSpanAvx2(t, (GLfloat)y, blocks, last - 8, depth, color);
+                    x = last;
+                }
+            }
+            if (x <= sx1)
+                rasterizeSpan(t, (GLfloat)y, x, sx1, depth, color);
+        }
+    }
+} // rasterizeTile
+
+void SoftRasterizer::flush() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (m_bClearPending || !m_Triangles.empty())
+        m_Pool.parallelFor(m_Bins.size(), [this](size_t tile) { rasterizeTile(tile); });
+    m_Pending.rasterMs = millisecondsSince(start);
+    m_Stats = m_Pending;
+    SoftRasterizerStats stats = { 0, 0, 0, 0.0, 0.0 };
+    m_Pending = stats;
+    m_bClearPending = false;
+    m_Triangles.clear();
+    for (size_t i = 0; i < m_Bins.size(); i++)
+        m_Bins[i].clear();
+} // flush
+
+bool SoftRasterizer::writePPM(const char* path) const {
+    FILE* file = fopen(path, "wb");
+    if (!file)
+        return false;
+    fprintf(file, "P6\n%d %d\n255\n", m_Width, m_Height);
+    std::vector<unsigned char> row(m_Width * 3);
+    for (int y = m_Height - 1; y >= 0; y--) {
+        const unsigned char* src = &m_Color[(size_t)y * m_Width * 4];
+        for (int x = 0; x < m_Width; x++) {
+            row[x * 3 + 0] = src[x * 4 + 0];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + 2];
+        }
+        fwrite(row.data(), 1, row.size(), file);
+    }
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+} // writePPM
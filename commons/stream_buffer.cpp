@@ -0,0 +1,144 @@
+
+/*
+ * Реализация потокового буфера StreamBuffer.
+ */
+
+#include "stream_buffer.h"
+#include "gl_ext.h"
+#include "gl_state.h"
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+StreamBuffer::StreamBuffer(GLenum target, GLsizeiptr segmentSize, Mode mode)
+    : m_Target(target),
+      m_Buffer(0),
+      m_Mode(mode),
+      m_SegmentSize(segmentSize),
+      m_Segment(0),
+      m_Used(0),
+      m_bSegmentReady(true),
+      m_bMapped(false),
+      m_pPersistent(nullptr) {
+    memset(m_Fences, 0, sizeof(m_Fences));
+    memset(&m_Frame, 0, sizeof(m_Frame));
+    memset(&m_LastFrame, 0, sizeof(m_LastFrame));
+
+    const GLExtensions& ext = glExtensions();
+    if (m_Mode == AUTO)
+        m_Mode = ext.bufferStorage ? PERSISTENT : UNSYNCHRONIZED;
+    if (m_Mode == PERSISTENT && !ext.bufferStorage) {
+        std::cout << "Warning: " << "persistent mapping is not supported, fallback to unsynchronized mapping" << std::endl;
+        m_Mode = UNSYNCHRONIZED;
+    }
+
+    glGenBuffers(1, &m_Buffer);
+    GLState::current().bindBuffer(m_Target, m_Buffer);
+    if (m_Mode == PERSISTENT) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        ext.BufferStorage(m_Target, m_SegmentSize * STREAM_SEGMENTS, nullptr, flags);
+        m_pPersistent = (unsigned char*)glMapBufferRange(m_Target, 0, m_SegmentSize * STREAM_SEGMENTS, flags);
+        if (!m_pPersistent) {
+            throw std::logic_error("can't map the stream buffer persistently");
+        }
+    }
+    else if (m_Mode == UNSYNCHRONIZED) {
+        glBufferData(m_Target, m_SegmentSize * STREAM_SEGMENTS, nullptr, GL_STREAM_DRAW);
+    }
+    else {
+        // в режиме ORPHAN сегмент один: каждый кадр драйвер выдает новую память
+        glBufferData(m_Target, m_SegmentSize, nullptr, GL_STREAM_DRAW);
+    }
+} // StreamBuffer
+
+StreamBuffer::~StreamBuffer() {
+    for (int i = 0; i < STREAM_SEGMENTS; i++) {
+        if (m_Fences[i])
+            glDeleteSync(m_Fences[i]);
+    }
+    if (m_pPersistent || m_bMapped) {
+        GLState::current().bindBuffer(m_Target, m_Buffer);
+        glUnmapBuffer(m_Target);
+    }
+    GLState::current().deleteBuffers(1, &m_Buffer);
+} // ~StreamBuffer
+
+/*
+ * Ждет, пока GPU закончит читать сегмент. Сначала барьер проверяется без ожидания,
+ * поэтому в обычном случае (GPU отстает меньше чем на STREAM_SEGMENTS кадров)
+ * программа не блокируется.
+ */
+void StreamBuffer::waitSegment(GLuint segment) {
+    GLsync fence = m_Fences[segment];
+    if (!fence)
+        return;
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        m_Frame.stalls++;
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);   // 1 мс
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    m_Fences[segment] = 0;
+} // waitSegment
+
+void* StreamBuffer::map(GLsizeiptr size, GLsizeiptr alignment, GLintptr* offset) {
+    if (m_bMapped) {
+        throw std::logic_error("stream buffer is already mapped");
+    }
+    if (alignment < 1)
+        alignment = 1;
+    GLsizeiptr start = (m_Used + alignment - 1) / alignment * alignment;
+    if (start + size > m_SegmentSize) {
+        throw std::logic_error("stream buffer segment overflow");
+    }
+
+    if (!m_bSegmentReady) {
+        waitSegment(m_Segment);
+        m_bSegmentReady = true;
+    }
+
+    GLintptr base = (m_Mode == ORPHAN) ? 0 : (GLintptr)m_Segment * m_SegmentSize;
+    *offset = base + start;
+    m_Used = start + size;
+    m_Frame.bytes += size;
+    m_Frame.allocations++;
+
+    if (m_Mode == PERSISTENT)
+        return m_pPersistent + *offset;
+
+    GLState::current().bindBuffer(m_Target, m_Buffer);
+    if (m_Mode == ORPHAN && start == 0)
+        glBufferData(m_Target, m_SegmentSize, nullptr, GL_STREAM_DRAW);
+    void* ptr = glMapBufferRange(m_Target, *offset, size,
+                                 GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    if (!ptr) {
+        throw std::logic_error("can't map the stream buffer");
+    }
+    m_bMapped = true;
+    return ptr;
+} // map
+
+void StreamBuffer::unmap() {
+    if (!m_bMapped)
+        return;
+    GLState::current().bindBuffer(m_Target, m_Buffer);
+    glUnmapBuffer(m_Target);
+    m_bMapped = false;
+} // unmap
+
+void StreamBuffer::endFrame() {
+    unmap();
+    if (m_Mode != ORPHAN) {
+        if (m_Fences[m_Segment])
+            glDeleteSync(m_Fences[m_Segment]);
+        m_Fences[m_Segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_Segment = (m_Segment + 1) % STREAM_SEGMENTS;
+        m_bSegmentReady = false;
+    }
+    m_Used = 0;
+    m_LastFrame = m_Frame;
+    memset(&m_Frame, 0, sizeof(m_Frame));
+} // endFrame
@@ -0,0 +1,857 @@
+/*
+ * Реализация блочного сжатия текстур (см. include/texture_compress.h).
+ */
+
+#include "texture_compress.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+#include <immintrin.h>
+
+bool isCompressedFormat(GLenum format) {
+    return format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ||
+           format == GL_COMPRESSED_RGBA_BPTC_UNORM || format == GL_COMPRESSED_RGB8_ETC2;
+}
+
+size_t compressedBlockSize(GLenum format) {
+    return format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || format == GL_COMPRESSED_RGB8_ETC2 ? 8 : 16;
+}
+
+size_t compressedSize(GLenum format, int width, int height) {
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * compressedBlockSize(format);
+}
+
+//-------- общие функции -----------------------------------------------
+// блок 4 x 4 из изображения; за краем повторяются крайние тексели
+static void fetchBlock(const unsigned char* rgba, int width, int height, int bx, int by, uint8_t block[64]) {
+    for (int y = 0; y < 4; y++) {
+        int sy = std::min(by * 4 + y, height - 1);
+        for (int x = 0; x < 4; x++) {
+            int sx = std::min(bx * 4 + x, width - 1);
+            memcpy(block + (y * 4 + x) * 4, rgba + ((size_t)sy * width + sx) * 4, 4);
+        }
+    }
+}
+
+static void storeBlock(const uint8_t block[64], int width, int height, int bx, int by, unsigned char* rgba) {
+    for (int y = 0; y < 4 && by * 4 + y < height; y++) {
+        for (int x = 0; x < 4 && bx * 4 + x < width; x++)
+            memcpy(rgba + ((size_t)(by * 4 + y) * width + bx * 4 + x) * 4, block + (y * 4 + x) * 4, 4);
+    }
+}
+
+static inline int clampByte(int v) {
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+/*
+ * Главная ось облака точек (первые channels компонент текселей) методом степеней по матрице
+ * ковариации. Возвращает среднее и ось; для блока одного цвета ось нулевая.
+ */
+static void principalAxis(const uint8_t block[64], int channels, float mean[4], float axis[4]) {
+    for (int c = 0; c < 4; c++)
+        mean[c] = axis[c] = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < channels; c++)
+            mean[c] += block[i * 4 + c];
+    }
+    for (int c = 0; c < channels; c++)
+        mean[c] /= 16.0f;
+    float cov[4][4] = {};
+    for (int i = 0; i < 16; i++) {
+        float d[4];
+        for (int c = 0; c < channels; c++)
+            d[c] = block[i * 4 + c] - mean[c];
+        for (int a = 0; a < channels; a++) {
+            for (int b = 0; b < channels; b++)
+                cov[a][b] += d[a] * d[b];
+        }
+    }
+    // начальное направление - диагональ, степеней достаточно восьми
+    float v[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float w[4] = {}, length = 0.0f;
+        for (int a = 0; a < channels; a++) {
+            for (int b = 0; b < channels; b++)
+                w[a] += cov[a][b] * v[b];
+            length = std::max(length, fabsf(w[a]));
+        }
+        if (length < 1e-6f)
+            return;
+        for (int a = 0; a < channels; a++)
+            v[a] = w[a] / length;
+    }
+    float length = 0.0f;
+    for (int c = 0; c < channels; c++)
+        length += v[c] * v[c];
+    length = sqrtf(length);
+    for (int c = 0; c < channels; c++)
+        axis[c] = v[c] / length;
+}
+
+// концы отрезка по главной оси: проекции крайних текселей
+static void axisEndpoints(const uint8_t block[64], int channels, float lo[4], float hi[4]) {
+    float mean[4], axis[4];
+    principalAxis(block, channels, mean, axis);
+    float tMin = 0.0f, tMax = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float t = 0.0f;
+        for (int c = 0; c < channels; c++)
+            t += (block[i * 4 + c] - mean[c]) * axis[c];
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+    for (int c = 0; c < channels; c++) {
+        lo[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * tMin));
+        hi[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * tMax));
+    }
+}
+
+/*
+ * Концы отрезка по методу наименьших квадратов для известных весов текселей: тексель i
+ * приближается как (1 - w[i]) * lo + w[i] * hi. false, если система вырождена.
+ */
+static bool leastSquaresEndpoints(const uint8_t block[64], int channels, const float w[16], float lo[4], float hi[4]) {
+    float aa = 0.0f, bb = 0.0f, ab = 0.0f, ax[4] = {}, bx[4] = {};
+    for (int i = 0; i < 16; i++) {
+        float a = 1.0f - w[i], b = w[i];
+        aa += a * a;
+        bb += b * b;
+        ab += a * b;
+        for (int c = 0; c < channels; c++) {
+            ax[c] += a * block[i * 4 + c];
+            bx[c] += b * block[i * 4 + c];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (fabsf(det) < 1e-6f)
+        return false;
+    for (int c = 0; c < channels; c++) {
+        lo[c] = std::min(255.0f, std::max(0.0f, (ax[c] * bb - bx[c] * ab) / det));
+        hi[c] = std::min(255.0f, std::max(0.0f, (bx[c] * aa - ax[c] * ab) / det));
+    }
+    return true;
+}
+
+//-------- BC1 ---------------------------------------------------------
+static inline uint16_t pack565(const float c[4]) {
+    int r = (int)(c[0] * 31.0f / 255.0f + 0.5f), g = (int)(c[1] * 63.0f / 255.0f + 0.5f), b = (int)(c[2] * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static inline void unpack565(uint16_t c, int rgb[3]) {
+    int r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// палитра четырехцветного режима в порядке кодов 0..3
+static void bc1Palette(uint16_t c0, uint16_t c1, int palette[4][3]) {
+    unpack565(c0, palette[0]);
+    unpack565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+}
+
+// индексы текселей для пары концов и суммарная ошибка
+static int bc1Indices(const uint8_t block[64], uint16_t c0, uint16_t c1, uint8_t indices[16]) {
+    int palette[4][3];
+    bc1Palette(c0, c1, palette);
+    int total = 0;
+    for (int i = 0; i < 16; i++) {
+        int best = 0, bestError = INT32_MAX;
+        for (int k = 0; k < 4; k++) {
+            int dr = block[i * 4] - palette[k][0], dg = block[i * 4 + 1] - palette[k][1], db = block[i * 4 + 2] - palette[k][2];
+            int error = dr * dr + dg * dg + db * db;
+            if (error < bestError) {
+                bestError = error;
+                best = k;
+            }
+        }
+        indices[i] = (uint8_t)best;
+        total += bestError;
+    }
+    return total;
+}
+
+/*
+ * Цвет BC1 (он же цветовая часть BC3). Всегда четырехцветный режим: c0 > c1, а при c0 == c1 все
+ * индексы нулевые, и режим не важен.
+ */
+static void encodeBC1Color(const uint8_t block[64], uint8_t out[8]) {
+    float lo[4], hi[4];
+    axisEndpoints(block, 3, lo, hi);
+    uint16_t c0 = pack565(hi), c1 = pack565(lo);
+    uint8_t indices[16];
+    int error = bc1Indices(block, c0, c1, indices);
+
+    // одно уточнение концов по найденным индексам
+    static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    float w[16];
+    for (int i = 0; i < 16; i++)
+        w[i] = weights[indices[i]];
+    if (error > 0 && leastSquaresEndpoints(block, 3, w, hi, lo)) {
+        uint16_t r0 = pack565(hi), r1 = pack565(lo);
+        uint8_t refined[16];
+        int refinedError = bc1Indices(block, r0, r1, refined);
+        if (refinedError < error) {
+            c0 = r0;
+            c1 = r1;
+            memcpy(indices, refined, 16);
+        }
+    }
+
+    if (c0 < c1) {
+        std::swap(c0, c1);
+        static const uint8_t swapped[4] = { 1, 0, 3, 2 };
+        for (int i = 0; i < 16; i++)
+            indices[i] = swapped[indices[i]];
+    }
+    else if (c0 == c1) {
+        memset(indices, 0, 16);
+    }
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; i++)
+        bits |= (uint32_t)indices[i] << (2 * i);
+    out[0] = (uint8_t)c0;
+    out[1] = (uint8_t)(c0 >> 8);
+    out[2] = (uint8_t)c1;
+    out[3] = (uint8_t)(c1 >> 8);
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (uint8_t)(bits >> (8 * i));
+} // encodeBC1Color
+
+static void decodeBC1Color(const uint8_t in[8], bool allowThreeColor, uint8_t block[64]) {
+    uint16_t c0 = (uint16_t)(in[0] | (in[1] << 8)), c1 = (uint16_t)(in[2] | (in[3] << 8));
+    int palette[4][3];
+    bc1Palette(c0, c1, palette);
+    if (allowThreeColor && c0 <= c1) {
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    uint32_t bits = in[4] | (in[5] << 8) | (in[6] << 16) | ((uint32_t)in[7] << 24);
+    for (int i = 0; i < 16; i++) {
+        const int* color = palette[(bits >> (2 * i)) & 3];
+        block[i * 4] = (uint8_t)color[0];
+        block[i * 4 + 1] = (uint8_t)color[1];
+        block[i * 4 + 2] = (uint8_t)color[2];
+        block[i * 4 + 3] = 255;
+    }
+}
+
+//-------- BC3 ---------------------------------------------------------
+// альфа BC3: восемь уровней между наименьшей и наибольшей альфой блока
+static void encodeBC3Alpha(const uint8_t block[64], uint8_t out[8]) {
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; i++) {
+        a0 = std::max(a0, (int)block[i * 4 + 3]);
+        a1 = std::min(a1, (int)block[i * 4 + 3]);
+    }
+    out[0] = (uint8_t)a0;
+    out[1] = (uint8_t)a1;
+    uint64_t bits = 0;
+    if (a0 > a1) {
+        int palette[8] = { a0, a1 };
+        for (int k = 2; k < 8; k++)
+            palette[k] = ((8 - k) * a0 + (k - 1) * a1) / 7;
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestError = 256;
+            for (int k = 0; k < 8; k++) {
+                int error = abs(block[i * 4 + 3] - palette[k]);
+                if (error < bestError) {
+                    bestError = error;
+                    best = k;
+                }
+            }
+            bits |= (uint64_t)best << (3 * i);
+        }
+    }
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (uint8_t)(bits >> (8 * i));
+}
+
+static void decodeBC3Alpha(const uint8_t in[8], uint8_t block[64]) {
+    int a0 = in[0], a1 = in[1], palette[8] = { a0, a1 };
+    if (a0 > a1) {
+        for (int k = 2; k < 8; k++)
+            palette[k] = ((8 - k) * a0 + (k - 1) * a1) / 7;
+    }
+    else {
+        for (int k = 2; k < 6; k++)
+            palette[k] = ((6 - k) * a0 + (k - 1) * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; i++)
+        bits |= (uint64_t)in[2 + i] << (8 * i);
+    for (int i = 0; i < 16; i++)
+        block[i * 4 + 3] = (uint8_t)palette[(bits >> (3 * i)) & 7];
+}
+
+//-------- BC7, режим 6 ------------------------------------------------
+static const int bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct BC7Endpoints {
+    int     e[2][4];            // 7-битные компоненты концов
+    int     p[2];               // p-биты
+};
+
+static int bc7Indices(const uint8_t block[64], const BC7Endpoints& ep, uint8_t indices[16]) {
+    int palette[16][4];
+    for (int c = 0; c < 4; c++) {
+        int lo = (ep.e[0][c] << 1) | ep.p[0], hi = (ep.e[1][c] << 1) | ep.p[1];
+        for (int k = 0; k < 16; k++)
+            palette[k][c] = ((64 - bc7Weights[k]) * lo + bc7Weights[k] * hi + 32) >> 6;
+    }
+    int total = 0;
+    for (int i = 0; i < 16; i++) {
+        int best = 0, bestError = INT32_MAX;
+        for (int k = 0; k < 16; k++) {
+            int error = 0;
+            for (int c = 0; c < 4; c++) {
+                int d = block[i * 4 + c] - palette[k][c];
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                best = k;
+            }
+        }
+        indices[i] = (uint8_t)best;
+        total += bestError;
+    }
+    return total;
+}
+
+// лучшее сочетание p-битов для концов lo и hi
+static int bc7Quantize(const uint8_t block[64], const float lo[4], const float hi[4], BC7Endpoints& ep, uint8_t indices[16]) {
+    int bestError = INT32_MAX;
+    for (int pBits = 0; pBits < 4; pBits++) {
+        BC7Endpoints candidate;
+        candidate.p[0] = pBits & 1;
+        candidate.p[1] = pBits >> 1;
+        for (int c = 0; c < 4; c++) {
+            candidate.e[0][c] = std::min(127, std::max(0, (int)floorf((lo[c] - candidate.p[0]) / 2.0f + 0.5f)));
+            candidate.e[1][c] = std::min(127, std::max(0, (int)floorf((hi[c] - candidate.p[1]) / 2.0f + 0.5f)));
+        }
+        uint8_t candidateIndices[16];
+        int error = bc7Indices(block, candidate, candidateIndices);
+        if (error < bestError) {
+            bestError = error;
+            ep = candidate;
+            memcpy(indices, candidateIndices, 16);
+        }
+    }
+    return bestError;
+}
+
+static void encodeBC7Block(const uint8_t block[64], uint8_t out[16]) {
+    float lo[4], hi[4];
+    axisEndpoints(block, 4, lo, hi);
+    BC7Endpoints ep;
+    uint8_t indices[16];
+    int error = bc7Quantize(block, lo, hi, ep, indices);
+
+    float w[16];
+    for (int i = 0; i < 16; i++)
+        w[i] = bc7Weights[indices[i]] / 64.0f;
+    if (error > 0 && leastSquaresEndpoints(block, 4, w, lo, hi)) {
+        BC7Endpoints refined;
+        uint8_t refinedIndices[16];
+        if (bc7Quantize(block, lo, hi, refined, refinedIndices) < error) {
+            ep = refined;
+            memcpy(indices, refinedIndices, 16);
+        }
+    }
+
+    // старший бит индекса первого текселя не хранится и должен быть нулем
+    if (indices[0] & 8) {
+        for (int c = 0; c < 4; c++)
+            std::swap(ep.e[0][c], ep.e[1][c]);
+        std::swap(ep.p[0], ep.p[1]);
+        for (int i = 0; i < 16; i++)
+            indices[i] = (uint8_t)(15 - indices[i]);
+    }
+
+    uint64_t lowBits = 1u << 6, highBits = 0;     // режим 6
+    int position = 7;
+    for (int c = 0; c < 4; c++) {
+        for (int k = 0; k < 2; k++) {
+            lowBits |= (uint64_t)ep.e[k][c] << position;
+            position += 7;
+        }
+    }
+    lowBits |= (uint64_t)ep.p[0] << 63;           // position == 63
+    highBits |= (uint64_t)ep.p[1];
+    highBits |= (uint64_t)indices[0] << 1;
+    for (int i = 1; i < 16; i++)
+        highBits |= (uint64_t)indices[i] << (4 + 4 * (i - 1));
+    for (int i = 0; i < 8; i++) {
+        out[i] = (uint8_t)(lowBits >> (8 * i));
+        out[8 + i] = (uint8_t)(highBits >> (8 * i));
+    }
+} // encodeBC7Block
+
+static bool decodeBC7Block(const uint8_t in[16], uint8_t block[64]) {
+    if ((in[0] & 0x7F) != 0x40)
+        return false;
+    uint64_t lowBits = 0, highBits = 0;
+    for (int i = 0; i < 8; i++) {
+        lowBits |= (uint64_t)in[i] << (8 * i);
+        highBits |= (uint64_t)in[8 + i] << (8 * i);
+    }
+    BC7Endpoints ep;
+    int position = 7;
+    for (int c = 0; c < 4; c++) {
+        for (int k = 0; k < 2; k++) {
+            ep.e[k][c] = (int)((lowBits >> position) & 127);
+            position += 7;
+        }
+    }
+    ep.p[0] = (int)(lowBits >> 63);
+    ep.p[1] = (int)(highBits & 1);
+    for (int i = 0; i < 16; i++) {
+        int index = i == 0 ? (int)((highBits >> 1) & 7) : (int)((highBits >> (4 + 4 * (i - 1))) & 15);
+        for (int c = 0; c < 4; c++) {
+            int lo = (ep.e[0][c] << 1) | ep.p[0], hi = (ep.e[1][c] << 1) | ep.p[1];
+            block[i * 4 + c] = (uint8_t)(((64 - bc7Weights[index]) * lo + bc7Weights[index] * hi + 32) >> 6);
+        }
+    }
+    return true;
+}
+
+//-------- ETC2 (режимы ETC1) ------------------------------------------
+static const int etcModifiers[8][4] = {
+    { 2, 8, -2, -8 }, { 5, 17, -5, -17 }, { 9, 29, -9, -29 }, { 13, 42, -13, -42 },
+    { 18, 60, -18, -60 }, { 24, 80, -24, -80 }, { 33, 106, -33, -106 }, { 47, 183, -47, -183 }
+};
+
+// тексель (x, y) принадлежит второму подблоку?
+static inline bool etcSecond(int x, int y, bool flip) {
+    return flip ? y >= 2 : x >= 2;
+}
+
+/*
+ * Лучшая таблица модификаторов для подблока с базовым цветом base. Индексы текселей пишутся
+ * в indices (в порядке y * 4 + x), возвращается ошибка подблока.
+ */
+static int etcSubblock(const uint8_t block[64], bool flip, bool second, const int base[3], int& table, uint8_t indices[16]) {
+    int bestError = INT32_MAX;
+    for (int t = 0; t < 8; t++) {
+        int error = 0;
+        uint8_t candidate[16];
+        for (int i = 0; i < 16; i++) {
+            if (etcSecond(i & 3, i >> 2, flip) != second)
+                continue;
+            int best = 0, bestPixel = INT32_MAX;
+            for (int k = 0; k < 4; k++) {
+                int pixel = 0;
+                for (int c = 0; c < 3; c++) {
+                    int d = block[i * 4 + c] - clampByte(base[c] + etcModifiers[t][k]);
+                    pixel += d * d;
+                }
+                if (pixel < bestPixel) {
+                    bestPixel = pixel;
+                    best = k;
+                }
+            }
+            candidate[i] = (uint8_t)best;
+            error += bestPixel;
+        }
+        if (error < bestError) {
+            bestError = error;
+            table = t;
+            for (int i = 0; i < 16; i++) {
+                if (etcSecond(i & 3, i >> 2, flip) == second)
+                    indices[i] = candidate[i];
+            }
+        }
+    }
+    return bestError;
+}
+
+static void encodeETC2Block(const uint8_t block[64], uint8_t out[8]) {
+    uint64_t bestBits = 0;
+    int bestError = INT32_MAX;
+    for (int flip = 0; flip < 2; flip++) {
+        float average[2][3] = {};
+        for (int i = 0; i < 16; i++) {
+            int s = etcSecond(i & 3, i >> 2, flip != 0);
+            for (int c = 0; c < 3; c++)
+                average[s][c] += block[i * 4 + c] / 8.0f;
+        }
+        for (int differential = 0; differential < 2; differential++) {
+            int quantized[2][3], base[2][3];
+            bool fits = true;
+            for (int s = 0; s < 2; s++) {
+                for (int c = 0; c < 3; c++) {
+                    if (differential) {
+                        quantized[s][c] = std::min(31, (int)(average[s][c] * 31.0f / 255.0f + 0.5f));
+                        base[s][c] = (quantized[s][c] << 3) | (quantized[s][c] >> 2);
+                    }
+                    else {
+                        quantized[s][c] = std::min(15, (int)(average[s][c] * 15.0f / 255.0f + 0.5f));
+                        base[s][c] = quantized[s][c] * 17;
+                    }
+                }
+            }
+            for (int c = 0; differential && c < 3; c++) {
+                int delta = quantized[1][c] - quantized[0][c];
+                fits = fits && delta >= -4 && delta <= 3;
+            }
+            if (!fits)
+                continue;
+
+            int tables[2];
+            uint8_t indices[16];
+            int error = etcSubblock(block, flip != 0, false, base[0], tables[0], indices) +
+                        etcSubblock(block, flip != 0, true, base[1], tables[1], indices);
+            if (error >= bestError)
+                continue;
+            bestError = error;
+
+            uint64_t bits = 0;
+            for (int c = 0; c < 3; c++) {
+                int shift = 59 - 8 * c;
+                if (differential) {
+                    bits |= (uint64_t)quantized[0][c] << shift;
+                    bits |= (uint64_t)((quantized[1][c] - quantized[0][c]) & 7) << (shift - 3);
+                }
+                else {
+                    bits |= (uint64_t)quantized[0][c] << (shift + 1);
+                    bits |= (uint64_t)quantized[1][c] << (shift - 3);
+                }
+            }
+            bits |= (uint64_t)tables[0] << 37;
+            bits |= (uint64_t)tables[1] << 34;
+            bits |= (uint64_t)differential << 33;
+            bits |= (uint64_t)flip << 32;
+            // индексы по столбцам: тексель (x, y) - бит x * 4 + y; код 0..3 -> (старший, младший)
+            static const int codes[4] = { 0, 1, 2, 3 };
+            for (int i = 0; i < 16; i++) {
+                int p = (i & 3) * 4 + (i >> 2), code = codes[indices[i]];
+                bits |= (uint64_t)(code >> 1) << (16 + p);
+                bits |= (uint64_t)(code & 1) << p;
+            }
+            bestBits = bits;
+        }
+    }
+    for (int i = 0; i < 8; i++)
+        out[i] = (uint8_t)(bestBits >> (56 - 8 * i));
+} // encodeETC2Block
+
+static bool decodeETC2Block(const uint8_t in[8], uint8_t block[64]) {
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; i++)
+        bits = (bits << 8) | in[i];
+    bool differential = (bits >> 33) & 1, flip = (bits >> 32) & 1;
+    int base[2][3];
+    for (int c = 0; c < 3; c++) {
+        int shift = 59 - 8 * c;
+        if (differential) {
+            int c0 = (int)((bits >> shift) & 31), delta = (int)((bits >> (shift - 3)) & 7);
+            int c1 = c0 + (delta >= 4 ? delta - 8 : delta);
+            if (c1 < 0 || c1 > 31)
+                return false;           // режимы T, H и planar
+            base[0][c] = (c0 << 3) | (c0 >> 2);
+            base[1][c] = (c1 << 3) | (c1 >> 2);
+        }
+        else {
+            base[0][c] = (int)((bits >> (shift + 1)) & 15) * 17;
+            base[1][c] = (int)((bits >> (shift - 3)) & 15) * 17;
+        }
+    }
+    int tables[2] = { (int)((bits >> 37) & 7), (int)((bits >> 34) & 7) };
+    for (int i = 0; i < 16; i++) {
+        int x = i & 3, y = i >> 2, p = x * 4 + y, s = etcSecond(x, y, flip);
+        int code = (int)(((bits >> (16 + p)) & 1) << 1 | ((bits >> p) & 1));
+        for (int c = 0; c < 3; c++)
+            block[i * 4 + c] = (uint8_t)clampByte(base[s][c] + etcModifiers[tables[s]][code]);
+        block[i * 4 + 3] = 255;
+    }
+    return true;
+}
+
+//-------- быстрый BC1/BC3 ---------------------------------------------
+/*
+ * Общая часть скалярного пути и AVX2: по наименьшим и наибольшим каналам блока считает концы
+ * и палитру. Палитра цвета хранится как RGBA с нулевой альфой - в таком виде ее удобно
+ * сравнивать с текселями, у которых альфа тоже обнулена.
+ */
+struct FastBlock {
+    uint16_t    c0, c1;
+    uint32_t    palette[4];
+    int         a0, a1;             // альфа: a0 > a1, либо a0 == a1 и все индексы нулевые
+    float       alphaScale;         // 7 / (a0 - a1)
+};
+
+static void fastEndpoints(const uint8_t minimum[4], const uint8_t maximum[4], FastBlock& fb) {
+    int lo[3], hi[3];
+    for (int c = 0; c < 3; c++) {
+        int inset = (maximum[c] - minimum[c]) >> 4;
+        lo[c] = minimum[c] + inset;
+        hi[c] = maximum[c] - inset;
+    }
+    fb.c0 = (uint16_t)((((hi[0] * 31 + 127) / 255) << 11) | (((hi[1] * 63 + 127) / 255) << 5) | ((hi[2] * 31 + 127) / 255));
+    fb.c1 = (uint16_t)((((lo[0] * 31 + 127) / 255) << 11) | (((lo[1] * 63 + 127) / 255) << 5) | ((lo[2] * 31 + 127) / 255));
+    int palette[4][3];
+    bc1Palette(fb.c0, fb.c1, palette);
+    for (int k = 0; k < 4; k++)
+        fb.palette[k] = (uint32_t)palette[k][0] | ((uint32_t)palette[k][1] << 8) | ((uint32_t)palette[k][2] << 16);
+
+    int inset = (maximum[3] - minimum[3]) >> 5;
+    fb.a0 = maximum[3] - inset;
+    fb.a1 = minimum[3] + inset;
+    fb.alphaScale = fb.a0 > fb.a1 ? 7.0f / (fb.a0 - fb.a1) : 0.0f;
+}
+
+// положение t = 0..7 на отрезке от a1 к a0 -> код BC3: 7 -> 0, 0 -> 1, остальные 8 - t
+static inline int fastAlphaCode(int t) {
+    int code = (8 - t) & 7;
+    return code ^ (code < 2 ? 1 : 0);
+}
+
+static void fastWrite(const FastBlock& fb, bool alpha, uint32_t colorBits, uint64_t alphaBits, uint8_t* out) {
+    if (alpha) {
+        out[0] = (uint8_t)fb.a0;
+        out[1] = (uint8_t)fb.a1;
+        if (fb.a0 == fb.a1)
+            alphaBits = 0;
+        for (int i = 0; i < 6; i++)
+            out[2 + i] = (uint8_t)(alphaBits >> (8 * i));
+        out += 8;
+    }
+    if (fb.c0 == fb.c1)
+        colorBits = 0;      // иначе при c0 == c1 включился бы трехцветный режим BC1
+    out[0] = (uint8_t)fb.c0;
+    out[1] = (uint8_t)(fb.c0 >> 8);
+    out[2] = (uint8_t)fb.c1;
+    out[3] = (uint8_t)(fb.c1 >> 8);
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (uint8_t)(colorBits >> (8 * i));
+}
+
+// блок 4 x 4 начиная с src, строки через stride байт
+static void encodeFast(const uint8_t* src, size_t stride, bool alpha, uint8_t* out) {
+    uint8_t minimum[4] = { 255, 255, 255, 255 }, maximum[4] = { 0, 0, 0, 0 };
+    for (int y = 0; y < 4; y++) {
+        for (int i = 0; i < 16; i++) {
+            minimum[i & 3] = std::min(minimum[i & 3], src[y * stride + i]);
+            maximum[i & 3] = std::max(maximum[i & 3], src[y * stride + i]);
+        }
+    }
+    FastBlock fb;
+    fastEndpoints(minimum, maximum, fb);
+
+    uint32_t colorBits = 0;
+    uint64_t alphaBits = 0;
+    for (int i = 0; i < 16; i++) {
+        const uint8_t* texel = src + (i >> 2) * stride + (i & 3) * 4;
+        int best = 0, bestDistance = INT32_MAX;
+        for (int k = 0; k < 4; k++) {
+            int distance = abs(texel[0] - (int)(fb.palette[k] & 255)) + abs(texel[1] - (int)((fb.palette[k] >> 8) & 255)) +
+                           abs(texel[2] - (int)((fb.palette[k] >> 16) & 255));
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = k;
+            }
+        }
+        colorBits |= (uint32_t)best << (2 * i);
+        if (alpha) {
+            int t = (int)((float)(texel[3] - fb.a1) * fb.alphaScale + 0.5f);
+            t = std::min(7, std::max(0, t));
+            alphaBits |= (uint64_t)fastAlphaCode(t) << (3 * i);
+        }
+    }
+    fastWrite(fb, alpha, colorBits, alphaBits, out);
+} // encodeFast
+
+// OR всех восьми 32-битных элементов
+__attribute__((target("avx2")))
+static inline uint32_t horizontalOr(__m256i v) {
+    __m128i x = _mm_or_si128(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    x = _mm_or_si128(x, _mm_shuffle_epi32(x, 0x4E));
+    x = _mm_or_si128(x, _mm_shuffle_epi32(x, 0xB1));
+    return (uint32_t)_mm_cvtsi128_si32(x);
+}
+
+// то же для восьми текселей за раз: в регистре строки 0-1 или 2-3 блока
+__attribute__((target("avx2")))
+static void encodeFastAvx2(const uint8_t* src, size_t stride, bool alpha, uint8_t* out) {
+    __m256i texels[2];
+    for (int half = 0; half < 2; half++) {
+        __m128i first = _mm_loadu_si128((const __m128i*)(src + (2 * half) * stride));
+        __m128i second = _mm_loadu_si128((const __m128i*)(src + (2 * half + 1) * stride));
+        texels[half] = _mm256_inserti128_si256(_mm256_castsi128_si256(first), second, 1);
+    }
+
+    __m256i lo = _mm256_min_epu8(texels[0], texels[1]), hi = _mm256_max_epu8(texels[0], texels[1]);
+    __m128i minimum = _mm_min_epu8(_mm256_castsi256_si128(lo), _mm256_extracti128_si256(lo, 1));
+    __m128i maximum = _mm_max_epu8(_mm256_castsi256_si128(hi), _mm256_extracti128_si256(hi, 1));
+    minimum = _mm_min_epu8(minimum, _mm_shuffle_epi32(minimum, 0x4E));
+    maximum = _mm_max_epu8(maximum, _mm_shuffle_epi32(maximum, 0x4E));
+    minimum = _mm_min_epu8(minimum, _mm_shuffle_epi32(minimum, 0xB1));
+    maximum = _mm_max_epu8(maximum, _mm_shuffle_epi32(maximum, 0xB1));
+    uint32_t packedMin = (uint32_t)_mm_cvtsi128_si32(minimum), packedMax = (uint32_t)_mm_cvtsi128_si32(maximum);
+    // fastEndpoints и fastWrite собраны без AVX: без очистки верхних половин регистров переход стоит дороже их самих
+    _mm256_zeroupper();
+    FastBlock fb;
+    fastEndpoints((const uint8_t*)&packedMin, (const uint8_t*)&packedMax, fb);
+
+    const __m256i rgbMask = _mm256_set1_epi32(0x00FFFFFF);
+    const __m256i ones8 = _mm256_set1_epi8(1), ones16 = _mm256_set1_epi16(1);
+    const __m256i colorShifts = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+    const __m256i alphaShifts = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    uint32_t colorBits = 0;
+    uint64_t alphaBits = 0;
+    for (int half = 0; half < 2; half++) {
+        __m256i rgb = _mm256_and_si256(texels[half], rgbMask);
+        __m256i best = _mm256_set1_epi32(INT32_MAX), index = _mm256_setzero_si256();
+        for (int k = 0; k < 4; k++) {
+            __m256i color = _mm256_set1_epi32((int)fb.palette[k]);
+            __m256i difference = _mm256_or_si256(_mm256_subs_epu8(rgb, color), _mm256_subs_epu8(color, rgb));
+            __m256i distance = _mm256_madd_epi16(_mm256_maddubs_epi16(difference, ones8), ones16);
+            __m256i closer = _mm256_cmpgt_epi32(best, distance);
+            best = _mm256_min_epi32(best, distance);
+            index = _mm256_blendv_epi8(index, _mm256_set1_epi32(k), closer);
+        }
+        colorBits |= horizontalOr(_mm256_sllv_epi32(index, colorShifts)) << (16 * half);
+
+        if (alpha) {
+            __m256i a = _mm256_sub_epi32(_mm256_srli_epi32(texels[half], 24), _mm256_set1_epi32(fb.a1));
+            __m256 position = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(a), _mm256_set1_ps(fb.alphaScale)),
+                                            _mm256_set1_ps(0.5f));
+            __m256i t = _mm256_cvttps_epi32(position);
+            t = _mm256_min_epi32(_mm256_set1_epi32(7), _mm256_max_epi32(_mm256_setzero_si256(), t));
+            __m256i code = _mm256_and_si256(_mm256_sub_epi32(_mm256_set1_epi32(8), t), _mm256_set1_epi32(7));
+            __m256i swap = _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(2), code), _mm256_set1_epi32(1));
+            code = _mm256_xor_si256(code, swap);
+            alphaBits |= (uint64_t)horizontalOr(_mm256_sllv_epi32(code, alphaShifts)) << (24 * half);
+        }
+    }
+    _mm256_zeroupper();
+    fastWrite(fb, alpha, colorBits, alphaBits, out);
+} // encodeFastAvx2
+
+bool compressHasAvx2() {
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+//-------- изображения -------------------------------------------------
+static void compressBlock(GLenum format, const uint8_t block[64], uint8_t* out) {
+    switch (format) {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+            encodeBC1Color(block, out);
+            break;
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            encodeBC3Alpha(block, out);
+            encodeBC1Color(block, out + 8);
+            break;
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+            encodeBC7Block(block, out);
+            break;
+        case GL_COMPRESSED_RGB8_ETC2:
+            encodeETC2Block(block, out);
+            break;
+    }
+}
+
+void compressImage(GLenum format, const unsigned char* rgba, int width, int height, unsigned char* blocks,
+                   ThreadPool* pool) {
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    size_t blockSize = compressedBlockSize(format);
+    std::function<void(size_t)> row = [&](size_t by) {
+        uint8_t block[64];
+        for (int bx = 0; bx < blocksX; bx++) {
+            fetchBlock(rgba, width, height, bx, (int)by, block);
+            compressBlock(format, block, blocks + (by * blocksX + bx) * blockSize);
+        }
+    };
+    if (pool) {
+        pool->parallelFor(blocksY, row);
+    }
+    else {
+        for (int by = 0; by < blocksY; by++)
+            row(by);
+    }
+} // compressImage
+
+void compressImageFast(GLenum format, const unsigned char* rgba, int width, int height, unsigned char* blocks,
+                       ThreadPool* pool, bool allowAvx2) {
+    if (format != GL_COMPRESSED_RGB_S3TC_DXT1_EXT && format != GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+        throw std::logic_error("fast compression supports only BC1 and BC3");
+    bool alpha = format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, avx2 = allowAvx2 && compressHasAvx2();
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    size_t blockSize = compressedBlockSize(format), stride = (size_t)width * 4;
+    std::function<void(size_t)> row = [&](size_t by) {
+        uint8_t block[64];
+        for (int bx = 0; bx < blocksX; bx++) {
+            // целые блоки читаются прямо из изображения, краевые - из копии
+            const uint8_t* src = rgba + (by * 4 * width + bx * 4) * 4;
+            size_t srcStride = stride;
+            if (bx * 4 + 4 > width || (int)by * 4 + 4 > height) {
+                fetchBlock(rgba, width, height, bx, (int)by, block);
+                src = block;
+                srcStride = 16;
+            }
+            unsigned char* out = blocks + (by * blocksX + bx) * blockSize;
+            if (avx2)
+                encodeFastAvx2(src, srcStride, alpha, out);
+            else
+                encodeFast(src, srcStride, alpha, out);
+        }
+    };
+    if (pool) {
+        pool->parallelFor(blocksY, row);
+    }
+    else {
+        for (int by = 0; by < blocksY; by++)
+            row(by);
+    }
+} // compressImageFast
+
+bool decompressImage(GLenum format, const unsigned char* blocks, int width, int height, unsigned char* rgba) {
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    size_t blockSize = compressedBlockSize(format);
+    uint8_t block[64];
+    for (int by = 0; by < blocksY; by++) {
+        for (int bx = 0; bx < blocksX; bx++) {
+            const uint8_t* in = blocks + ((size_t)by * blocksX + bx) * blockSize;
+            bool ok = true;
+            switch (format) {
+                case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+                    decodeBC1Color(in, true, block);
+                    break;
+                case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+                    decodeBC1Color(in + 8, false, block);
+                    decodeBC3Alpha(in, block);
+                    break;
+                case GL_COMPRESSED_RGBA_BPTC_UNORM:
+                    ok = decodeBC7Block(in, block);
+                    break;
+                case GL_COMPRESSED_RGB8_ETC2:
+                    ok = decodeETC2Block(in, block);
+                    break;
+                default:
+                    ok = false;
+            }
+            if (!ok)
+                return false;
+            storeBlock(block, width, height, bx, by, rgba);
+        }
+    }
+    return true;
+} // decompressImage
@@ -0,0 +1,504 @@
+/*
+ * Реализация менеджера текстур (см. include/texture_manager.h).
+ */
+
+#include "texture_manager.h"
+#include "gl_ext.h"
+#include "gl_state.h"
+#include "image_cache.h"
+#include "image_decoder.h"
+#include "ktx_file.h"
+#include "texture_compress.h"
+#include "thread_pool.h"
+#include "vfs.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <strings.h>
+#include <vector>
+
+TextureManager& TextureManager::current() {
+    static TextureManager s_manager;
+    return s_manager;
+}
+
+TextureManager::TextureManager()
+    : m_pWorkers(nullptr) {
+    TextureManagerStats stats = { 0, 0, 0, 0, 0 };
+    m_Stats = stats;
+}
+
+TextureManager::~TextureManager() {
+    // без контекста OpenGL остается только дождаться потоков и освободить память
+    if (m_pWorkers)
+        delete m_pWorkers;
+    for (std::list<Job>::iterator it = m_Jobs.begin(); it != m_Jobs.end(); ++it) {
+        delete it->file;
+        delete it->image;
+    }
+}
+
+// "../textures/box.jpg" и "../textures/./box.jpg" - один и тот же файл
+std::string TextureManager::makeKey(const char* path, const TextureOptions& options) {
+    char resolved[PATH_MAX];
+    std::string key(realpath(path, resolved) ? resolved : path);
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), "|%x|%x|%x|%d", options.wrap, options.minFilter, options.magFilter,
+             options.channels);
+    return key + suffix;
+}
+
+// драйверы хранят RGB как RGBA; mip-уровни добавляют треть
+static size_t textureBytes(int width, int height, const TextureOptions& options) {
+    size_t bytes = (size_t)width * height * 4;
+    if (options.hasMipmaps())
+        bytes += bytes / 3;
+    return bytes;
+}
+
+static void gSetParameters(const TextureOptions& options) {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, options.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, options.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, options.minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, options.magFilter);
+}
+
+// хранилище уровня level привязанной текстуры; pixels == nullptr - без данных
+static void gSpecifyLevel(const TextureOptions& options, GLint level, int width, int height, const void* pixels) {
+    // строки RGB не выровнены на 4 байта, если ширина не кратна 4
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (options.channels == 4)
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    else
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+// параметры и хранилище уровня 0 для привязанной текстуры
+static void gSpecify(const TextureOptions& options, int width, int height, const void* pixels) {
+    gSetParameters(options);
+    gSpecifyLevel(options, 0, width, height, pixels);
+}
+
+// уровни в буфере загрузки лежат подряд, как в кэше изображений
+static size_t levelsSize(int width, int height, int channels, int levels) {
+    size_t size = 0;
+    for (int i = 0; i < levels; i++) {
+        size += (size_t)width * height * channels;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return size;
+}
+
+static bool isKtxPath(const char* path) {
+    const char* ext = strrchr(path, '.');
+    return ext && strcasecmp(ext, ".ktx") == 0;
+}
+
+/*
+ * Текстура из файла KTX. Сжатые уровни загружаются как есть или, без поддержки формата,
+ * распаковываются в RGBA8; несжатые передаются в glTexImage2D с форматом из файла.
+ */
+static GLuint gLoadKtx(const char* path, const TextureOptions& options, size_t& bytes) {
+    VfsFile file;
+    if (!Vfs::current().read(path, file)) {
+        std::cout << "Failed loading of the texture " << path << std::endl;
+        return 0;
+    }
+    KtxView image;
+    if (!parseKtx(file.data(), file.size(), image)) {
+        std::cout << "Failed loading of the texture " << path << ": bad KTX file" << std::endl;
+        return 0;
+    }
+    bool compressed = isCompressedFormat(image.internalFormat);
+    bool supported = compressed && glSupportsCompressedFormat(image.internalFormat);
+    if (!compressed && !image.format) {
+        std::cout << "Failed loading of the texture " << path << ": unsupported format" << std::endl;
+        return 0;
+    }
+    size_t levels = options.hasMipmaps() ? image.levels.size() : 1;
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    GLState::current().bindTexture(GL_TEXTURE_2D, texture);
+    gSetParameters(options);
+    // уровней в файле может быть меньше полной цепочки - текстура все равно полна
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels - 1);
+    bytes = 0;
+    std::vector<unsigned char> rgba;
+    for (size_t i = 0; i < levels; i++) {
+        const KtxLevelView& level = image.levels[i];
+        if (supported) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, image.internalFormat, level.width, level.height, 0,
+                                   (GLsizei)level.size, level.data);
+            bytes += level.size;
+        }
+        else if (compressed) {
+            rgba.resize((size_t)level.width * level.height * 4);
+            if (!decompressImage(image.internalFormat, level.data, level.width, level.height, rgba.data())) {
+                std::cout << "Failed loading of the texture " << path << ": unsupported blocks" << std::endl;
+                GLState::current().bindTexture(GL_TEXTURE_2D, 0);
+                GLState::current().deleteTextures(1, &texture);
+                return 0;
+            }
+            glTexImage2D(GL_TEXTURE_2D, (GLint)i, GL_RGBA8, level.width, level.height, 0, GL_RGBA,
+                         GL_UNSIGNED_BYTE, rgba.data());
+            bytes += rgba.size();
+        }
+        else {
+            // строки в KTX выровнены на 4 байта, как GL_UNPACK_ALIGNMENT по умолчанию
+            glTexImage2D(GL_TEXTURE_2D, (GLint)i, image.internalFormat, level.width, level.height, 0,
+                         image.format, image.type, level.data);
+            bytes += (size_t)level.width * level.height * 4;
+        }
+    }
+    GLState::current().bindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+} // gLoadKtx
+
+// заглушка 1 x 1: такая текстура полна и с mip-фильтром, уровней у нее больше нет
+static GLuint gCreatePlaceholder(const TextureOptions& options) {
+    static const unsigned char gray[4] = { 128, 128, 128, 255 };
+    GLuint texture;
+    glGenTextures(1, &texture);
+    GLState::current().bindTexture(GL_TEXTURE_2D, texture);
+    gSpecify(options, 1, 1, gray);
+    GLState::current().bindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+void TextureManager::gAddEntry(const std::string& key, GLuint texture, size_t bytes, Job* job) {
+    Entry entry = { key, texture, bytes, 1, job };
+    m_Entries[texture] = entry;
+    m_Keys[key] = texture;
+    m_Stats.textures++;
+    m_Stats.bytes += bytes;
+}
+
+GLuint TextureManager::gAcquire(const char* path, const TextureOptions& options) {
+    if (options.channels != 3 && options.channels != 4)
+        throw std::logic_error("texture must have 3 or 4 channels");
+    std::string key = makeKey(path, options);
+    std::map<std::string, GLuint>::iterator found = m_Keys.find(key);
+    if (found != m_Keys.end()) {
+        m_Entries[found->second].refs++;
+        m_Stats.hits++;
+        return found->second;
+    }
+
+    if (isKtxPath(path)) {
+        size_t bytes = 0;
+        GLuint texture = gLoadKtx(path, options, bytes);
+        if (texture) {
+            gAddEntry(key, texture, bytes, nullptr);
+            m_Stats.loads++;
+        }
+        return texture;
+    }
+
+    CachedImage image;
+    if (!loadCachedImage(path, options.channels, image)) {
+        std::cout << "Failed loading of the texture " << path << std::endl;
+        return 0;
+    }
+    GLuint texture;
+    glGenTextures(1, &texture);
+    GLState::current().bindTexture(GL_TEXTURE_2D, texture);
+    gSpecify(options, image.getWidth(), image.getHeight(), image.getLevel(0).data);
+    if (options.hasMipmaps() && image.getLevelCount() > 1) {
+        for (size_t i = 1; i < image.getLevelCount(); i++) {
+            const CachedLevel& level = image.getLevel(i);
+            gSpecifyLevel(options, (GLint)i, level.width, level.height, level.data);
+        }
+    }
+    else if (options.hasMipmaps())
+        glGenerateMipmap(GL_TEXTURE_2D);
+    GLState::current().bindTexture(GL_TEXTURE_2D, 0);
+
+    gAddEntry(key, texture, textureBytes(image.getWidth(), image.getHeight(), options), nullptr);
+    m_Stats.loads++;
+    return texture;
+} // gAcquire
+
+GLuint TextureManager::gAcquireAsync(const char* path, const TextureOptions& options) {
+    if (options.channels != 3 && options.channels != 4)
+        throw std::logic_error("texture must have 3 or 4 channels");
+    std::string key = makeKey(path, options);
+    std::map<std::string, GLuint>::iterator found = m_Keys.find(key);
+    if (found != m_Keys.end()) {
+        m_Entries[found->second].refs++;
+        m_Stats.hits++;
+        return found->second;
+    }
+
+    // декодировать нечего: уровни сразу уходят в драйвер
+    if (isKtxPath(path)) {
+        GLuint texture = gAcquire(path, options);
+        if (!texture) {
+            texture = gCreatePlaceholder(options);
+            gAddEntry(key, texture, 4, nullptr);
+        }
+        return texture;
+    }
+
+    GLuint texture = gCreatePlaceholder(options);
+
+    Job job;
+    job.path = path;
+    job.options = options;
+    job.texture = texture;
+    job.state = Job::READING;
+    job.file = nullptr;
+    job.image = nullptr;
+    job.levels = 1;
+    job.width = job.height = 0;
+    job.buffer = 0;
+    job.mapped = nullptr;
+    m_Jobs.push_back(job);
+    Job* pJob = &m_Jobs.back();
+    gAddEntry(key, texture, 4, pJob);
+    m_Stats.pending++;
+
+    if (!m_pWorkers)
+        m_pWorkers = new ThreadPool(TEXTURE_DECODE_THREADS);
+    m_pWorkers->submit([this, pJob]() { read(pJob); });
+    return texture;
+} // gAcquireAsync
+
+/*
+ * Выполняется в пуле: размер нужен раньше пикселей, чтобы декодировать прямо в буфер. С кэшем
+ * изображений здесь же изображение берется из кэша или декодируется и сохраняется в него.
+ */
+void TextureManager::read(Job* job) {
+    bool ok;
+    ImageInfo info;
+    if (ImageCache::current().isEnabled()) {
+        job->image = new CachedImage();
+        ok = loadCachedImage(job->path.c_str(), job->options.channels, *job->image);
+        info.width = job->image->getWidth();
+        info.height = job->image->getHeight();
+        job->levels = job->options.hasMipmaps() ? (int)job->image->getLevelCount() : 1;
+    }
+    else {
+        job->file = new VfsFile();
+        ok = Vfs::current().read(job->path.c_str(), *job->file)
+          && getImageInfo(job->file->data(), job->file->size(), info);
+    }
+    std::lock_guard<std::mutex> lock(m_JobMutex);
+    job->width = ok ? info.width : 0;
+    job->height = ok ? info.height : 0;
+    job->state = ok ? Job::READ : Job::FAILED;
+}
+
+// выполняется в пуле
+void TextureManager::decode(Job* job) {
+    unsigned char* pixels = job->mapped ? (unsigned char*)job->mapped : job->pixels.data();
+    bool ok = true;
+    if (job->image) {
+        for (int i = 0; i < job->levels; i++) {
+            const CachedLevel& level = job->image->getLevel(i);
+            memcpy(pixels, level.data, level.size);
+            pixels += level.size;
+        }
+        job->image->close();
+    }
+    else {
+        ok = decodeImage(job->file->data(), job->file->size(), job->options.channels, pixels);
+        job->file->close();
+    }
+    std::lock_guard<std::mutex> lock(m_JobMutex);
+    job->state = ok ? Job::DECODED : Job::FAILED;
+}
+
+void TextureManager::gMapBuffer(Job& job) {
+    GLsizeiptr size = (GLsizeiptr)levelsSize(job.width, job.height, job.options.channels, job.levels);
+    glGenBuffers(1, &job.buffer);
+    GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, job.buffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    job.mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (!job.mapped) {
+        // отобразить не удалось - декодируем в память и загружаем из нее
+        GLState::current().deleteBuffers(1, &job.buffer);
+        job.buffer = 0;
+        job.pixels.resize(size);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_JobMutex);
+        job.state = Job::DECODING;
+    }
+    Job* pJob = &job;
+    m_pWorkers->submit([this, pJob]() { decode(pJob); });
+} // gMapBuffer
+
+void TextureManager::gUpload(Job& job) {
+    // хранилище задается без буфера: с привязанным GL_PIXEL_UNPACK_BUFFER nullptr означал бы смещение 0
+    GLState::current().bindTexture(GL_TEXTURE_2D, job.texture);
+    gSpecify(job.options, job.width, job.height, job.buffer ? nullptr : job.pixels.data());
+    if (job.buffer) {
+        GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, job.buffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        job.mapped = nullptr;
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, job.width, job.height,
+                        job.options.channels == 4 ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+    // mip-уровни из кэша лежат в буфере (или в pixels) за уровнем 0
+    size_t offset = 0;
+    int width = job.width, height = job.height;
+    for (int i = 1; i < job.levels; i++) {
+        offset += (size_t)width * height * job.options.channels;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+        gSpecifyLevel(job.options, i, width, height, job.buffer ? (GLvoid*)offset : job.pixels.data() + offset);
+    }
+    if (job.buffer) {
+        GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        // буфер можно удалить сразу: драйвер держит его, пока копирование не закончится
+        GLState::current().deleteBuffers(1, &job.buffer);
+        job.buffer = 0;
+    }
+    if (job.options.hasMipmaps() && job.levels == 1)
+        glGenerateMipmap(GL_TEXTURE_2D);
+    GLState::current().bindTexture(GL_TEXTURE_2D, 0);
+    std::vector<unsigned char>().swap(job.pixels);
+
+    Entry& entry = m_Entries[job.texture];
+    size_t bytes = textureBytes(job.width, job.height, job.options);
+    m_Stats.bytes += bytes - entry.bytes;
+    entry.bytes = bytes;
+    entry.job = nullptr;
+    m_Stats.loads++;
+    m_Stats.pending--;
+    job.texture = 0;
+} // gUpload
+
+// освобождает то, что осталось от отмененной или неудачной загрузки
+void TextureManager::gDiscard(Job& job) {
+    if (job.mapped) {
+        GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, job.buffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        job.mapped = nullptr;
+    }
+    if (job.buffer) {
+        GLState::current().deleteBuffers(1, &job.buffer);
+        job.buffer = 0;
+    }
+    std::vector<unsigned char>().swap(job.pixels);
+    delete job.file;
+    job.file = nullptr;
+    delete job.image;
+    job.image = nullptr;
+}
+
+/*
+ * Проходит загрузки по порядку. Этапы, которые сейчас выполняет пул, пропускаются; остальные
+ * продвигаются на шаг. Готовые и отмененные загрузки удаляются из списка.
+ */
+size_t TextureManager::gUpdate() {
+    size_t ready = 0, mapped = 0;
+    for (std::list<Job>::iterator it = m_Jobs.begin(); it != m_Jobs.end(); ) {
+        Job& job = *it;
+        Job::State state;
+        {
+            std::lock_guard<std::mutex> lock(m_JobMutex);
+            state = job.state;
+        }
+        if (state == Job::READING || state == Job::DECODING) {
+            ++it;
+            continue;
+        }
+        if (job.texture && state == Job::FAILED) {
+            std::cout << "Failed loading of the texture " << job.path << std::endl;
+            m_Entries[job.texture].job = nullptr;
+            m_Stats.pending--;
+            job.texture = 0;
+        }
+        else if (job.texture && state == Job::READ) {
+            // хотя бы одна загрузка за кадр, даже если изображение больше бюджета
+            size_t size = levelsSize(job.width, job.height, job.options.channels, job.levels);
+            if (mapped > 0 && mapped + size > TEXTURE_UPLOAD_BUDGET) {
+                ++it;
+                continue;
+            }
+            mapped += size;
+            gMapBuffer(job);
+        }
+        else if (job.texture && state == Job::DECODED) {
+            gUpload(job);
+            ready++;
+        }
+        if (job.texture) {
+            ++it;
+            continue;
+        }
+        gDiscard(job);
+        it = m_Jobs.erase(it);
+    }
+    return ready;
+} // gUpdate
+
+void TextureManager::gFinish() {
+    while (!m_Jobs.empty()) {
+        m_pWorkers->wait();
+        gUpdate();
+    }
+}
+
+bool TextureManager::isReady(GLuint texture) const {
+    std::map<GLuint, Entry>::const_iterator found = m_Entries.find(texture);
+    return found != m_Entries.end() && !found->second.job;
+}
+
+void TextureManager::addRef(GLuint texture) {
+    std::map<GLuint, Entry>::iterator found = m_Entries.find(texture);
+    if (found == m_Entries.end())
+        throw std::logic_error("texture does not belong to the texture manager");
+    found->second.refs++;
+}
+
+void TextureManager::gRelease(GLuint texture) {
+    if (!texture)
+        return;
+    std::map<GLuint, Entry>::iterator found = m_Entries.find(texture);
+    if (found == m_Entries.end())
+        throw std::logic_error("texture does not belong to the texture manager");
+    if (--found->second.refs > 0)
+        return;
+    if (found->second.job) {
+        // остатки загрузки освободит gUpdate, когда пул закончит текущий этап
+        found->second.job->texture = 0;
+        m_Stats.pending--;
+    }
+    GLState::current().deleteTextures(1, &texture);
+    m_Stats.textures--;
+    m_Stats.bytes -= found->second.bytes;
+    m_Keys.erase(found->second.key);
+    m_Entries.erase(found);
+} // gRelease
+
+void TextureManager::gFinalize() {
+    if (m_pWorkers)
+        m_pWorkers->wait();
+    for (std::list<Job>::iterator it = m_Jobs.begin(); it != m_Jobs.end(); ++it)
+        gDiscard(*it);
+    m_Jobs.clear();
+    for (std::map<GLuint, Entry>::iterator it = m_Entries.begin(); it != m_Entries.end(); ++it) {
+        std::cout << "Texture " << it->second.key.substr(0, it->second.key.find('|'))
+                  << " is still referenced " << it->second.refs << " time(s)" << std::endl;
+        GLState::current().deleteTextures(1, &it->first);
+    }
+    m_Entries.clear();
+    m_Keys.clear();
+    m_Stats.textures = 0;
+    m_Stats.bytes = 0;
+    m_Stats.pending = 0;
+} // gFinalize
@@ -0,0 +1,226 @@
+/*
+ * Реализация упаковки текстур (см. include/texture_packer.h).
+ */
+
+#include "texture_packer.h"
+#include "gl_state.h"
+#include "image_decoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+static int alignUp(int value, int alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// билинейное растяжение RGBA8; центры текселей совмещаются, как при выборке GL_LINEAR
+static void resample(const std::vector<unsigned char>& src, int srcWidth, int srcHeight,
+                     unsigned char* dst, int dstWidth, int dstHeight) {
+    for (int y = 0; y < dstHeight; y++) {
+        float fy = std::max(0.0f, (y + 0.5f) * srcHeight / dstHeight - 0.5f);
+        int y0 = std::min((int)fy, srcHeight - 1), y1 = std::min(y0 + 1, srcHeight - 1);
+        float wy = fy - y0;
+        for (int x = 0; x < dstWidth; x++) {
+            float fx = std::max(0.0f, (x + 0.5f) * srcWidth / dstWidth - 0.5f);
+            int x0 = std::min((int)fx, srcWidth - 1), x1 = std::min(x0 + 1, srcWidth - 1);
+            float wx = fx - x0;
+            for (int c = 0; c < 4; c++) {
+                float top = src[((size_t)y0 * srcWidth + x0) * 4 + c] * (1.0f - wx) + src[((size_t)y0 * srcWidth + x1) * 4 + c] * wx;
+                float bottom = src[((size_t)y1 * srcWidth + x0) * 4 + c] * (1.0f - wx) + src[((size_t)y1 * srcWidth + x1) * 4 + c] * wx;
+                dst[((size_t)y * dstWidth + x) * 4 + c] = (unsigned char)(top * (1.0f - wy) + bottom * wy + 0.5f);
+            }
+        }
+    }
+} // resample
+
+TexturePacker::TexturePacker(Mode mode)
+    : m_Mode(mode),
+      m_Texture(0) {
+    TexturePackerStats stats = { 0, 0, 0, 0, 0, 0.0f };
+    m_Stats = stats;
+}
+
+int TexturePacker::add(const char* path) {
+    if (m_Texture)
+        throw std::logic_error("texture packer is already built");
+    // изображение декодируется сразу в свой буфер, без промежуточной копии
+    Image image;
+    ImageInfo info;
+    if (!loadImage(path, 4, image.pixels, info)) {
+        std::cout << "Failed loading of the texture " << path << std::endl;
+        return -1;
+    }
+    image.width = info.width;
+    image.height = info.height;
+    m_Images.push_back(std::move(image));
+    return (int)m_Images.size() - 1;
+}
+
+int TexturePacker::add(const unsigned char* rgba, int width, int height) {
+    if (m_Texture)
+        throw std::logic_error("texture packer is already built");
+    if (width <= 0 || height <= 0)
+        throw std::logic_error("empty image");
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.pixels.assign(rgba, rgba + (size_t)width * height * 4);
+    m_Images.push_back(image);
+    return (int)m_Images.size() - 1;
+}
+
+const TextureRegion& TexturePacker::getRegion(int index) const {
+    if (index < 0 || (size_t)index >= m_Regions.size())
+        throw std::logic_error("texture region does not exist (was gBuild called?)");
+    return m_Regions[index];
+}
+
+GLuint TexturePacker::gBuild(int maxSize) {
+    if (m_Texture)
+        throw std::logic_error("texture packer is already built");
+    if (m_Images.empty())
+        throw std::logic_error("texture packer has no images");
+    size_t used = 0;
+    for (size_t i = 0; i < m_Images.size(); i++)
+        used += (size_t)m_Images[i].width * m_Images[i].height;
+
+    glGenTextures(1, &m_Texture);
+    GLState::current().bindTexture(getTarget(), m_Texture);
+    if (m_Mode == ARRAY)
+        gBuildArray(maxSize);
+    else
+        gBuildAtlas(maxSize);
+    GLState::current().bindTexture(getTarget(), 0);
+
+    m_Stats.images = m_Images.size();
+    m_Stats.occupancy = (float)std::min(1.0, (double)used / ((double)m_Stats.width * m_Stats.height * m_Stats.layers));
+    std::vector<Image>().swap(m_Images);
+    return m_Texture;
+} // gBuild
+
+void TexturePacker::gBuildArray(int maxSize) {
+    int width = 1, height = 1;
+    for (size_t i = 0; i < m_Images.size(); i++) {
+        width = std::max(width, m_Images[i].width);
+        height = std::max(height, m_Images[i].height);
+    }
+    width = std::min(width, maxSize);
+    height = std::min(height, maxSize);
+    GLsizei layers = (GLsizei)m_Images.size();
+
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    std::vector<unsigned char> layer((size_t)width * height * 4);
+    for (GLsizei i = 0; i < layers; i++) {
+        const Image& image = m_Images[i];
+        const unsigned char* pixels = image.pixels.data();
+        if (image.width != width || image.height != height) {
+            resample(image.pixels, image.width, image.height, layer.data(), width, height);
+            pixels = layer.data();
+        }
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        TextureRegion region = { i, { 0.0f, 0.0f }, { 1.0f, 1.0f } };
+        m_Regions.push_back(region);
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+    m_Stats.width = width;
+    m_Stats.height = height;
+    m_Stats.layers = layers;
+    m_Stats.bytes = (size_t)width * height * 4 * layers * 4 / 3;
+} // gBuildArray
+
+/*
+ * Полки: ячейки от высоких к низким слева направо, новая полка - когда ячейка не влезает
+ * по ширине. Ширина атласа начинается со степени двойки около корня из общей площади и
+ * удваивается, пока полки не поместятся по высоте.
+ */
+void TexturePacker::gBuildAtlas(int maxSize) {
+    const int alignment = 1 << TEXTURE_ATLAS_MAX_LEVEL, border = TEXTURE_ATLAS_BORDER;
+    size_t count = m_Images.size();
+    std::vector<int> cellWidth(count), cellHeight(count), cellX(count), cellY(count), order(count);
+    double area = 0.0;
+    int width = alignment;
+    for (size_t i = 0; i < count; i++) {
+        cellWidth[i] = alignUp(m_Images[i].width + 2 * border, alignment);
+        cellHeight[i] = alignUp(m_Images[i].height + 2 * border, alignment);
+        area += (double)cellWidth[i] * cellHeight[i];
+        width = std::max(width, cellWidth[i]);
+        order[i] = (int)i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return cellHeight[a] > cellHeight[b]; });
+    while (width < sqrt(area))
+        width *= 2;
+
+    int height = 0;
+    for ( ; ; width *= 2) {
+        if (width > maxSize)
+            throw std::logic_error("images do not fit into the texture atlas");
+        int x = 0, y = 0, shelf = 0;
+        for (size_t k = 0; k < count; k++) {
+            int i = order[k];
+            if (x + cellWidth[i] > width) {
+                y += shelf;
+                x = shelf = 0;
+            }
+            cellX[i] = x;
+            cellY[i] = y;
+            x += cellWidth[i];
+            shelf = std::max(shelf, cellHeight[i]);
+        }
+        height = y + shelf;
+        if (height <= maxSize)
+            break;
+    }
+
+    // ячейка целиком: изображение со смещением border, за его краями - повтор крайних текселей
+    std::vector<unsigned char> atlas((size_t)width * height * 4, 0);
+    m_Regions.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const Image& image = m_Images[i];
+        for (int cy = 0; cy < cellHeight[i]; cy++) {
+            int sy = std::min(std::max(cy - border, 0), image.height - 1);
+            for (int cx = 0; cx < cellWidth[i]; cx++) {
+                int sx = std::min(std::max(cx - border, 0), image.width - 1);
+                memcpy(&atlas[((size_t)(cellY[i] + cy) * width + cellX[i] + cx) * 4],
+                       &image.pixels[((size_t)sy * image.width + sx) * 4], 4);
+            }
+        }
+        TextureRegion& region = m_Regions[i];
+        region.layer = 0;
+        region.offset[0] = (GLfloat)(cellX[i] + border) / width;
+        region.offset[1] = (GLfloat)(cellY[i] + border) / height;
+        region.scale[0] = (GLfloat)image.width / width;
+        region.scale[1] = (GLfloat)image.height / height;
+    }
+
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, atlas.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, TEXTURE_ATLAS_MAX_LEVEL);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    m_Stats.width = width;
+    m_Stats.height = height;
+    m_Stats.layers = 1;
+    m_Stats.bytes = 0;
+    for (int level = 0; level <= TEXTURE_ATLAS_MAX_LEVEL; level++)
+        m_Stats.bytes += (size_t)std::max(1, width >> level) * std::max(1, height >> level) * 4;
+} // gBuildAtlas
+
+void TexturePacker::gFinalize() {
+    if (m_Texture) {
+        GLState::current().deleteTextures(1, &m_Texture);
+        m_Texture = 0;
+    }
+    m_Regions.clear();
+}
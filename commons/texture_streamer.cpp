@@ -0,0 +1,442 @@
+/*
+ * Реализация потоковой загрузки mip-уровней (см. include/texture_streamer.h).
+ */
+
+#include "texture_streamer.h"
+#include "gl_ext.h"
+#include "gl_state.h"
+#include "texture_compress.h"
+#include "thread_pool.h"
+#include "vfs.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+TextureStreamer& TextureStreamer::current() {
+    static TextureStreamer s_streamer;
+    return s_streamer;
+}
+
+TextureStreamer::TextureStreamer()
+    : m_pWorkers(nullptr),
+      m_Budget(TEXTURE_STREAMING_BUDGET),
+      m_PixelsPerUnit(0.0f),
+      m_Frame(1) {
+    TextureStreamerStats stats = { 0, 0, 0, 0, 0, 0, 0 };
+    m_Stats = stats;
+    setViewport(600.0f, 0.785398f);
+}
+
+TextureStreamer::~TextureStreamer() {
+    // без контекста OpenGL остается только дождаться потоков и освободить память
+    if (m_pWorkers)
+        delete m_pWorkers;
+    for (std::list<Load>::iterator it = m_Loads.begin(); it != m_Loads.end(); ++it)
+        delete it->file;
+    for (std::map<GLuint, Entry>::iterator it = m_Entries.begin(); it != m_Entries.end(); ++it)
+        delete it->second.file;
+}
+
+std::string TextureStreamer::makeKey(const char* path, GLenum wrap) {
+    char resolved[PATH_MAX];
+    std::string key(realpath(path, resolved) ? resolved : path);
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "|%x", wrap);
+    return key + suffix;
+}
+
+TextureStreamer::Entry& TextureStreamer::getEntry(GLuint texture) {
+    std::map<GLuint, Entry>::iterator found = m_Entries.find(texture);
+    if (found == m_Entries.end())
+        throw std::logic_error("texture does not belong to the texture streamer");
+    return found->second;
+}
+
+void TextureStreamer::setViewport(GLfloat height, GLfloat fovY) {
+    m_PixelsPerUnit = height / (2.0f * tanf(fovY * 0.5f));
+}
+
+/*
+ * Задает уровень привязанной текстуры. data == nullptr при привязанном GL_PIXEL_UNPACK_BUFFER -
+ * данные с начала буфера; width == 0 - освободить уровень.
+ */
+static void gSpecifyLevel(const KtxView& image, bool decompress, GLuint level, int width, int height,
+                          size_t size, const void* data) {
+    if (decompress)
+        glTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    else if (!image.format)
+        glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, image.internalFormat, width, height, 0,
+                               (GLsizei)size, data);
+    else
+        glTexImage2D(GL_TEXTURE_2D, (GLint)level, image.internalFormat, width, height, 0, image.format,
+                     image.type, data);
+}
+
+GLuint TextureStreamer::gAcquire(const char* path, GLenum wrap) {
+    std::string key = makeKey(path, wrap);
+    std::map<std::string, GLuint>::iterator found = m_Keys.find(key);
+    if (found != m_Keys.end()) {
+        m_Entries[found->second].refs++;
+        return found->second;
+    }
+
+    VfsFile* file = new VfsFile();
+    KtxView image;
+    if (!Vfs::current().read(path, *file) || !parseKtx(file->data(), file->size(), image)) {
+        std::cout << "Failed loading of the texture " << path << std::endl;
+        delete file;
+        return 0;
+    }
+    bool compressed = isCompressedFormat(image.internalFormat);
+    if (!compressed && !image.format) {
+        std::cout << "Failed loading of the texture " << path << ": unsupported format" << std::endl;
+        delete file;
+        return 0;
+    }
+    bool decompress = compressed && !glSupportsCompressedFormat(image.internalFormat);
+    GLuint levels = (GLuint)image.levels.size();
+    GLuint tail = 0;
+    while (tail + 1 < levels && std::max(image.levels[tail].width, image.levels[tail].height) > TEXTURE_STREAMING_TAIL)
+        tail++;
+
+    Entry entry;
+    entry.key = key;
+    entry.refs = 1;
+    entry.file = file;
+    entry.image = image;
+    entry.decompress = decompress;
+    entry.tail = tail;
+    entry.resident = tail;
+    entry.wanted = tail;
+    entry.used.assign(levels, 0);
+    entry.load = nullptr;
+    for (GLuint i = 0; i < levels; i++) {
+        const KtxLevelView& level = image.levels[i];
+        // драйверы хранят RGB как RGBA
+        entry.bytes.push_back(compressed && !decompress ? level.size : (size_t)level.width * level.height * 4);
+    }
+
+    glGenTextures(1, &entry.texture);
+    GLState::current().bindTexture(GL_TEXTURE_2D, entry.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)tail);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels - 1);
+    // хвост мал, он загружается сразу и без буферов
+    std::vector<unsigned char> rgba;
+    for (GLuint i = tail; i < levels; i++) {
+        const KtxLevelView& level = image.levels[i];
+        const unsigned char* data = level.data;
+        if (decompress) {
+            rgba.resize((size_t)level.width * level.height * 4);
+            if (!decompressImage(image.internalFormat, level.data, level.width, level.height, rgba.data())) {
+                std::cout << "Failed loading of the texture " << path << ": unsupported blocks" << std::endl;
+                GLState::current().bindTexture(GL_TEXTURE_2D, 0);
+                GLState::current().deleteTextures(1, &entry.texture);
+                delete file;
+                return 0;
+            }
+            data = rgba.data();
+        }
+        gSpecifyLevel(image, decompress, i, level.width, level.height, level.size, data);
+        m_Stats.residentBytes += entry.bytes[i];
+    }
+    GLState::current().bindTexture(GL_TEXTURE_2D, 0);
+
+    m_Entries[entry.texture] = entry;
+    m_Keys[key] = entry.texture;
+    m_Stats.textures++;
+    return entry.texture;
+} // gAcquire
+
+void TextureStreamer::gRelease(GLuint texture) {
+    if (!texture)
+        return;
+    Entry& entry = getEntry(texture);
+    if (--entry.refs > 0)
+        return;
+    if (entry.load) {
+        // пул, может быть, еще читает файл: его удалит gDiscard вместе с остатками загрузки
+        entry.load->texture = 0;
+        entry.load->file = entry.file;
+        m_Stats.pending--;
+        m_Stats.pendingBytes -= entry.bytes[entry.load->level];
+    }
+    else
+        delete entry.file;
+    for (GLuint i = entry.resident; i < entry.bytes.size(); i++)
+        m_Stats.residentBytes -= entry.bytes[i];
+    GLState::current().deleteTextures(1, &texture);
+    m_Stats.textures--;
+    m_Keys.erase(entry.key);
+    m_Entries.erase(texture);
+} // gRelease
+
+void TextureStreamer::requestLevel(GLuint texture, GLuint level) {
+    Entry& entry = getEntry(texture);
+    // уровни от wanted до хвоста уже отмечены в этом кадре
+    for (GLuint i = level; i < entry.wanted; i++)
+        entry.used[i] = m_Frame;
+    entry.wanted = std::min(entry.wanted, level);
+}
+
+GLuint TextureStreamer::request(GLuint texture, GLfloat size, GLfloat distance, GLfloat uvScale) {
+    const Entry& entry = getEntry(texture);
+    const KtxLevelView& top = entry.image.levels[0];
+    GLfloat texels = std::max(top.width, top.height) * uvScale;
+    GLfloat pixels = distance > 1e-4f ? size / distance * m_PixelsPerUnit : HUGE_VALF;
+    GLuint level = 0;
+    if (texels > pixels)
+        level = std::min((GLuint)log2f(texels / pixels), (GLuint)entry.image.levels.size() - 1);
+    requestLevel(texture, level);
+    return level;
+}
+
+// выполняется в пуле: здесь файл читается с диска, если его страниц еще нет в памяти
+void TextureStreamer::copy(Load* load) {
+    unsigned char* pixels = load->mapped ? (unsigned char*)load->mapped : load->pixels.data();
+    bool ok = true;
+    if (load->decompress)
+        ok = decompressImage(load->format, load->source, load->width, load->height, pixels);
+    else
+        memcpy(pixels, load->source, load->size);
+    std::lock_guard<std::mutex> lock(m_LoadMutex);
+    load->state = ok ? Load::COPIED : Load::FAILED;
+}
+
+/*
+ * Освобождает место под bytes байт, выгружая самые давно нужные уровни. Выгрузить можно только
+ * базовый уровень текстуры, иначе загруженные уровни перестанут быть непрерывными.
+ */
+bool TextureStreamer::gEvictFor(size_t bytes) {
+    while (m_Stats.residentBytes + m_Stats.pendingBytes + bytes > m_Budget) {
+        Entry* victim = nullptr;
+        for (std::map<GLuint, Entry>::iterator it = m_Entries.begin(); it != m_Entries.end(); ++it) {
+            Entry& entry = it->second;
+            if (entry.load || entry.resident >= entry.tail || entry.used[entry.resident] == m_Frame)
+                continue;
+            // из одинаково старых выгоднее выгрузить больший
+            if (!victim || entry.used[entry.resident] < victim->used[victim->resident]
+                || (entry.used[entry.resident] == victim->used[victim->resident]
+                    && entry.bytes[entry.resident] > victim->bytes[victim->resident]))
+                victim = &entry;
+        }
+        if (!victim)
+            return false;
+        GLuint level = victim->resident++;
+        GLState::current().bindTexture(GL_TEXTURE_2D, victim->texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)victim->resident);
+        gSpecifyLevel(victim->image, victim->decompress, level, 0, 0, 0, nullptr);
+        GLState::current().bindTexture(GL_TEXTURE_2D, 0);
+        m_Stats.residentBytes -= victim->bytes[level];
+        m_Stats.evictions++;
+    }
+    return true;
+} // gEvictFor
+
+void TextureStreamer::gStartLoad(Entry& entry) {
+    GLuint level = entry.resident - 1;
+    const KtxLevelView& view = entry.image.levels[level];
+    Load load;
+    load.texture = entry.texture;
+    load.level = level;
+    load.state = Load::COPYING;
+    load.source = view.data;
+    load.width = view.width;
+    load.height = view.height;
+    load.format = entry.image.internalFormat;
+    load.decompress = entry.decompress;
+    load.size = entry.decompress ? (size_t)view.width * view.height * 4 : view.size;
+    load.file = nullptr;
+    load.buffer = 0;
+    load.mapped = nullptr;
+
+    glGenBuffers(1, &load.buffer);
+    GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, load.buffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)load.size, nullptr, GL_STREAM_DRAW);
+    load.mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)load.size,
+                                   GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (!load.mapped) {
+        // отобразить не удалось - копируем в память и загружаем из нее
+        GLState::current().deleteBuffers(1, &load.buffer);
+        load.buffer = 0;
+        load.pixels.resize(load.size);
+    }
+    m_Loads.push_back(load);
+    Load* pLoad = &m_Loads.back();
+    entry.load = pLoad;
+    m_Stats.pending++;
+    m_Stats.pendingBytes += entry.bytes[level];
+
+    if (!m_pWorkers)
+        m_pWorkers = new ThreadPool(TEXTURE_STREAMING_THREADS);
+    m_pWorkers->submit([this, pLoad]() { copy(pLoad); });
+} // gStartLoad
+
+void TextureStreamer::gUpload(Load& load) {
+    Entry& entry = m_Entries[load.texture];
+    GLState::current().bindTexture(GL_TEXTURE_2D, load.texture);
+    if (load.buffer) {
+        GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, load.buffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        load.mapped = nullptr;
+    }
+    gSpecifyLevel(entry.image, entry.decompress, load.level, load.width, load.height, load.size,
+                  load.buffer ? nullptr : load.pixels.data());
+    // уровень становится базовым, только когда его данные уже в очереди GPU
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)load.level);
+    if (load.buffer) {
+        GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        // буфер можно удалить сразу: драйвер держит его, пока копирование не закончится
+        GLState::current().deleteBuffers(1, &load.buffer);
+        load.buffer = 0;
+    }
+    GLState::current().bindTexture(GL_TEXTURE_2D, 0);
+
+    entry.resident = load.level;
+    entry.load = nullptr;
+    m_Stats.residentBytes += entry.bytes[load.level];
+    m_Stats.pendingBytes -= entry.bytes[load.level];
+    m_Stats.pending--;
+    m_Stats.loads++;
+    load.texture = 0;
+} // gUpload
+
+// освобождает то, что осталось от загрузки
+void TextureStreamer::gDiscard(Load& load) {
+    if (load.mapped) {
+        GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, load.buffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        load.mapped = nullptr;
+    }
+    if (load.buffer) {
+        GLState::current().deleteBuffers(1, &load.buffer);
+        load.buffer = 0;
+    }
+    std::vector<unsigned char>().swap(load.pixels);
+    delete load.file;
+    load.file = nullptr;
+}
+
+size_t TextureStreamer::gCompleteLoads() {
+    size_t ready = 0;
+    for (std::list<Load>::iterator it = m_Loads.begin(); it != m_Loads.end(); ) {
+        Load& load = *it;
+        Load::State state;
+        {
+            std::lock_guard<std::mutex> lock(m_LoadMutex);
+            state = load.state;
+        }
+        if (state == Load::COPYING) {
+            ++it;
+            continue;
+        }
+        if (load.texture && state == Load::FAILED) {
+            // уровень не распаковался - текстура остается на тех уровнях, что есть
+            Entry& entry = m_Entries[load.texture];
+            std::cout << "Failed loading of the texture " << entry.key.substr(0, entry.key.find('|'))
+                      << " level " << load.level << ": unsupported blocks" << std::endl;
+            entry.tail = entry.resident;
+            entry.wanted = std::max(entry.wanted, entry.tail);
+            entry.load = nullptr;
+            m_Stats.pending--;
+            m_Stats.pendingBytes -= entry.bytes[load.level];
+            load.texture = 0;
+        }
+        else if (load.texture) {
+            gUpload(load);
+            ready++;
+        }
+        gDiscard(load);
+        it = m_Loads.erase(it);
+    }
+    return ready;
+} // gCompleteLoads
+
+/*
+ * Уровни догружаются по одному на текстуру за кадр: сначала текстурам, которым не хватает
+ * больше всего уровней, пока хватает бюджета памяти и бюджета отображения за кадр.
+ */
+size_t TextureStreamer::gUpdate() {
+    size_t ready = gCompleteLoads();
+
+    std::vector<Entry*> candidates;
+    m_Stats.wantedBytes = 0;
+    for (std::map<GLuint, Entry>::iterator it = m_Entries.begin(); it != m_Entries.end(); ++it) {
+        Entry& entry = it->second;
+        for (GLuint i = entry.wanted; i < entry.bytes.size(); i++)
+            m_Stats.wantedBytes += entry.bytes[i];
+        if (!entry.load && entry.wanted < entry.resident)
+            candidates.push_back(&entry);
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Entry* a, const Entry* b) {
+        return a->resident - a->wanted > b->resident - b->wanted;
+    });
+    size_t mapped = 0;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        Entry& entry = *candidates[i];
+        size_t size = entry.bytes[entry.resident - 1];
+        // хотя бы одна загрузка за кадр, даже если уровень больше бюджета отображения
+        if (mapped > 0 && mapped + size > TEXTURE_STREAMING_UPLOAD_BUDGET)
+            break;
+        if (!gEvictFor(size))
+            break;
+        gStartLoad(entry);
+        mapped += size;
+    }
+
+    for (std::map<GLuint, Entry>::iterator it = m_Entries.begin(); it != m_Entries.end(); ++it)
+        it->second.wanted = it->second.tail;
+    m_Frame++;
+    return ready;
+} // gUpdate
+
+void TextureStreamer::gFinish() {
+    if (m_pWorkers)
+        m_pWorkers->wait();
+    gCompleteLoads();
+}
+
+GLuint TextureStreamer::getResidentLevel(GLuint texture) const {
+    std::map<GLuint, Entry>::const_iterator found = m_Entries.find(texture);
+    if (found == m_Entries.end())
+        throw std::logic_error("texture does not belong to the texture streamer");
+    return found->second.resident;
+}
+
+GLuint TextureStreamer::getLevelCount(GLuint texture) const {
+    std::map<GLuint, Entry>::const_iterator found = m_Entries.find(texture);
+    if (found == m_Entries.end())
+        throw std::logic_error("texture does not belong to the texture streamer");
+    return (GLuint)found->second.image.levels.size();
+}
+
+void TextureStreamer::gFinalize() {
+    if (m_pWorkers)
+        m_pWorkers->wait();
+    for (std::list<Load>::iterator it = m_Loads.begin(); it != m_Loads.end(); ++it)
+        gDiscard(*it);
+    m_Loads.clear();
+    for (std::map<GLuint, Entry>::iterator it = m_Entries.begin(); it != m_Entries.end(); ++it) {
+        std::cout << "Texture " << it->second.key.substr(0, it->second.key.find('|'))
+                  << " is still referenced " << it->second.refs << " time(s)" << std::endl;
+        GLState::current().deleteTextures(1, &it->first);
+        delete it->second.file;
+    }
+    m_Entries.clear();
+    m_Keys.clear();
+    m_Stats.textures = 0;
+    m_Stats.residentBytes = 0;
+    m_Stats.pendingBytes = 0;
+    m_Stats.pending = 0;
+} // gFinalize
@@ -0,0 +1,93 @@
+/*
+ * Реализация пула потоков (см. include/thread_pool.h).
+ */
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(unsigned threads)
+    : m_Busy(0),
+      m_bStop(false) {
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < threads; i++)
+        m_Workers.push_back(std::thread(&ThreadPool::run, this));
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bStop = true;
+    }
+    m_TaskReady.notify_all();
+    for (size_t i = 0; i < m_Workers.size(); i++)
+        m_Workers[i].join();
+} // ~ThreadPool
+
+void ThreadPool::submit(const std::function<void()>& task) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Tasks.push_back(task);
+    }
+    m_TaskReady.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (!m_Tasks.empty() || m_Busy > 0)
+        m_AllDone.wait(lock);
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& f) {
+    if (count == 0)
+        return;
+    // состояние живет на стеке: функция не вернется, пока все помощники не закончат
+    struct Job {
+        std::atomic<size_t>     next;
+        size_t                  helpers;
+        std::mutex              mutex;
+        std::condition_variable done;
+    } job;
+    job.next = 0;
+    // вызывающий поток работает вместо одного из рабочих: всего участвуют size() потоков
+    job.helpers = std::min<size_t>(m_Workers.size(), count) - 1;
+    const std::function<void(size_t)>* body = &f;
+    Job* state = &job;
+    for (size_t i = 0, n = job.helpers; i < n; i++) {
+        submit([state, count, body]() {
+            for (size_t k = state->next++; k < count; k = state->next++)
+                (*body)(k);
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (--state->helpers == 0)
+                state->done.notify_one();
+        });
+    }
+    for (size_t k = job.next++; k < count; k = job.next++)
+        f(k);
+    std::unique_lock<std::mutex> lock(job.mutex);
+    while (job.helpers > 0)
+        job.done.wait(lock);
+} // parallelFor
+
+void ThreadPool::run() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            while (!m_bStop && m_Tasks.empty())
+                m_TaskReady.wait(lock);
+            if (m_Tasks.empty())
+                return;
+            task.swap(m_Tasks.front());
+            m_Tasks.pop_front();
+            m_Busy++;
+        }
+        task();
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Busy--;
+        if (m_Tasks.empty() && m_Busy == 0)
+            m_AllDone.notify_all();
+    }
+} // run
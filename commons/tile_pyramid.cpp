@@ -0,0 +1,246 @@
+/*
+ * Реализация пирамиды плиток (см. include/tile_pyramid.h).
+ */
+
+#include "tile_pyramid.h"
+#include "thread_pool.h"
+#include "vfs.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// уровни пирамиды для изображения width x height; возвращает число плиток
+static GLuint64 makeLevels(int width, int height, int content, std::vector<TilePyramidLevel>& levels) {
+    levels.clear();
+    GLuint64 tiles = 0;
+    for (GLuint w = width, h = height; ; w = (w + 1) / 2, h = (h + 1) / 2) {
+        TilePyramidLevel level = { w, h, (w + content - 1) / content, (h + content - 1) / content, tiles };
+        levels.push_back(level);
+        tiles += (GLuint64)level.columns * level.rows;
+        if (level.columns == 1 && level.rows == 1)
+            break;
+    }
+    return tiles;
+}
+
+static GLuint64 tilesOffset(size_t levelCount) {
+    GLuint64 offset = sizeof(TilePyramidHeader) + levelCount * sizeof(TilePyramidLevel);
+    return (offset + TILE_PYRAMID_ALIGNMENT - 1) & ~(GLuint64)(TILE_PYRAMID_ALIGNMENT - 1);
+}
+
+//-------- TilePyramid -------------------------------------------------
+TilePyramid::TilePyramid()
+    : m_pFile(nullptr),
+      m_pHeader(nullptr),
+      m_pLevels(nullptr) {}
+
+TilePyramid::~TilePyramid() {
+    close();
+}
+
+void TilePyramid::close() {
+    delete m_pFile;
+    m_pFile = nullptr;
+    m_pHeader = nullptr;
+    m_pLevels = nullptr;
+}
+
+bool TilePyramid::open(const char* path) {
+    close();
+    VfsFile* file = new VfsFile();
+    if (!Vfs::current().read(path, *file, Vfs::RANDOM) || file->size() < sizeof(TilePyramidHeader)) {
+        delete file;
+        return false;
+    }
+    // заголовок проверяется целиком: дальше плитки адресуются без проверок
+    const TilePyramidHeader* header = (const TilePyramidHeader*)file->data();
+    bool ok = header->magic == TILE_PYRAMID_MAGIC && header->version == TILE_PYRAMID_VERSION
+           && header->width > 0 && header->height > 0 && (header->channels == 3 || header->channels == 4)
+           && header->tileSize % 4 == 0 && header->tileSize > 2 * header->border
+           && header->levelCount > 0 && header->levelCount <= 32
+           && tilesOffset(header->levelCount) == header->tilesOffset && header->tilesOffset <= file->size();
+    std::vector<TilePyramidLevel> expected;
+    GLuint64 tiles = 0;
+    if (ok) {
+        tiles = makeLevels(header->width, header->height, header->tileSize - 2 * header->border, expected);
+        ok = expected.size() == header->levelCount
+          && memcmp(expected.data(), file->data() + sizeof(TilePyramidHeader),
+                    expected.size() * sizeof(TilePyramidLevel)) == 0
+          && tiles <= (file->size() - header->tilesOffset)
+                      / ((GLuint64)header->tileSize * header->tileSize * header->channels);
+    }
+    if (!ok) {
+        delete file;
+        return false;
+    }
+    m_pFile = file;
+    m_pHeader = header;
+    m_pLevels = (const TilePyramidLevel*)(file->data() + sizeof(TilePyramidHeader));
+    return true;
+} // open
+
+const unsigned char* TilePyramid::getTile(GLuint level, GLuint column, GLuint row) const {
+    const TilePyramidLevel& info = m_pLevels[level];
+    GLuint64 index = info.firstTile + (GLuint64)row * info.columns + column;
+    return m_pFile->data() + m_pHeader->tilesOffset + index * getTileBytes();
+}
+
+//-------- построение ---------------------------------------------------
+namespace {
+
+// пирамида, которая строится в отображенном файле
+struct PyramidWriter {
+    unsigned char*                  base;
+    GLuint64                        offset;         // первой плитки
+    std::vector<TilePyramidLevel>   levels;
+    int                             channels;
+    int                             tileSize;
+    int                             content;
+    const TileSource*               source;
+
+    unsigned char* tile(size_t level, GLuint column, GLuint row) const {
+        const TilePyramidLevel& info = levels[level];
+        GLuint64 index = info.firstTile + (GLuint64)row * info.columns + column;
+        return base + offset + index * tileSize * tileSize * channels;
+    }
+
+    /*
+     * Копирует count пикселей строки y уровня level, начиная с x; x за краями уровня заменяется
+     * ближайшим краевым пикселем. Строка y должна лежать внутри уровня.
+     */
+    void readRow(size_t level, int y, int x, int count, unsigned char* dst) const {
+        int width = (int)levels[level].width;
+        GLuint row = y / content;
+        int inRow = TILE_PYRAMID_BORDER + y - (int)row * content;
+        while (count > 0) {
+            int clamped = std::min(std::max(x, 0), width - 1);
+            GLuint column = clamped / content;
+            int inColumn = clamped - (int)column * content;
+            // внутри уровня копируется сразу остаток плитки, за краем - по одному пикселю
+            int run = x == clamped ? std::min(count, std::min(content - inColumn, width - clamped)) : 1;
+            const unsigned char* src = tile(level, column, row)
+                                     + ((size_t)inRow * tileSize + TILE_PYRAMID_BORDER + inColumn) * channels;
+            memcpy(dst, src, (size_t)run * channels);
+            dst += (size_t)run * channels;
+            x += run;
+            count -= run;
+        }
+    }
+
+    void buildTile(size_t level, GLuint column, GLuint row) const {
+        const TilePyramidLevel& info = levels[level];
+        int width = (int)info.width, height = (int)info.height;
+        // плитка с рамкой начинается в (x0, y0), а пиксели уровня есть в [x1, x2) x [y1, y2)
+        int x0 = (int)column * content - TILE_PYRAMID_BORDER, y0 = (int)row * content - TILE_PYRAMID_BORDER;
+        int x1 = std::max(x0, 0), x2 = std::min(x0 + tileSize, width);
+        int y1 = std::max(y0, 0), y2 = std::min(y0 + tileSize, height);
+        int w = x2 - x1, h = y2 - y1;
+        std::vector<unsigned char> region((size_t)w * h * channels);
+        if (level == 0)
+            (*source)(x1, y1, w, h, region.data());
+        else {
+            // пиксель - среднее 2 x 2 пикселей предыдущего уровня
+            int below = (int)levels[level - 1].height;
+            std::vector<unsigned char> rows((size_t)2 * 2 * w * channels);
+            unsigned char* row0 = rows.data();
+            unsigned char* row1 = rows.data() + (size_t)2 * w * channels;
+            for (int y = 0; y < h; y++) {
+                readRow(level - 1, 2 * (y1 + y), 2 * x1, 2 * w, row0);
+                readRow(level - 1, std::min(2 * (y1 + y) + 1, below - 1), 2 * x1, 2 * w, row1);
+                unsigned char* dst = region.data() + (size_t)y * w * channels;
+                for (int x = 0; x < w; x++)
+                    for (int c = 0; c < channels; c++) {
+                        size_t a = (size_t)2 * x * channels + c, b = a + channels;
+                        *dst++ = (unsigned char)((row0[a] + row0[b] + row1[a] + row1[b] + 2) / 4);
+                    }
+            }
+        }
+        // за краями уровня повторяются крайние пиксели
+        unsigned char* dst = tile(level, column, row);
+        int left = x1 - x0, right = tileSize - left - w;
+        for (int y = 0; y < tileSize; y++) {
+            int sy = std::min(std::max(y0 + y, y1), y2 - 1) - y1;
+            const unsigned char* src = region.data() + (size_t)sy * w * channels;
+            for (int i = 0; i < left; i++, dst += channels)
+                memcpy(dst, src, channels);
+            memcpy(dst, src, (size_t)w * channels);
+            dst += (size_t)w * channels;
+            for (int i = 0; i < right; i++, dst += channels)
+                memcpy(dst, src + (size_t)(w - 1) * channels, channels);
+        }
+    } // buildTile
+};
+
+} // namespace
+
+bool buildTilePyramid(const char* path, int width, int height, int channels, const TileSource& source,
+                      int tileSize, unsigned threads) {
+    if (width <= 0 || height <= 0 || (channels != 3 && channels != 4) || tileSize % 4 != 0
+        || tileSize <= 2 * TILE_PYRAMID_BORDER)
+        throw std::logic_error("invalid tile pyramid parameters");
+
+    PyramidWriter writer;
+    writer.channels = channels;
+    writer.tileSize = tileSize;
+    writer.content = tileSize - 2 * TILE_PYRAMID_BORDER;
+    writer.source = &source;
+    GLuint64 tiles = makeLevels(width, height, writer.content, writer.levels);
+    writer.offset = tilesOffset(writer.levels.size());
+    GLuint64 size = writer.offset + tiles * tileSize * tileSize * channels;
+
+    // файл строится на месте в отображении, поэтому память не зависит от размера изображения
+    std::string temporary = std::string(path) + ".tmp";
+    int fd = ::open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    void* mapping = MAP_FAILED;
+    if (fd >= 0 && ftruncate(fd, (off_t)size) == 0)
+        mapping = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (fd >= 0)
+        ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cout << "Failed writing of the tile pyramid " << temporary << std::endl;
+        unlink(temporary.c_str());
+        return false;
+    }
+    writer.base = (unsigned char*)mapping;
+
+    TilePyramidHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = TILE_PYRAMID_MAGIC;
+    header.version = TILE_PYRAMID_VERSION;
+    header.width = width;
+    header.height = height;
+    header.channels = channels;
+    header.tileSize = tileSize;
+    header.border = TILE_PYRAMID_BORDER;
+    header.levelCount = (GLuint)writer.levels.size();
+    header.tilesOffset = writer.offset;
+    memcpy(writer.base, &header, sizeof(header));
+    memcpy(writer.base + sizeof(header), writer.levels.data(), writer.levels.size() * sizeof(TilePyramidLevel));
+
+    // уровень строится только из готового предыдущего
+    ThreadPool pool(threads);
+    for (size_t level = 0; level < writer.levels.size(); level++) {
+        const TilePyramidLevel& info = writer.levels[level];
+        pool.parallelFor((size_t)info.columns * info.rows, [&writer, &info, level](size_t i) {
+            writer.buildTile(level, (GLuint)(i % info.columns), (GLuint)(i / info.columns));
+        });
+    }
+
+    bool ok = msync(mapping, (size_t)size, MS_SYNC) == 0;
+    munmap(mapping, (size_t)size);
+    if (!ok || rename(temporary.c_str(), path) != 0) {
+        std::cout << "Failed writing of the tile pyramid " << path << std::endl;
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+} // buildTilePyramid
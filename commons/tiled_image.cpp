@@ -0,0 +1,416 @@
+/*
+ * Реализация потокового просмотра пирамиды плиток (см. include/tiled_image.h).
+ */
+
+#include "tiled_image.h"
+#include "gl_state.h"
+#include "stream_buffer.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+static const GLuint64 NO_TILE = ~(GLuint64)0;
+static const unsigned PINNED = UINT_MAX;       // плитка вершины пирамиды не вытесняется
+
+struct TileVertex {
+    GLfloat     x, y;
+    GLfloat     u, v, layer;
+};
+
+static GLuint keyLevel(GLuint64 key) {
+    return (GLuint)(key >> 48);
+}
+
+static GLuint keyRow(GLuint64 key) {
+    return (GLuint)(key >> 24) & 0xFFFFFF;
+}
+
+static GLuint keyColumn(GLuint64 key) {
+    return (GLuint)key & 0xFFFFFF;
+}
+
+TiledImage::TiledImage()
+    : m_Texture(0),
+      m_Format(0),
+      m_pWorkers(nullptr),
+      m_pVertices(nullptr),
+      m_Vao(0),
+      m_TopLeft(0.0f, 0.0f),
+      m_PixelSize(1.0f),
+      m_PixelsPerUnit(0.0f),
+      m_Reserved(0),
+      m_Frame(1) {
+    TiledImageStats stats = { 0, 0, 0, 0, 0, 0, 0 };
+    m_Stats = stats;
+    setViewport(600.0f, 0.785398f);
+}
+
+TiledImage::~TiledImage() {
+    // без контекста OpenGL остается только дождаться потоков: они читают отображение файла
+    if (m_pWorkers)
+        delete m_pWorkers;
+}
+
+bool TiledImage::gOpen(const char* path, GLuint cacheSlots) {
+    gClose();
+    if (!m_Pyramid.open(path)) {
+        std::cout << "Failed loading of the tiled image " << path << std::endl;
+        return false;
+    }
+    GLint maxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    GLuint slots = maxLayers > 0 ? std::min(cacheSlots, (GLuint)maxLayers) : cacheSlots;
+    if (slots < 1)
+        throw std::logic_error("tiled image needs at least one cache slot");
+
+    int size = m_Pyramid.getTileSize();
+    m_Format = m_Pyramid.getChannels() == 4 ? GL_RGBA : GL_RGB;
+    glGenTextures(1, &m_Texture);
+    GLState::current().bindTexture(GL_TEXTURE_2D_ARRAY, m_Texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, m_Format == GL_RGBA ? GL_RGBA8 : GL_RGB8, size, size, slots, 0,
+                 m_Format, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+    // вершина пирамиды загружается сразу: ее можно рисовать вместо любой плитки
+    GLuint top = m_Pyramid.getLevelCount() - 1;
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, size, size, 1, m_Format, GL_UNSIGNED_BYTE,
+                    m_Pyramid.getTile(top, 0, 0));
+    GLState::current().bindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    Slot free = { NO_TILE, 0, false };
+    m_Slots.assign(slots, free);
+    m_Slots[0].key = makeKey(top, 0, 0);
+    m_Slots[0].used = PINNED;
+    m_Tiles[m_Slots[0].key] = 0;
+    m_Stats.resident = 1;
+
+    m_pVertices = new StreamBuffer(GL_ARRAY_BUFFER, TILED_IMAGE_MAX_TILES * 6 * sizeof(TileVertex));
+    glGenVertexArrays(1, &m_Vao);
+    return true;
+} // gOpen
+
+void TiledImage::gClose() {
+    if (m_pWorkers)
+        m_pWorkers->wait();
+    for (std::list<Load>::iterator it = m_Loads.begin(); it != m_Loads.end(); ++it)
+        gDiscard(*it);
+    m_Loads.clear();
+    if (m_Texture) {
+        GLState::current().deleteTextures(1, &m_Texture);
+        m_Texture = 0;
+    }
+    if (m_Vao) {
+        GLState::current().deleteVertexArrays(1, &m_Vao);
+        m_Vao = 0;
+    }
+    delete m_pVertices;
+    m_pVertices = nullptr;
+    m_Slots.clear();
+    m_Tiles.clear();
+    m_Selected.clear();
+    m_Pyramid.close();
+    m_Stats.selected = 0;
+    m_Stats.fallbacks = 0;
+    m_Stats.resident = 0;
+    m_Stats.pending = 0;
+} // gClose
+
+void TiledImage::setPlacement(const glm::vec2& topLeft, GLfloat pixelSize) {
+    m_TopLeft = topLeft;
+    m_PixelSize = pixelSize;
+}
+
+void TiledImage::setViewport(GLfloat height, GLfloat fovY) {
+    m_PixelsPerUnit = height / (2.0f * tanf(fovY * 0.5f));
+}
+
+/*
+ * Плитка уровня level делится на четыре плитки уровня ниже, пока ее тексель на экране крупнее
+ * пикселя. Расстояние берется до ближайшей к камере точки плитки.
+ *
+ * За каждой плиткой, до которой обход еще не дошел, в m_Reserved закреплено место в m_Selected,
+ * и делится плитка, только если места хватает и ее детям, и всем закрепленным. Поэтому на пределе
+ * TILED_IMAGE_MAX_TILES остальные участки получают грубую плитку, а не остаются пустыми.
+ */
+void TiledImage::select(const glm::mat4& viewProjection, const glm::vec3& eye, GLuint level, GLuint column,
+                        GLuint row) {
+    m_Reserved--;           // место этой плитки: занимается ею самой или освобождается
+    const TilePyramidLevel& info = m_Pyramid.getLevel(level);
+    GLuint content = m_Pyramid.getContentSize();
+    GLfloat scale = ldexpf(m_PixelSize, (int)level);
+    GLfloat x0 = m_TopLeft.x + column * content * scale;
+    GLfloat x1 = m_TopLeft.x + std::min((column + 1) * content, info.width) * scale;
+    GLfloat y0 = m_TopLeft.y - row * content * scale;
+    GLfloat y1 = m_TopLeft.y - std::min((row + 1) * content, info.height) * scale;
+
+    glm::vec4 corners[4] = {
+        viewProjection * glm::vec4(x0, y0, 0.0f, 1.0f),
+        viewProjection * glm::vec4(x1, y0, 0.0f, 1.0f),
+        viewProjection * glm::vec4(x0, y1, 0.0f, 1.0f),
+        viewProjection * glm::vec4(x1, y1, 0.0f, 1.0f)
+    };
+    // плитка не видна, если все углы по одну внешнюю сторону одной из плоскостей отсечения
+    for (int axis = 0; axis < 3; axis++) {
+        int below = 0, above = 0;
+        for (int i = 0; i < 4; i++) {
+            below += corners[i][axis] < -corners[i].w;
+            above += corners[i][axis] > corners[i].w;
+        }
+        if (below == 4 || above == 4)
+            return;
+    }
+
+    glm::vec3 nearest(std::min(std::max(eye.x, x0), x1), std::min(std::max(eye.y, y1), y0), 0.0f);
+    GLfloat distance = glm::length(eye - nearest);
+    GLfloat pixels = distance > 1e-6f ? scale / distance * m_PixelsPerUnit : HUGE_VALF;
+    if (level > 0 && pixels > 1.0f) {
+        const TilePyramidLevel& below = m_Pyramid.getLevel(level - 1);
+        GLuint rows = std::min(2 * row + 2, below.rows) - 2 * row;
+        GLuint columns = std::min(2 * column + 2, below.columns) - 2 * column;
+        if (m_Selected.size() + m_Reserved + rows * columns <= TILED_IMAGE_MAX_TILES) {
+            m_Reserved += rows * columns;
+            for (GLuint r = 2 * row; r < 2 * row + rows; r++)
+                for (GLuint c = 2 * column; c < 2 * column + columns; c++)
+                    select(viewProjection, eye, level - 1, c, r);
+            return;
+        }
+    }
+    Selected selected = { makeKey(level, column, row), distance, NO_TILE, 0 };
+    m_Selected.push_back(selected);
+} // select
+
+/*
+ * Свободный слой или слой плитки, которая дольше всех не рисовалась. Плитки этого кадра
+ * и загружаемые не вытесняются.
+ */
+bool TiledImage::gAcquireSlot(GLuint& slot) {
+    GLuint victim = (GLuint)m_Slots.size();
+    for (GLuint i = 0; i < m_Slots.size(); i++) {
+        const Slot& candidate = m_Slots[i];
+        if (candidate.key == NO_TILE) {
+            slot = i;
+            return true;
+        }
+        if (candidate.loading || candidate.used >= m_Frame)
+            continue;
+        if (victim == m_Slots.size() || candidate.used < m_Slots[victim].used)
+            victim = i;
+    }
+    if (victim == m_Slots.size())
+        return false;
+    m_Tiles.erase(m_Slots[victim].key);
+    m_Slots[victim].key = NO_TILE;
+    m_Stats.resident--;
+    m_Stats.evictions++;
+    slot = victim;
+    return true;
+} // gAcquireSlot
+
+void TiledImage::gStartLoad(TileKey key, GLuint slot) {
+    size_t size = m_Pyramid.getTileBytes();
+    Load load;
+    load.slot = slot;
+    load.state = Load::COPYING;
+    load.source = m_Pyramid.getTile(keyLevel(key), keyColumn(key), keyRow(key));
+    load.buffer = 0;
+    load.mapped = nullptr;
+
+    glGenBuffers(1, &load.buffer);
+    GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, load.buffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)size, nullptr, GL_STREAM_DRAW);
+    load.mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)size,
+                                   GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (!load.mapped) {
+        // отобразить не удалось - копируем в память и загружаем из нее
+        GLState::current().deleteBuffers(1, &load.buffer);
+        load.buffer = 0;
+        load.pixels.resize(size);
+    }
+    m_Loads.push_back(load);
+    Load* pLoad = &m_Loads.back();
+    Slot& target = m_Slots[slot];
+    target.key = key;
+    target.used = m_Frame;
+    target.loading = true;
+    m_Tiles[key] = slot;
+    m_Stats.pending++;
+
+    if (!m_pWorkers)
+        m_pWorkers = new ThreadPool(TILED_IMAGE_THREADS);
+    // здесь, в пуле, страницы плитки читаются с диска, если их еще нет в памяти
+    m_pWorkers->submit([this, pLoad, size]() {
+        memcpy(pLoad->mapped ? pLoad->mapped : pLoad->pixels.data(), pLoad->source, size);
+        std::lock_guard<std::mutex> lock(m_LoadMutex);
+        pLoad->state = Load::COPIED;
+    });
+} // gStartLoad
+
+void TiledImage::gUpload(Load& load) {
+    int size = m_Pyramid.getTileSize();
+    GLState::current().bindTexture(GL_TEXTURE_2D_ARRAY, m_Texture);
+    if (load.buffer) {
+        GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, load.buffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        load.mapped = nullptr;
+    }
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)load.slot, size, size, 1, m_Format, GL_UNSIGNED_BYTE,
+                    load.buffer ? nullptr : load.pixels.data());
+    if (load.buffer) {
+        GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        // буфер можно удалить сразу: драйвер держит его, пока копирование не закончится
+        GLState::current().deleteBuffers(1, &load.buffer);
+        load.buffer = 0;
+    }
+    GLState::current().bindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    m_Slots[load.slot].loading = false;
+    m_Stats.resident++;
+    m_Stats.pending--;
+    m_Stats.loads++;
+} // gUpload
+
+// освобождает то, что осталось от загрузки
+void TiledImage::gDiscard(Load& load) {
+    if (load.mapped) {
+        GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, load.buffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        load.mapped = nullptr;
+    }
+    if (load.buffer) {
+        GLState::current().deleteBuffers(1, &load.buffer);
+        load.buffer = 0;
+    }
+    std::vector<unsigned char>().swap(load.pixels);
+}
+
+void TiledImage::gCompleteLoads() {
+    for (std::list<Load>::iterator it = m_Loads.begin(); it != m_Loads.end(); ) {
+        Load::State state;
+        {
+            std::lock_guard<std::mutex> lock(m_LoadMutex);
+            state = it->state;
+        }
+        if (state == Load::COPYING) {
+            ++it;
+            continue;
+        }
+        gUpload(*it);
+        gDiscard(*it);
+        it = m_Loads.erase(it);
+    }
+} // gCompleteLoads
+
+void TiledImage::gUpdate(const glm::mat4& viewProjection, const glm::vec3& eye) {
+    if (!isOpen())
+        return;
+    m_Frame++;
+    gCompleteLoads();
+
+    m_Selected.clear();
+    m_Reserved = 1;
+    select(viewProjection, eye, m_Pyramid.getLevelCount() - 1, 0, 0);
+
+    // каждая плитка рисуется из самой подробной загруженной: своей или одной из грубых над ней
+    std::vector<const Selected*> missing;
+    m_Stats.selected = m_Selected.size();
+    m_Stats.fallbacks = 0;
+    m_Stats.finestLevel = m_Pyramid.getLevelCount() - 1;
+    for (size_t i = 0; i < m_Selected.size(); i++) {
+        Selected& selected = m_Selected[i];
+        GLuint level = keyLevel(selected.key), column = keyColumn(selected.key), row = keyRow(selected.key);
+        m_Stats.finestLevel = std::min(m_Stats.finestLevel, level);
+        if (m_Tiles.find(selected.key) == m_Tiles.end())
+            missing.push_back(&selected);
+        for (GLuint shift = 0; ; shift++) {
+            TileKey key = makeKey(level + shift, column >> shift, row >> shift);
+            std::map<TileKey, GLuint>::const_iterator found = m_Tiles.find(key);
+            if (found != m_Tiles.end() && !m_Slots[found->second].loading) {
+                selected.source = key;
+                selected.slot = found->second;
+                break;
+            }
+        }
+        if (selected.source != selected.key)
+            m_Stats.fallbacks++;
+        if (m_Slots[selected.slot].used != PINNED)
+            m_Slots[selected.slot].used = m_Frame;
+    }
+
+    // сначала грубые плитки: они быстрее всего закрывают размытые участки, затем ближние
+    std::sort(missing.begin(), missing.end(), [](const Selected* a, const Selected* b) {
+        GLuint la = keyLevel(a->key), lb = keyLevel(b->key);
+        return la != lb ? la > lb : a->distance < b->distance;
+    });
+    size_t started = 0;
+    for (size_t i = 0; i < missing.size(); i++) {
+        GLuint slot;
+        if (started == TILED_IMAGE_UPLOADS || m_Loads.size() >= TILED_IMAGE_MAX_PENDING || !gAcquireSlot(slot))
+            break;
+        gStartLoad(missing[i]->key, slot);
+        started++;
+    }
+} // gUpdate
+
+void TiledImage::gDraw() {
+    if (!isOpen() || m_Selected.empty())
+        return;
+    GLintptr offset;
+    TileVertex* vertex = (TileVertex*)m_pVertices->map(m_Selected.size() * 6 * sizeof(TileVertex),
+                                                       sizeof(GLfloat), &offset);
+    GLfloat content = (GLfloat)m_Pyramid.getContentSize();
+    GLfloat border = (GLfloat)m_Pyramid.getBorder();
+    GLfloat size = (GLfloat)m_Pyramid.getTileSize();
+    GLfloat width = (GLfloat)m_Pyramid.getWidth(), height = (GLfloat)m_Pyramid.getHeight();
+    for (size_t i = 0; i < m_Selected.size(); i++) {
+        const Selected& selected = m_Selected[i];
+        GLuint level = keyLevel(selected.key);
+        const TilePyramidLevel& info = m_Pyramid.getLevel(level);
+        // пиксели уровня, которые покрывает плитка
+        GLfloat px0 = keyColumn(selected.key) * content, px1 = std::min(px0 + content, (GLfloat)info.width);
+        GLfloat py0 = keyRow(selected.key) * content, py1 = std::min(py0 + content, (GLfloat)info.height);
+        GLfloat scale = ldexpf(1.0f, (int)level);
+        GLfloat x0 = m_TopLeft.x + std::min(px0 * scale, width) * m_PixelSize;
+        GLfloat x1 = m_TopLeft.x + std::min(px1 * scale, width) * m_PixelSize;
+        GLfloat y0 = m_TopLeft.y - std::min(py0 * scale, height) * m_PixelSize;
+        GLfloat y1 = m_TopLeft.y - std::min(py1 * scale, height) * m_PixelSize;
+        // те же пиксели в плитке source, которая может быть на shift уровней грубее
+        GLfloat shrink = ldexpf(1.0f, -(int)(keyLevel(selected.source) - level));
+        GLfloat sx = keyColumn(selected.source) * content, sy = keyRow(selected.source) * content;
+        GLfloat u0 = (border + px0 * shrink - sx) / size, u1 = (border + px1 * shrink - sx) / size;
+        GLfloat v0 = (border + py0 * shrink - sy) / size, v1 = (border + py1 * shrink - sy) / size;
+        GLfloat layer = (GLfloat)selected.slot;
+        TileVertex quad[6] = {
+            { x0, y0, u0, v0, layer }, { x0, y1, u0, v1, layer }, { x1, y1, u1, v1, layer },
+            { x0, y0, u0, v0, layer }, { x1, y1, u1, v1, layer }, { x1, y0, u1, v0, layer }
+        };
+        memcpy(vertex, quad, sizeof(quad));
+        vertex += 6;
+    }
+    m_pVertices->unmap();
+
+    GLState::current().bindVertexArray(m_Vao);
+    GLState::current().bindBuffer(GL_ARRAY_BUFFER, m_pVertices->getBuffer());
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(TileVertex), (GLvoid*)offset);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(TileVertex), (GLvoid*)(offset + 2 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(2);
+    GLState::current().bindTextureUnit(0, GL_TEXTURE_2D_ARRAY, m_Texture);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(m_Selected.size() * 6));
+    GLState::current().bindVertexArray(0);
+    m_pVertices->endFrame();
+} // gDraw
+
+void TiledImage::gFinish() {
+    if (m_pWorkers)
+        m_pWorkers->wait();
+    gCompleteLoads();
+}
@@ -0,0 +1,172 @@
+/*
+ * Реализация виртуальной файловой системы (см. include/vfs.h).
+ */
+
+#include "vfs.h"
+#include "pak_file.h"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//-------- VfsFile -----------------------------------------------------
+VfsFile::VfsFile()
+    : m_pData(nullptr),
+      m_Size(0),
+      m_pMapping(nullptr) {}
+
+VfsFile::~VfsFile() {
+    close();
+}
+
+void VfsFile::close() {
+    if (m_pMapping)
+        munmap(m_pMapping, m_Size);
+    m_pMapping = nullptr;
+    m_pData = nullptr;
+    m_Size = 0;
+}
+
+//-------- Vfs ---------------------------------------------------------
+Vfs& Vfs::current() {
+    static Vfs s_vfs;
+    return s_vfs;
+}
+
+Vfs::Vfs() {
+    VfsStats stats = { 0, 0, 0, 0, 0 };
+    m_Stats = stats;
+}
+
+Vfs::~Vfs() {
+    unmountAll();
+}
+
+bool Vfs::mountPak(const char* path) {
+    PakFile* pak = new PakFile();
+    if (!pak->open(path)) {
+        delete pak;
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Paks.push_back(pak);
+    m_Stats.paks = m_Paks.size();
+    return true;
+}
+
+void Vfs::mountDirectory(const char* path) {
+    std::string directory(path);
+    while (directory.size() > 1 && directory[directory.size() - 1] == '/')
+        directory.erase(directory.size() - 1);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Directories.push_back(directory);
+    m_Stats.directories = m_Directories.size();
+}
+
+void Vfs::unmountAll() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (size_t i = 0; i < m_Paks.size(); i++)
+        delete m_Paks[i];
+    m_Paks.clear();
+    m_Directories.clear();
+    m_Stats.paks = m_Stats.directories = 0;
+}
+
+std::string Vfs::logicalName(const char* path) {
+    if (path[0] == '/')
+        return std::string();
+    std::vector<std::string> parts;
+    for (const char* p = path; *p; ) {
+        const char* end = strchr(p, '/');
+        if (!end)
+            end = p + strlen(p);
+        std::string part(p, end);
+        if (part == "..") {
+            if (!parts.empty())
+                parts.pop_back();
+        }
+        else if (!part.empty() && part != ".") {
+            parts.push_back(part);
+        }
+        p = *end ? end + 1 : end;
+    }
+    std::string name;
+    for (size_t i = 0; i < parts.size(); i++) {
+        if (i)
+            name += '/';
+        name += parts[i];
+    }
+    return name;
+} // logicalName
+
+bool Vfs::mapFile(const char* path, VfsFile& file, Access access) {
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    if (ok && st.st_size > 0) {
+        void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ok = data != MAP_FAILED;
+        if (ok) {
+            // советы madvise не объединяются через |, это перечисление. Файл, читаемый вразброс,
+            // наперед не читается: для пирамиды в сотни мегабайт это заполнило бы кэш страниц
+            if (access == RANDOM) {
+                madvise(data, st.st_size, MADV_RANDOM);
+            }
+            else {
+                madvise(data, st.st_size, MADV_SEQUENTIAL);
+                madvise(data, st.st_size, MADV_WILLNEED);
+            }
+            file.m_pMapping = data;
+            file.m_pData = (const unsigned char*)data;
+            file.m_Size = st.st_size;
+        }
+    }
+    else if (ok) {
+        static const unsigned char empty = 0;
+        file.m_pData = &empty;
+    }
+    ::close(fd);
+    return ok;
+} // mapFile
+
+bool Vfs::read(const char* path, VfsFile& file, Access access) {
+    file.close();
+    std::string name = logicalName(path);
+    std::vector<std::string> directories;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for (size_t i = m_Paks.size(); !name.empty() && i-- > 0; ) {
+            const unsigned char* data;
+            size_t size;
+            if (m_Paks[i]->find(name.c_str(), data, size)) {
+                file.m_pData = data;
+                file.m_Size = size;
+                m_Stats.pakReads++;
+                return true;
+            }
+        }
+        if (!name.empty())
+            directories = m_Directories;
+    }
+    // диск читается без блокировки: отображение большого файла может занять время
+    bool found = mapFile(path, file, access);
+    for (size_t i = directories.size(); !found && i-- > 0; )
+        found = mapFile((directories[i] + "/" + name).c_str(), file, access);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (found)
+        m_Stats.looseReads++;
+    else
+        m_Stats.misses++;
+    return found;
+} // read
+
+VfsStats Vfs::getStats() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Stats;
+}
@@ -0,0 +1,237 @@
+/*
+ * Реализация видео на текстуре (см. include/video_texture.h).
+ */
+
+#include "video_texture.h"
+#include "gl_state.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+static const size_t NO_FRAME = ~(size_t)0;
+
+VideoTexture::VideoTexture()
+    : m_Head(0),
+      m_InFlight(0),
+      m_NextFrame(0),
+      m_Shown(NO_FRAME),
+      m_Start(-1.0),
+      m_bLoop(true),
+      m_pWorkers(nullptr) {
+    m_Textures[0] = m_Textures[1] = m_Textures[2] = 0;
+    VideoTextureStats stats = { 0, 0, 0, 0, 0, 0, 0 };
+    m_Stats = stats;
+}
+
+VideoTexture::~VideoTexture() {
+    // без контекста OpenGL остается только дождаться потоков: они пишут в отображения буферов
+    if (m_pWorkers)
+        delete m_pWorkers;
+}
+
+bool VideoTexture::gOpen(const char* path, bool loop) {
+    gClose();
+    if (!m_File.open(path))
+        return false;
+    m_bLoop = loop;
+
+    // до первого кадра текстуры черные: Y = 0, U = V = 128
+    int widths[3] = { m_File.getWidth(), m_File.getChromaWidth(), m_File.getChromaWidth() };
+    int heights[3] = { m_File.getHeight(), m_File.getChromaHeight(), m_File.getChromaHeight() };
+    std::vector<unsigned char> black(m_File.getLumaBytes(), 0);
+    glGenTextures(3, m_Textures);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int i = 0; i < 3; i++) {
+        if (i == 1)
+            std::fill(black.begin(), black.end(), 128);
+        GLState::current().bindTexture(GL_TEXTURE_2D, m_Textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, widths[i], heights[i], 0, GL_RED, GL_UNSIGNED_BYTE, black.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    GLState::current().bindTexture(GL_TEXTURE_2D, 0);
+
+    // буферы создаются один раз: каждое отображение с GL_MAP_INVALIDATE_BUFFER_BIT и так
+    // получает свежую память, если GPU еще читает прошлый кадр
+    m_Ring.resize(VIDEO_TEXTURE_RING);
+    for (size_t i = 0; i < m_Ring.size(); i++) {
+        Slot& slot = m_Ring[i];
+        slot.state = Slot::FREE;
+        slot.ok = false;
+        slot.frame = 0;
+        slot.mapped = nullptr;
+        glGenBuffers(1, &slot.buffer);
+        GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)m_File.getFrameBytes(), nullptr, GL_STREAM_DRAW);
+    }
+    GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    m_pWorkers = new ThreadPool(VIDEO_TEXTURE_THREADS);
+    return true;
+} // gOpen
+
+void VideoTexture::gClose() {
+    // потоки дочитывают начатые кадры в отображения, которые еще не сняты
+    delete m_pWorkers;
+    m_pWorkers = nullptr;
+    for (size_t i = 0; i < m_Ring.size(); i++) {
+        gRelease(m_Ring[i]);
+        GLState::current().deleteBuffers(1, &m_Ring[i].buffer);
+    }
+    m_Ring.clear();
+    if (m_Textures[0]) {
+        GLState::current().deleteTextures(3, m_Textures);
+        m_Textures[0] = m_Textures[1] = m_Textures[2] = 0;
+    }
+    m_File.close();
+    m_Head = 0;
+    m_InFlight = 0;
+    m_NextFrame = 0;
+    m_Shown = NO_FRAME;
+    m_Start = -1.0;
+    m_Stats.pending = 0;
+} // gClose
+
+void VideoTexture::gStartRead(Slot& slot, size_t frame) {
+    size_t size = m_File.getFrameBytes();
+    GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+    slot.mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)size,
+                                   GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (!slot.mapped)
+        // отобразить не удалось - читаем в память и загружаем из нее
+        slot.pixels.resize(size);
+    slot.frame = frame;
+    slot.ok = false;
+    slot.state = Slot::READING;
+
+    Slot* pSlot = &slot;
+    unsigned char* planes = slot.mapped ? (unsigned char*)slot.mapped : slot.pixels.data();
+    size_t index = fileFrame(frame);
+    // здесь, в пуле, кадр читается с диска прямо в буфер
+    m_pWorkers->submit([this, pSlot, planes, index]() {
+        bool ok = m_File.readFrame(index, planes);
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        pSlot->ok = ok;
+        pSlot->state = Slot::READY;
+    });
+} // gStartRead
+
+void VideoTexture::gUpload(Slot& slot) {
+    // плоскости лежат в буфере подряд: Y, U, V
+    size_t offsets[3] = { 0, m_File.getLumaBytes(), m_File.getLumaBytes() + m_File.getChromaBytes() };
+    int widths[3] = { m_File.getWidth(), m_File.getChromaWidth(), m_File.getChromaWidth() };
+    int heights[3] = { m_File.getHeight(), m_File.getChromaHeight(), m_File.getChromaHeight() };
+    bool fromBuffer = slot.mapped != nullptr;
+    if (fromBuffer) {
+        GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        slot.mapped = nullptr;
+    }
+    // строки плоскостей не выровнены, ширина цветности бывает нечетной
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int i = 0; i < 3; i++) {
+        GLState::current().bindTexture(GL_TEXTURE_2D, m_Textures[i]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, widths[i], heights[i], GL_RED, GL_UNSIGNED_BYTE,
+                        fromBuffer ? (const GLvoid*)offsets[i] : slot.pixels.data() + offsets[i]);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    GLState::current().bindTexture(GL_TEXTURE_2D, 0);
+    if (fromBuffer)
+        GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+} // gUpload
+
+// возвращает буфер в кольцо; сам буфер остается для следующих кадров
+void VideoTexture::gRelease(Slot& slot) {
+    if (slot.mapped) {
+        GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        slot.mapped = nullptr;
+    }
+    slot.state = Slot::FREE;
+}
+
+void VideoTexture::gUpdate(double time) {
+    if (!isOpen())
+        return;
+    // часы видео идут с показа первого кадра, а до него нужен только он. Кадр берется ближайший
+    // по времени, а не последний начавшийся: при частоте окна, равной частоте видео, обновления
+    // приходят почти ровно на границах кадров, и дрожание времени не должно путать кадры
+    size_t due = 0;
+    if (m_Start >= 0.0) {
+        due = (size_t)std::max(0.0, floor((time - m_Start) * m_File.getFps() + 0.5));
+        if (!m_bLoop)
+            due = std::min(due, m_File.getFrameCount() - 1);
+    }
+
+    // кадры приходят по порядку кольца; из прочитанных подряд, чье время пришло, показывается
+    // последний, а более ранние пропускаются
+    Slot* show = nullptr;
+    while (m_InFlight > 0) {
+        Slot& slot = m_Ring[m_Head];
+        Slot::State state;
+        bool ok;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            state = slot.state;
+            ok = slot.ok;
+        }
+        if (state != Slot::READY || slot.frame > due)
+            break;
+        m_Head = (m_Head + 1) % m_Ring.size();
+        m_InFlight--;
+        if (!ok) {
+            m_Stats.failed++;
+            gRelease(slot);
+            continue;
+        }
+        m_Stats.bytesRead += m_File.getFrameBytes();
+        if (show) {
+            gRelease(*show);
+            m_Stats.dropped++;
+        }
+        show = &slot;
+    }
+    if (show) {
+        if (m_Start < 0.0)
+            m_Start = time;
+        gUpload(*show);
+        gRelease(*show);
+        m_Shown = show->frame;
+        m_Stats.frame = fileFrame(m_Shown);
+        m_Stats.presented++;
+    }
+    if (m_Shown != NO_FRAME && m_Shown != due)
+        m_Stats.stalls++;
+
+    // свободные буферы кольца сразу занимаются следующими кадрами; кадры, время которых уже
+    // прошло, не читаются вовсе
+    bool started = false;
+    while (m_InFlight < m_Ring.size()) {
+        size_t frame = m_NextFrame;
+        if (frame < due) {
+            m_Stats.dropped += due - frame;
+            frame = due;
+        }
+        if (!m_bLoop && frame >= m_File.getFrameCount())
+            break;
+        gStartRead(m_Ring[(m_Head + m_InFlight) % m_Ring.size()], frame);
+        m_InFlight++;
+        m_NextFrame = frame + 1;
+        started = true;
+    }
+    if (started && (m_bLoop || m_NextFrame < m_File.getFrameCount()))
+        m_File.readAhead(fileFrame(m_NextFrame));
+    m_Stats.pending = m_InFlight;
+} // gUpdate
+
+void VideoTexture::gBind(GLuint firstUnit) const {
+    for (GLuint i = 0; i < 3; i++)
+        GLState::current().bindTextureUnit(firstUnit + i, GL_TEXTURE_2D, m_Textures[i]);
+}
@@ -0,0 +1,170 @@
+/*
+ * Реализация чтения видео Y4M (см. include/y4m_file.h).
+ */
+
+#include "y4m_file.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+static const char Y4M_SIGNATURE[] = "YUV4MPEG2 ";
+static const char Y4M_FRAME[] = "FRAME\n";
+static const size_t Y4M_FRAME_TAG = sizeof(Y4M_FRAME) - 1;
+static const size_t Y4M_MAX_HEADER = 1024;
+
+Y4MFile::Y4MFile()
+    : m_Fd(-1),
+      m_Width(0),
+      m_Height(0),
+      m_ChromaWidth(0),
+      m_ChromaHeight(0),
+      m_Fps(25.0),
+      m_bFullRange(false),
+      m_HeaderBytes(0),
+      m_FrameBytes(0),
+      m_FrameCount(0) {}
+
+Y4MFile::~Y4MFile() {
+    close();
+}
+
+void Y4MFile::close() {
+    if (m_Fd >= 0)
+        ::close(m_Fd);
+    m_Fd = -1;
+    m_FrameCount = 0;
+}
+
+// разбирает теги заголовка потока; header заканчивается '\n'
+bool Y4MFile::parseHeader(const char* header) {
+    m_Width = m_Height = 0;
+    m_Fps = 25.0;
+    m_bFullRange = false;
+    std::string chroma = "420jpeg";
+    const char* p = header + sizeof(Y4M_SIGNATURE) - 1;
+    while (*p != '\n') {
+        const char* end = p;
+        while (*end != ' ' && *end != '\n')
+            end++;
+        if (end == p) {
+            p++;
+            continue;
+        }
+        std::string value(p + 1, end);
+        switch (*p) {
+        case 'W':
+            m_Width = atoi(value.c_str());
+            break;
+        case 'H':
+            m_Height = atoi(value.c_str());
+            break;
+        case 'F': {
+            int numerator = 0, denominator = 0;
+            if (sscanf(value.c_str(), "%d:%d", &numerator, &denominator) == 2 && numerator > 0 && denominator > 0)
+                m_Fps = (double)numerator / denominator;
+            break;
+        }
+        case 'C':
+            chroma = value;
+            break;
+        case 'X':
+            if (value == "COLORRANGE=FULL")
+                m_bFullRange = true;
+            break;
+        default:
+            // I (развертка), A (форма пикселя) и неизвестные теги на чтение не влияют
+            break;
+        }
+        p = *end == ' ' ? end + 1 : end;
+    }
+    if (m_Width <= 0 || m_Height <= 0)
+        return false;
+    // 420p10 и другие глубины больше 8 бит не поддерживаются; варианты 4:2:0 отличаются только
+    // положением отсчетов цветности
+    if (chroma == "420" || chroma == "420jpeg" || chroma == "420paldv" || chroma == "420mpeg2") {
+        m_ChromaWidth = (m_Width + 1) / 2;
+        m_ChromaHeight = (m_Height + 1) / 2;
+    }
+    else if (chroma == "422") {
+        m_ChromaWidth = (m_Width + 1) / 2;
+        m_ChromaHeight = m_Height;
+    }
+    else if (chroma == "444") {
+        m_ChromaWidth = m_Width;
+        m_ChromaHeight = m_Height;
+    }
+    else
+        return false;
+    m_FrameBytes = getLumaBytes() + 2 * getChromaBytes();
+    return true;
+} // parseHeader
+
+bool Y4MFile::open(const char* path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        std::cout << "Failed loading of the video " << path << std::endl;
+        return false;
+    }
+    char header[Y4M_MAX_HEADER + 1];
+    ssize_t length = pread(fd, header, Y4M_MAX_HEADER, 0);
+    header[length > 0 ? length : 0] = '\0';
+    const char* end = length > 0 ? strchr(header, '\n') : nullptr;
+    struct stat st;
+    bool ok = end && strncmp(header, Y4M_SIGNATURE, sizeof(Y4M_SIGNATURE) - 1) == 0 && parseHeader(header)
+           && fstat(fd, &st) == 0;
+    if (ok) {
+        m_HeaderBytes = end - header + 1;
+        // строка первого кадра должна быть без параметров, иначе кадры разного размера
+        ok = (size_t)length < m_HeaderBytes + Y4M_FRAME_TAG
+          || memcmp(header + m_HeaderBytes, Y4M_FRAME, Y4M_FRAME_TAG) == 0;
+        m_FrameCount = ((size_t)st.st_size - m_HeaderBytes) / (Y4M_FRAME_TAG + m_FrameBytes);
+    }
+    if (!ok || m_FrameCount == 0) {
+        std::cout << "Failed loading of the video " << path << " (expected 8-bit 4:2:0, 4:2:2 or 4:4:4 Y4M)"
+                  << std::endl;
+        ::close(fd);
+        m_FrameCount = 0;
+        return false;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    m_Fd = fd;
+    return true;
+} // open
+
+bool Y4MFile::readFrame(size_t index, unsigned char* planes) const {
+    if (index >= m_FrameCount)
+        return false;
+    off_t offset = (off_t)(m_HeaderBytes + index * (Y4M_FRAME_TAG + m_FrameBytes));
+    // строка кадра и плоскости читаются одним вызовом, плоскости - сразу на место
+    char tag[Y4M_FRAME_TAG];
+    struct iovec parts[2] = { { tag, Y4M_FRAME_TAG }, { planes, m_FrameBytes } };
+    ssize_t done = preadv(m_Fd, parts, 2, offset);
+    if (done < (ssize_t)Y4M_FRAME_TAG || memcmp(tag, Y4M_FRAME, Y4M_FRAME_TAG) != 0)
+        return false;
+    size_t filled = (size_t)done - Y4M_FRAME_TAG;
+    offset += done;
+    while (filled < m_FrameBytes) {
+        done = pread(m_Fd, planes + filled, m_FrameBytes - filled, offset);
+        if (done <= 0)
+            return false;
+        filled += (size_t)done;
+        offset += done;
+    }
+    return true;
+} // readFrame
+
+void Y4MFile::readAhead(size_t index) const {
+    if (index >= m_FrameCount)
+        return;
+    off_t offset = (off_t)(m_HeaderBytes + index * (Y4M_FRAME_TAG + m_FrameBytes));
+    posix_fadvise(m_Fd, offset, (off_t)(Y4M_FRAME_TAG + m_FrameBytes), POSIX_FADV_WILLNEED);
+}
@@ -27,6 +27,17 @@
  *     то посмотрите стандартную реализацию и обязательно включите ее код в свою версию main.
  *     Первым параметром передайте имя класса потока из п.2, а вторым параметром передайте заголовок
  *     для окна.
+ *  4. Приложение, созданное через DEFINE_APP, понимает ключи командной строки:
+ *       --record <файл>       записывать кадры окна в файл .png, .ppm или .y4m (см. include/frame_capture.h);
+ *       --record-frames <N>   закрыть окно после N записанных кадров;
+ *       --pak <файл>          читать ресурсы из пакета (см. include/vfs.h), можно несколько раз;
+ *       --image-decoder <имя> декодировать изображения в первую очередь этой библиотекой
+ *                             (libjpeg-turbo, stb_image или SOIL, см. include/image_decoder.h);
+ *       --no-image-cache      не сохранять декодированные изображения в bin/image-cache
+ *                             (см. include/image_cache.h).
+ *     Пакет bin/assets.pak подключается и без ключа, если он есть.
+ *     Кадр записывается в Application::gRender, поэтому свой gRender должен заканчиваться
+ *     вызовом base::gRender.
  * 
  */
 
@@ -34,23 +45,32 @@
 #define _APPLICATION_INCLUDED_H_
 
 #include "using_gl.h"
+#include "gl_state.h"
 
 #include <iostream>
 #include <exception>
 #include <stdexcept>
 
+class FrameCapture;
+
 class Application {
 protected:
     inline Application(bool bDebugging = false)
         : m_imain_window_width(-1),
           m_imain_window_height(-1),
           m_pWindow(nullptr),
-          m_bDebugging(bDebugging) {}
+          m_bDebugging(bDebugging),
+          m_pCapture(nullptr),
+          m_pRecordPath(nullptr),
+          m_RecordFrames(0) {}
     inline Application(int width, int height, bool bDebugging = false) 
         : m_imain_window_width(width),
           m_imain_window_height(height),
           m_pWindow(nullptr),
-          m_bDebugging(bDebugging) {}
+          m_bDebugging(bDebugging),
+          m_pCapture(nullptr),
+          m_pRecordPath(nullptr),
+          m_RecordFrames(0) {}
     virtual ~Application() {}
     
     static Application* s_app;
@@ -58,6 +78,15 @@ protected:
     int m_imain_window_width;
     int m_imain_window_height;
     bool m_bDebugging;
+    FrameCapture* m_pCapture;           // запись кадров (--record)
+    const char* m_pRecordPath;
+    long m_RecordFrames;
+    
+    /**
+     * \brief Записывает текущий кадр окна, если запись включена. Вызывается из gRender до
+     * glfwSwapBuffers.
+     */
+    void gCaptureFrame();
     
     // default callbacks
     static void window_resize_callback(GLFWwindow* window, int width, int height);
@@ -73,6 +102,12 @@ public:
      */
     void run();
     
+    /**
+     * \brief Разбирает общие для всех примеров ключи командной строки (--record и т.п.).
+     * Вызывается до gInit. Незнакомые ключи пропускаются.
+     */
+    void setCommandLine(int argc, char** argv);
+    
     /*
      * Замечание: методы, которые начинаются на g, используют функции OpenGL
      */
@@ -93,7 +128,9 @@ public:
      * должна перерисовываться автоматически с некоторым интервалом
      */
     virtual void gRender(bool auto_redraw = true) {
+        gCaptureFrame();
         glfwSwapBuffers(m_pWindow);
+        GLState::current().endFrame();
     }
     
     /**
@@ -106,7 +143,7 @@ public:
      * \brief Позволяет изменить размер Viewport
      */
     virtual void gResize(int width, int height) {
-        glViewport(0, 0, width, height);
+        GLState::current().viewport(0, 0, width, height);
         glfwGetWindowSize(m_pWindow, &m_imain_window_width, &m_imain_window_height);
     }
     
@@ -204,7 +241,9 @@ MAIN_DECL                                                                      \
     Application * app = appclass::Create();                                    \
     try {                                                                      \
         if (app) {                                                             \
+            app->setCommandLine(argc, argv);                                   \
             app->gInit(title);                                                 \
+            GLState::current().sync();                                         \
             app->run();                                                        \
         }                                                                      \
         else {                                                                 \
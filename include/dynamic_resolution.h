@@ -0,0 +1,201 @@
+/*
+ * Динамическое разрешение: сцена рисуется в уменьшенный буфер, когда GPU не укладывается в бюджет кадра
+ *
+ * Время отрисовки большинства сцен растет вместе с числом пикселей. Если GPU не успевает
+ * нарисовать кадр в размер окна за отведенное время (например, 16.7 мс для 60 кадров в
+ * секунду на слабой видеокарте или на llvmpipe), лучше рисовать сцену в меньшем разрешении
+ * и растягивать результат на окно, чем терять кадры.
+ *
+ * Устройство:
+ *   - ResolutionController - только арифметика: по измеренному времени GPU выбирает масштаб
+ *     стороны буфера в пределах [minScale, maxScale]. Время сглаживается, масштаб уменьшается
+ *     сразу, как только время превысило бюджет, а увеличивается осторожно - небольшими шагами
+ *     и только при заметном запасе, чтобы разрешение не "дышало" каждый кадр;
+ *   - DynamicResolution - часть, работающая с OpenGL. Время сцены измеряется запросами
+ *     GL_TIME_ELAPSED; результаты читаются через несколько кадров, поэтому конвейер не
+ *     останавливается. Буфер кадра берется из RenderTargetPool (см. include/render_target_pool.h)
+ *     под maxScale, а уменьшенное разрешение - это просто меньший viewport в его левом нижнем
+ *     углу, так что смена масштаба ничего не пересоздает. В конце кадра изображение
+ *     растягивается на окно шейдером 3.3.shader13 (билинейно или с повышением резкости).
+ *
+ * Пример
+ *
+ *   RenderTargetPool targets;
+ *   DynamicResolution resolution(16.0f);
+ *   resolution.gInit(SHADER_PATH_PREFIX, targets);     // и gResize при изменении размера окна
+ *   ...
+ *   targets.gBeginFrame();
+ *   resolution.gBeginFrame();                          // дальше рисуем сцену как обычно
+ *   ...
+ *   resolution.gEndFrame();                            // растягивает кадр на окно
+ *   targets.gEndFrame();
+ */
+
+#ifndef _DYNAMIC_RESOLUTION_INCLUDED_H_
+#define _DYNAMIC_RESOLUTION_INCLUDED_H_
+
+#include "glad/glad.h"
+
+#define RESOLUTION_TIMER_QUERIES    4       // кадров между запросом времени и чтением результата
+
+class Shader;
+class RenderTargetPool;
+struct RenderTarget;
+
+class ResolutionController {
+public:
+    /**
+     * \param budgetMs  Сколько миллисекунд GPU можно тратить на сцену
+     * \param minScale  Наименьший масштаб стороны буфера
+     * \param maxScale  Наибольший масштаб стороны буфера
+     */
+    ResolutionController(GLfloat budgetMs = 16.0f, GLfloat minScale = 0.5f, GLfloat maxScale = 1.0f);
+
+    /**
+     * \brief Учитывает время очередного кадра и возвращает новый масштаб.
+     */
+    GLfloat update(GLfloat gpuMs);
+
+    void setBudget(GLfloat budgetMs) {
+        m_BudgetMs = budgetMs;
+    }
+
+    GLfloat getBudget() const {
+        return m_BudgetMs;
+    }
+
+    void setScaleRange(GLfloat minScale, GLfloat maxScale);
+
+    /**
+     * \brief Сбрасывает сглаженное время и возвращается к масштабу scale.
+     */
+    void reset(GLfloat scale);
+
+    GLfloat getScale() const {
+        return m_Scale;
+    }
+
+    /**
+     * \brief Сглаженное время GPU, мс.
+     */
+    GLfloat getSmoothedMs() const {
+        return m_SmoothedMs;
+    }
+
+private:
+    GLfloat m_BudgetMs;
+    GLfloat m_MinScale;
+    GLfloat m_MaxScale;
+    GLfloat m_Scale;
+    GLfloat m_SmoothedMs;       // 0 - измерений еще не было
+    GLuint  m_Cooldown;         // сколько измерений еще относится к старому масштабу
+    GLuint  m_GrowDelay;        // измерений до следующего увеличения масштаба
+};
+
+class DynamicResolution {
+public:
+    enum Upscale {
+        BILINEAR,
+        SHARPEN         // билинейно и затем повышение резкости с ограничением по соседям
+    };
+
+    DynamicResolution(GLfloat budgetMs = 16.0f, GLfloat minScale = 0.5f, GLfloat maxScale = 1.0f);
+    ~DynamicResolution();
+
+    /**
+     * \brief Загружает шейдер растяжения из каталога shaderDir и создает запросы времени.
+     * Буфер кадра на каждый кадр берется из пула targets.
+     */
+    void gInit(const char* shaderDir, RenderTargetPool& targets);
+
+    /**
+     * \brief Запоминает размер окна width x height. Вызывается из gResize приложения.
+     * Размер буфера кадра следует за размером, который применил пул.
+     */
+    void gResize(int width, int height);
+
+    /**
+     * \brief Начинает кадр: выбирает масштаб, берет буфер кадра из пула и задает viewport.
+     */
+    void gBeginFrame();
+
+    /**
+     * \brief Заканчивает кадр: растягивает изображение на окно (буфер кадра 0) и возвращает
+     * буфер в пул.
+     */
+    void gEndFrame();
+
+    /**
+     * \brief Удаляет объекты OpenGL. Вызывается из gFinalize приложения.
+     */
+    void gFinalize();
+
+    /**
+     * \brief Включает подстройку масштаба. Выключенная - рисуем с maxScale.
+     */
+    void setEnabled(bool enabled);
+
+    bool isEnabled() const {
+        return m_bEnabled;
+    }
+
+    void setUpscale(Upscale upscale) {
+        m_Upscale = upscale;
+    }
+
+    Upscale getUpscale() const {
+        return m_Upscale;
+    }
+
+    /**
+     * \brief Сила повышения резкости для SHARPEN, от 0 до 1.
+     */
+    void setSharpness(GLfloat sharpness) {
+        m_Sharpness = sharpness;
+    }
+
+    ResolutionController& getController() {
+        return m_Controller;
+    }
+
+    int getRenderWidth() const {
+        return m_RenderWidth;
+    }
+
+    int getRenderHeight() const {
+        return m_RenderHeight;
+    }
+
+    /**
+     * \brief Последнее измеренное время GPU на сцену, мс (0, пока измерений нет).
+     */
+    GLfloat getGpuMs() const {
+        return m_GpuMs;
+    }
+
+private:
+    DynamicResolution(const DynamicResolution&);
+    DynamicResolution& operator=(const DynamicResolution&);
+
+    void gReadTimers();
+
+    ResolutionController    m_Controller;
+    GLfloat                 m_MaxScale;
+    bool                    m_bEnabled;
+    Upscale                 m_Upscale;
+    GLfloat                 m_Sharpness;
+    Shader*                 m_pShader;
+    RenderTargetPool*       m_pTargets;
+    const RenderTarget*     m_pTarget;          // буфер текущего кадра (под maxScale)
+    GLuint                  m_Vao;
+    int                     m_WindowWidth;
+    int                     m_WindowHeight;
+    int                     m_RenderWidth;      // размер текущего кадра внутри буфера
+    int                     m_RenderHeight;
+    GLuint                  m_Queries[RESOLUTION_TIMER_QUERIES];
+    bool                    m_QueryPending[RESOLUTION_TIMER_QUERIES];
+    GLuint                  m_Query;            // запрос текущего кадра
+    GLfloat                 m_GpuMs;
+};
+
+#endif // _DYNAMIC_RESOLUTION_INCLUDED_H_
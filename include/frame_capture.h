@@ -0,0 +1,150 @@
+/*
+ * Запись кадров в файлы без остановки конвейера
+ *
+ * glReadPixels в обычную память ждет, пока GPU дорисует кадр, и все, что было поставлено
+ * в очередь, выполняется синхронно: частота кадров при записи падает в разы. FrameCapture
+ * читает кадр в буфер пикселей (GL_PIXEL_PACK_BUFFER): glReadPixels только ставит копирование
+ * в очередь GPU и сразу возвращается. Буферов CAPTURE_RING_SIZE, они используются по кругу,
+ * а в память кадр отображается через несколько кадров, когда барьер (glFenceSync) уже пройден.
+ * Кодирование и запись файлов выполняет отдельный поток (ThreadPool из одного потока,
+ * поэтому кадры пишутся строго по порядку).
+ *
+ * Формат выбирается по расширению пути (см. include/image_write.h):
+ *   .png  - файл на кадр; если в пути нет %d, номер кадра добавляется перед расширением
+ *           (shot.png -> shot_00000.png);
+ *   .ppm  - с %d в пути - файл на кадр, без него - все кадры подряд в одном файле;
+ *   .y4m  - один файл с несжатым видео. Размер кадра берется из первого кадра, кадры
+ *           другого размера (после изменения размера окна) пропускаются.
+ *
+ * Если GPU отстал больше чем на CAPTURE_RING_SIZE кадров или кодировщик не успевает
+ * (в очереди CAPTURE_MAX_QUEUED кадров), gCapture ждет: кадры не теряются, а задержки
+ * видны в статистике.
+ *
+ * Приложения на основе Application получают запись бесплатно (см. include/application.h):
+ *
+ *   ./13-advanced-camera-with-class-camera --record capture.y4m --record-frames 600
+ *
+ * Пример
+ *
+ *   FrameCapture capture;
+ *   capture.start("frame%05d.png");
+ *   ...
+ *   capture.gCapture(0, width, height);     // в конце каждого кадра, до glfwSwapBuffers
+ *   ...
+ *   capture.gStop();                        // пока контекст OpenGL еще жив
+ */
+
+#ifndef _FRAME_CAPTURE_INCLUDED_H_
+#define _FRAME_CAPTURE_INCLUDED_H_
+
+#include "glad/glad.h"
+#include "thread_pool.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define CAPTURE_RING_SIZE   3
+#define CAPTURE_MAX_QUEUED  4
+
+/**
+ * \brief Статистика записи с момента start(). Поля written и skipped обновляет поток
+ * кодировщика, окончательные значения - после gStop().
+ */
+struct FrameCaptureStats {
+    size_t  captured;           // вызовов gCapture
+    size_t  written;            // кадров записано
+    size_t  skipped;            // кадров другого размера в потоке Y4M
+    size_t  gpuStalls;          // пришлось ждать GPU
+    size_t  encoderStalls;      // пришлось ждать кодировщик
+    double  captureMs;          // время в gCapture, то есть потерянное основным потоком
+};
+
+class FrameCapture {
+public:
+    enum Format {
+        PNG,
+        PPM,
+        Y4M
+    };
+
+    FrameCapture();
+
+    /**
+     * \brief Останавливает запись. Буферы OpenGL удаляются только в gStop().
+     */
+    ~FrameCapture();
+
+    /**
+     * \brief Начинает запись в path. \param fps  Частота кадров в заголовке Y4M
+     * \return false, если формат не распознан или файл не открылся
+     */
+    bool start(const char* path, int fps = 60);
+
+    bool isRecording() const {
+        return m_bRecording;
+    }
+
+    /**
+     * \brief Ставит в очередь чтение цветового буфера framebuffer (0 - окно) размером
+     * width x height и забирает кадры, которые GPU уже скопировал.
+     */
+    void gCapture(GLuint framebuffer, int width, int height);
+
+    /**
+     * \brief Дожидается всех кадров, закрывает файлы и удаляет буферы пикселей.
+     */
+    void gStop();
+
+    /**
+     * \brief Копия статистики: written и skipped меняет поток кодировщика.
+     */
+    FrameCaptureStats getStats();
+
+    /**
+     * \brief Путь, в который идет запись.
+     */
+    const std::string& getPath() const {
+        return m_Path;
+    }
+
+private:
+    FrameCapture(const FrameCapture&);
+    FrameCapture& operator=(const FrameCapture&);
+
+    struct Slot {
+        GLuint      buffer;
+        GLsizeiptr  capacity;
+        GLsync      fence;
+        int         width;
+        int         height;
+        bool        pending;
+    };
+
+    void gRetrieve(Slot& slot);
+    size_t acquireFrame();
+    void encode(size_t frame, int width, int height, size_t index);
+
+    Format                                      m_Format;
+    std::string                                 m_Path;         // шаблон имени файла с %d или файл потока
+    int                                         m_Fps;
+    bool                                        m_bRecording;
+    FILE*                                       m_pStream;      // PPM-поток или Y4M
+    int                                         m_StreamWidth;
+    int                                         m_StreamHeight;
+    Slot                                        m_Slots[CAPTURE_RING_SIZE];
+    unsigned                                    m_Next;         // слот для следующего кадра
+    unsigned                                    m_Oldest;       // самый старый ожидающий слот
+    size_t                                      m_Index;        // номер следующего кадра
+    std::vector< std::vector<unsigned char> >   m_Frames;       // кадры для кодировщика
+    std::vector<size_t>                         m_FreeFrames;
+    std::mutex                                  m_Mutex;        // m_FreeFrames, m_bWriteFailed, m_Stats
+    std::condition_variable                     m_FrameFreed;
+    bool                                        m_bWriteFailed;
+    FrameCaptureStats                           m_Stats;
+    ThreadPool                                  m_Encoder;
+};
+
+#endif // _FRAME_CAPTURE_INCLUDED_H_
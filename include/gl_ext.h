@@ -0,0 +1,63 @@
+/*
+ * Функции OpenGL, которых нет в нашем профиле GLAD
+ *
+ * GLAD в каталоге lib сгенерирован для OpenGL 3.3 и расширения GL_ARB_debug_output.
+ * Некоторые модули умеют пользоваться более новыми возможностями, если драйвер их
+ * предоставляет (постоянное отображение буферов, косвенная отрисовка и т.п.).
+ * Указатели на такие функции загружаются здесь через glfwGetProcAddress, а флаги
+ * в структуре GLExtensions сообщают, можно ли ими пользоваться.
+ *
+ * Загрузка выполняется при первом вызове glExtensions(), поэтому к этому моменту
+ * контекст OpenGL уже должен быть текущим (то есть после Application::gInit).
+ */
+
+#ifndef _GL_EXT_INCLUDED_H_
+#define _GL_EXT_INCLUDED_H_
+
+#include "glad/glad.h"
+
+//-------- GL 4.4 / GL_ARB_buffer_storage --------------------------------
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT             0x0040
+#define GL_MAP_COHERENT_BIT               0x0080
+#define GL_DYNAMIC_STORAGE_BIT            0x0100
+#define GL_CLIENT_STORAGE_BIT             0x0200
+#endif
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+//-------- GL 4.3 / GL_ARB_multi_draw_indirect ---------------------------
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER           0x8F3F
+#endif
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+
+//-------- сжатые текстуры (см. texture_compress.h) ----------------------
+//   GL_EXT_texture_compression_s3tc - BC1 и BC3, GL 4.2 / GL_ARB_texture_compression_bptc - BC7,
+//   GL 4.3 / GL_ARB_ES3_compatibility - ETC2. Новых функций не нужно, только флаги.
+
+struct GLExtensions {
+    bool                                bufferStorage;      // GL 4.4 или GL_ARB_buffer_storage
+    PFNGLBUFFERSTORAGEPROC              BufferStorage;
+    bool                                multiDrawIndirect;  // GL 4.3 или GL_ARB_multi_draw_indirect
+    PFNGLMULTIDRAWELEMENTSINDIRECTPROC  MultiDrawElementsIndirect;
+    bool                                textureCompressionS3TC;
+    bool                                textureCompressionBPTC;
+    bool                                textureCompressionETC2;
+};
+
+/**
+ * \brief Проверяет, поддерживает ли текущий контекст расширение с именем name.
+ */
+bool glHasExtension(const char* name);
+
+/**
+ * \brief Возвращает таблицу дополнительных функций текущего контекста.
+ */
+const GLExtensions& glExtensions();
+
+/**
+ * \brief Можно ли загружать текстуры в сжатом формате format (см. texture_compress.h) как есть.
+ */
+bool glSupportsCompressedFormat(GLenum format);
+
+#endif // _GL_EXT_INCLUDED_H_
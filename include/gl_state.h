@@ -0,0 +1,414 @@
+/*
+ * Кэш состояния OpenGL
+ *
+ * Драйверу не важно, что мы привязываем ту же текстуру, что уже привязана: каждый вызов
+ * glBindTexture, glUseProgram или glEnable все равно проходит через проверку и запись
+ * состояния. Класс GLState запоминает текущее состояние контекста и пропускает вызовы,
+ * которые ничего не меняют. Поэтому привязки "к нулю" после отрисовки (glBindVertexArray(0),
+ * glBindTexture(GL_TEXTURE_2D, 0)) больше не нужны: следующая привязка и так заменит объект.
+ *
+ * Чтобы кэш оставался верным, все изменения состояния должны проходить через него.
+ * Если код все же вызывал функции OpenGL напрямую (например, в gInit), вызовите sync() -
+ * кэш перечитает состояние из контекста. Типовой main (DEFINE_APP) делает это сам после gInit.
+ *
+ * Для каждого кадра считается количество отправленных в драйвер и пропущенных вызовов.
+ * Кадр завершается в Application::gRender, статистику последнего кадра возвращает frameStats().
+ *
+ * Пример
+ *
+ *   GLState& gl = GLState::current();
+ *   gl.enable(GL_DEPTH_TEST);
+ *   gl.useProgram(m_Shaders->ID);
+ *   gl.bindTextureUnit(0, GL_TEXTURE_2D, texture_box);
+ *   gl.bindVertexArray(VAO);
+ *   glDrawArrays(GL_TRIANGLES, 0, 36);
+ */
+
+#ifndef _GL_STATE_INCLUDED_H_
+#define _GL_STATE_INCLUDED_H_
+
+#include "glad/glad.h"
+#include "gl_ext.h"
+
+#include <cstring>
+
+#define GLS_MAX_TEXTURE_UNITS   16
+
+/**
+ * \brief Счетчики вызовов за кадр
+ */
+struct GLStateStats {
+    GLuint issued;      // вызовов отправлено в драйвер
+    GLuint skipped;     // вызовов пропущено, так как состояние уже установлено
+};
+
+class GLState {
+public:
+    /**
+     * \brief Кэш состояния текущего контекста. В примерах контекст всегда один.
+     */
+    static GLState& current() {
+        static GLState s_state;
+        return s_state;
+    }
+
+    //-------- режимы (glEnable/glDisable) ------------------------------
+    void enable(GLenum cap) {
+        setCapability(cap, true);
+    }
+    void disable(GLenum cap) {
+        setCapability(cap, false);
+    }
+
+    //-------- объекты ---------------------------------------------------
+    void useProgram(GLuint program) {
+        if (m_Program == program) {
+            skip();
+            return;
+        }
+        glUseProgram(program);
+        m_Program = program;
+        issue();
+    }
+
+    void bindVertexArray(GLuint vao) {
+        if (m_Vao == vao) {
+            skip();
+            return;
+        }
+        glBindVertexArray(vao);
+        m_Vao = vao;
+        // GL_ELEMENT_ARRAY_BUFFER - часть состояния VAO
+        m_Buffers[bufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+        issue();
+    }
+
+    void bindBuffer(GLenum target, GLuint buffer) {
+        int slot = bufferSlot(target);
+        if (slot >= 0 && m_Buffers[slot] == buffer) {
+            skip();
+            return;
+        }
+        glBindBuffer(target, buffer);
+        if (slot >= 0)
+            m_Buffers[slot] = buffer;
+        issue();
+    }
+
+    void bindFramebuffer(GLenum target, GLuint framebuffer) {
+        bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+        bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+        if ((!draw || m_DrawFramebuffer == framebuffer) && (!read || m_ReadFramebuffer == framebuffer)) {
+            skip();
+            return;
+        }
+        glBindFramebuffer(target, framebuffer);
+        if (draw)
+            m_DrawFramebuffer = framebuffer;
+        if (read)
+            m_ReadFramebuffer = framebuffer;
+        issue();
+    }
+
+    //-------- текстуры -------------------------------------------------
+    void activeTexture(GLenum unit) {
+        GLuint index = unit - GL_TEXTURE0;
+        if (m_ActiveUnit == index) {
+            skip();
+            return;
+        }
+        glActiveTexture(unit);
+        m_ActiveUnit = index;
+        issue();
+    }
+
+    /**
+     * \brief Привязывает текстуру к активному текстурному блоку.
+     */
+    void bindTexture(GLenum target, GLuint texture) {
+        int slot = textureSlot(target);
+        if (slot >= 0 && m_ActiveUnit < GLS_MAX_TEXTURE_UNITS && m_Textures[m_ActiveUnit][slot] == texture) {
+            skip();
+            return;
+        }
+        glBindTexture(target, texture);
+        if (slot >= 0 && m_ActiveUnit < GLS_MAX_TEXTURE_UNITS)
+            m_Textures[m_ActiveUnit][slot] = texture;
+        issue();
+    }
+
+    /**
+     * \brief Привязывает текстуру к блоку unit (0, 1, ...). glActiveTexture
+     * вызывается только если привязка действительно меняется.
+     */
+    void bindTextureUnit(GLuint unit, GLenum target, GLuint texture) {
+        int slot = textureSlot(target);
+        if (slot >= 0 && unit < GLS_MAX_TEXTURE_UNITS && m_Textures[unit][slot] == texture) {
+            skip();
+            return;
+        }
+        activeTexture(GL_TEXTURE0 + unit);
+        bindTexture(target, texture);
+    }
+
+    //-------- прочее состояние -----------------------------------------
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+        if (m_Viewport[0] == x && m_Viewport[1] == y && m_Viewport[2] == width && m_Viewport[3] == height) {
+            skip();
+            return;
+        }
+        glViewport(x, y, width, height);
+        m_Viewport[0] = x;
+        m_Viewport[1] = y;
+        m_Viewport[2] = width;
+        m_Viewport[3] = height;
+        issue();
+    }
+
+    void clearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) {
+        if (m_ClearColor[0] == r && m_ClearColor[1] == g && m_ClearColor[2] == b && m_ClearColor[3] == a) {
+            skip();
+            return;
+        }
+        glClearColor(r, g, b, a);
+        m_ClearColor[0] = r;
+        m_ClearColor[1] = g;
+        m_ClearColor[2] = b;
+        m_ClearColor[3] = a;
+        issue();
+    }
+
+    void depthMask(GLboolean flag) {
+        if (m_DepthMask == flag) {
+            skip();
+            return;
+        }
+        glDepthMask(flag);
+        m_DepthMask = flag;
+        issue();
+    }
+
+    void blendFunc(GLenum sfactor, GLenum dfactor) {
+        if (m_BlendSrc == sfactor && m_BlendDst == dfactor) {
+            skip();
+            return;
+        }
+        glBlendFunc(sfactor, dfactor);
+        m_BlendSrc = sfactor;
+        m_BlendDst = dfactor;
+        issue();
+    }
+
+    //-------- удаление объектов ----------------------------------------
+    /*
+     * При удалении привязанного объекта OpenGL сам отвязывает его, поэтому
+     * кэш должен узнать об удалении, иначе новый объект с тем же именем
+     * не будет привязан.
+     */
+    void deleteProgram(GLuint program) {
+        glDeleteProgram(program);
+        if (m_Program == program)
+            m_Program = UNKNOWN;
+    }
+
+    void deleteVertexArrays(GLsizei n, const GLuint* arrays) {
+        glDeleteVertexArrays(n, arrays);
+        for (GLsizei i = 0; i < n; i++)
+            if (m_Vao == arrays[i])
+                m_Vao = 0;
+    }
+
+    void deleteBuffers(GLsizei n, const GLuint* buffers) {
+        glDeleteBuffers(n, buffers);
+        for (GLsizei i = 0; i < n; i++)
+            for (int slot = 0; slot < BUFFER_SLOTS; slot++)
+                if (m_Buffers[slot] == buffers[i])
+                    m_Buffers[slot] = 0;
+    }
+
+    void deleteTextures(GLsizei n, const GLuint* textures) {
+        glDeleteTextures(n, textures);
+        for (GLsizei i = 0; i < n; i++)
+            for (int unit = 0; unit < GLS_MAX_TEXTURE_UNITS; unit++)
+                for (int slot = 0; slot < TEXTURE_SLOTS; slot++)
+                    if (m_Textures[unit][slot] == textures[i])
+                        m_Textures[unit][slot] = 0;
+    }
+
+    void deleteFramebuffers(GLsizei n, const GLuint* framebuffers) {
+        glDeleteFramebuffers(n, framebuffers);
+        for (GLsizei i = 0; i < n; i++) {
+            if (m_DrawFramebuffer == framebuffers[i])
+                m_DrawFramebuffer = 0;
+            if (m_ReadFramebuffer == framebuffers[i])
+                m_ReadFramebuffer = 0;
+        }
+    }
+
+    //-------- синхронизация и статистика -------------------------------
+    /**
+     * \brief Перечитывает состояние из контекста OpenGL. Нужно вызывать после того,
+     * как код менял состояние в обход кэша.
+     */
+    void sync() {
+        GLint value;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &value);
+        m_Program = value;
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &value);
+        m_Vao = value;
+        glGetIntegerv(GL_ACTIVE_TEXTURE, &value);
+        m_ActiveUnit = value - GL_TEXTURE0;
+        for (int slot = 0; slot < BUFFER_SLOTS; slot++)
+            m_Buffers[slot] = UNKNOWN;
+        for (int unit = 0; unit < GLS_MAX_TEXTURE_UNITS; unit++)
+            for (int slot = 0; slot < TEXTURE_SLOTS; slot++)
+                m_Textures[unit][slot] = UNKNOWN;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &value);
+        m_DrawFramebuffer = value;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &value);
+        m_ReadFramebuffer = value;
+        glGetIntegerv(GL_VIEWPORT, m_Viewport);
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, m_ClearColor);
+        glGetBooleanv(GL_DEPTH_WRITEMASK, &m_DepthMask);
+        glGetIntegerv(GL_BLEND_SRC_RGB, &value);
+        m_BlendSrc = value;
+        glGetIntegerv(GL_BLEND_DST_RGB, &value);
+        m_BlendDst = value;
+        for (int i = 0; i < CAPABILITIES; i++)
+            m_Caps[i].enabled = glIsEnabled(m_Caps[i].cap) == GL_TRUE;
+    }
+
+    /**
+     * \brief Завершает кадр: запоминает его счетчики и обнуляет текущие.
+     */
+    void endFrame() {
+        m_LastFrame = m_Frame;
+        m_Frame.issued = 0;
+        m_Frame.skipped = 0;
+    }
+
+    /**
+     * \brief Счетчики последнего завершенного кадра.
+     */
+    const GLStateStats& frameStats() const {
+        return m_LastFrame;
+    }
+
+    GLuint getProgram() const {
+        return m_Program;
+    }
+
+    GLuint getVertexArray() const {
+        return m_Vao;
+    }
+
+private:
+    static const GLuint UNKNOWN = 0xFFFFFFFFu;
+    static const int BUFFER_SLOTS = 9;
+    static const int TEXTURE_SLOTS = 5;
+    static const int CAPABILITIES = 7;
+    struct Capability {
+        GLenum cap;
+        bool   enabled;
+    };
+
+    /*
+     * Начальные значения совпадают со значениями по умолчанию для нового контекста.
+     */
+    GLState()
+        : m_Program(0),
+          m_Vao(0),
+          m_ActiveUnit(0),
+          m_DrawFramebuffer(0),
+          m_ReadFramebuffer(0),
+          m_DepthMask(GL_TRUE),
+          m_BlendSrc(GL_ONE),
+          m_BlendDst(GL_ZERO) {
+        memset(m_Buffers, 0, sizeof(m_Buffers));
+        memset(m_Textures, 0, sizeof(m_Textures));
+        // размер окна заранее не известен, поэтому первый glViewport всегда выполняется
+        m_Viewport[0] = m_Viewport[1] = m_Viewport[2] = m_Viewport[3] = -1;
+        m_ClearColor[0] = m_ClearColor[1] = m_ClearColor[2] = m_ClearColor[3] = 0.0f;
+        const GLenum caps[CAPABILITIES] = {
+            GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE, GL_SCISSOR_TEST,
+            GL_STENCIL_TEST, GL_MULTISAMPLE, GL_FRAMEBUFFER_SRGB
+        };
+        for (int i = 0; i < CAPABILITIES; i++) {
+            m_Caps[i].cap = caps[i];
+            m_Caps[i].enabled = caps[i] == GL_MULTISAMPLE;
+        }
+        m_Frame.issued = m_Frame.skipped = 0;
+        m_LastFrame = m_Frame;
+    }
+    GLState(const GLState&);
+    GLState& operator=(const GLState&);
+
+    void issue() {
+        m_Frame.issued++;
+    }
+    void skip() {
+        m_Frame.skipped++;
+    }
+
+    void setCapability(GLenum cap, bool enabled) {
+        for (int i = 0; i < CAPABILITIES; i++) {
+            if (m_Caps[i].cap == cap) {
+                if (m_Caps[i].enabled == enabled) {
+                    skip();
+                    return;
+                }
+                m_Caps[i].enabled = enabled;
+                break;
+            }
+        }
+        if (enabled)
+            glEnable(cap);
+        else
+            glDisable(cap);
+        issue();
+    }
+
+    static int bufferSlot(GLenum target) {
+        switch (target) {
+            case GL_ARRAY_BUFFER:           return 0;
+            case GL_ELEMENT_ARRAY_BUFFER:   return 1;
+            case GL_PIXEL_PACK_BUFFER:      return 2;
+            case GL_PIXEL_UNPACK_BUFFER:    return 3;
+            case GL_UNIFORM_BUFFER:         return 4;
+            case GL_COPY_READ_BUFFER:       return 5;
+            case GL_COPY_WRITE_BUFFER:      return 6;
+            case GL_TEXTURE_BUFFER:         return 7;
+            case GL_DRAW_INDIRECT_BUFFER:   return 8;
+        }
+        return -1;
+    }
+
+    static int textureSlot(GLenum target) {
+        switch (target) {
+            case GL_TEXTURE_2D:             return 0;
+            case GL_TEXTURE_2D_ARRAY:       return 1;
+            case GL_TEXTURE_CUBE_MAP:       return 2;
+            case GL_TEXTURE_3D:             return 3;
+            case GL_TEXTURE_BUFFER:         return 4;
+        }
+        return -1;
+    }
+
+    GLuint          m_Program;
+    GLuint          m_Vao;
+    GLuint          m_ActiveUnit;
+    GLuint          m_Buffers[BUFFER_SLOTS];
+    GLuint          m_Textures[GLS_MAX_TEXTURE_UNITS][TEXTURE_SLOTS];
+    GLuint          m_DrawFramebuffer;
+    GLuint          m_ReadFramebuffer;
+    GLint           m_Viewport[4];
+    GLfloat         m_ClearColor[4];
+    GLboolean       m_DepthMask;
+    GLenum          m_BlendSrc;
+    GLenum          m_BlendDst;
+    Capability      m_Caps[CAPABILITIES];
+    GLStateStats    m_Frame;
+    GLStateStats    m_LastFrame;
+}; // class GLState
+
+#endif // _GL_STATE_INCLUDED_H_
@@ -0,0 +1,195 @@
+/*
+ * Кэш декодированных изображений на диске
+ *
+ * При каждом запуске TextureManager заново декодирует одни и те же JPEG из textures/, а
+ * glGenerateMipmap заново строит mip-уровни. ImageCache сохраняет результат - пиксели всех
+ * уровней - в файл, который при следующем запуске достаточно отобразить в память и передать
+ * в glTexImage2D как есть.
+ *
+ * Ключ кэша - содержимое исходного файла (64-битный хэш и размер) и число каналов, поэтому
+ * переименованный или скопированный файл находит ту же запись, а измененный - новую. Старые
+ * записи не удаляются; каталог кэша можно просто очистить.
+ *
+ * Формат файла - без сжатия, все смещения выровнены на IMAGE_CACHE_ALIGNMENT:
+ *
+ *   [ImageCacheHeader][ImageCacheLevel x levelCount][пиксели уровня 0][уровня 1]...
+ *
+ * Строки уровней идут подряд без выравнивания (для RGB нужен GL_UNPACK_ALIGNMENT 1).
+ * Mip-уровни строятся усреднением 2 x 2, как в tools/texture-cook. Файл пишется во временный
+ * и переименовывается, так что два процесса (или два потока) не увидят наполовину записанную
+ * запись.
+ *
+ * Кэш включается каталогом: Application использует bin/image-cache, ключ --no-image-cache
+ * его выключает (см. application.h). Выключенный кэш ничего не хранит, и loadCachedImage
+ * только декодирует уровень 0.
+ *
+ * Пример
+ *
+ *   ImageCache::current().setDirectory("image-cache");
+ *   CachedImage image;
+ *   if (loadCachedImage(TEXTURE_PATH_PREFIX"/box.jpg", 3, image))
+ *       for (size_t i = 0; i < image.getLevelCount(); i++)
+ *           ... image.getLevel(i).data ...
+ */
+
+#ifndef _IMAGE_CACHE_INCLUDED_H_
+#define _IMAGE_CACHE_INCLUDED_H_
+
+#include "glad/glad.h"
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define IMAGE_CACHE_MAGIC           0x43474D49u     // "IMGC"
+#define IMAGE_CACHE_VERSION         1
+#define IMAGE_CACHE_ALIGNMENT       64
+
+struct ImageCacheHeader {
+    GLuint      magic;
+    GLuint      version;
+    GLuint64    sourceHash;
+    GLuint64    sourceSize;
+    GLuint      width;
+    GLuint      height;
+    GLuint      channels;
+    GLuint      levelCount;
+};
+
+struct ImageCacheLevel {
+    GLuint      width;
+    GLuint      height;
+    GLuint64    offset;             // от начала файла
+    GLuint64    size;
+};
+
+struct CachedLevel {
+    int                     width;
+    int                     height;
+    const unsigned char*    data;
+    size_t                  size;
+};
+
+/**
+ * \brief Декодированное изображение: уровни указывают либо в отображенный файл кэша, либо
+ * в собственную память (если изображение только что декодировано).
+ */
+class CachedImage {
+public:
+    CachedImage();
+    ~CachedImage();
+
+    int getWidth() const {
+        return m_Width;
+    }
+
+    int getHeight() const {
+        return m_Height;
+    }
+
+    size_t getLevelCount() const {
+        return m_Levels.size();
+    }
+
+    const CachedLevel& getLevel(size_t level) const {
+        return m_Levels[level];
+    }
+
+    /**
+     * \brief true, если уровни взяты из кэша, а не декодированы заново.
+     */
+    bool isHit() const {
+        return m_Hit;
+    }
+
+    /**
+     * \brief Освобождает память или отображение; уровней не остается.
+     */
+    void close();
+
+private:
+    CachedImage(const CachedImage&);
+    CachedImage& operator=(const CachedImage&);
+
+    friend class ImageCache;
+    friend bool loadCachedImage(const char* path, int channels, CachedImage& image);
+
+    int                         m_Width;
+    int                         m_Height;
+    std::vector<CachedLevel>    m_Levels;
+    void*                       m_pMapping;     // отображение файла кэша
+    size_t                      m_MappingSize;
+    std::vector<unsigned char>  m_Pixels;       // уровни в памяти, если кэш выключен или не записался
+    bool                        m_Hit;
+}; // class CachedImage
+
+struct ImageCacheStats {
+    size_t  hits;
+    size_t  misses;
+    size_t  stores;             // записано файлов
+    size_t  bytesStored;
+};
+
+class ImageCache {
+public:
+    static ImageCache& current();
+
+    /**
+     * \brief Каталог кэша; создается при первой записи. Пустая строка выключает кэш.
+     */
+    void setDirectory(const std::string& directory);
+
+    const std::string& getDirectory() const {
+        return m_Directory;
+    }
+
+    bool isEnabled() const {
+        return !m_Directory.empty();
+    }
+
+    /**
+     * \brief Ищет запись для исходного файла с хэшем hash (см. hashBytes) и размером size и
+     * отображает ее в image.
+     * \return false, если записи нет или она повреждена
+     */
+    bool find(GLuint64 hash, size_t size, int channels, CachedImage& image);
+
+    /**
+     * \brief Достраивает к декодированному уровню 0 в pixels mip-уровни и записывает их в кэш.
+     * Содержимое pixels переходит к image, и image получает все уровни, даже если записать
+     * файл не удалось.
+     */
+    void store(GLuint64 hash, size_t size, int channels, std::vector<unsigned char>& pixels,
+               int width, int height, CachedImage& image);
+
+    /**
+     * \brief Путь к файлу записи (файла может и не быть).
+     */
+    std::string getPath(GLuint64 hash, size_t size, int channels) const;
+
+    ImageCacheStats getStats();
+
+private:
+    ImageCache();
+    ImageCache(const ImageCache&);
+    ImageCache& operator=(const ImageCache&);
+
+    std::string             m_Directory;
+    std::mutex              m_Mutex;        // статистика: кэшем пользуются потоки загрузки
+    ImageCacheStats         m_Stats;
+}; // class ImageCache
+
+/**
+ * \brief 64-битный хэш содержимого (MurmurHash64A).
+ */
+GLuint64 hashBytes(const unsigned char* data, size_t size, GLuint64 seed = 0);
+
+/**
+ * \brief Читает файл через Vfs и берет изображение из кэша или декодирует его (см.
+ * image_decoder.h) и сохраняет в кэш. Безопасно вызывать из любого потока.
+ * \return false, если файл не нашелся или не декодировался; сообщение не выводится
+ */
+bool loadCachedImage(const char* path, int channels, CachedImage& image);
+
+#endif // _IMAGE_CACHE_INCLUDED_H_
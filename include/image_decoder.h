@@ -0,0 +1,90 @@
+/*
+ * Декодирование изображений: один интерфейс, несколько библиотек
+ *
+ * В примерах два декодера: include/stb_image.h (05-textures) и SOIL (06-another-texture и
+ * TextureManager), и выбор между ними зашит в код. ImageDecoder - общий интерфейс, за которым
+ * стоят взаимозаменяемые библиотеки:
+ *
+ *   libjpeg-turbo  только JPEG, с SIMD; не нужна при сборке - библиотека загружается через
+ *                  dlopen, если она есть в системе и при сборке нашелся jpeglib.h
+ *   stb_image      JPEG, PNG, BMP, TGA... (include/stb_image.h)
+ *   SOIL           то же, что stb_image, но более старой версии
+ *
+ * imageDecoders() при первом вызове проверяет, какие библиотеки доступны, и упорядочивает их
+ * от быстрой к медленной (скорости сравнивает утилита tools/image-bench). Изображение
+ * декодирует первая библиотека, которая поняла его заголовок; если она не справилась
+ * (например, CMYK JPEG у libjpeg-turbo), пробуется следующая.
+ *
+ * Декодирование пишет в буфер вызывающего: сначала getImageInfo узнает размер по заголовку,
+ * затем decodeImage заполняет width * height * channels байт - например, прямо отображенный
+ * буфер GL_PIXEL_UNPACK_BUFFER (см. texture_manager.h). libjpeg-turbo декодирует строки
+ * прямо туда; stb_image и SOIL выделяют память сами, и изображение из нее копируется.
+ *
+ * Пример
+ *
+ *   ImageInfo info;
+ *   if (getImageInfo(file.data(), file.size(), info)) {
+ *       std::vector<unsigned char> pixels((size_t)info.width * info.height * 4);
+ *       decodeImage(file.data(), file.size(), 4, pixels.data());
+ *   }
+ */
+
+#ifndef _IMAGE_DECODER_INCLUDED_H_
+#define _IMAGE_DECODER_INCLUDED_H_
+
+#include <cstddef>
+#include <vector>
+
+struct ImageInfo {
+    int     width;
+    int     height;
+    int     channels;           // в файле; декодировать можно в любое число каналов от 1 до 4
+};
+
+class ImageDecoder {
+public:
+    virtual ~ImageDecoder() {}
+
+    virtual const char* getName() const = 0;
+
+    /**
+     * \brief Читает размер изображения из заголовка, не декодируя его.
+     * \return false, если формат этой библиотеке незнаком
+     */
+    virtual bool getInfo(const unsigned char* data, size_t size, ImageInfo& info) const = 0;
+
+    /**
+     * \brief Декодирует изображение в pixels: строки подряд, без выравнивания, по channels
+     * байт на пиксель (1 - яркость, 2 - яркость и альфа, 3 - RGB, 4 - RGBA).
+     */
+    virtual bool decode(const unsigned char* data, size_t size, int channels, unsigned char* pixels) const = 0;
+};
+
+/**
+ * \brief Доступные декодеры, от быстрого к медленному. Безопасно вызывать из любого потока.
+ */
+const std::vector<ImageDecoder*>& imageDecoders();
+
+/**
+ * \brief Ставит декодер с именем name первым. Вызывается при запуске, до загрузки изображений.
+ * \return false, если такого декодера нет
+ */
+bool setPreferredImageDecoder(const char* name);
+
+/**
+ * \brief Размер изображения по заголовку (первым декодером, который понял формат).
+ */
+bool getImageInfo(const unsigned char* data, size_t size, ImageInfo& info);
+
+/**
+ * \brief Декодирует изображение в буфер вызывающего размером width * height * channels байт.
+ */
+bool decodeImage(const unsigned char* data, size_t size, int channels, unsigned char* pixels);
+
+/**
+ * \brief Читает файл через Vfs (см. vfs.h) и декодирует его в pixels.
+ * \return false, если файл не нашелся или не декодировался; сообщение не выводится
+ */
+bool loadImage(const char* path, int channels, std::vector<unsigned char>& pixels, ImageInfo& info);
+
+#endif // _IMAGE_DECODER_INCLUDED_H_
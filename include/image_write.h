@@ -0,0 +1,41 @@
+/*
+ * Запись изображений: PNG, PPM и кадры Y4M
+ *
+ * Функции принимают 8-битные пиксели с channels каналами (3 - RGB, 4 - RGBA, альфа
+ * отбрасывается) и флаг bottomUp: true, если первая строка в памяти - нижняя, как
+ * у glReadPixels. В файл строки всегда пишутся сверху вниз.
+ *
+ *   PNG - без сжатия (deflate из "stored"-блоков), поэтому не нужна zlib и запись стоит
+ *         столько же, сколько копирование памяти; файл размером с несжатый кадр;
+ *   PPM - двоичный P6. Несколько PPM подряд в одном файле читает, например,
+ *         ffmpeg -f image2pipe -c:v ppm -i stream.ppm;
+ *   Y4M - несжатое видео YUV 4:2:0 (BT.601, ограниченный диапазон), которое понимают
+ *         ffmpeg, x264 и mpv. Сначала пишется заголовок потока, затем кадры.
+ */
+
+#ifndef _IMAGE_WRITE_INCLUDED_H_
+#define _IMAGE_WRITE_INCLUDED_H_
+
+#include <cstdio>
+
+/**
+ * \brief Записывает PNG в файл path. \return false при ошибке
+ */
+bool writePNG(const char* path, const unsigned char* pixels, int width, int height, int channels, bool bottomUp);
+
+/**
+ * \brief Дописывает в открытый файл один кадр PPM. \return false при ошибке
+ */
+bool writePPM(FILE* file, const unsigned char* pixels, int width, int height, int channels, bool bottomUp);
+
+/**
+ * \brief Записывает заголовок потока Y4M с частотой fps кадров в секунду.
+ */
+bool writeY4MHeader(FILE* file, int width, int height, int fps);
+
+/**
+ * \brief Переводит кадр в YUV 4:2:0 и дописывает его в поток Y4M.
+ */
+bool writeY4MFrame(FILE* file, const unsigned char* pixels, int width, int height, int channels, bool bottomUp);
+
+#endif // _IMAGE_WRITE_INCLUDED_H_
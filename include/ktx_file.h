@@ -0,0 +1,111 @@
+/*
+ * Файлы текстур KTX 1.1 (.ktx)
+ *
+ * JPEG и PNG приходится при каждой загрузке распаковывать на процессоре, а потом драйвер еще
+ * строит mip-уровни. Текстура, подготовленная заранее утилитой tools/texture-cook, хранится
+ * в KTX уже сжатой (см. texture_compress.h) и со всеми mip-уровнями, и каждый уровень уходит
+ * в glCompressedTexImage2D как есть:
+ *
+ *   [KtxHeader][пары ключ-значение][imageSize, уровень 0][imageSize, уровень 1]...
+ *
+ * Заголовок хранит перечисления OpenGL напрямую (glInternalFormat и т.п.), поэтому выбран
+ * KTX 1, а не KTX 2 с форматами Vulkan. Поддерживаются только двумерные текстуры без
+ * массивов и граней куба в порядке байт little-endian; пары ключ-значение при чтении
+ * пропускаются. Данные уровней выровнены на 4 байта, как требует формат.
+ *
+ * Пример
+ *
+ *   KtxImage image;
+ *   if (readKtxFile(TEXTURE_PATH_PREFIX"/box.ktx", image))
+ *       ... image.levels[0].data ...
+ */
+
+#ifndef _KTX_FILE_INCLUDED_H_
+#define _KTX_FILE_INCLUDED_H_
+
+#include "glad/glad.h"
+
+#include <cstddef>
+#include <vector>
+
+#define KTX_ENDIANNESS          0x04030201u
+
+struct KtxHeader {
+    GLubyte     identifier[12];         // «KTX 11»\r\n\x1A\n
+    GLuint      endianness;
+    GLuint      glType;                 // 0 для сжатых форматов
+    GLuint      glTypeSize;
+    GLuint      glFormat;               // 0 для сжатых форматов
+    GLuint      glInternalFormat;
+    GLuint      glBaseInternalFormat;
+    GLuint      pixelWidth;
+    GLuint      pixelHeight;
+    GLuint      pixelDepth;
+    GLuint      numberOfArrayElements;
+    GLuint      numberOfFaces;
+    GLuint      numberOfMipmapLevels;
+    GLuint      bytesOfKeyValueData;
+};
+
+struct KtxLevel {
+    int                         width;
+    int                         height;
+    std::vector<unsigned char>  data;
+};
+
+/**
+ * \brief Текстура в памяти. Для несжатых форматов строки уровней выровнены на 4 байта
+ * (GL_UNPACK_ALIGNMENT по умолчанию).
+ */
+struct KtxImage {
+    GLenum                  internalFormat;
+    GLenum                  baseFormat;         // GL_RGB или GL_RGBA
+    GLenum                  format;             // 0 для сжатых форматов
+    GLenum                  type;               // 0 для сжатых форматов
+    std::vector<KtxLevel>   levels;
+
+    KtxImage()
+        : internalFormat(0), baseFormat(0), format(0), type(0) {}
+};
+
+struct KtxLevelView {
+    int                     width;
+    int                     height;
+    const unsigned char*    data;
+    size_t                  size;
+};
+
+/**
+ * \brief Текстура, которая разобрана прямо в памяти файла: уровни указывают в его данные.
+ */
+struct KtxView {
+    GLenum                      internalFormat;
+    GLenum                      baseFormat;
+    GLenum                      format;
+    GLenum                      type;
+    std::vector<KtxLevelView>   levels;
+
+    KtxView()
+        : internalFormat(0), baseFormat(0), format(0), type(0) {}
+};
+
+/**
+ * \brief Записывает текстуру в файл.
+ * \return false, если файл не удалось записать
+ */
+bool writeKtxFile(const char* path, const KtxImage& image);
+
+/**
+ * \brief Читает текстуру из файла.
+ * \return false, если файл не найден, поврежден или описывает неподдерживаемую текстуру
+ */
+bool readKtxFile(const char* path, KtxImage& image);
+
+/**
+ * \brief Разбирает файл KTX, уже загруженный или отображенный в память (например, из пакета,
+ * см. vfs.h), без копирования уровней. view действителен, пока жива память data.
+ * \return false, если файл поврежден или описывает неподдерживаемую текстуру
+ */
+bool parseKtx(const unsigned char* data, size_t size, KtxView& view);
+
+#endif // _KTX_FILE_INCLUDED_H_
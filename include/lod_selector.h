@@ -0,0 +1,81 @@
+/*
+ * Выбор уровня детализации во время отрисовки
+ *
+ * Ошибка уровня (MeshLod::error, см. include/mesh_simplify.h) задана в долях размера меша.
+ * Умножив ее на размер объекта в мире и поделив на расстояние до камеры, получаем, на сколько
+ * пикселей упрощенный меш отклонится от исходного на экране. Выбирается самый грубый уровень,
+ * у которого это отклонение не больше порога (обычно около пикселя).
+ *
+ * Чтобы объект на границе двух уровней не переключался туда-обратно каждый кадр, действует
+ * гистерезис: на более грубый уровень переходим, только когда его ошибка меньше порога
+ * с запасом, а на более подробный - когда ошибка текущего уровня превысит порог с запасом.
+ *
+ * Скачок при смене уровня можно сгладить: в течение fadeTime секунд рисуются оба уровня,
+ * и каждый отбрасывает свою часть пикселей по упорядоченному дизеринговому узору
+ * (шейдер 3.3.shader12.fs.glsl). Прозрачность и сортировка при этом не нужны.
+ */
+
+#ifndef _LOD_SELECTOR_INCLUDED_H_
+#define _LOD_SELECTOR_INCLUDED_H_
+
+#include "mesh_file.h"
+
+/**
+ * \brief Состояние выбора уровня для одного объекта
+ */
+struct LodState {
+    GLuint      lod;            // текущий уровень
+    GLuint      previousLod;    // уровень, который сейчас растворяется
+    GLfloat     fade;           // доля перехода к lod: 1 - переход закончен
+
+    LodState() : lod(0), previousLod(0), fade(1.0f) {}
+
+    bool isFading() const {
+        return fade < 1.0f;
+    }
+};
+
+class LodSelector {
+public:
+    /**
+     * \param pixelError  Допустимое отклонение на экране в пикселях
+     * \param hysteresis  Запас вокруг порога (0.25 - переключение при 0.75 и 1.25 порога)
+     * \param fadeTime    Длительность перехода между уровнями в секундах (0 - без перехода)
+     */
+    LodSelector(GLfloat pixelError = 1.0f, GLfloat hysteresis = 0.25f, GLfloat fadeTime = 0.0f);
+
+    /**
+     * \brief Параметры проекции: высота окна в пикселях и вертикальный угол обзора в радианах.
+     */
+    void setViewport(GLfloat height, GLfloat fovY);
+
+    void setFadeTime(GLfloat fadeTime) {
+        m_FadeTime = fadeTime;
+    }
+
+    GLfloat getFadeTime() const {
+        return m_FadeTime;
+    }
+
+    /**
+     * \brief Отклонение уровня с ошибкой error на экране в пикселях.
+     * \param size      Размер объекта в мире (диагональ габаритов с учетом масштаба)
+     * \param distance  Расстояние от камеры до объекта
+     */
+    GLfloat projectedError(GLfloat error, GLfloat size, GLfloat distance) const;
+
+    /**
+     * \brief Выбирает уровень для объекта и продвигает переход между уровнями.
+     * \return Новый текущий уровень (он же state.lod)
+     */
+    GLuint select(LodState& state, const MeshLod* lods, GLuint lodCount,
+                  GLfloat size, GLfloat distance, GLfloat deltaTime) const;
+
+private:
+    GLfloat m_PixelError;
+    GLfloat m_Hysteresis;
+    GLfloat m_FadeTime;
+    GLfloat m_PixelsPerUnit;    // пикселей на единицу длины на расстоянии 1
+};
+
+#endif // _LOD_SELECTOR_INCLUDED_H_
@@ -0,0 +1,157 @@
+/*
+ * Пакет разнородных мешей для косвенной отрисовки
+ *
+ * Инстансинг позволяет нарисовать много копий одного меша одним вызовом, но разные меши
+ * все равно требуют отдельных вызовов. MeshBatch складывает вершины и индексы всех мешей
+ * в общие буферы (одна пара VBO/EBO и один VAO на весь пакет), а каждый кадр собирает
+ * список команд DrawElementsIndirectCommand. Весь список рисуется:
+ *
+ *   - одним вызовом glMultiDrawElementsIndirect на GL 4.3+ (или GL_ARB_multi_draw_indirect),
+ *     команды при этом пишутся в буфер GL_DRAW_INDIRECT_BUFFER через StreamBuffer;
+ *   - циклом glDrawElementsInstancedBaseVertex на GL 3.3.
+ *
+ * Чтобы шейдер знал, какой объект он рисует, пакет может выдавать номер объекта через
+ * целочисленный атрибут экземпляра (enableObjectId). Номер равен baseInstance команды плюс
+ * номер экземпляра, поэтому по нему можно читать данные объекта, например матрицу модели
+ * из текстурного буфера (samplerBuffer).
+ *
+ * Пример
+ *
+ *   MeshBatch batch(5 * sizeof(GLfloat));
+ *   batch.setAttribute(0, 3, GL_FLOAT, GL_FALSE, 0);
+ *   batch.setAttribute(2, 2, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat));
+ *   batch.enableObjectId(3);
+ *   GLuint cube = batch.addMesh(vertices, 24, indices, 36);
+ *   batch.build();
+ *   ...
+ *   batch.begin();
+ *   batch.draw(cube, 10);
+ *   batch.submit();
+ */
+
+#ifndef _MESH_BATCH_INCLUDED_H_
+#define _MESH_BATCH_INCLUDED_H_
+
+#include "glad/glad.h"
+
+#include <vector>
+
+class StreamBuffer;
+
+/**
+ * \brief Формат команды совпадает с форматом, который ожидает glMultiDrawElementsIndirect.
+ */
+struct DrawElementsIndirectCommand {
+    GLuint  count;
+    GLuint  instanceCount;
+    GLuint  firstIndex;
+    GLint   baseVertex;
+    GLuint  baseInstance;
+};
+
+/**
+ * \brief Статистика последнего вызова MeshBatch::submit()
+ */
+struct MeshBatchStats {
+    GLuint  commands;       // команд в списке
+    GLuint  apiCalls;       // вызовов OpenGL, потраченных на отрисовку списка
+    bool    indirect;       // использовался glMultiDrawElementsIndirect
+};
+
+class MeshBatch {
+public:
+    /**
+     * \param vertexStride  Размер одной вершины в байтах (одинаков для всех мешей пакета)
+     * \param maxObjects    Максимальное число объектов (экземпляров) за кадр
+     */
+    MeshBatch(GLsizei vertexStride, GLuint maxObjects = 65536);
+    ~MeshBatch();
+
+    /**
+     * \brief Описывает вершинный атрибут. Вызывается до build().
+     */
+    void setAttribute(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei offset);
+
+    /**
+     * \brief Включает целочисленный атрибут с номером объекта. Вызывается до build().
+     */
+    void enableObjectId(GLuint index);
+
+    /**
+     * \brief Добавляет меш в пакет. Индексы задаются относительно вершин этого меша.
+     * \return Идентификатор меша для draw()
+     */
+    GLuint addMesh(const void* vertices, GLsizei vertexCount, const GLuint* indices, GLsizei indexCount);
+
+    /**
+     * \brief Загружает все меши в общие буферы и настраивает VAO.
+     */
+    void build();
+
+    /**
+     * \brief Начинает новый список команд.
+     */
+    void begin();
+
+    /**
+     * \brief Добавляет в список instanceCount экземпляров меша mesh.
+     * \return Номер первого объекта этой команды (его получит шейдер через атрибут объекта)
+     */
+    GLuint draw(GLuint mesh, GLuint instanceCount = 1);
+
+    /**
+     * \brief Рисует весь список. Программа и текстуры должны быть уже установлены.
+     */
+    void submit(GLenum mode = GL_TRIANGLES);
+
+    /**
+     * \brief Запрещает косвенную отрисовку даже если она поддерживается (для сравнения).
+     */
+    void setIndirectEnabled(bool enabled) {
+        m_bIndirectEnabled = enabled;
+    }
+
+    GLuint getVertexArray() const {
+        return m_Vao;
+    }
+
+    const MeshBatchStats& getStats() const {
+        return m_Stats;
+    }
+
+private:
+    MeshBatch(const MeshBatch&);
+    MeshBatch& operator=(const MeshBatch&);
+
+    struct Attribute {
+        GLuint      index;
+        GLint       size;
+        GLenum      type;
+        GLboolean   normalized;
+        GLsizei     offset;
+    };
+    struct Mesh {
+        GLuint      firstIndex;
+        GLuint      indexCount;
+        GLint       baseVertex;
+    };
+
+    GLsizei                                     m_Stride;
+    GLuint                                      m_MaxObjects;
+    std::vector<Attribute>                      m_Attributes;
+    GLint                                       m_ObjectIdIndex;
+    std::vector<unsigned char>                  m_Vertices;
+    std::vector<GLuint>                         m_Indices;
+    std::vector<Mesh>                           m_Meshes;
+    std::vector<DrawElementsIndirectCommand>    m_Commands;
+    GLuint                                      m_Objects;
+    GLuint                                      m_Vao;
+    GLuint                                      m_Vbo;
+    GLuint                                      m_Ebo;
+    GLuint                                      m_ObjectIdBuffer;
+    StreamBuffer*                               m_pIndirect;
+    bool                                        m_bIndirectEnabled;
+    MeshBatchStats                              m_Stats;
+}; // class MeshBatch
+
+#endif // _MESH_BATCH_INCLUDED_H_
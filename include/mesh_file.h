@@ -0,0 +1,179 @@
+/*
+ * Двоичный формат мешей (.mesh)
+ *
+ * Исходные форматы вроде OBJ и glTF удобны для обмена, но их приходится разбирать при каждой
+ * загрузке. Меш, подготовленный заранее утилитой tools/mesh-cooker, хранится в файле уже в том
+ * виде, в котором он уходит на GPU:
+ *
+ *   [MeshFileHeader][выравнивание][вершины][выравнивание][индексы]
+ *
+ * Заголовок фиксированного размера описывает формат вершин (атрибуты для glVertexAttribPointer),
+ * тип индексов, габариты меша и диапазоны индексов для уровней детализации (LOD). Блоки вершин
+ * и индексов выровнены по MESH_FILE_ALIGNMENT байт от начала файла.
+ *
+ * MeshFile отображает файл в память (mmap) и передает блоки в glBufferData прямо из отображения:
+ * ни разбора, ни промежуточных копий. Числа в файле записаны в порядке байт little-endian.
+ *
+ * Пример
+ *
+ *   MeshFile mesh;
+ *   if (mesh.open(MESH_PATH_PREFIX"/torus.mesh")) {
+ *       mesh.upload();
+ *       mesh.close();     // данные уже на GPU
+ *   }
+ *   ...
+ *   mesh.draw();
+ */
+
+#ifndef _MESH_FILE_INCLUDED_H_
+#define _MESH_FILE_INCLUDED_H_
+
+#include "glad/glad.h"
+
+#include <vector>
+#include <cstddef>
+
+#define MESH_FILE_MAGIC         0x4853454Du     // "MESH"
+#define MESH_FILE_VERSION       1
+#define MESH_FILE_ALIGNMENT     64
+#define MESH_MAX_ATTRIBUTES     8
+#define MESH_MAX_LODS           8
+
+/**
+ * \brief Вершинный атрибут (параметры glVertexAttribPointer)
+ */
+struct MeshAttribute {
+    GLuint      index;
+    GLint       size;
+    GLenum      type;
+    GLuint      normalized;
+    GLuint      offset;
+};
+
+/**
+ * \brief Уровень детализации: диапазон в общем буфере индексов
+ */
+struct MeshLod {
+    GLuint      firstIndex;
+    GLuint      indexCount;
+    GLfloat     error;          // относительная ошибка упрощения (0 - исходный меш)
+    GLuint      reserved;
+};
+
+struct MeshFileHeader {
+    GLuint          magic;
+    GLuint          version;
+    GLuint          vertexStride;
+    GLuint          vertexCount;
+    GLuint          indexCount;
+    GLenum          indexType;              // GL_UNSIGNED_SHORT или GL_UNSIGNED_INT
+    GLuint          attributeCount;
+    GLuint          lodCount;
+    GLfloat         boundsMin[3];
+    GLfloat         boundsMax[3];
+    GLuint64        vertexOffset;           // смещения блоков от начала файла
+    GLuint64        vertexSize;
+    GLuint64        indexOffset;
+    GLuint64        indexSize;
+    MeshAttribute   attributes[MESH_MAX_ATTRIBUTES];
+    MeshLod         lods[MESH_MAX_LODS];
+};
+
+/**
+ * \brief Меш в памяти: результат импорта и вход для writeMeshFile
+ */
+struct MeshData {
+    GLuint                      vertexStride;
+    std::vector<unsigned char>  vertices;
+    std::vector<GLuint>         indices;
+    std::vector<MeshAttribute>  attributes;
+    std::vector<MeshLod>        lods;       // пусто - один уровень на весь меш
+    GLfloat                     boundsMin[3];
+    GLfloat                     boundsMax[3];
+
+    MeshData();
+
+    size_t vertexCount() const {
+        return vertexStride ? vertices.size() / vertexStride : 0;
+    }
+
+    /**
+     * \brief Считает габариты по атрибуту 0 (позиция, три числа GLfloat).
+     */
+    void computeBounds();
+};
+
+/**
+ * \brief Записывает меш в файл. Индексы сохраняются 16-битными, если вершин не больше 65536.
+ * \return false, если файл не удалось записать
+ */
+bool writeMeshFile(const char* path, const MeshData& mesh);
+
+class MeshFile {
+public:
+    MeshFile();
+    ~MeshFile();
+
+    /**
+     * \brief Отображает файл в память и проверяет заголовок.
+     * \return false, если файл не найден или поврежден
+     */
+    bool open(const char* path);
+
+    /**
+     * \brief Снимает отображение файла. Загруженные на GPU буферы остаются.
+     */
+    void close();
+
+    bool isOpen() const {
+        return m_pData != nullptr;
+    }
+
+    const MeshFileHeader& header() const {
+        return m_Header;
+    }
+
+    const void* vertexData() const {
+        return m_pData + m_Header.vertexOffset;
+    }
+
+    const void* indexData() const {
+        return m_pData + m_Header.indexOffset;
+    }
+
+    size_t fileSize() const {
+        return m_Size;
+    }
+
+    /**
+     * \brief Создает VAO и буферы прямо из отображенного файла.
+     */
+    void upload();
+
+    /**
+     * \brief Рисует уровень детализации lod (программа и текстуры должны быть установлены).
+     */
+    void draw(GLuint lod = 0, GLsizei instanceCount = 1) const;
+
+    /**
+     * \brief Удаляет VAO и буферы.
+     */
+    void release();
+
+    GLuint getVertexArray() const {
+        return m_Vao;
+    }
+
+private:
+    MeshFile(const MeshFile&);
+    MeshFile& operator=(const MeshFile&);
+
+    MeshFileHeader          m_Header;
+    const unsigned char*    m_pData;
+    size_t                  m_Size;
+    GLuint                  m_Vao;
+    GLuint                  m_Vbo;
+    GLuint                  m_Ebo;
+}; // class MeshFile
+
+#endif // _MESH_FILE_INCLUDED_H_
@@ -0,0 +1,60 @@
+/*
+ * Импорт мешей из исходных форматов
+ *
+ * Поддерживаются:
+ *   - Wavefront OBJ: v, vt, vn и f (многоугольники разбиваются веером на треугольники,
+ *     отрицательные индексы отсчитываются от конца). Одинаковые тройки v/vt/vn сливаются
+ *     в одну вершину. Материалы, группы и прочие команды пропускаются.
+ *     Файл отображается в память и делится по концам строк на куски, которые разбираются
+ *     параллельно; затем вершины сливаются в общей хэш-таблице, поделенной между потоками.
+ *     Порядок вершин и индексов тот же, что при разборе в один поток.
+ *   - glTF 2.0 (.gltf с внешними .bin или data: URI, а также .glb): треугольные примитивы
+ *     всех мешей файла с атрибутами POSITION, NORMAL и TEXCOORD_0. Преобразования узлов
+ *     сцены не применяются, разреженные (sparse) аксессоры не поддерживаются.
+ *
+ * Результат всегда в одном формате (MESH_IMPORT_STRIDE байт на вершину):
+ *   атрибут 0 - позиция, три числа GLfloat;
+ *   атрибут 1 - нормаль, три числа GLfloat (где в файле нормали нет - у грани OBJ без vn или
+ *               примитива glTF без NORMAL, - она вычисляется, остальные берутся из файла);
+ *   атрибут 2 - текстурные координаты, два числа GLfloat (начало внизу, как в OBJ и OpenGL).
+ */
+
+#ifndef _MESH_IMPORT_INCLUDED_H_
+#define _MESH_IMPORT_INCLUDED_H_
+
+#include "mesh_file.h"
+
+#define MESH_IMPORT_STRIDE  (8 * sizeof(GLfloat))
+
+/**
+ * \brief Сведения о загрузке: размер исходного файла, время и число потоков
+ */
+struct MeshImportStats {
+    size_t      bytes;
+    double      seconds;
+    unsigned    threads;
+
+    MeshImportStats() : bytes(0), seconds(0.0), threads(0) {}
+    double megabytesPerSecond() const {
+        return seconds > 0.0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0;
+    }
+};
+
+/**
+ * \brief Загружает OBJ. \return false, если файл не найден или не разобран
+ * \param threads Число потоков, 0 - по числу ядер (на файлах меньше мегабайта на поток их будет меньше)
+ * \param stats Если не nullptr, сюда записываются сведения о загрузке
+ */
+bool importObj(const char* path, MeshData& mesh, unsigned threads = 0, MeshImportStats* stats = nullptr);
+
+/**
+ * \brief Загружает glTF или GLB. \return false, если файл не найден или не разобран
+ */
+bool importGltf(const char* path, MeshData& mesh);
+
+/**
+ * \brief Выбирает импортер по расширению файла (.obj, .gltf, .glb).
+ */
+bool importMesh(const char* path, MeshData& mesh, unsigned threads = 0, MeshImportStats* stats = nullptr);
+
+#endif // _MESH_IMPORT_INCLUDED_H_
@@ -0,0 +1,117 @@
+/*
+ * Обработка мешей перед загрузкой на GPU
+ *
+ * Порядок вершин и треугольников в меше сильно влияет на скорость отрисовки:
+ *
+ *   1. Сварка вершин (weldVertices). Одинаковые вершины хранятся один раз, а треугольники
+ *      ссылаются на них через индексы. Куб из models/model_cube.h занимает 36 вершин,
+ *      а уникальных среди них всего 16.
+ *   2. Кэш вершин (optimizeVertexCache). GPU запоминает результаты вершинного шейдера для
+ *      нескольких последних индексов. Если соседние треугольники используют общие вершины,
+ *      шейдер вызывается реже. Порядок треугольников строится алгоритмом Tipsify
+ *      (P. Sander, D. Nehab, J. Barczak. Fast Triangle Reordering for Vertex Locality
+ *      and Reduced Overdraw. 2007).
+ *   3. Перерисовка (optimizeOverdraw). Треугольники разбиваются на кластеры, и кластеры,
+ *      которые смотрят "наружу" меша, рисуются первыми - они чаще закрывают остальные,
+ *      и тест глубины отбрасывает больше фрагментов.
+ *   4. Выборка вершин (optimizeVertexFetch). Вершины переставляются в порядке первого
+ *      использования, чтобы чтение вершинного буфера шло последовательно.
+ *
+ * Качество порядка оценивается двумя числами:
+ *   ACMR - среднее число промахов кэша на треугольник (от 0.5 в идеале до 3.0);
+ *   ATVR - среднее число вызовов шейдера на уникальную вершину (1.0 в идеале).
+ *
+ * Все функции работают с индексами GLuint и вершинами произвольного формата с шагом stride,
+ * у которых позиция - три числа GLfloat по смещению positionOffset.
+ */
+
+#ifndef _MESH_OPTIMIZER_INCLUDED_H_
+#define _MESH_OPTIMIZER_INCLUDED_H_
+
+#include "glad/glad.h"
+
+#include <vector>
+#include <cstddef>
+
+// Размер моделируемого кэша вершин
+#define MESHOPT_CACHE_SIZE  16
+
+namespace meshopt {
+
+/**
+ * \brief Оценка порядка индексов для FIFO-кэша вершин
+ */
+struct CacheStats {
+    float acmr;
+    float atvr;
+};
+
+/**
+ * \brief Результат optimizeMesh: оценки до и после оптимизации
+ */
+struct OptimizeReport {
+    size_t      vertexCountBefore;
+    size_t      vertexCountAfter;
+    CacheStats  before;
+    CacheStats  after;
+};
+
+/**
+ * \brief Моделирует FIFO-кэш размера cacheSize и оценивает порядок индексов.
+ */
+CacheStats analyzeVertexCache(const GLuint* indices, size_t indexCount, size_t vertexCount,
+                              size_t cacheSize = MESHOPT_CACHE_SIZE);
+
+/**
+ * \brief Сваривает побайтно одинаковые вершины.
+ *
+ * \param vertices     Неиндексированные вершины (каждые три подряд - треугольник)
+ *                     или вершины, на которые ссылаются indices
+ * \param indices      Индексы исходного меша или nullptr для неиндексированного
+ * \param outVertices  Уникальные вершины
+ * \param outIndices   Новые индексы
+ * \return Количество уникальных вершин
+ */
+size_t weldVertices(const void* vertices, size_t vertexCount, size_t stride,
+                    const GLuint* indices, size_t indexCount,
+                    std::vector<unsigned char>& outVertices, std::vector<GLuint>& outIndices);
+
+/**
+ * \brief Переставляет треугольники для лучшего использования кэша вершин (Tipsify).
+ *
+ * \param clusters  Если не nullptr, сюда записываются номера первых треугольников
+ *                  "жестких" кластеров - мест, где кэш сбрасывается
+ */
+void optimizeVertexCache(GLuint* indices, size_t indexCount, size_t vertexCount,
+                         size_t cacheSize = MESHOPT_CACHE_SIZE, std::vector<size_t>* clusters = nullptr);
+
+/**
+ * \brief Переставляет кластеры треугольников, чтобы уменьшить перерисовку.
+ * Индексы должны быть уже обработаны optimizeVertexCache.
+ *
+ * \param threshold  Насколько можно ухудшить ACMR ради более мелких кластеров (например, 1.05)
+ */
+void optimizeOverdraw(GLuint* indices, size_t indexCount, const void* vertices, size_t vertexCount,
+                      size_t stride, size_t positionOffset = 0, float threshold = 1.05f,
+                      size_t cacheSize = MESHOPT_CACHE_SIZE);
+
+/**
+ * \brief Переставляет вершины в порядке первого использования и исправляет индексы.
+ * \return Количество используемых вершин (неиспользуемые отбрасываются)
+ */
+size_t optimizeVertexFetch(void* vertices, size_t vertexCount, size_t stride,
+                           GLuint* indices, size_t indexCount);
+
+/**
+ * \brief Полная обработка: сварка, кэш, перерисовка и выборка.
+ *
+ * \param vertices  На входе исходные вершины, на выходе - оптимизированные
+ * \param indices   На входе индексы (может быть пустым для неиндексированного меша),
+ *                  на выходе - оптимизированные
+ */
+OptimizeReport optimizeMesh(std::vector<unsigned char>& vertices, size_t stride,
+                            std::vector<GLuint>& indices, size_t positionOffset = 0);
+
+} // namespace meshopt
+
+#endif // _MESH_OPTIMIZER_INCLUDED_H_
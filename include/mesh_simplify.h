@@ -0,0 +1,61 @@
+/*
+ * Упрощение мешей и цепочки уровней детализации (LOD)
+ *
+ * Далекий объект занимает на экране несколько десятков пикселей, а рисуется всеми своими
+ * треугольниками. Уровни детализации - это упрощенные копии меша, которые рисуются вместо
+ * исходного, когда разница не видна.
+ *
+ * Упрощение - последовательное стягивание ребер с метрикой квадрик (M. Garland, P. Heckbert.
+ * Surface Simplification Using Quadric Error Metrics. 1997). Каждой вершине сопоставляется
+ * сумма квадратов расстояний до плоскостей ее треугольников; стягивание ребра a -> b стоит
+ * столько, сколько эта сумма в точке b. Дешевые ребра стягиваются первыми.
+ *
+ * Вершина a всегда переезжает в уже существующую вершину b, поэтому все уровни пользуются
+ * одним буфером вершин и отличаются только индексами. В файле .mesh это диапазоны MeshLod
+ * в общем буфере индексов.
+ *
+ * Вершины на границе меша и на швах (одна позиция, но разные нормали или текстурные
+ * координаты) не двигаются: иначе в меше появились бы дыры или поплыла бы развертка.
+ * Поэтому меш с "плоскими" нормалями (все вершины - швы) упростить не получится.
+ */
+
+#ifndef _MESH_SIMPLIFY_INCLUDED_H_
+#define _MESH_SIMPLIFY_INCLUDED_H_
+
+#include "mesh_file.h"
+
+#include <vector>
+#include <cstddef>
+
+namespace meshopt {
+
+/**
+ * \brief Упрощает меш до targetIndexCount индексов или до ошибки targetError.
+ *
+ * \param indices      Индексы исходного меша (треугольники)
+ * \param vertices     Вершины с шагом stride, позиция - три числа GLfloat по смещению positionOffset
+ * \param targetError  Допустимое отклонение поверхности в долях диагонали габаритов меша
+ * \param out          Индексы упрощенного меша (ссылаются на те же вершины)
+ * \param resultError  Если не nullptr, сюда записывается достигнутая ошибка (в тех же долях)
+ * \return Количество индексов в out
+ */
+size_t simplifyMesh(const GLuint* indices, size_t indexCount, const void* vertices, size_t vertexCount,
+                    size_t stride, size_t targetIndexCount, float targetError, std::vector<GLuint>& out,
+                    float* resultError = nullptr, size_t positionOffset = 0);
+
+/**
+ * \brief Строит цепочку LOD для меша из mesh_import.h или с атрибутом 0 - позицией float3.
+ *
+ * Уровень 0 - исходные индексы, каждый следующий получается из предыдущего и содержит
+ * примерно ratio его треугольников. Цепочка обрывается, когда упростить не удается или
+ * ошибка превышает maxError. Индексы всех уровней записываются подряд в mesh.indices,
+ * диапазоны и ошибки - в mesh.lods. Порядок треугольников каждого уровня оптимизируется
+ * для кэша вершин.
+ *
+ * \return Количество уровней (не больше MESH_MAX_LODS)
+ */
+size_t generateLods(MeshData& mesh, size_t maxLods = MESH_MAX_LODS, float ratio = 0.5f, float maxError = 0.05f);
+
+} // namespace meshopt
+
+#endif // _MESH_SIMPLIFY_INCLUDED_H_
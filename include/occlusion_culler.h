@@ -0,0 +1,145 @@
+/*
+ * Программное отсечение невидимых объектов (occlusion culling) на CPU
+ *
+ * Отсечение по пирамиде видимости выбрасывает объекты за краями экрана, но кубы, спрятанные
+ * за стеной, все равно рисуются. OcclusionCuller рисует на CPU несколько простых заслоняющих
+ * мешей (стены, крупные здания) в маленький буфер глубины, а затем проверяет по нему
+ * ограничивающие параллелепипеды (AABB) остальных объектов. Объект, все пиксели прямоугольника
+ * которого закрыты заслонителями ближе его самой близкой точки, не рисуется.
+ *
+ * Устройство:
+ *   - буфер глубины небольшой (по умолчанию 256 x 128), глубина - z/w из [0, 1], 1 - дальше всего;
+ *   - экран делится на плитки 8 x 4 пикселя, для каждой хранится самая дальняя глубина в ней.
+ *     Проверка объекта сначала смотрит на плитки и спускается к пикселям, только если плитка
+ *     закрыта не целиком (иерархический буфер глубины);
+ *   - треугольники рисуются полосами по 8 пикселей: три функции ребер и глубина считаются
+ *     сразу для восьми пикселей инструкциями AVX2, маска покрытия выбирает, какие из них
+ *     записать (если процессор не знает AVX2, работает обычный цикл);
+ *   - экран делится на горизонтальные полосы плиток, каждую полосу рисует свой поток пула,
+ *     поэтому блокировки не нужны.
+ *
+ * Модуль не использует OpenGL и работает без окна (см. tools/occlusion-bench).
+ *
+ * Ограничения: заслонители рисуются по центрам пикселей, поэтому на краях стены в редких
+ * случаях может пропасть объект, видимый в щель шириной меньше пикселя грубого буфера.
+ *
+ * Пример
+ *
+ *   OcclusionCuller culler;
+ *   culler.beginFrame(projection * view);
+ *   culler.addOccluder(wallVertices, 5 * sizeof(GLfloat), wallIndices, 36, wallModel);
+ *   culler.rasterize();
+ *   if (culler.isVisible(boxMin, boxMax))
+ *       ... рисовать ...
+ */
+
+#ifndef _OCCLUSION_CULLER_INCLUDED_H_
+#define _OCCLUSION_CULLER_INCLUDED_H_
+
+#include "glad/glad.h"
+#include "thread_pool.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#define OCCLUSION_TILE_WIDTH    8
+#define OCCLUSION_TILE_HEIGHT   4
+
+/**
+ * \brief Статистика за кадр
+ */
+struct OcclusionStats {
+    size_t  occluderTriangles;      // после отсечения задних граней, ближней плоскости и краев экрана
+    size_t  tested;                 // проверено AABB
+    size_t  culled;                 // из них невидимы
+    double  rasterizeMs;
+    double  testMs;
+};
+
+class OcclusionCuller {
+public:
+    /**
+     * \param width, height  Размер буфера глубины (округляется вверх до размера плитки)
+     * \param threads        Потоки для рисования, 0 - по числу ядер
+     */
+    OcclusionCuller(int width = 256, int height = 128, unsigned threads = 0);
+
+    /**
+     * \brief Начинает кадр: очищает заслонители и запоминает матрицу projection * view.
+     */
+    void beginFrame(const glm::mat4& viewProjection);
+
+    /**
+     * \brief Добавляет заслоняющий меш. Позиция - три числа GLfloat в начале каждой вершины.
+     * \param backfaceCulling  Отбрасывать треугольники, повернутые к камере задней стороной
+     *                         (по часовой стрелке). Только для мешей с согласованным обходом:
+     *                         у куба из models/model_cube.h, например, он не согласован.
+     */
+    void addOccluder(const GLfloat* vertices, size_t stride, const GLuint* indices, size_t indexCount,
+                     const glm::mat4& model, bool backfaceCulling = false);
+
+    /**
+     * \brief Рисует все заслонители в буфер глубины и строит глубины плиток.
+     */
+    void rasterize();
+
+    /**
+     * \brief Проверяет AABB в мировых координатах. Объекты за краями экрана и за дальней
+     * плоскостью тоже считаются невидимыми. Можно вызывать из нескольких потоков.
+     */
+    bool isVisible(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const;
+
+    /**
+     * \brief Проверяет count AABB (min и max подряд, 6 чисел на объект) в потоках пула.
+     * \param visible  Сюда записывается 1 для видимых и 0 для невидимых
+     */
+    void testBoxes(const GLfloat* bounds, size_t count, unsigned char* visible);
+
+    const OcclusionStats& getStats() const {
+        return m_Stats;
+    }
+
+    int getWidth() const {
+        return m_Width;
+    }
+
+    int getHeight() const {
+        return m_Height;
+    }
+
+    const GLfloat* getDepth() const {
+        return m_Depth.data();
+    }
+
+    /**
+     * \brief true, если для рисования используется AVX2.
+     */
+    static bool hasAvx2();
+
+    /**
+     * \brief Внутреннее представление треугольника (экранные координаты и уравнения).
+     */
+    struct Triangle {
+        GLfloat edge[3][3];     // A, B, C: A * x + B * y + C >= 0 внутри
+        GLfloat depth[3];       // z = depth[0] * x + depth[1] * y + depth[2]
+        int     minX, minY, maxX, maxY;
+    };
+
+private:
+    void setupTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c, bool backfaceCulling);
+    void rasterizeBand(size_t band);
+    size_t testRange(const GLfloat* bounds, size_t first, size_t last, unsigned char* visible) const;
+
+    int                     m_Width;
+    int                     m_Height;
+    int                     m_TilesX;
+    int                     m_TilesY;
+    glm::mat4               m_ViewProjection;
+    std::vector<GLfloat>    m_Depth;
+    std::vector<GLfloat>    m_TileMax;
+    std::vector<Triangle>   m_Triangles;
+    ThreadPool              m_Pool;
+    OcclusionStats          m_Stats;
+};
+
+#endif // _OCCLUSION_CULLER_INCLUDED_H_
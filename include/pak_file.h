@@ -0,0 +1,128 @@
+/*
+ * Пакет ресурсов (.pak)
+ *
+ * Примеры читают шейдеры и текстуры россыпью по относительным путям ("../shaders/...",
+ * "../textures/..."): на каждый ресурс свой open, а путь считается от текущего каталога.
+ * Пакет, собранный утилитой tools/pak-builder, хранит все файлы в одном файле:
+ *
+ *   [PakFileHeader][PakEntry x entryCount][имена][выравнивание][файл 0][выравнивание][файл 1]...
+ *
+ * Оглавление (PakEntry) отсортировано по именам, поэтому файл ищется двоичным поиском. Имена -
+ * логические пути вида "textures/box.jpg" (см. Vfs::logicalName) в кодировке UTF-8 с
+ * завершающим нулем. Данные каждого файла выровнены по PAK_FILE_ALIGNMENT байт от начала
+ * пакета, так что .mesh и .ktx внутри пакета сохраняют свое выравнивание. Числа записаны в
+ * порядке байт little-endian.
+ *
+ * PakFile отображает пакет в память (mmap) целиком; find возвращает указатель прямо в
+ * отображение, который действителен до close. Обычно пакеты подключаются через Vfs
+ * (см. vfs.h), а не напрямую.
+ *
+ * Пример
+ *
+ *   std::vector<PakInput> inputs;
+ *   inputs.push_back(PakInput("shaders/3.3.shader09.vs.glsl", "../shaders/3.3.shader09.vs.glsl"));
+ *   writePakFile("assets.pak", inputs);
+ *   ...
+ *   PakFile pak;
+ *   const unsigned char* data;
+ *   size_t size;
+ *   if (pak.open("assets.pak") && pak.find("shaders/3.3.shader09.vs.glsl", data, size))
+ *       ...
+ */
+
+#ifndef _PAK_FILE_INCLUDED_H_
+#define _PAK_FILE_INCLUDED_H_
+
+#include "glad/glad.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#define PAK_FILE_MAGIC          0x4B415041u     // "APAK"
+#define PAK_FILE_VERSION        1
+#define PAK_FILE_ALIGNMENT      64
+
+struct PakFileHeader {
+    GLuint      magic;
+    GLuint      version;
+    GLuint      entryCount;
+    GLuint      namesSize;          // байт в таблице имен, включая завершающие нули
+};
+
+struct PakEntry {
+    GLuint64    offset;             // от начала пакета, кратно PAK_FILE_ALIGNMENT
+    GLuint64    size;
+    GLuint      nameOffset;         // в таблице имен
+    GLuint      nameLength;         // без завершающего нуля
+    GLuint64    reserved;
+};
+
+/**
+ * \brief Файл для записи в пакет: логическое имя и путь на диске.
+ */
+struct PakInput {
+    std::string name;
+    std::string path;
+
+    PakInput(const std::string& name, const std::string& path)
+        : name(name), path(path) {}
+};
+
+/**
+ * \brief Записывает пакет из файлов inputs. Имена должны быть разными.
+ * \return false, если какой-то файл не прочитался или пакет не удалось записать
+ */
+bool writePakFile(const char* path, const std::vector<PakInput>& inputs);
+
+class PakFile {
+public:
+    PakFile();
+    ~PakFile();
+
+    /**
+     * \brief Отображает пакет в память и проверяет оглавление.
+     * \return false, если файла нет или он поврежден
+     */
+    bool open(const char* path);
+
+    /**
+     * \brief Снимает отображение; указатели, полученные от find, становятся недействительны.
+     */
+    void close();
+
+    /**
+     * \brief Ищет файл по логическому имени.
+     * \return false, если такого файла в пакете нет
+     */
+    bool find(const char* name, const unsigned char*& data, size_t& size) const;
+
+    GLuint getEntryCount() const {
+        return m_pHeader ? m_pHeader->entryCount : 0;
+    }
+
+    const PakEntry& getEntry(GLuint index) const {
+        return m_pEntries[index];
+    }
+
+    const char* getName(GLuint index) const {
+        return m_pNames + m_pEntries[index].nameOffset;
+    }
+
+    const std::string& getPath() const {
+        return m_Path;
+    }
+
+private:
+    PakFile(const PakFile&);
+    PakFile& operator=(const PakFile&);
+
+    const unsigned char*    m_pData;
+    size_t                  m_Size;
+    const PakFileHeader*    m_pHeader;
+    const PakEntry*         m_pEntries;
+    const char*             m_pNames;
+    std::string             m_Path;
+}; // class PakFile
+
+#endif // _PAK_FILE_INCLUDED_H_
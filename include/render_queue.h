@@ -0,0 +1,179 @@
+/*
+ * Очередь отрисовки с сортировкой по 64-битному ключу
+ *
+ * Вместо того чтобы в gRender вызывать glUseProgram, glBindTexture и glBindVertexArray
+ * в том порядке, в котором написан код, приложение складывает в очередь "пакеты отрисовки"
+ * (DrawPacket). Каждый пакет кодируется в 64-битный ключ, ключи сортируются поразрядно
+ * (radix sort), после чего очередь выполняет отрисовку, переключая программы, текстуры
+ * и VAO только тогда, когда они действительно меняются.
+ *
+ * Раскладка ключа (от старших битов к младшим):
+ *
+ *   [63..60] слой (layer)      - явный порядок проходов: фон, сцена, интерфейс и т.п.
+ *   [59]     прозрачность      - прозрачные объекты рисуются после непрозрачных
+ *   непрозрачные: [58..48] программа, [47..36] набор текстур, [35..24] VAO, [23..0] глубина
+ *   прозрачные:   [58..35] глубина (в обратном порядке), [34..24] программа, [23..12] текстуры, [11..0] VAO
+ *
+ * Непрозрачные объекты группируются по состоянию, а внутри одного состояния рисуются
+ * от ближних к дальним (раннее отсечение по глубине). Прозрачные объекты рисуются строго
+ * от дальних к ближним.
+ *
+ * Пример
+ *
+ *   RenderQueue queue;
+ *   ...
+ *   queue.begin(0.1f, 100.0f);
+ *   DrawPacket packet;
+ *   packet.program = m_Shaders->ID;
+ *   packet.vao = VAO;
+ *   packet.textures[0] = texture_box;
+ *   packet.count = 36;
+ *   packet.depth = distance;
+ *   UniformValue model = UniformValue::mat4(modelLocation, glm::value_ptr(modelMatrix));
+ *   queue.submit(packet, &model, 1);
+ *   ...
+ *   queue.flush();
+ */
+
+#ifndef _RENDER_QUEUE_INCLUDED_H_
+#define _RENDER_QUEUE_INCLUDED_H_
+
+#include "glad/glad.h"
+
+#include <map>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Количество текстурных блоков, которые может занять один пакет
+#define RQ_MAX_TEXTURE_UNITS  4
+
+/**
+ * \brief Значение uniform-переменной, которое нужно установить перед отрисовкой пакета.
+ */
+struct UniformValue {
+    enum Type {
+        INT1,
+        FLOAT1,
+        FLOAT3,
+        FLOAT4,
+        MAT4
+    };
+    GLint   location;
+    Type    type;
+    union {
+        GLint   i;
+        GLfloat f[16];
+    } value;
+
+    static UniformValue int1(GLint location, GLint v);
+    static UniformValue float1(GLint location, GLfloat v);
+    static UniformValue float3(GLint location, const GLfloat* v);
+    static UniformValue float4(GLint location, const GLfloat* v);
+    static UniformValue mat4(GLint location, const GLfloat* m);
+};
+
+/**
+ * \brief Описание одного вызова отрисовки.
+ *
+ * Если indexType равен 0, то выполняется glDrawArrays(mode, first, count),
+ * иначе glDrawElements(mode, count, indexType, indices).
+ */
+struct DrawPacket {
+    GLuint          program;
+    GLuint          vao;
+    GLuint          textures[RQ_MAX_TEXTURE_UNITS];    // 0 - блок не используется
+    GLenum          textureTargets[RQ_MAX_TEXTURE_UNITS];  // GL_TEXTURE_2D (по умолчанию) или GL_TEXTURE_2D_ARRAY
+    GLenum          mode;
+    GLint           first;
+    GLsizei         count;
+    GLenum          indexType;
+    const GLvoid*   indices;
+    GLfloat         depth;          // расстояние от камеры в пространстве вида
+    GLuint          layer;          // 0..15
+    bool            translucent;
+
+    DrawPacket();
+};
+
+/**
+ * \brief Статистика последнего вызова RenderQueue::flush()
+ */
+struct RenderQueueStats {
+    GLuint draws;
+    GLuint programSwitches;
+    GLuint textureSwitches;
+    GLuint vaoSwitches;
+};
+
+class RenderQueue {
+public:
+    RenderQueue();
+
+    /**
+     * \brief Начинает новый кадр: очищает очередь.
+     *
+     * \param zNear  Ближняя граница, используемая для квантования глубины
+     * \param zFar   Дальняя граница, используемая для квантования глубины
+     */
+    void begin(GLfloat zNear, GLfloat zFar);
+
+    /**
+     * \brief Добавляет пакет в очередь. Значения uniform-переменных копируются,
+     * поэтому массив uniforms может быть временным.
+     */
+    void submit(const DrawPacket& packet, const UniformValue* uniforms = nullptr, GLuint uniformCount = 0);
+
+    /**
+     * \brief Сортирует очередь и выполняет все накопленные вызовы отрисовки.
+     */
+    void flush();
+
+    /**
+     * \brief Количество пакетов в очереди.
+     */
+    size_t size() const {
+        return m_Packets.size();
+    }
+
+    const RenderQueueStats& getStats() const {
+        return m_Stats;
+    }
+
+    /**
+     * \brief Кодирует пакет в ключ сортировки. Открыт для отладки и тестов.
+     */
+    uint64_t makeKey(const DrawPacket& packet);
+
+private:
+    struct Entry {
+        uint64_t key;
+        uint32_t index;
+    };
+    struct Record {
+        DrawPacket  packet;
+        uint32_t    firstUniform;
+        uint32_t    uniformCount;
+    };
+    typedef std::vector<GLuint> TextureSet;
+
+    uint32_t programIndex(GLuint program);
+    uint32_t vaoIndex(GLuint vao);
+    uint32_t textureSetIndex(const GLuint* textures);
+    uint32_t quantizeDepth(GLfloat depth) const;
+    void radixSort();
+    void applyUniform(const UniformValue& u) const;
+
+    GLfloat                         m_zNear;
+    GLfloat                         m_zFar;
+    std::vector<Record>             m_Packets;
+    std::vector<UniformValue>       m_Uniforms;
+    std::vector<Entry>              m_Entries;
+    std::vector<Entry>              m_Scratch;
+    std::map<GLuint, uint32_t>      m_Programs;
+    std::map<GLuint, uint32_t>      m_Vaos;
+    std::map<TextureSet, uint32_t>  m_TextureSets;
+    RenderQueueStats                m_Stats;
+}; // class RenderQueue
+
+#endif // _RENDER_QUEUE_INCLUDED_H_
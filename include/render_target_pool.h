@@ -0,0 +1,167 @@
+/*
+ * Пул буферов кадра (render targets) для промежуточных проходов
+ *
+ * Каждый проход, который рисует не в окно (постобработка, тени, уменьшенное разрешение),
+ * нуждается в буфере кадра с текстурами. Если каждый проход заводит свои, память видеокарты
+ * тратится на буферы, которые живут всего один проход, а при изменении размера окна все они
+ * пересоздаются на каждом шаге перетаскивания рамки.
+ *
+ * RenderTargetPool выдает буферы по описанию (формат, размер, число сэмплов) на время кадра:
+ *   - gAcquire находит свободный буфер с таким же описанием или создает новый;
+ *   - release возвращает буфер в пул, и следующий проход того же кадра может получить его же.
+ *     GPU выполняет команды по порядку, поэтому повторное использование внутри кадра безопасно;
+ *   - gEndFrame возвращает в пул все, что осталось выданным, и удаляет буферы, которые не
+ *     понадобились RENDER_TARGET_MAX_IDLE кадров подряд.
+ *
+ * Размер окна пул применяет с задержкой: gResize только запоминает новый размер, а getWidth()
+ * и getHeight() меняются, когда размер не менялся RENDER_TARGET_RESIZE_DELAY мс. Пока рамку
+ * тянут, проходы рисуют в буферы старого размера, а результат растягивается на окно.
+ *
+ * Цвет и глубина - текстуры (GL_TEXTURE_2D или GL_TEXTURE_2D_MULTISAMPLE), поэтому следующий
+ * проход может читать любую из них. Объем памяти считается по размерам и форматам; наибольший
+ * объем за время работы - в getStats().peakBytes.
+ *
+ * Пример
+ *
+ *   RenderTargetPool targets;
+ *   targets.gResize(width, height);                // из gResize приложения
+ *   ...
+ *   targets.gBeginFrame();
+ *   RenderTargetDesc desc = { targets.getWidth(), targets.getHeight(), GL_RGBA16F, GL_DEPTH24_STENCIL8, 1 };
+ *   const RenderTarget* scene = targets.gAcquire(desc);
+ *   GLState::current().bindFramebuffer(GL_FRAMEBUFFER, scene->framebuffer);
+ *   ...
+ *   targets.release(scene);
+ *   targets.gEndFrame();
+ */
+
+#ifndef _RENDER_TARGET_POOL_INCLUDED_H_
+#define _RENDER_TARGET_POOL_INCLUDED_H_
+
+#include "glad/glad.h"
+
+#include <chrono>
+#include <list>
+
+#define RENDER_TARGET_MAX_IDLE          8       // кадров без использования до удаления буфера
+#define RENDER_TARGET_RESIZE_DELAY      200     // мс без изменений размера окна до его применения
+
+/**
+ * \brief Описание буфера кадра. Нулевой формат - без этого вложения.
+ */
+struct RenderTargetDesc {
+    int     width;
+    int     height;
+    GLenum  colorFormat;        // внутренний формат цвета: GL_RGBA8, GL_RGBA16F, ...
+    GLenum  depthFormat;        // GL_DEPTH24_STENCIL8, GL_DEPTH_COMPONENT32F, ...
+    int     samples;            // 1 - без мультисэмплинга
+
+    bool operator==(const RenderTargetDesc& other) const {
+        return width == other.width && height == other.height && colorFormat == other.colorFormat &&
+               depthFormat == other.depthFormat && samples == other.samples;
+    }
+};
+
+struct RenderTarget {
+    RenderTargetDesc    desc;
+    GLuint              framebuffer;
+    GLuint              color;      // текстура цвета или 0
+    GLuint              depth;      // текстура глубины или 0
+    GLenum              target;     // GL_TEXTURE_2D или GL_TEXTURE_2D_MULTISAMPLE
+};
+
+struct RenderTargetPoolStats {
+    size_t  targets;            // буферов в пуле сейчас
+    size_t  inUse;              // из них выдано
+    size_t  allocations;        // буферов создано за все время
+    size_t  reuses;             // gAcquire, обошедшихся без создания
+    size_t  bytes;              // память под текстуры сейчас
+    size_t  peakBytes;          // наибольшее значение bytes
+};
+
+class RenderTargetPool {
+public:
+    RenderTargetPool();
+
+    /**
+     * \brief Буферы OpenGL удаляются только в gFinalize().
+     */
+    ~RenderTargetPool() {}
+
+    /**
+     * \brief Запоминает новый размер окна. Первый размер применяется сразу, следующие -
+     * после RENDER_TARGET_RESIZE_DELAY мс без изменений.
+     */
+    void gResize(int width, int height);
+
+    /**
+     * \brief Начинает кадр: применяет отложенный размер окна, если он устоялся.
+     * \return true, если размер изменился
+     */
+    bool gBeginFrame();
+
+    /**
+     * \brief Выдает буфер по описанию desc до release() или до конца кадра.
+     */
+    const RenderTarget* gAcquire(const RenderTargetDesc& desc);
+
+    /**
+     * \brief Возвращает буфер в пул. Содержимое сохраняется до следующего gAcquire.
+     */
+    void release(const RenderTarget* target);
+
+    /**
+     * \brief Заканчивает кадр: возвращает все выданные буферы и удаляет давно не нужные.
+     */
+    void gEndFrame();
+
+    /**
+     * \brief Удаляет все буферы. Вызывается из gFinalize приложения.
+     */
+    void gFinalize();
+
+    /**
+     * \brief Примененный размер окна, под который проходы выбирают размеры буферов.
+     */
+    int getWidth() const {
+        return m_Width;
+    }
+
+    int getHeight() const {
+        return m_Height;
+    }
+
+    const RenderTargetPoolStats& getStats() const {
+        return m_Stats;
+    }
+
+    /**
+     * \brief Сколько байт занимает буфер с описанием desc.
+     */
+    static size_t getSize(const RenderTargetDesc& desc);
+
+private:
+    RenderTargetPool(const RenderTargetPool&);
+    RenderTargetPool& operator=(const RenderTargetPool&);
+
+    struct Entry {
+        RenderTarget    target;
+        size_t          bytes;
+        size_t          lastFrame;      // последний кадр, в котором буфер выдавался
+        bool            inUse;
+    };
+
+    void gCreate(Entry& entry);
+    void gDestroy(Entry& entry);
+
+    std::list<Entry>                        m_Entries;      // адреса элементов списка не меняются
+    size_t                                  m_Frame;
+    int                                     m_Width;
+    int                                     m_Height;
+    int                                     m_PendingWidth;
+    int                                     m_PendingHeight;
+    std::chrono::steady_clock::time_point   m_PendingSince;
+    RenderTargetPoolStats                   m_Stats;
+};
+
+#endif // _RENDER_TARGET_POOL_INCLUDED_H_
@@ -10,6 +10,8 @@
 #define SHADER_H_INCLUDED
 
 #include <glad/glad.h>
+#include "gl_state.h"
+#include "vfs.h"
 #include <glm/glm.hpp>
 
 #include <string>
@@ -33,69 +35,42 @@ public:
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
     {
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-            // if geometry shader path is present, also load a geometry shader
-            if(geometryPath != nullptr)
-            {
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
-        }
-        catch (std::ifstream::failure e)
+        // 1. retrieve the vertex/fragment source code through the VFS (see vfs.h): from a pak
+        // the source is passed to glShaderSource straight from the mapping, without copies
+        VfsFile vShaderFile;
+        VfsFile fShaderFile;
+        VfsFile gShaderFile;
+        if (!Vfs::current().read(vertexPath, vShaderFile) || !Vfs::current().read(fragmentPath, fShaderFile)
+            || (geometryPath != nullptr && !Vfs::current().read(geometryPath, gShaderFile)))
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
+        const char* vShaderCode = vShaderFile.size() ? (const char*)vShaderFile.data() : "";
+        const char * fShaderCode = fShaderFile.size() ? (const char*)fShaderFile.data() : "";
+        GLint vShaderLength = (GLint)vShaderFile.size();
+        GLint fShaderLength = (GLint)fShaderFile.size();
         // 2. compile shaders
         unsigned int vertex, fragment;
         int success;
         char infoLog[512];
         // vertex shader
         vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        glShaderSource(vertex, 1, &vShaderCode, &vShaderLength);
         glCompileShader(vertex);
         checkCompileErrors(vertex, "VERTEX");
         // fragment Shader
         fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
+        glShaderSource(fragment, 1, &fShaderCode, &fShaderLength);
         glCompileShader(fragment);
         checkCompileErrors(fragment, "FRAGMENT");
         // if geometry shader is given, compile geometry shader
         unsigned int geometry;
         if(geometryPath != nullptr)
         {
-            const char * gShaderCode = geometryCode.c_str();
+            const char * gShaderCode = gShaderFile.size() ? (const char*)gShaderFile.data() : "";
+            GLint gShaderLength = (GLint)gShaderFile.size();
             geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
+            glShaderSource(geometry, 1, &gShaderCode, &gShaderLength);
             glCompileShader(geometry);
             checkCompileErrors(geometry, "GEOMETRY");
         }
@@ -120,7 +95,7 @@ public:
     // ------------------------------------------------------------------------
     void use() 
     { 
-        glUseProgram(ID); 
+        GLState::current().useProgram(ID); 
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
@@ -0,0 +1,176 @@
+/*
+ * Программный растеризатор: отрисовка сцен примеров без GPU
+ *
+ * Скорость примеров зависит от того, какая реализация OpenGL установлена, а на машинах сборки
+ * видеокарты нет вовсе. SoftRasterizer выполняет на CPU то же, что пара шейдеров
+ * 3.3.shader09.vs.glsl / 3.3.shader05.fs.glsl с включенным GL_DEPTH_TEST:
+ *
+ *   gl_Position = projection * view * model * vec4(position, 1.0);
+ *   TexCoord = vec2(texCoord.x, 1.0 - texCoord.y);
+ *   FragColor = texture(ourTexture, TexCoord);
+ *
+ * Результат детерминирован: при любом числе потоков и с AVX2 или без него получается один
+ * и тот же кадр, поэтому его можно сравнивать побайтно и использовать как эталон для
+ * сравнения времени и изображения с путем через OpenGL.
+ *
+ * Устройство:
+ *   - drawElements только обрабатывает вершины (преобразование, отсечение ближней плоскостью,
+ *     переход к экранным координатам) и раскладывает треугольники по корзинам плиток 64 x 64;
+ *   - flush() рисует плитки в потоках пула, каждую плитку целиком один поток. Треугольники
+ *     в корзине лежат в порядке отправки, поэтому порядок рисования такой же, как в GL;
+ *   - внутри плитки функции ребер, глубина и 1/w считаются сразу для восьми пикселей (AVX2,
+ *     если процессор его знает), а текстура выбирается для каждого прошедшего теста пикселя.
+ *
+ * Правила как в OpenGL: центры пикселей в (x + 0.5, y + 0.5), правило "верхнего левого ребра"
+ * для пикселей на общей границе треугольников, перспективно-корректная интерполяция текстурных
+ * координат, тест глубины GL_LESS, обе стороны треугольников рисуются (GL_CULL_FACE выключен).
+ * Текстура фильтруется билинейно с повтором (GL_LINEAR, GL_REPEAT) без мип-уровней, поэтому
+ * на сильно уменьшенных текстурах кадр отличается от GL_LINEAR_MIPMAP_LINEAR.
+ *
+ * Строки буфера цвета идут снизу вверх, как у glReadPixels.
+ */
+
+#ifndef _SOFT_RASTERIZER_INCLUDED_H_
+#define _SOFT_RASTERIZER_INCLUDED_H_
+
+#include "glad/glad.h"
+#include "thread_pool.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#define SOFT_TILE_SIZE  64
+
+/**
+ * \brief Текстура RGBA8. Строка 0 - первая строка изображения, как в glTexImage2D.
+ */
+struct SoftTexture {
+    int                         width;
+    int                         height;
+    std::vector<unsigned char>  texels;
+
+    SoftTexture() : width(0), height(0) {}
+
+    /**
+     * \brief Копирует изображение с channels байтами на пиксель (1..4).
+     */
+    void assign(const unsigned char* data, int width, int height, int channels);
+};
+
+/**
+ * \brief Статистика за последний flush()
+ */
+struct SoftRasterizerStats {
+    size_t  triangles;          // отправлено в drawElements
+    size_t  rasterized;         // осталось после отсечения
+    size_t  binned;             // попаданий треугольников в плитки
+    double  vertexMs;           // обработка вершин и раскладка по плиткам
+    double  rasterMs;
+};
+
+class SoftRasterizer {
+public:
+    /**
+     * \param threads  Потоки для рисования плиток, 0 - по числу ядер
+     */
+    SoftRasterizer(int width, int height, unsigned threads = 0);
+
+    /**
+     * \brief Очищает цвет и глубину (аналог glClear). Еще не нарисованные треугольники отбрасываются.
+     */
+    void clear(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+
+    void setTexture(const SoftTexture* texture) {
+        m_pTexture = texture;
+    }
+
+    void setView(const glm::mat4& view, const glm::mat4& projection) {
+        m_View = view;
+        m_Projection = projection;
+    }
+
+    /**
+     * \brief Рисует треугольники с текущими текстурой и матрицами (аналог glDrawElements).
+     * Позиция - три числа GLfloat по смещению 0, текстурные координаты - два числа GLfloat
+     * по смещению texCoordOffset (как в CubeLayout из примеров).
+     */
+    void drawElements(const GLfloat* vertices, size_t stride, size_t texCoordOffset,
+                      const GLuint* indices, size_t indexCount, const glm::mat4& model);
+
+    /**
+     * \brief Рисует все накопленные треугольники.
+     */
+    void flush();
+
+    int getWidth() const {
+        return m_Width;
+    }
+
+    int getHeight() const {
+        return m_Height;
+    }
+
+    const unsigned char* getColor() const {
+        return m_Color.data();
+    }
+
+    const SoftRasterizerStats& getStats() const {
+        return m_Stats;
+    }
+
+    /**
+     * \brief Записывает буфер цвета в двоичный PPM (строки сверху вниз). \return false при ошибке
+     */
+    bool writePPM(const char* path) const;
+
+    /**
+     * \brief true, если плитки рисуются инструкциями AVX2.
+     */
+    static bool hasAvx2();
+
+    /**
+     * \brief Треугольник после обработки вершин: уравнения для экранных координат.
+     */
+    struct Triangle {
+        GLfloat             edge[3][3];     // A * x + B * y + C, внутри >= 0 (или > 0, см. topLeft)
+        GLfloat             depth[3];       // z/w
+        GLfloat             invW[3];        // 1/w
+        GLfloat             u[3];           // s/w
+        GLfloat             v[3];           // t/w
+        int                 topLeft;        // биты ребер, для которых граница входит в треугольник
+        int                 minX, minY, maxX, maxY;
+        const SoftTexture*  texture;
+    };
+
+private:
+    SoftRasterizer(const SoftRasterizer&);
+    SoftRasterizer& operator=(const SoftRasterizer&);
+
+    struct ClipVertex {
+        glm::vec4   position;
+        GLfloat     s, t;
+    };
+
+    void setupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c,
+                       std::vector<Triangle>& out) const;
+    void rasterizeTile(size_t tile);
+
+    int                                 m_Width;
+    int                                 m_Height;
+    int                                 m_TilesX;
+    int                                 m_TilesY;
+    std::vector<unsigned char>          m_Color;
+    std::vector<GLfloat>                m_Depth;
+    unsigned char                       m_ClearColor[4];
+    bool                                m_bClearPending;
+    const SoftTexture*                  m_pTexture;
+    glm::mat4                           m_View;
+    glm::mat4                           m_Projection;
+    std::vector<Triangle>               m_Triangles;
+    std::vector< std::vector<GLuint> >  m_Bins;
+    ThreadPool                          m_Pool;
+    SoftRasterizerStats                 m_Pending;      // копится до flush()
+    SoftRasterizerStats                 m_Stats;
+};
+
+#endif // _SOFT_RASTERIZER_INCLUDED_H_
@@ -0,0 +1,126 @@
+/*
+ * Потоковый буфер для данных, которые меняются каждый кадр
+ *
+ * Все буферы в примерах заполняются один раз в gInit через glBufferData(..., GL_STATIC_DRAW).
+ * Для данных, которые пересчитываются каждый кадр (матрицы экземпляров, частицы, отладочные
+ * линии), так делать нельзя: запись в буфер, который еще читает GPU, заставит драйвер
+ * ждать окончания предыдущего кадра.
+ *
+ * StreamBuffer делит буфер на STREAM_SEGMENTS сегмента. В каждом кадре данные пишутся
+ * в свой сегмент, а в конце кадра сегмент закрывается барьером (glFenceSync). К сегменту
+ * программа вернется только через STREAM_SEGMENTS кадров, и ждать барьер придется лишь
+ * тогда, когда GPU отстал больше чем на это количество кадров.
+ *
+ * Режимы работы:
+ *   PERSISTENT     - буфер создается через glBufferStorage и отображается в память один раз
+ *                    (GL 4.4 или GL_ARB_buffer_storage);
+ *   UNSYNCHRONIZED - каждый участок отображается через glMapBufferRange с флагом
+ *                    GL_MAP_UNSYNCHRONIZED_BIT (чистый GL 3.3), барьеры те же;
+ *   ORPHAN         - каждый кадр буфер "осиротевает" (glBufferData с NULL), драйвер сам
+ *                    выдает новую память, барьеры не нужны.
+ *   AUTO           - PERSISTENT, если доступен, иначе UNSYNCHRONIZED.
+ *
+ * Сам буфер никакой неявной синхронизации не делает: map() только выделяет место,
+ * ожидание барьера происходит один раз при переходе на следующий сегмент.
+ *
+ * Пример
+ *
+ *   StreamBuffer stream(GL_ARRAY_BUFFER, 1024 * 1024);
+ *   ...
+ *   GLintptr offset;
+ *   glm::mat4* dst = (glm::mat4*)stream.map(count * sizeof(glm::mat4), 16, &offset);
+ *   ... запись в dst ...
+ *   stream.unmap();
+ *   glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (GLvoid*)offset);
+ *   glDrawArraysInstanced(...);
+ *   stream.endFrame();
+ */
+
+#ifndef _STREAM_BUFFER_INCLUDED_H_
+#define _STREAM_BUFFER_INCLUDED_H_
+
+#include "glad/glad.h"
+
+#define STREAM_SEGMENTS     3
+
+/**
+ * \brief Статистика потокового буфера за последний завершенный кадр
+ */
+struct StreamBufferStats {
+    GLsizeiptr  bytes;          // сколько байт записано
+    GLuint      allocations;    // сколько раз вызывался map()
+    GLuint      stalls;         // сколько раз пришлось ждать GPU на барьере
+};
+
+class StreamBuffer {
+public:
+    enum Mode {
+        AUTO,
+        PERSISTENT,
+        UNSYNCHRONIZED,
+        ORPHAN
+    };
+
+    /**
+     * \param target       Цель привязки (GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER и т.д.)
+     * \param segmentSize  Размер одного сегмента, т.е. максимальный объем данных за кадр
+     * \param mode         Способ работы с памятью буфера
+     */
+    StreamBuffer(GLenum target, GLsizeiptr segmentSize, Mode mode = AUTO);
+    ~StreamBuffer();
+
+    /**
+     * \brief Выделяет size байт в сегменте текущего кадра.
+     *
+     * \param size       Размер участка
+     * \param alignment  Выравнивание начала участка (например, 16 для матриц или
+     *                   GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT для uniform-буферов)
+     * \param offset     Смещение участка от начала буфера для glVertexAttribPointer,
+     *                   glDrawElements или glBindBufferRange
+     * \return           Указатель для записи. Действителен до вызова unmap().
+     */
+    void* map(GLsizeiptr size, GLsizeiptr alignment, GLintptr* offset);
+
+    /**
+     * \brief Завершает запись участка, полученного через map(). Вызывается до отрисовки.
+     */
+    void unmap();
+
+    /**
+     * \brief Закрывает сегмент кадра барьером и переходит к следующему сегменту.
+     */
+    void endFrame();
+
+    GLuint getBuffer() const {
+        return m_Buffer;
+    }
+
+    Mode getMode() const {
+        return m_Mode;
+    }
+
+    const StreamBufferStats& getStats() const {
+        return m_LastFrame;
+    }
+
+private:
+    StreamBuffer(const StreamBuffer&);
+    StreamBuffer& operator=(const StreamBuffer&);
+
+    void waitSegment(GLuint segment);
+
+    GLenum              m_Target;
+    GLuint              m_Buffer;
+    Mode                m_Mode;
+    GLsizeiptr          m_SegmentSize;
+    GLuint              m_Segment;          // сегмент текущего кадра
+    GLsizeiptr          m_Used;             // занято в текущем сегменте
+    bool                m_bSegmentReady;    // барьер текущего сегмента уже пройден
+    bool                m_bMapped;
+    GLsync              m_Fences[STREAM_SEGMENTS];
+    unsigned char*      m_pPersistent;      // отображение буфера в режиме PERSISTENT
+    StreamBufferStats   m_Frame;
+    StreamBufferStats   m_LastFrame;
+}; // class StreamBuffer
+
+#endif // _STREAM_BUFFER_INCLUDED_H_
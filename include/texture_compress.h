@@ -0,0 +1,107 @@
+/*
+ * Блочное сжатие текстур: BC1, BC3, BC7 и ETC2
+ *
+ * Несжатая текстура RGB8 занимает в памяти видеокарты 4 байта на тексель (драйверы выравнивают
+ * RGB до RGBA), и каждый тексель читается при выборке целиком. Форматы блочного сжатия хранят
+ * блок 4 x 4 текселя в 8 или 16 байтах и распаковываются самим GPU при выборке:
+ *
+ *   GL_COMPRESSED_RGB_S3TC_DXT1_EXT        BC1, RGB, 8 байт на блок (0.5 байта на тексель)
+ *   GL_COMPRESSED_RGBA_S3TC_DXT5_EXT       BC3, RGBA: BC1 для цвета и 8 байт для альфы
+ *   GL_COMPRESSED_RGBA_BPTC_UNORM          BC7, RGBA, 16 байт на блок, качество заметно выше BC1
+ *   GL_COMPRESSED_RGB8_ETC2                ETC2, RGB, 8 байт на блок; основной формат OpenGL ES 3
+ *
+ * Кодировщики здесь рассчитаны на подготовку текстур заранее (tools/texture-cook):
+ *   - BC1 и цвет BC3 - концы отрезка по главной оси цветов блока, затем одно уточнение концов
+ *     методом наименьших квадратов;
+ *   - BC7 - только режим 6 (одно подмножество, RGBA 7.7.7.7 + p-бит, 16 уровней), он же дает
+ *     лучший результат на плавных текстурах;
+ *   - ETC2 - режимы ETC1 (отдельные и разностные цвета подблоков с выбором разбиения), которые
+ *     ETC2 читает без изменений.
+ *
+ * Изображения, которые появляются только во время работы (снимки, процедурные текстуры),
+ * сжимает compressImageFast - кодировщик реального времени для BC1 и BC3:
+ *   - концы отрезка - габаритный прямоугольник цветов блока, сжатый на 1/16 размаха с каждой
+ *     стороны (для альфы - на 1/32), без главной оси и уточнений;
+ *   - индекс цвета - ближайший из четырех по сумме модулей разностей каналов, индекс альфы -
+ *     округленное положение на отрезке;
+ *   - блок из 16 текселей обрабатывается двумя регистрами AVX2 по восемь текселей (если
+ *     процессор его не знает, работает обычный цикл). Результат побайтно одинаков с AVX2 и без.
+ * Качество ниже, чем у compressImage (на 0.5-3 дБ PSNR), а с AVX2 он быстрее в десятки раз
+ * (tools/texture-cook --bench).
+ *
+ * Распаковка (decompressImage) нужна, когда драйвер формат не поддерживает (см. флаги
+ * textureCompression* в gl_ext.h): текстура тогда загружается несжатой. Распаковываются все
+ * блоки, которые пишут здешние кодировщики; блоки BC7 в других режимах и режимы ETC2 T, H и
+ * planar не поддерживаются.
+ *
+ * Пример
+ *
+ *   std::vector<unsigned char> blocks(compressedSize(GL_COMPRESSED_RGB_S3TC_DXT1_EXT, width, height));
+ *   compressImage(GL_COMPRESSED_RGB_S3TC_DXT1_EXT, rgba, width, height, blocks.data(), &pool);
+ */
+
+#ifndef _TEXTURE_COMPRESS_INCLUDED_H_
+#define _TEXTURE_COMPRESS_INCLUDED_H_
+
+#include "glad/glad.h"
+
+#include <cstddef>
+
+// форматы сжатия в GL 3.3 входят только через расширения
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT     0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT    0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM       0x8E8C
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2             0x9274
+#endif
+
+class ThreadPool;
+
+/**
+ * \brief true для четырех форматов, перечисленных выше.
+ */
+bool isCompressedFormat(GLenum format);
+
+/**
+ * \brief Байт на блок 4 x 4: 8 для BC1 и ETC2, 16 для BC3 и BC7.
+ */
+size_t compressedBlockSize(GLenum format);
+
+/**
+ * \brief Размер сжатого изображения width x height (неполные блоки по краям считаются целыми).
+ */
+size_t compressedSize(GLenum format, int width, int height);
+
+/**
+ * \brief Сжимает изображение RGBA8 (строки сверху вниз, без выравнивания) в формат format.
+ * Блоки по краям дополняются повторением крайних текселей.
+ *
+ * \param pool  Пул потоков для строк блоков или nullptr
+ */
+void compressImage(GLenum format, const unsigned char* rgba, int width, int height, unsigned char* blocks,
+                   ThreadPool* pool = nullptr);
+
+/**
+ * \brief То же, что compressImage, но быстрым кодировщиком; только BC1 и BC3.
+ *
+ * \param allowAvx2  false - обычный цикл даже на процессоре с AVX2 (для сравнения скорости)
+ */
+void compressImageFast(GLenum format, const unsigned char* rgba, int width, int height, unsigned char* blocks,
+                       ThreadPool* pool = nullptr, bool allowAvx2 = true);
+
+/**
+ * \brief true, если compressImageFast может использовать AVX2.
+ */
+bool compressHasAvx2();
+
+/**
+ * \brief Распаковывает изображение в RGBA8.
+ * \return false, если встретился блок, который здесь не поддерживается
+ */
+bool decompressImage(GLenum format, const unsigned char* blocks, int width, int height, unsigned char* rgba);
+
+#endif // _TEXTURE_COMPRESS_INCLUDED_H_
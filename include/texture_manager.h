@@ -0,0 +1,209 @@
+/*
+ * Менеджер текстур: одна загрузка на файл, подсчет ссылок
+ *
+ * Почти каждый пример загружал box.jpg одним и тем же скопированным блоком glGenTextures,
+ * glTexParameteri, SOIL_load_image и glTexImage2D и забывал удалить текстуру в gFinalize.
+ * TextureManager загружает файл один раз: повторный gAcquire с тем же путем и теми же
+ * параметрами (TextureOptions) только увеличивает счетчик ссылок и возвращает ту же текстуру.
+ * gRelease уменьшает счетчик, а на последней ссылке удаляет текстуру.
+ *
+ * Текстура - обычный GLuint, поэтому привязывается так же, как раньше. Если файл не
+ * загрузился, возвращается 0 и в консоль выводится сообщение; gRelease(0) ничего не делает.
+ * Файлы читаются через Vfs (см. vfs.h), поэтому могут лежать и в пакете ресурсов .pak, а
+ * декодирует их самая быстрая из доступных библиотек (см. image_decoder.h). Если включен кэш
+ * изображений (см. image_cache.h), повторный запуск берет из него готовые пиксели всех
+ * mip-уровней и не декодирует файл и не вызывает glGenerateMipmap.
+ *
+ * Асинхронная загрузка
+ *
+ * gAcquire декодирует JPEG прямо в потоке OpenGL, и для больших файлов это сотни миллисекунд
+ * до первого кадра. gAcquireAsync сразу возвращает текстуру-заглушку (один серый тексель),
+ * а файл и заголовок изображения читаются в пуле из TEXTURE_DECODE_THREADS потоков. Дальше
+ * работу продолжает gUpdate, который вызывается раз в кадр в потоке OpenGL:
+ *   1. по размеру из заголовка создается буфер GL_PIXEL_UNPACK_BUFFER и отображается в
+ *      память, а изображение декодируется в пуле прямо в него (см. image_decoder.h) или, с
+ *      кэшем изображений, копируется в него вместе с mip-уровнями;
+ *   2. когда декодирование закончено, буфер снимается с отображения, и glTexSubImage2D ставит
+ *      в очередь GPU загрузку из буфера - поток OpenGL пикселей вообще не касается.
+ * Номер текстуры при этом не меняется: та же текстура вместо заглушки получает изображение,
+ * поэтому привязки в приложении обновлять не нужно. За кадр в буферы отображается не больше
+ * TEXTURE_UPLOAD_BUDGET байт, чтобы загрузка многих текстур не давала рывков.
+ *
+ * Сжатые текстуры
+ *
+ * Файлы .ktx (см. ktx_file.h, готовит tools/texture-cook) уже содержат сжатые блоки и
+ * mip-уровни: уровни загружаются glCompressedTexImage2D без декодирования, поэтому
+ * gAcquireAsync загружает их сразу, как gAcquire. Если драйвер формат не поддерживает,
+ * блоки распаковываются в RGBA8. Из options для них берутся только wrap и фильтры; без
+ * mip-фильтра загружается один уровень 0.
+ *
+ * Пример
+ *
+ *   GLuint texture_box = TextureManager::current().gAcquire(TEXTURE_PATH_PREFIX"/box.jpg");
+ *   GLuint texture_wall = TextureManager::current().gAcquireAsync(TEXTURE_PATH_PREFIX"/wall.jpg");
+ *   ...
+ *   TextureManager::current().gUpdate();                   // в начале каждого кадра
+ *   GLState::current().bindTextureUnit(0, GL_TEXTURE_2D, texture_box);
+ *   ...
+ *   TextureManager::current().gRelease(texture_box);       // в gFinalize
+ *   TextureManager::current().gRelease(texture_wall);
+ *   TextureManager::current().gFinalize();                 // до base::gFinalize, пока контекст жив
+ */
+
+#ifndef _TEXTURE_MANAGER_INCLUDED_H_
+#define _TEXTURE_MANAGER_INCLUDED_H_
+
+#include "glad/glad.h"
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define TEXTURE_DECODE_THREADS      0                   // потоков декодирования, 0 - по числу ядер
+#define TEXTURE_UPLOAD_BUDGET       (16 << 20)          // байт, отображаемых в буферы за кадр
+
+class CachedImage;
+class ThreadPool;
+class VfsFile;
+
+/**
+ * \brief Параметры текстуры. Если minFilter использует mip-уровни (GL_LINEAR_MIPMAP_LINEAR и
+ * т.п.), они строятся при загрузке.
+ */
+struct TextureOptions {
+    GLenum  wrap;               // GL_TEXTURE_WRAP_S и GL_TEXTURE_WRAP_T
+    GLenum  minFilter;
+    GLenum  magFilter;
+    int     channels;           // 3 - RGB, 4 - RGBA
+
+    TextureOptions(GLenum wrap = GL_REPEAT, GLenum minFilter = GL_LINEAR, GLenum magFilter = GL_LINEAR,
+                   int channels = 3)
+        : wrap(wrap), minFilter(minFilter), magFilter(magFilter), channels(channels) {}
+
+    bool hasMipmaps() const {
+        return minFilter != GL_LINEAR && minFilter != GL_NEAREST;
+    }
+};
+
+struct TextureManagerStats {
+    size_t  textures;           // загруженных текстур
+    size_t  bytes;              // память под них, включая mip-уровни
+    size_t  loads;              // файлов загружено за все время
+    size_t  hits;               // gAcquire, обошедшихся без загрузки
+    size_t  pending;            // текстур, которые еще загружаются асинхронно
+};
+
+class TextureManager {
+public:
+    /**
+     * \brief Менеджер текстур текущего контекста OpenGL.
+     */
+    static TextureManager& current();
+
+    /**
+     * \brief Текстура из файла path с параметрами options. Файл загружается только при первом
+     * запросе, дальше возвращается та же текстура.
+     * \return текстура или 0, если файл не загрузился
+     */
+    GLuint gAcquire(const char* path, const TextureOptions& options = TextureOptions());
+
+    /**
+     * \brief То же, что gAcquire, но файл загружается в фоне, а до тех пор текстура содержит
+     * заглушку. Если файл не загрузится, заглушка так и останется.
+     * \return текстура (никогда 0)
+     */
+    GLuint gAcquireAsync(const char* path, const TextureOptions& options = TextureOptions());
+
+    /**
+     * \brief Продвигает асинхронные загрузки. Вызывается раз в кадр в потоке OpenGL.
+     * \return сколько текстур получили изображение за этот вызов
+     */
+    size_t gUpdate();
+
+    /**
+     * \brief Дожидается всех асинхронных загрузок.
+     */
+    void gFinish();
+
+    /**
+     * \brief false, пока асинхронная загрузка не закончилась (удачно или нет).
+     */
+    bool isReady(GLuint texture) const;
+
+    /**
+     * \brief Еще одна ссылка на уже полученную текстуру (например, для второго владельца).
+     */
+    void addRef(GLuint texture);
+
+    /**
+     * \brief Отпускает ссылку; текстура удаляется вместе с последней ссылкой.
+     */
+    void gRelease(GLuint texture);
+
+    /**
+     * \brief Дожидается фоновых загрузок и удаляет все текстуры, даже те, на которые еще есть
+     * ссылки, и сообщает о них. Вызывается до уничтожения окна: потоки пишут в отображенные буферы.
+     */
+    void gFinalize();
+
+    const TextureManagerStats& getStats() const {
+        return m_Stats;
+    }
+
+private:
+    TextureManager();
+    ~TextureManager();
+    TextureManager(const TextureManager&);
+    TextureManager& operator=(const TextureManager&);
+
+    // асинхронная загрузка; поля, кроме state, меняет только тот, кому принадлежит текущий этап
+    struct Job {
+        enum State {
+            READING,            // в пуле: чтение файла и заголовка изображения
+            READ,               // в потоке OpenGL: ждет буфер
+            DECODING,           // в пуле: декодирование прямо в отображенный буфер
+            DECODED,            // в потоке OpenGL: ждет glTexSubImage2D
+            FAILED
+        };
+        std::string     path;
+        TextureOptions  options;
+        GLuint          texture;        // 0 - текстуру отпустили, загрузка отменена
+        State           state;          // под m_JobMutex
+        VfsFile*        file;           // содержимое файла, пока изображение не декодировано
+        CachedImage*    image;          // уровни из кэша изображений, если он включен
+        int             levels;         // уровней в буфере: больше одного только из кэша
+        std::vector<unsigned char> pixels;  // вместо буфера, если его не удалось отобразить
+        int             width;
+        int             height;
+        GLuint          buffer;
+        void*           mapped;
+    };
+
+    struct Entry {
+        std::string     key;
+        GLuint          texture;
+        size_t          bytes;
+        unsigned        refs;
+        Job*            job;            // незавершенная асинхронная загрузка
+    };
+
+    static std::string makeKey(const char* path, const TextureOptions& options);
+
+    void gAddEntry(const std::string& key, GLuint texture, size_t bytes, Job* job);
+    void read(Job* job);
+    void decode(Job* job);
+    void gMapBuffer(Job& job);
+    void gUpload(Job& job);
+    void gDiscard(Job& job);
+
+    std::map<std::string, GLuint>   m_Keys;         // путь и параметры -> текстура
+    std::map<GLuint, Entry>         m_Entries;
+    std::list<Job>                  m_Jobs;         // адреса элементов списка не меняются
+    std::mutex                      m_JobMutex;
+    ThreadPool*                     m_pWorkers;     // создается при первой асинхронной загрузке
+    TextureManagerStats             m_Stats;
+};
+
+#endif // _TEXTURE_MANAGER_INCLUDED_H_
@@ -0,0 +1,134 @@
+/*
+ * Упаковка многих текстур в одну: массив текстур или атлас
+ *
+ * Ящики с разными изображениями нельзя нарисовать подряд без glBindTexture между ними, и при
+ * многих материалах смены текстур становятся главной статьей расходов. RenderQueue сокращает
+ * их до одной на изображение, но не меньше. TexturePacker собирает изображения одного формата
+ * (RGBA8) в одну текстуру, после чего все такие объекты рисуются с одной привязкой, а чем они
+ * отличаются, сообщает uniform-переменная материала (TextureRegion):
+ *
+ *   ARRAY  GL_TEXTURE_2D_ARRAY, по слою на изображение. Все слои одного размера (наибольшего
+ *          из изображений), меньшие изображения растягиваются билинейно. Повтор (GL_REPEAT) и
+ *          полная цепочка mip-уровней работают как у обычной текстуры; в шейдере
+ *          texture(layers, vec3(uv, region.layer)).
+ *
+ *   ATLAS  GL_TEXTURE_2D, изображения разложены по полкам без масштабирования. Вокруг каждого
+ *          изображения рамка из TEXTURE_ATLAS_BORDER повторенных крайних текселей, а ячейки
+ *          выровнены на 2^TEXTURE_ATLAS_MAX_LEVEL текселей, поэтому на уровнях до
+ *          TEXTURE_ATLAS_MAX_LEVEL включительно соседи друг в друга не просачиваются; больше
+ *          уровней у атласа нет. Текстурные координаты пересчитываются:
+ *          uv' = region.offset + clamp(uv, 0, 1) * region.scale - повтор в атласе невозможен.
+ *
+ * Пример
+ *
+ *   TexturePacker packer(TexturePacker::ARRAY);
+ *   int box = packer.add(TEXTURE_PATH_PREFIX"/box.jpg");
+ *   int wood = packer.add(TEXTURE_PATH_PREFIX"/wood.jpg");
+ *   packer.gBuild();
+ *   ...
+ *   GLState::current().bindTextureUnit(0, packer.getTarget(), packer.getTexture());     // один раз
+ *   m_Shaders->setFloat("layer", (float)packer.getRegion(box).layer);
+ *   ...
+ *   packer.gFinalize();
+ */
+
+#ifndef _TEXTURE_PACKER_INCLUDED_H_
+#define _TEXTURE_PACKER_INCLUDED_H_
+
+#include "glad/glad.h"
+
+#include <cstddef>
+#include <vector>
+
+#define TEXTURE_ATLAS_BORDER        8           // текселей рамки вокруг изображения в атласе
+#define TEXTURE_ATLAS_MAX_LEVEL     3           // mip-уровней, на которых рамка еще есть: 8 >> 3 = 1
+
+/**
+ * \brief Где лежит изображение в упакованной текстуре.
+ */
+struct TextureRegion {
+    GLint   layer;              // слой массива; в атласе 0
+    GLfloat offset[2];          // uv' = offset + uv * scale; в массиве (0, 0) и (1, 1)
+    GLfloat scale[2];
+};
+
+struct TexturePackerStats {
+    size_t  images;
+    int     width;              // размер слоя или атласа
+    int     height;
+    int     layers;
+    size_t  bytes;              // память под текстуру, включая mip-уровни
+    float   occupancy;          // доля текселей, занятых изображениями (без рамок и растяжения)
+};
+
+class TexturePacker {
+public:
+    enum Mode {
+        ARRAY,
+        ATLAS
+    };
+
+    explicit TexturePacker(Mode mode);
+
+    /**
+     * \brief Добавляет изображение из файла.
+     * \return номер изображения для getRegion или -1, если файл не загрузился
+     */
+    int add(const char* path);
+
+    /**
+     * \brief Добавляет изображение RGBA8 (строки подряд, без выравнивания); пиксели копируются.
+     */
+    int add(const unsigned char* rgba, int width, int height);
+
+    /**
+     * \brief Создает текстуру из добавленных изображений. После этого добавлять нельзя,
+     * а изображения в памяти освобождаются.
+     *
+     * \param maxSize  Наибольшая сторона атласа или слоя (GL_MAX_TEXTURE_SIZE)
+     */
+    GLuint gBuild(int maxSize = 4096);
+
+    const TextureRegion& getRegion(int index) const;
+
+    GLuint getTexture() const {
+        return m_Texture;
+    }
+
+    /**
+     * \brief GL_TEXTURE_2D_ARRAY или GL_TEXTURE_2D - для glBindTexture.
+     */
+    GLenum getTarget() const {
+        return m_Mode == ARRAY ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    }
+
+    const TexturePackerStats& getStats() const {
+        return m_Stats;
+    }
+
+    /**
+     * \brief Удаляет текстуру.
+     */
+    void gFinalize();
+
+private:
+    TexturePacker(const TexturePacker&);
+    TexturePacker& operator=(const TexturePacker&);
+
+    struct Image {
+        int                         width;
+        int                         height;
+        std::vector<unsigned char>  pixels;
+    };
+
+    void gBuildArray(int maxSize);
+    void gBuildAtlas(int maxSize);
+
+    Mode                        m_Mode;
+    std::vector<Image>          m_Images;
+    std::vector<TextureRegion>  m_Regions;
+    GLuint                      m_Texture;
+    TexturePackerStats          m_Stats;
+}; // class TexturePacker
+
+#endif // _TEXTURE_PACKER_INCLUDED_H_
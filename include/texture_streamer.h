@@ -0,0 +1,217 @@
+/*
+ * Потоковая загрузка mip-уровней текстур по требованию
+ *
+ * TextureManager загружает текстуру сразу со всеми mip-уровнями, хотя дальний ящик читает только
+ * мелкие из них. В большой сцене видеопамять уходит на уровни 0, которые почти никогда не
+ * нужны. TextureStreamer держит в памяти видеокарты только те уровни, которые сейчас видны:
+ *
+ *   1. gAcquire загружает из файла .ktx (см. ktx_file.h, готовит tools/texture-cook) только
+ *      "хвост" - уровни не больше TEXTURE_STREAMING_TAIL текселей по стороне. Хвост остается в
+ *      памяти всегда, поэтому текстуру можно рисовать сразу.
+ *   2. Каждый кадр приложение сообщает, какой уровень нужен: request по размеру объекта и
+ *      расстоянию до камеры (как LodSelector, см. lod_selector.h) или requestLevel напрямую.
+ *      Нужен тот уровень, который выберет при выборке сам GPU: log2 от числа текселей текстуры
+ *      на пиксель экрана.
+ *   3. gUpdate догружает недостающие уровни по одному, от мелкого к крупному: файл остается
+ *      отображенным в память, пул потоков копирует (или распаковывает, если формат не
+ *      поддерживается) уровень в отображенный буфер GL_PIXEL_UNPACK_BUFFER, а следующий
+ *      gUpdate загружает его в текстуру. Первыми догружаются текстуры, которым не хватает больше
+ *      всего уровней.
+ *   4. Все уровни всех текстур укладываются в бюджет (setBudget). Чтобы загрузить уровень сверх
+ *      бюджета, выгружаются уровни, которые дольше всех не были нужны (LRU). Уровни, нужные в
+ *      текущем кадре, не выгружаются никогда: если бюджета не хватает даже на них, загрузка
+ *      просто останавливается. Пока бюджет не исчерпан, ненужные уровни остаются в памяти.
+ *
+ * Загруженные уровни - всегда непрерывный ряд от residentLevel до последнего, и их границы
+ * задает GL_TEXTURE_BASE_LEVEL: выборка не обращается к уровням ниже базового, и текстура полна
+ * без них. Выгруженный уровень задается заново с размером 0 x 0, и драйвер освобождает его
+ * память, а номер текстуры не меняется - привязки в приложении обновлять не нужно.
+ *
+ * Фильтрация у потоковых текстур всегда трилинейная (GL_LINEAR_MIPMAP_LINEAR).
+ *
+ * Пример
+ *
+ *   GLuint texture = TextureStreamer::current().gAcquire(TEXTURE_PATH_PREFIX"/wall.ktx");
+ *   TextureStreamer::current().setViewport(600.0f, glm::radians(45.0f));
+ *   ...
+ *   TextureStreamer::current().request(texture, 1.0f, distance);      // для каждого объекта
+ *   TextureStreamer::current().gUpdate();                               // раз в кадр
+ *   ...
+ *   TextureStreamer::current().gRelease(texture);                       // в gFinalize
+ */
+
+#ifndef _TEXTURE_STREAMER_INCLUDED_H_
+#define _TEXTURE_STREAMER_INCLUDED_H_
+
+#include "glad/glad.h"
+#include "ktx_file.h"
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define TEXTURE_STREAMING_BUDGET        (64 << 20)      // байт видеопамяти по умолчанию
+#define TEXTURE_STREAMING_TAIL          64              // уровни не больше этого размера всегда в памяти
+#define TEXTURE_STREAMING_UPLOAD_BUDGET (8 << 20)       // байт, отображаемых в буферы за кадр
+#define TEXTURE_STREAMING_THREADS       2               // потоков чтения уровней, 0 - по числу ядер
+
+class ThreadPool;
+class VfsFile;
+
+struct TextureStreamerStats {
+    size_t  textures;           // потоковых текстур
+    size_t  residentBytes;      // память загруженных уровней
+    size_t  pendingBytes;       // память уровней, которые сейчас загружаются
+    size_t  wantedBytes;        // память всех уровней, нужных в последнем кадре
+    size_t  loads;              // уровней загружено за все время
+    size_t  evictions;          // уровней выгружено за все время
+    size_t  pending;            // уровней, которые сейчас загружаются
+};
+
+class TextureStreamer {
+public:
+    /**
+     * \brief Загрузчик текстур текущего контекста OpenGL.
+     */
+    static TextureStreamer& current();
+
+    /**
+     * \brief Текстура из файла .ktx с mip-уровнями. Сразу загружается только хвост, повторный
+     * запрос того же файла возвращает ту же текстуру.
+     * \return текстура или 0, если файл не загрузился
+     */
+    GLuint gAcquire(const char* path, GLenum wrap = GL_REPEAT);
+
+    /**
+     * \brief Отпускает ссылку; текстура удаляется вместе с последней ссылкой.
+     */
+    void gRelease(GLuint texture);
+
+    /**
+     * \brief Параметры проекции для request: высота окна в пикселях и вертикальный угол обзора
+     * в радианах.
+     */
+    void setViewport(GLfloat height, GLfloat fovY);
+
+    /**
+     * \brief Бюджет видеопамяти на все уровни всех текстур. Хвосты загружаются независимо от него.
+     */
+    void setBudget(size_t bytes) {
+        m_Budget = bytes;
+    }
+
+    size_t getBudget() const {
+        return m_Budget;
+    }
+
+    /**
+     * \brief Текстура нужна в этом кадре начиная с уровня level.
+     */
+    void requestLevel(GLuint texture, GLuint level);
+
+    /**
+     * \brief Текстура нужна объекту размера size на расстоянии distance от камеры.
+     * \param uvScale  Сколько раз текстура повторяется на размере объекта
+     * \return нужный уровень
+     */
+    GLuint request(GLuint texture, GLfloat size, GLfloat distance, GLfloat uvScale = 1.0f);
+
+    /**
+     * \brief Загружает готовые уровни, выгружает лишние и начинает загрузку следующих.
+     * Вызывается раз в кадр в потоке OpenGL, после всех request этого кадра.
+     * \return сколько уровней загружено за этот вызов
+     */
+    size_t gUpdate();
+
+    /**
+     * \brief Дожидается начатых загрузок уровней и загружает их в текстуры.
+     */
+    void gFinish();
+
+    /**
+     * \brief Самый подробный загруженный уровень (текущий GL_TEXTURE_BASE_LEVEL).
+     */
+    GLuint getResidentLevel(GLuint texture) const;
+
+    /**
+     * \brief Уровней в файле текстуры.
+     */
+    GLuint getLevelCount(GLuint texture) const;
+
+    /**
+     * \brief Прерывает загрузки и удаляет все текстуры, даже те, на которые еще есть ссылки,
+     * и сообщает о них.
+     */
+    void gFinalize();
+
+    const TextureStreamerStats& getStats() const {
+        return m_Stats;
+    }
+
+private:
+    TextureStreamer();
+    ~TextureStreamer();
+    TextureStreamer(const TextureStreamer&);
+    TextureStreamer& operator=(const TextureStreamer&);
+
+    // загрузка одного уровня; поля, кроме state, меняет только тот, кому принадлежит текущий этап
+    struct Load {
+        enum State {
+            COPYING,            // в пуле: копирование или распаковка уровня в буфер
+            COPIED,             // в потоке OpenGL: ждет загрузки в текстуру
+            FAILED
+        };
+        GLuint          texture;        // 0 - текстуру отпустили, загрузка отменена
+        GLuint          level;
+        State           state;          // под m_LoadMutex
+        const unsigned char* source;    // данные уровня в отображенном файле
+        int             width;
+        int             height;
+        GLenum          format;         // формат данных в файле
+        bool            decompress;     // распаковать в RGBA8, а не копировать
+        size_t          size;           // байт в буфере
+        VfsFile*        file;           // файл отпущенной текстуры, пока пул его читает
+        std::vector<unsigned char> pixels;  // вместо буфера, если его не удалось отобразить
+        GLuint          buffer;
+        void*           mapped;
+    };
+
+    struct Entry {
+        std::string     key;
+        GLuint          texture;
+        unsigned        refs;
+        VfsFile*        file;           // отображен, пока текстура жива
+        KtxView         image;          // уровни указывают в file
+        bool            decompress;     // формат не поддерживается: уровни распаковываются в RGBA8
+        GLuint          tail;           // первый уровень хвоста
+        GLuint          resident;       // самый подробный загруженный уровень
+        GLuint          wanted;         // нужный уровень в этом кадре
+        std::vector<size_t>     bytes;  // память каждого уровня
+        std::vector<unsigned>   used;   // кадр, в котором уровень был нужен в последний раз
+        Load*           load;           // незавершенная загрузка уровня resident - 1
+    };
+
+    static std::string makeKey(const char* path, GLenum wrap);
+
+    Entry& getEntry(GLuint texture);
+    void copy(Load* load);
+    bool gEvictFor(size_t bytes);
+    void gStartLoad(Entry& entry);
+    void gUpload(Load& load);
+    void gDiscard(Load& load);
+    size_t gCompleteLoads();
+
+    std::map<std::string, GLuint>   m_Keys;         // путь и wrap -> текстура
+    std::map<GLuint, Entry>         m_Entries;
+    std::list<Load>                 m_Loads;        // адреса элементов списка не меняются
+    std::mutex                      m_LoadMutex;
+    ThreadPool*                     m_pWorkers;     // создается при первой загрузке уровня
+    size_t                          m_Budget;
+    GLfloat                         m_PixelsPerUnit;
+    unsigned                        m_Frame;
+    TextureStreamerStats            m_Stats;
+};
+
+#endif // _TEXTURE_STREAMER_INCLUDED_H_
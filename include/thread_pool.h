@@ -0,0 +1,73 @@
+/*
+ * Пул рабочих потоков
+ *
+ * Создавать потоки на каждую задачу (или каждый кадр) дорого: запуск std::thread стоит десятки
+ * микросекунд. ThreadPool создает потоки один раз и раздает им задачи из общей очереди.
+ *
+ *   submit(task)           - поставить задачу в очередь и сразу вернуться;
+ *   wait()                 - дождаться, пока очередь опустеет и все задачи выполнятся;
+ *   parallelFor(count, f)  - вызвать f(i) для i от 0 до count - 1 и дождаться конца. Номера
+ *                            раздаются по одному через атомарный счетчик. Вызывающий поток
+ *                            работает наравне с size() - 1 рабочими, так что пул из одного
+ *                            потока выполняет parallelFor последовательно.
+ *
+ * Пример
+ *
+ *   ThreadPool pool;
+ *   pool.parallelFor(tiles.size(), [&](size_t i) { rasterizeTile(tiles[i]); });
+ */
+
+#ifndef _THREAD_POOL_INCLUDED_H_
+#define _THREAD_POOL_INCLUDED_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    /**
+     * \param threads  Число рабочих потоков, 0 - по числу ядер
+     */
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    unsigned size() const {
+        return (unsigned)m_Workers.size();
+    }
+
+    /**
+     * \brief Ставит задачу в очередь.
+     */
+    void submit(const std::function<void()>& task);
+
+    /**
+     * \brief Ждет выполнения всех поставленных задач.
+     */
+    void wait();
+
+    /**
+     * \brief Вызывает f(i) для всех i из [0, count) в потоках пула и в вызывающем потоке.
+     * Возвращается, когда все вызовы закончены. Вызывать из задач самого пула нельзя.
+     */
+    void parallelFor(size_t count, const std::function<void(size_t)>& f);
+
+private:
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    void run();
+
+    std::vector<std::thread>            m_Workers;
+    std::deque< std::function<void()> > m_Tasks;
+    std::mutex                          m_Mutex;
+    std::condition_variable             m_TaskReady;
+    std::condition_variable             m_AllDone;
+    size_t                              m_Busy;         // задачи, которые сейчас выполняются
+    bool                                m_bStop;
+};
+
+#endif // _THREAD_POOL_INCLUDED_H_
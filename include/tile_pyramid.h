@@ -0,0 +1,163 @@
+/*
+ * Пирамида плиток для изображений, которые не помещаются в одну текстуру (.tiles)
+ *
+ * Скан в сотни мегапикселей не загрузить ни в одну текстуру (GL_MAX_TEXTURE_SIZE обычно 16384),
+ * ни целиком в память. Файл пирамиды хранит изображение плитками TILE_PYRAMID_TILE_SIZE x
+ * TILE_PYRAMID_TILE_SIZE на всех уровнях детализации: уровень 0 - исходное изображение, каждый
+ * следующий вдвое меньше (с округлением вверх), последний помещается в одну плитку.
+ *
+ *   [TilePyramidHeader][TilePyramidLevel x levelCount] ... [плитки уровня 0][уровня 1]...
+ *
+ * Плитки идут по строкам, без сжатия, все одного размера, поэтому место плитки в файле
+ * вычисляется, а не ищется в таблице. Первая плитка выровнена на TILE_PYRAMID_ALIGNMENT, и
+ * при размере 256 x 256 каждая плитка занимает целые страницы: чтение плитки из отображенного
+ * файла касается только ее страниц.
+ *
+ * Каждая плитка покрывает getContentSize() пикселей и окружена рамкой в TILE_PYRAMID_BORDER
+ * пикселей из соседних плиток (на краях изображения повторяются крайние пиксели). Благодаря
+ * рамке билинейная фильтрация внутри плитки дает тот же результат, что и на целом изображении,
+ * и швов между плитками не видно. Пиксели правых и нижних плиток за краем уровня тоже
+ * повторяют крайние.
+ *
+ * buildTilePyramid строит пирамиду, не держа изображение в памяти: уровень 0 запрашивается у
+ * источника по прямоугольникам плиток, следующие уровни усредняются 2 x 2 из уже записанного
+ * предыдущего прямо в отображенном файле. Так строится изображение любого размера, лишь бы
+ * хватило места на диске.
+ *
+ * Пример
+ *
+ *   buildTilePyramid("scan.tiles", 65536, 65536, 3,
+ *                    [](int x, int y, int width, int height, unsigned char* pixels) { ... });
+ *   TilePyramid pyramid;
+ *   if (pyramid.open("scan.tiles"))
+ *       ... pyramid.getTile(level, column, row) ...
+ */
+
+#ifndef _TILE_PYRAMID_INCLUDED_H_
+#define _TILE_PYRAMID_INCLUDED_H_
+
+#include "glad/glad.h"
+
+#include <cstddef>
+#include <functional>
+
+#define TILE_PYRAMID_MAGIC          0x52595054u     // "TPYR"
+#define TILE_PYRAMID_VERSION        1
+#define TILE_PYRAMID_TILE_SIZE      256             // сторона плитки вместе с рамкой
+#define TILE_PYRAMID_BORDER         1
+#define TILE_PYRAMID_ALIGNMENT      4096
+
+class VfsFile;
+
+struct TilePyramidHeader {
+    GLuint      magic;
+    GLuint      version;
+    GLuint      width;              // размер уровня 0
+    GLuint      height;
+    GLuint      channels;           // 3 - RGB, 4 - RGBA
+    GLuint      tileSize;
+    GLuint      border;
+    GLuint      levelCount;
+    GLuint64    tilesOffset;        // от начала файла до первой плитки
+};
+
+struct TilePyramidLevel {
+    GLuint      width;
+    GLuint      height;
+    GLuint      columns;            // плиток по горизонтали
+    GLuint      rows;
+    GLuint64    firstTile;          // номер первой плитки уровня среди всех плиток файла
+};
+
+/**
+ * \brief Источник пикселей уровня 0: заполняет прямоугольник width x height с левым верхним
+ * углом (x, y), строки идут подряд без выравнивания. Прямоугольник всегда лежит внутри
+ * изображения. Вызывается из нескольких потоков одновременно.
+ */
+typedef std::function<void(int x, int y, int width, int height, unsigned char* pixels)> TileSource;
+
+/**
+ * \brief Пирамида, открытая для чтения: файл отображается в память (через Vfs, см. vfs.h), и
+ * плитки указывают прямо в отображение. Файл отображается с советом Vfs::RANDOM, без чтения
+ * наперед: страницы читаются с диска при первом обращении к ним, так что открыть пирамиду
+ * любого размера ничего не стоит.
+ */
+class TilePyramid {
+public:
+    TilePyramid();
+    ~TilePyramid();
+
+    /**
+     * \return false, если файла нет или он поврежден; сообщение не выводится
+     */
+    bool open(const char* path);
+    void close();
+
+    bool isOpen() const {
+        return m_pHeader != nullptr;
+    }
+
+    int getWidth() const {
+        return (int)m_pHeader->width;
+    }
+
+    int getHeight() const {
+        return (int)m_pHeader->height;
+    }
+
+    int getChannels() const {
+        return (int)m_pHeader->channels;
+    }
+
+    int getTileSize() const {
+        return (int)m_pHeader->tileSize;
+    }
+
+    int getBorder() const {
+        return (int)m_pHeader->border;
+    }
+
+    /**
+     * \brief Пикселей уровня, которые покрывает одна плитка по каждой стороне (без рамки).
+     */
+    int getContentSize() const {
+        return (int)(m_pHeader->tileSize - 2 * m_pHeader->border);
+    }
+
+    GLuint getLevelCount() const {
+        return m_pHeader->levelCount;
+    }
+
+    const TilePyramidLevel& getLevel(GLuint level) const {
+        return m_pLevels[level];
+    }
+
+    size_t getTileBytes() const {
+        return (size_t)m_pHeader->tileSize * m_pHeader->tileSize * m_pHeader->channels;
+    }
+
+    /**
+     * \brief Пиксели плитки вместе с рамкой, строки сверху вниз.
+     */
+    const unsigned char* getTile(GLuint level, GLuint column, GLuint row) const;
+
+private:
+    TilePyramid(const TilePyramid&);
+    TilePyramid& operator=(const TilePyramid&);
+
+    VfsFile*                    m_pFile;
+    const TilePyramidHeader*    m_pHeader;      // указывает в файл; nullptr - пирамида закрыта
+    const TilePyramidLevel*     m_pLevels;
+}; // class TilePyramid
+
+/**
+ * \brief Строит пирамиду изображения width x height с channels каналами и записывает ее в
+ * path (через временный файл). Уровень 0 берется у source, плитки строятся в threads потоках
+ * (0 - по числу ядер).
+ * \param tileSize  Сторона плитки с рамкой, кратна 4
+ * \return false, если файл не записался; сообщение выводится
+ */
+bool buildTilePyramid(const char* path, int width, int height, int channels, const TileSource& source,
+                      int tileSize = TILE_PYRAMID_TILE_SIZE, unsigned threads = 0);
+
+#endif // _TILE_PYRAMID_INCLUDED_H_
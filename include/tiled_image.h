@@ -0,0 +1,198 @@
+/*
+ * Просмотр огромных изображений: потоковая загрузка плиток пирамиды
+ *
+ * TiledImage рисует изображение из пирамиды плиток (см. tile_pyramid.h) любого размера, держа
+ * в видеопамяти не больше cacheSlots плиток - слоев одного массива текстур
+ * GL_TEXTURE_2D_ARRAY. Каждый кадр:
+ *   1. gUpdate обходит дерево плиток от вершины пирамиды (одна плитка) вниз и выбирает для
+ *      каждого участка изображения уровень, на котором тексель на экране не крупнее пикселя
+ *      (как выбирает mip-уровень сам GPU). Плитки вне поля зрения отбрасываются вместе с
+ *      поддеревом, поэтому работа зависит от размера окна, а не изображения. Плиток выбирается
+ *      не больше TILED_IMAGE_MAX_TILES; на пределе часть участков остается на более грубом уровне.
+ *   2. Недостающие плитки загружаются от грубых к подробным, не больше TILED_IMAGE_UPLOADS за
+ *      кадр: пул потоков копирует плитку из отображенного файла (здесь и читается диск) в
+ *      отображенный буфер GL_PIXEL_UNPACK_BUFFER, а следующий gUpdate загружает его в
+ *      свободный слой. Если свободных слоев нет, занимается слой плитки, которая дольше всех
+ *      не рисовалась (LRU); плитки, нужные в этом кадре, не вытесняются.
+ *   3. gDraw рисует каждую выбранную плитку, а пока она не загружена - тот же участок из
+ *      ближайшей загруженной грубой плитки, так что дыр нет никогда: плитка вершины пирамиды
+ *      загружается в gOpen и не вытесняется.
+ *
+ * Память ограничена независимо от размера изображения: в видеопамяти - cacheSlots плиток, в
+ * обычной - буферы не больше TILED_IMAGE_MAX_PENDING загрузок, а файл пирамиды только
+ * отображается, и его страницы система вытесняет сама.
+ *
+ * Изображение лежит в плоскости z = 0: левый верхний угол в точке topLeft, ось x вправо, строки
+ * вниз (в сторону -y), один пиксель уровня 0 - pixelSize единиц (см. setPlacement). Внутри
+ * плитки работает только билинейная фильтрация: mip-уровни заменяет сама пирамида.
+ *
+ * gDraw рисует треугольники с атрибутами 0 (vec2 - положение в плоскости) и 2 (vec3 - текстурные
+ * координаты и номер слоя), см. шейдеры 3.3.shader17.*.glsl. Программу с sampler2DArray на блоке
+ * 0 и ее матрицы задает приложение.
+ *
+ * Пример
+ *
+ *   TiledImage image;
+ *   image.gOpen("scan.tiles");
+ *   image.setPlacement(glm::vec2(-8.0f, 4.0f), 16.0f / image.getPyramid().getWidth());
+ *   image.setViewport(600.0f, glm::radians(45.0f));
+ *   ...
+ *   image.gUpdate(projection * view, camera.Position);    // раз в кадр
+ *   shader->use();
+ *   image.gDraw();
+ *   ...
+ *   image.gClose();                                        // в gFinalize
+ */
+
+#ifndef _TILED_IMAGE_INCLUDED_H_
+#define _TILED_IMAGE_INCLUDED_H_
+
+#include "glad/glad.h"
+#include "tile_pyramid.h"
+
+#include <glm/glm.hpp>
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#define TILED_IMAGE_CACHE_SLOTS     256         // плиток в видеопамяти по умолчанию (64 МБ для 256 x 256 RGBA)
+#define TILED_IMAGE_UPLOADS         8           // новых загрузок плиток за кадр
+#define TILED_IMAGE_MAX_PENDING     32          // незавершенных загрузок
+#define TILED_IMAGE_MAX_TILES       2048        // плиток, выбираемых за кадр
+#define TILED_IMAGE_THREADS         2           // потоков чтения плиток, 0 - по числу ядер
+
+class StreamBuffer;
+class ThreadPool;
+
+struct TiledImageStats {
+    size_t  selected;           // плиток выбрано в последнем кадре
+    size_t  fallbacks;          // из них нарисовано из более грубой плитки
+    size_t  resident;           // плиток в видеопамяти
+    size_t  pending;            // плиток, которые сейчас загружаются
+    size_t  loads;              // плиток загружено за все время
+    size_t  evictions;          // плиток вытеснено за все время
+    GLuint  finestLevel;        // самый подробный уровень среди выбранных плиток
+};
+
+class TiledImage {
+public:
+    TiledImage();
+    ~TiledImage();
+
+    /**
+     * \brief Открывает пирамиду и создает кэш плиток в видеопамяти.
+     * \param cacheSlots  Плиток в кэше; не больше GL_MAX_ARRAY_TEXTURE_LAYERS
+     * \return false, если файл не открылся; сообщение выводится
+     */
+    bool gOpen(const char* path, GLuint cacheSlots = TILED_IMAGE_CACHE_SLOTS);
+
+    /**
+     * \brief Прерывает загрузки и удаляет кэш плиток.
+     */
+    void gClose();
+
+    bool isOpen() const {
+        return m_Pyramid.isOpen();
+    }
+
+    const TilePyramid& getPyramid() const {
+        return m_Pyramid;
+    }
+
+    /**
+     * \brief Положение изображения в плоскости z = 0: левый верхний угол и размер пикселя.
+     */
+    void setPlacement(const glm::vec2& topLeft, GLfloat pixelSize);
+
+    /**
+     * \brief Параметры проекции: высота окна в пикселях и вертикальный угол обзора в радианах.
+     */
+    void setViewport(GLfloat height, GLfloat fovY);
+
+    /**
+     * \brief Выбирает плитки для камеры в точке eye с матрицей viewProjection, загружает
+     * готовые плитки и начинает загрузку недостающих. Раз в кадр, до gDraw.
+     */
+    void gUpdate(const glm::mat4& viewProjection, const glm::vec3& eye);
+
+    /**
+     * \brief Рисует выбранные плитки; программа должна быть уже выбрана.
+     */
+    void gDraw();
+
+    /**
+     * \brief Дожидается начатых загрузок и загружает плитки в кэш.
+     */
+    void gFinish();
+
+    const TiledImageStats& getStats() const {
+        return m_Stats;
+    }
+
+private:
+    TiledImage(const TiledImage&);
+    TiledImage& operator=(const TiledImage&);
+
+    // плитка: уровень, столбец и строка в одном числе
+    typedef GLuint64 TileKey;
+
+    struct Slot {
+        TileKey         key;            // NO_TILE - слой свободен
+        unsigned        used;           // кадр, в котором плитка рисовалась в последний раз
+        bool            loading;
+    };
+
+    // загрузка одной плитки; поля, кроме state, меняет только тот, кому принадлежит текущий этап
+    struct Load {
+        enum State {
+            COPYING,            // в пуле: копирование плитки в буфер
+            COPIED              // в потоке OpenGL: ждет загрузки в слой
+        };
+        GLuint          slot;
+        State           state;          // под m_LoadMutex
+        const unsigned char* source;    // плитка в отображенном файле
+        std::vector<unsigned char> pixels;  // вместо буфера, если его не удалось отобразить
+        GLuint          buffer;
+        void*           mapped;
+    };
+
+    struct Selected {
+        TileKey         key;
+        GLfloat         distance;       // до камеры, для порядка загрузки
+        TileKey         source;         // плитка, которая рисуется вместо нее: она сама или грубее
+        GLuint          slot;           // слой source
+    };
+
+    static TileKey makeKey(GLuint level, GLuint column, GLuint row) {
+        return ((TileKey)level << 48) | ((TileKey)row << 24) | column;
+    }
+
+    void select(const glm::mat4& viewProjection, const glm::vec3& eye, GLuint level, GLuint column, GLuint row);
+    bool gAcquireSlot(GLuint& slot);
+    void gStartLoad(TileKey key, GLuint slot);
+    void gUpload(Load& load);
+    void gDiscard(Load& load);
+    void gCompleteLoads();
+
+    TilePyramid                         m_Pyramid;
+    GLuint                              m_Texture;
+    GLenum                              m_Format;
+    std::vector<Slot>                   m_Slots;
+    std::map<TileKey, GLuint>           m_Tiles;        // плитка -> слой, в том числе загружаемая
+    std::vector<Selected>               m_Selected;
+    std::list<Load>                     m_Loads;        // адреса элементов списка не меняются
+    std::mutex                          m_LoadMutex;
+    ThreadPool*                         m_pWorkers;     // создается при первой загрузке плитки
+    StreamBuffer*                       m_pVertices;
+    GLuint                              m_Vao;
+    glm::vec2                           m_TopLeft;
+    GLfloat                             m_PixelSize;
+    GLfloat                             m_PixelsPerUnit;
+    size_t                              m_Reserved;     // мест в m_Selected за еще не обойденными плитками
+    unsigned                            m_Frame;
+    TiledImageStats                     m_Stats;
+};
+
+#endif // _TILED_IMAGE_INCLUDED_H_
@@ -0,0 +1,273 @@
+/*
+ * Формат вершины, описанный на этапе компиляции
+ *
+ * Вместо ручных вызовов glVertexAttribPointer с "магическими" шагами вида 5 * sizeof(GLfloat)
+ * формат вершины задается списком атрибутов:
+ *
+ *   typedef VertexLayout< VertexAttr<0, vfmt::Half3>,
+ *                         VertexAttr<2, vfmt::UNorm16x2> > CubeLayout;
+ *
+ * Смещения атрибутов и шаг вершины (CubeLayout::stride) вычисляются компилятором,
+ * а CubeLayout::setup() настраивает привязанный VAO.
+ *
+ * Кроме 32-битных чисел с плавающей точкой поддерживаются сжатые форматы:
+ *   Half2/3/4     - половинная точность (GL_HALF_FLOAT), например, для позиций;
+ *   UNorm16x2     - нормированные 16-битные целые без знака, для текстурных координат в [0, 1]
+ *                   (значения вне диапазона обрезаются; для повторяющихся координат - Half2);
+ *   SNorm10x3     - нормаль, упакованная в одно 32-битное слово (GL_INT_2_10_10_10_REV);
+ *   UNorm8x4      - цвет, по байту на компоненту.
+ * Шейдер при этом не меняется: он по-прежнему получает vec2/vec3/vec4.
+ *
+ * Исходные данные моделей хранятся числами GLfloat. CubeLayout::pack() переводит массив
+ * вершин, в котором атрибуты идут подряд в том же порядке (позиция 3 числа, координаты 2 числа),
+ * в сжатый формат. Куб из models/model_cube.h занимает 20 байт на вершину, в формате
+ * CubeLayout - 12 байт.
+ */
+
+#ifndef _VERTEX_LAYOUT_INCLUDED_H_
+#define _VERTEX_LAYOUT_INCLUDED_H_
+
+#include "glad/glad.h"
+
+#include <vector>
+#include <cstring>
+#include <cstddef>
+
+namespace vfmt {
+
+/**
+ * \brief Переводит число в половинную точность с округлением к ближайшему четному.
+ */
+inline GLushort floatToHalf(GLfloat value) {
+    GLuint f;
+    memcpy(&f, &value, sizeof(f));
+    GLuint sign = (f >> 16) & 0x8000;
+    GLuint mantissa = f & 0x7fffff;
+    GLint exponent = (GLint)((f >> 23) & 0xff) - 127 + 15;
+
+    if (((f >> 23) & 0xff) == 0xff)                 // бесконечность или NaN
+        return (GLushort)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    if (exponent >= 31)                             // переполнение
+        return (GLushort)(sign | 0x7c00);
+    if (exponent <= 0) {                            // денормализованное число или ноль
+        if (exponent < -10)
+            return (GLushort)sign;
+        mantissa |= 0x800000;
+        GLuint shift = 14 - exponent;
+        GLuint half = mantissa >> shift;
+        GLuint rest = mantissa & ((1u << shift) - 1);
+        GLuint middle = 1u << (shift - 1);
+        if (rest > middle || (rest == middle && (half & 1)))
+            half++;
+        return (GLushort)(sign | half);
+    }
+    GLuint half = sign | ((GLuint)exponent << 10) | (mantissa >> 13);
+    GLuint rest = mantissa & 0x1fff;
+    // перенос из мантиссы в порядок здесь корректен
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        half++;
+    return (GLushort)half;
+} // floatToHalf
+
+inline GLfloat clampf(GLfloat value, GLfloat lo, GLfloat hi) {
+    return value < lo ? lo : (value > hi ? hi : value);
+}
+
+/*
+ * Каждый формат описывает:
+ *   components  - сколько чисел GLfloat он берет из исходной вершины;
+ *   glSize      - параметр size для glVertexAttribPointer;
+ *   type, normalized - параметры type и normalized для glVertexAttribPointer;
+ *   size        - сколько байт он занимает в вершине (кратно 4 для выравнивания);
+ *   encode()    - перевод components чисел в size байт.
+ */
+
+template <GLint N>
+struct Float {
+    static const GLint      components = N;
+    static const GLint      glSize = N;
+    static const GLenum     type = GL_FLOAT;
+    static const GLboolean  normalized = GL_FALSE;
+    static const GLsizei    size = N * sizeof(GLfloat);
+    static void encode(const GLfloat* src, unsigned char* dst) {
+        memcpy(dst, src, size);
+    }
+};
+typedef Float<1> Float1;
+typedef Float<2> Float2;
+typedef Float<3> Float3;
+typedef Float<4> Float4;
+
+template <GLint N>
+struct Half {
+    static const GLint      components = N;
+    static const GLint      glSize = N;
+    static const GLenum     type = GL_HALF_FLOAT;
+    static const GLboolean  normalized = GL_FALSE;
+    static const GLsizei    size = (N * sizeof(GLushort) + 3) & ~3;     // Half3 дополняется до 8 байт
+    static void encode(const GLfloat* src, unsigned char* dst) {
+        GLushort h[4] = { 0, 0, 0, 0 };
+        for (GLint i = 0; i < N; i++)
+            h[i] = floatToHalf(src[i]);
+        memcpy(dst, h, size);
+    }
+};
+typedef Half<2> Half2;
+typedef Half<3> Half3;
+typedef Half<4> Half4;
+
+struct UNorm16x2 {
+    static const GLint      components = 2;
+    static const GLint      glSize = 2;
+    static const GLenum     type = GL_UNSIGNED_SHORT;
+    static const GLboolean  normalized = GL_TRUE;
+    static const GLsizei    size = 4;
+    static void encode(const GLfloat* src, unsigned char* dst) {
+        GLushort v[2];
+        for (int i = 0; i < 2; i++)
+            v[i] = (GLushort)(clampf(src[i], 0.0f, 1.0f) * 65535.0f + 0.5f);
+        memcpy(dst, v, size);
+    }
+};
+
+struct UNorm8x4 {
+    static const GLint      components = 4;
+    static const GLint      glSize = 4;
+    static const GLenum     type = GL_UNSIGNED_BYTE;
+    static const GLboolean  normalized = GL_TRUE;
+    static const GLsizei    size = 4;
+    static void encode(const GLfloat* src, unsigned char* dst) {
+        for (int i = 0; i < 4; i++)
+            dst[i] = (unsigned char)(clampf(src[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+};
+
+struct SNorm10x3 {
+    static const GLint      components = 3;
+    static const GLint      glSize = 4;     // четвертая компонента (2 бита) равна 1
+    static const GLenum     type = GL_INT_2_10_10_10_REV;
+    static const GLboolean  normalized = GL_TRUE;
+    static const GLsizei    size = 4;
+    static void encode(const GLfloat* src, unsigned char* dst) {
+        GLuint packed = 1u << 30;
+        for (int i = 0; i < 3; i++) {
+            GLfloat v = clampf(src[i], -1.0f, 1.0f) * 511.0f;
+            GLint q = (GLint)(v < 0.0f ? v - 0.5f : v + 0.5f);
+            packed |= ((GLuint)q & 0x3ff) << (10 * i);
+        }
+        memcpy(dst, &packed, size);
+    }
+};
+
+} // namespace vfmt
+
+/**
+ * \brief Атрибут вершины: номер (layout (location = Index) в шейдере) и формат из vfmt
+ */
+template <GLuint Index, typename Format>
+struct VertexAttr {
+    static const GLuint index = Index;
+    typedef Format format;
+};
+
+namespace vlayout_detail {
+
+template <typename... Attrs>
+struct List;
+
+template <>
+struct List<> {
+    static const GLsizei stride = 0;
+    static const size_t components = 0;
+    static void setup(GLsizei, GLintptr) {}
+    static void encode(const GLfloat*, unsigned char*) {}
+    template <typename Target>
+    static void describe(Target&, GLsizei) {}
+};
+
+template <typename Head, typename... Tail>
+struct List<Head, Tail...> {
+    typedef typename Head::format F;
+    static const GLsizei stride = F::size + List<Tail...>::stride;
+    static const size_t components = F::components + List<Tail...>::components;
+
+    static void setup(GLsizei step, GLintptr offset) {
+        glVertexAttribPointer(Head::index, F::glSize, F::type, F::normalized, step, (GLvoid*)offset);
+        glEnableVertexAttribArray(Head::index);
+        List<Tail...>::setup(step, offset + F::size);
+    }
+    static void encode(const GLfloat* src, unsigned char* dst) {
+        F::encode(src, dst);
+        List<Tail...>::encode(src + F::components, dst + F::size);
+    }
+    template <typename Target>
+    static void describe(Target& target, GLsizei offset) {
+        target.setAttribute(Head::index, F::glSize, F::type, F::normalized, offset);
+        List<Tail...>::describe(target, offset + F::size);
+    }
+};
+
+template <size_t I, typename... Attrs>
+struct Offset;
+
+template <typename Head, typename... Tail>
+struct Offset<0, Head, Tail...> {
+    static const GLsizei value = 0;
+};
+
+template <size_t I, typename Head, typename... Tail>
+struct Offset<I, Head, Tail...> {
+    static const GLsizei value = Head::format::size + Offset<I - 1, Tail...>::value;
+};
+
+} // namespace vlayout_detail
+
+template <typename... Attrs>
+struct VertexLayout {
+    // размер вершины в байтах
+    static const GLsizei stride = vlayout_detail::List<Attrs...>::stride;
+    // сколько чисел GLfloat занимает вершина в исходных данных для pack()
+    static const size_t components = vlayout_detail::List<Attrs...>::components;
+
+    /**
+     * \brief Смещение I-го атрибута (по порядку в списке) в байтах
+     */
+    template <size_t I>
+    static constexpr GLsizei offset() {
+        return vlayout_detail::Offset<I, Attrs...>::value;
+    }
+
+    /**
+     * \brief Настраивает атрибуты привязанного VAO для буфера, привязанного к GL_ARRAY_BUFFER.
+     *
+     * \param baseOffset  Смещение первой вершины в буфере
+     */
+    static void setup(GLintptr baseOffset = 0) {
+        vlayout_detail::List<Attrs...>::setup(stride, baseOffset);
+    }
+
+    /**
+     * \brief Передает атрибуты в target.setAttribute(index, size, type, normalized, offset)
+     * (например, в MeshBatch).
+     */
+    template <typename Target>
+    static void describe(Target& target) {
+        vlayout_detail::List<Attrs...>::describe(target, 0);
+    }
+
+    /**
+     * \brief Переводит вершины из GLfloat (components чисел на вершину) в этот формат.
+     */
+    static void pack(const GLfloat* src, size_t vertexCount, std::vector<unsigned char>& out) {
+        out.resize(vertexCount * stride);
+        for (size_t i = 0; i < vertexCount; i++)
+            vlayout_detail::List<Attrs...>::encode(src + i * components, &out[i * stride]);
+    }
+};
+
+template <typename... Attrs>
+const GLsizei VertexLayout<Attrs...>::stride;
+template <typename... Attrs>
+const size_t VertexLayout<Attrs...>::components;
+
+#endif // _VERTEX_LAYOUT_INCLUDED_H_
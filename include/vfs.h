@@ -0,0 +1,145 @@
+/*
+ * Виртуальная файловая система: пакеты ресурсов и файлы россыпью
+ *
+ * Загрузчики (Shader, TextureManager, TexturePacker) читают файлы через Vfs::read, а не
+ * открывают их сами. Путь, который им передан, например "../textures/box.jpg", сводится к
+ * логическому имени "textures/box.jpg" (начальные "./" и "../" отбрасываются), и файл ищется:
+ *   1. в подключенных пакетах .pak (см. pak_file.h), начиная с подключенного последним;
+ *   2. по самому пути, как раньше - относительно текущего каталога;
+ *   3. по логическому имени в подключенных каталогах, начиная с подключенного последним.
+ * Абсолютные пути читаются только с диска.
+ *
+ * Данные из пакета не копируются: VfsFile указывает прямо в отображение пакета, и, например,
+ * исходник шейдера уходит в glShaderSource без единой копии. Файл россыпью тоже отображается
+ * в память. Приложение (см. application.h) само подключает каталог на уровень выше
+ * исполняемого файла и пакет assets.pak рядом с ним, поэтому примеры находят ресурсы из любого
+ * текущего каталога.
+ *
+ * Подключать пакеты и каталоги нужно до загрузки ресурсов; читать можно из любого потока.
+ * Указатели из пакетов действительны до unmountAll.
+ *
+ * Пример
+ *
+ *   Vfs::current().mountPak("assets.pak");
+ *   VfsFile file;
+ *   if (Vfs::current().read(SHADER_PATH_PREFIX"/3.3.shader09.vs.glsl", file))
+ *       ... file.data(), file.size() ...
+ */
+
+#ifndef _VFS_INCLUDED_H_
+#define _VFS_INCLUDED_H_
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class PakFile;
+
+struct VfsStats {
+    size_t  paks;               // подключенных пакетов
+    size_t  directories;        // подключенных каталогов
+    size_t  pakReads;           // файлов, прочитанных из пакетов
+    size_t  looseReads;         // файлов, прочитанных с диска
+    size_t  misses;             // файлов, которые не нашлись
+};
+
+/**
+ * \brief Содержимое файла: указатель в пакет или отображение файла с диска.
+ */
+class VfsFile {
+public:
+    VfsFile();
+    ~VfsFile();
+
+    const unsigned char* data() const {
+        return m_pData;
+    }
+
+    size_t size() const {
+        return m_Size;
+    }
+
+    /**
+     * \brief true, если файл прочитан из пакета.
+     */
+    bool isPacked() const {
+        return m_pData && !m_pMapping;
+    }
+
+    /**
+     * \brief Освобождает отображение файла с диска.
+     */
+    void close();
+
+private:
+    VfsFile(const VfsFile&);
+    VfsFile& operator=(const VfsFile&);
+
+    friend class Vfs;
+
+    const unsigned char*    m_pData;
+    size_t                  m_Size;
+    void*                   m_pMapping;     // отображение файла с диска; для пакета nullptr
+}; // class VfsFile
+
+class Vfs {
+public:
+    /**
+     * \brief Как будет читаться файл с диска; по этому совету система подкачивает страницы.
+     */
+    enum Access {
+        SEQUENTIAL,         // один раз от начала до конца: файл читается наперед целиком
+        RANDOM              // вразброс (плитки, см. tile_pyramid.h): страницы - только по обращению
+    };
+
+    static Vfs& current();
+
+    /**
+     * \brief Подключает пакет. Файлы в нем закрывают одноименные из пакетов, подключенных
+     * раньше, и файлы на диске.
+     * \return false, если пакет не открылся
+     */
+    bool mountPak(const char* path);
+
+    /**
+     * \brief Подключает каталог, в котором ищутся логические имена, не найденные в пакетах
+     * и по исходному пути.
+     */
+    void mountDirectory(const char* path);
+
+    /**
+     * \brief Отключает все пакеты и каталоги.
+     */
+    void unmountAll();
+
+    /**
+     * \brief Читает файл (см. порядок поиска в начале файла).
+     * \param access  Совет для файла россыпью; отображение пакета он не меняет
+     * \return false, если файл не нашелся; сообщение не выводится
+     */
+    bool read(const char* path, VfsFile& file, Access access = SEQUENTIAL);
+
+    /**
+     * \brief Логическое имя: "../textures/./box.jpg" -> "textures/box.jpg". Для абсолютного
+     * пути - пустая строка.
+     */
+    static std::string logicalName(const char* path);
+
+    VfsStats getStats();
+
+private:
+    Vfs();
+    ~Vfs();
+    Vfs(const Vfs&);
+    Vfs& operator=(const Vfs&);
+
+    static bool mapFile(const char* path, VfsFile& file, Access access);
+
+    std::vector<PakFile*>       m_Paks;
+    std::vector<std::string>    m_Directories;
+    std::mutex                  m_Mutex;        // списки подключений и статистика
+    VfsStats                    m_Stats;
+}; // class Vfs
+
+#endif // _VFS_INCLUDED_H_
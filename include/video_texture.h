@@ -0,0 +1,144 @@
+/*
+ * Видео на текстуре: потоковое чтение Y4M и перевод YUV -> RGB в шейдере
+ *
+ * VideoTexture показывает кадры файла Y4M (см. y4m_file.h) в трех текстурах GL_R8: яркость Y
+ * во весь размер и цветность U, V в размере плоскостей цветности. В RGB кадр переводит
+ * фрагментный шейдер (см. 3.3.shader18.fs.glsl), поэтому процессор не трогает пиксели вовсе:
+ * кадр 3840 x 2160 в 4:2:0 - это 12 МБ, а в RGBA было бы 33 МБ и еще перевод каждого пикселя.
+ * Вся работа процессора - одно чтение файла на кадр, 750 МБ/с для 4K при 60 кадрах в секунду.
+ *
+ * Кадры идут через кольцо из VIDEO_TEXTURE_RING буферов GL_PIXEL_UNPACK_BUFFER:
+ *   1. gUpdate отображает свободный буфер кольца (с GL_MAP_INVALIDATE_BUFFER_BIT, чтобы не
+ *      ждать, пока GPU дочитает прошлый кадр из этого буфера) и отдает пулу потоков: поток
+ *      читает кадр с диска прямо в отображение, без промежуточной копии;
+ *   2. так читаются вперед сразу все буферы кольца, а следующий за ними кадр система по
+ *      просьбе readAhead читает в кэш страниц;
+ *   3. когда приходит время кадра, gUpdate снимает отображение и загружает плоскости из
+ *      буфера в текстуры тремя glTexSubImage2D - копирование идет уже на стороне драйвера.
+ *
+ * Время кадра считается от показа первого кадра по частоте из заголовка файла. Если чтение не
+ * успевает, кадр не ждут: пока нужный кадр не прочитан, остается прежний (stalls), а кадры,
+ * время которых прошло, пропускаются, в том числе еще не начатые - чтение сразу перескакивает
+ * к текущему (dropped). Так видео идет с собственной скоростью при любой скорости диска, а
+ * статистика показывает, сколько кадров не успело.
+ *
+ * Пример
+ *
+ *   VideoTexture video;
+ *   video.gOpen("clip.y4m");
+ *   ...
+ *   video.gUpdate(glfwGetTime());          // раз в кадр
+ *   video.gBind(0);                        // Y, U, V на блоки 0, 1, 2
+ *   shader->use();
+ *   shader->setInt("lumaTexture", 0);      // и chromaU - 1, chromaV - 2
+ *   shader->setBool("fullRange", video.getFile().isFullRange());
+ *   ...
+ *   video.gClose();                        // в gFinalize
+ */
+
+#ifndef _VIDEO_TEXTURE_INCLUDED_H_
+#define _VIDEO_TEXTURE_INCLUDED_H_
+
+#include "glad/glad.h"
+#include "y4m_file.h"
+
+#include <mutex>
+#include <vector>
+
+#define VIDEO_TEXTURE_RING          4           // буферов в кольце: кадров, читаемых наперед
+#define VIDEO_TEXTURE_THREADS       2           // потоков чтения кадров
+
+class ThreadPool;
+
+struct VideoTextureStats {
+    size_t      presented;          // кадров загружено в текстуры и показано
+    size_t      dropped;            // кадров пропущено, потому что их время прошло
+    size_t      stalls;             // обновлений, в которые нужный кадр еще не был прочитан
+    size_t      failed;             // кадров, которые не прочитались
+    size_t      pending;            // кадров читается или прочитано наперед
+    size_t      frame;              // номер показанного кадра в файле
+    GLuint64    bytesRead;          // прочитано с диска за все время
+};
+
+class VideoTexture {
+public:
+    VideoTexture();
+    ~VideoTexture();
+
+    /**
+     * \brief Открывает файл и создает текстуры и кольцо буферов.
+     * \param loop  Начинать сначала после последнего кадра; иначе последний кадр остается
+     * \return false, если файл не открылся; сообщение выводится
+     */
+    bool gOpen(const char* path, bool loop = true);
+
+    /**
+     * \brief Дожидается начатых чтений и удаляет текстуры и буферы.
+     */
+    void gClose();
+
+    bool isOpen() const {
+        return m_File.isOpen();
+    }
+
+    const Y4MFile& getFile() const {
+        return m_File;
+    }
+
+    /**
+     * \brief Показывает кадр, время которого пришло к моменту time (в секундах, например
+     * glfwGetTime()), и начинает чтение следующих. Раз в кадр, до gBind.
+     */
+    void gUpdate(double time);
+
+    /**
+     * \brief Привязывает текстуры Y, U и V к блокам firstUnit, firstUnit + 1 и firstUnit + 2.
+     */
+    void gBind(GLuint firstUnit) const;
+
+    const VideoTextureStats& getStats() const {
+        return m_Stats;
+    }
+
+private:
+    VideoTexture(const VideoTexture&);
+    VideoTexture& operator=(const VideoTexture&);
+
+    // буфер кольца; поля, кроме state и ok, меняет только поток OpenGL
+    struct Slot {
+        enum State {
+            FREE,
+            READING,            // в пуле: чтение кадра в буфер
+            READY               // прочитан, ждет своего времени
+        };
+        State           state;          // под m_Mutex
+        bool            ok;             // под m_Mutex: кадр прочитался
+        size_t          frame;          // номер кадра при воспроизведении, растет и при повторе
+        GLuint          buffer;
+        void*           mapped;
+        std::vector<unsigned char> pixels;  // вместо буфера, если его не удалось отобразить
+    };
+
+    void gStartRead(Slot& slot, size_t frame);
+    void gUpload(Slot& slot);
+    void gRelease(Slot& slot);
+
+    size_t fileFrame(size_t frame) const {
+        return m_bLoop ? frame % m_File.getFrameCount() : frame;
+    }
+
+    Y4MFile                     m_File;
+    GLuint                      m_Textures[3];  // Y, U, V
+    std::vector<Slot>           m_Ring;
+    size_t                      m_Head;         // самый старый буфер в работе
+    size_t                      m_InFlight;     // буферов в работе, от m_Head по кольцу
+    size_t                      m_NextFrame;    // кадр, который будет читаться следующим
+    size_t                      m_Shown;        // показанный кадр; ~0 - еще ни одного
+    double                      m_Start;        // время показа первого кадра; < 0 - еще не было
+    bool                        m_bLoop;
+    std::mutex                  m_Mutex;
+    ThreadPool*                 m_pWorkers;
+    VideoTextureStats           m_Stats;
+}; // class VideoTexture
+
+#endif // _VIDEO_TEXTURE_INCLUDED_H_
@@ -0,0 +1,132 @@
+/*
+ * Чтение несжатого видео Y4M (YUV4MPEG2)
+ *
+ * Y4M - текстовый заголовок потока и кадры подряд, каждый после строки "FRAME":
+ *
+ *   YUV4MPEG2 W3840 H2160 F60:1 Ip A1:1 C420jpeg\n
+ *   FRAME\n[плоскость Y][плоскость U][плоскость V]
+ *   FRAME\n...
+ *
+ * Плоскости лежат без выравнивания строк: Y - width x height байт, U и V - getChromaWidth() x
+ * getChromaHeight() (для 4:2:0 вдвое меньше по каждой стороне с округлением вверх). Такие
+ * файлы пишут ffmpeg (-pix_fmt yuv420p), x264 и запись кадров примеров (см. frame_capture.h).
+ *
+ * Поддерживаются 8-битные 4:2:0 (C420, C420jpeg, C420paldv, C420mpeg2), 4:2:2 и 4:4:4. Строка
+ * кадра должна быть ровно "FRAME\n", без параметров (других ffmpeg не пишет): тогда все кадры
+ * одного размера, и кадр n ищется не разбором файла, а умножением. Файл читается напрямую с
+ * диска, а не через Vfs (см. vfs.h): видео не кладут в пакеты, а отображать гигабайты ради
+ * однократного последовательного чтения незачем.
+ *
+ * readFrame читает кадр одним вызовом pread прямо в буфер вызывающего и может вызываться из
+ * нескольких потоков одновременно. Система предупреждена, что файл читается подряд
+ * (POSIX_FADV_SEQUENTIAL), и сама читает вперед; readAhead просит прочитать кадр заранее.
+ *
+ * Пример
+ *
+ *   Y4MFile video;
+ *   if (video.open("clip.y4m")) {
+ *       std::vector<unsigned char> planes(video.getFrameBytes());
+ *       for (size_t i = 0; i < video.getFrameCount(); i++)
+ *           video.readFrame(i, planes.data());
+ *   }
+ */
+
+#ifndef _Y4M_FILE_INCLUDED_H_
+#define _Y4M_FILE_INCLUDED_H_
+
+#include <cstddef>
+
+class Y4MFile {
+public:
+    Y4MFile();
+    ~Y4MFile();
+
+    /**
+     * \return false, если файла нет или формат не поддерживается; сообщение выводится
+     */
+    bool open(const char* path);
+    void close();
+
+    bool isOpen() const {
+        return m_Fd >= 0;
+    }
+
+    int getWidth() const {
+        return m_Width;
+    }
+
+    int getHeight() const {
+        return m_Height;
+    }
+
+    int getChromaWidth() const {
+        return m_ChromaWidth;
+    }
+
+    int getChromaHeight() const {
+        return m_ChromaHeight;
+    }
+
+    /**
+     * \brief Кадров в секунду из тега F заголовка (по умолчанию 25).
+     */
+    double getFps() const {
+        return m_Fps;
+    }
+
+    /**
+     * \brief true, если в заголовке XCOLORRANGE=FULL: значения 0..255 вместо 16..235.
+     */
+    bool isFullRange() const {
+        return m_bFullRange;
+    }
+
+    size_t getFrameCount() const {
+        return m_FrameCount;
+    }
+
+    /**
+     * \brief Байт во всех плоскостях одного кадра, без строки "FRAME".
+     */
+    size_t getFrameBytes() const {
+        return m_FrameBytes;
+    }
+
+    size_t getLumaBytes() const {
+        return (size_t)m_Width * m_Height;
+    }
+
+    size_t getChromaBytes() const {
+        return (size_t)m_ChromaWidth * m_ChromaHeight;
+    }
+
+    /**
+     * \brief Читает плоскости кадра index в planes (getFrameBytes() байт).
+     * \return false при ошибке чтения или если кадр поврежден
+     */
+    bool readFrame(size_t index, unsigned char* planes) const;
+
+    /**
+     * \brief Просит систему заранее прочитать кадр index в кэш страниц; не ждет чтения.
+     */
+    void readAhead(size_t index) const;
+
+private:
+    Y4MFile(const Y4MFile&);
+    Y4MFile& operator=(const Y4MFile&);
+
+    bool parseHeader(const char* header);
+
+    int         m_Fd;                   // -1 - файл закрыт
+    int         m_Width;
+    int         m_Height;
+    int         m_ChromaWidth;
+    int         m_ChromaHeight;
+    double      m_Fps;
+    bool        m_bFullRange;
+    size_t      m_HeaderBytes;          // заголовок потока вместе с '\n'
+    size_t      m_FrameBytes;
+    size_t      m_FrameCount;
+}; // class Y4MFile
+
+#endif // _Y4M_FILE_INCLUDED_H_
@@ -49,6 +49,40 @@ namespace models {
     -0.5f,  0.5f,  0.5f,  0.0f, 0.0f,
     -0.5f,  0.5f, -0.5f,  0.0f, 1.0f
     };
+    /*
+     * Тот же куб в индексированном виде: уникальные вершины (грани делят вершины,
+     * у которых совпадают и координаты, и текстурные координаты) и индексы треугольников.
+     * Получен из cube_vertices функцией meshopt::weldVertices (см. include/mesh_optimizer.h).
+     */
+    GLfloat cube_indexed_vertices[] = {
+    // координаты         // текстурные координаты
+    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+     0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
+     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+     0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+     0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
+    -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+    -0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+     0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+     0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+     0.5f, -0.5f, -0.5f,  1.0f, 1.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f, 0.0f
+    };
+    GLuint cube_indices[] = {
+     0,  1,  2,   2,  3,  0,     // задняя грань
+     4,  5,  6,   6,  7,  4,     // передняя
+     8,  9, 10,  10,  4,  8,     // левая
+    11,  2, 12,  12, 13, 11,     // правая
+    10, 14,  5,   5,  4, 10,     // нижняя
+     3,  2, 11,  11, 15,  3      // верхняя
+    };
+    const GLsizei cube_vertex_count = 16;
+    const GLsizei cube_index_count  = 36;
 }   // namespace models
 
 #endif  // MODEL_CUBE_INCLUDED_H
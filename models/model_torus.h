@@ -0,0 +1,46 @@
+#ifndef MODEL_TORUS_INCLUDED_H
+#define MODEL_TORUS_INCLUDED_H
+
+#include <GL/gl.h>
+#include <cmath>
+#include <vector>
+
+namespace models {
+    /*
+     * Тор с rings x sides сегментами: 2 * rings * sides треугольников.
+     * Вершина - позиция (3 числа), нормаль (3 числа) и текстурные координаты (2 числа),
+     * как у мешей из include/mesh_import.h. Тор удобен для проверки загрузки больших
+     * мешей: при rings = sides = 1000 в нем два миллиона треугольников.
+     */
+    inline void make_torus(GLuint rings, GLuint sides, GLfloat radius, GLfloat tube,
+                           std::vector<GLfloat>& vertices, std::vector<GLuint>& indices) {
+        const GLfloat PI2 = 6.28318530718f;
+        vertices.clear();
+        indices.clear();
+        vertices.reserve((size_t)(rings + 1) * (sides + 1) * 8);
+        indices.reserve((size_t)rings * sides * 6);
+        for (GLuint i = 0; i <= rings; i++) {
+            GLfloat u = (GLfloat)i / rings;
+            GLfloat cu = cosf(u * PI2), su = sinf(u * PI2);
+            for (GLuint j = 0; j <= sides; j++) {
+                GLfloat v = (GLfloat)j / sides;
+                GLfloat cv = cosf(v * PI2), sv = sinf(v * PI2);
+                GLfloat vertex[8] = {
+                    (radius + tube * cv) * cu, tube * sv, (radius + tube * cv) * su,
+                    cv * cu, sv, cv * su,
+                    u, v
+                };
+                vertices.insert(vertices.end(), vertex, vertex + 8);
+            }
+        }
+        for (GLuint i = 0; i < rings; i++) {
+            for (GLuint j = 0; j < sides; j++) {
+                GLuint a = i * (sides + 1) + j, b = a + sides + 1;
+                GLuint quad[6] = { a, a + 1, b, b, a + 1, b + 1 };
+                indices.insert(indices.end(), quad, quad + 6);
+            }
+        }
+    }
+}   // namespace models
+
+#endif  // MODEL_TORUS_INCLUDED_H
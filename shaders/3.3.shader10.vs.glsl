@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 2) in vec2 texCoord;
+// матрица модели для каждого экземпляра занимает четыре слота: 3, 4, 5 и 6
+layout (location = 3) in mat4 instanceModel;
+
+out vec2 TexCoord;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    gl_Position = projection * view * instanceModel * vec4(position, 1.0f);
+    TexCoord = vec2(texCoord.x, 1.0 - texCoord.y);
+}
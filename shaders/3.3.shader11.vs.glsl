@@ -0,0 +1,23 @@
+#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 2) in vec2 texCoord;
+// номер объекта приходит как атрибут экземпляра (см. MeshBatch::enableObjectId)
+layout (location = 3) in uint objectId;
+
+out vec2 TexCoord;
+
+// матрицы моделей всех объектов: по четыре texel'а RGBA32F на матрицу
+uniform samplerBuffer models;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    int base = int(objectId) * 4;
+    mat4 model = mat4(texelFetch(models, base + 0),
+                      texelFetch(models, base + 1),
+                      texelFetch(models, base + 2),
+                      texelFetch(models, base + 3));
+    gl_Position = projection * view * model * vec4(position, 1.0f);
+    TexCoord = vec2(texCoord.x, 1.0 - texCoord.y);
+}
@@ -0,0 +1,29 @@
+#version 330 core
+
+out vec4 FragColor;
+in vec2 TexCoord;
+
+uniform sampler2D ourTexture;
+uniform vec2 lodDither;
+
+/*
+    Плавная смена уровня детализации без прозрачности. Пока идет переход, объект рисуется дважды:
+    новый уровень с lodDither = (0, fade), старый - с lodDither = (fade, 1). Порог из матрицы Байера 4x4
+    у каждого пикселя свой, поэтому каждый пиксель экрана достается ровно одному из уровней, а доля
+    пикселей нового уровня растет вместе с fade. Вне перехода lodDither = (0, 1) и ничего не отбрасывается.
+*/
+const float bayer[16] = float[16](
+     0.0 / 16.0,  8.0 / 16.0,  2.0 / 16.0, 10.0 / 16.0,
+    12.0 / 16.0,  4.0 / 16.0, 14.0 / 16.0,  6.0 / 16.0,
+     3.0 / 16.0, 11.0 / 16.0,  1.0 / 16.0,  9.0 / 16.0,
+    15.0 / 16.0,  7.0 / 16.0, 13.0 / 16.0,  5.0 / 16.0
+);
+
+void main()
+{
+    ivec2 p = ivec2(gl_FragCoord.xy) & 3;
+    float threshold = bayer[p.y * 4 + p.x];
+    if (threshold < lodDither.x || threshold >= lodDither.y)
+        discard;
+    FragColor = texture(ourTexture, TexCoord);
+}
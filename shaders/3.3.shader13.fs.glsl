@@ -0,0 +1,35 @@
+#version 330 core
+
+out vec4 FragColor;
+in vec2 TexCoord;
+
+uniform sampler2D source;
+uniform vec2 uvScale;
+uniform vec2 texelSize;
+uniform float sharpness;
+
+/*
+    Растяжение кадра, нарисованного в левый нижний угол буфера, на все окно. Координаты
+    сжимаются в uvScale и не выходят за половину текселя от края нарисованной области, иначе
+    билинейная фильтрация подмешала бы пиксели прошлых кадров большего размера.
+
+    При sharpness > 0 к билинейному результату добавляется разность с четырьмя соседями
+    (лапласиан). Результат ограничивается наименьшим и наибольшим из соседей, чтобы на
+    контрастных краях не появлялись светлые и темные ореолы.
+*/
+void main()
+{
+    vec2 uv = clamp(TexCoord * uvScale, texelSize * 0.5, uvScale - texelSize * 0.5);
+    vec3 c = texture(source, uv).rgb;
+    if (sharpness > 0.0) {
+        vec2 lo = texelSize * 0.5, hi = uvScale - texelSize * 0.5;
+        vec3 n = texture(source, clamp(uv + vec2(0.0, texelSize.y), lo, hi)).rgb;
+        vec3 s = texture(source, clamp(uv - vec2(0.0, texelSize.y), lo, hi)).rgb;
+        vec3 e = texture(source, clamp(uv + vec2(texelSize.x, 0.0), lo, hi)).rgb;
+        vec3 w = texture(source, clamp(uv - vec2(texelSize.x, 0.0), lo, hi)).rgb;
+        vec3 minimum = min(c, min(min(n, s), min(e, w)));
+        vec3 maximum = max(c, max(max(n, s), max(e, w)));
+        c = clamp(c + (4.0 * c - (n + s + e + w)) * sharpness * 0.25, minimum, maximum);
+    }
+    FragColor = vec4(c, 1.0);
+}
@@ -0,0 +1,15 @@
+#version 330 core
+
+out vec2 TexCoord;
+
+/*
+    Полноэкранный треугольник без вершинного буфера: вершины 0, 1, 2 дают точки (0, 0), (2, 0)
+    и (0, 2), треугольник накрывает весь экран, а лишнее отсекается. Одного треугольника
+    достаточно, и по диагонали экрана нет шва, как у пары треугольников.
+*/
+void main()
+{
+    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    TexCoord = p;
+    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+}
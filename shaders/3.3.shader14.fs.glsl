@@ -0,0 +1,23 @@
+#version 330 core
+
+out vec4 FragColor;
+in vec2 TexCoord;
+
+uniform sampler2D ourTexture;
+uniform int workload;
+
+/*
+    Нарочно тяжелый фрагментный шейдер: время кадра растет с числом пикселей и с workload,
+    поэтому на нем хорошо видно, как динамическое разрешение удерживает бюджет кадра.
+*/
+void main()
+{
+    vec2 p = TexCoord;
+    float glow = 0.0;
+    for (int i = 0; i < workload; i++) {
+        p = vec2(sin(p.y * 3.1 + float(i)), cos(p.x * 2.7 - float(i))) * 0.5 + 0.5;
+        glow += p.x * p.y;
+    }
+    vec4 color = texture(ourTexture, TexCoord);
+    FragColor = vec4(color.rgb * (0.75 + 0.25 * fract(glow)), color.a);
+}
@@ -0,0 +1,18 @@
+#version 330 core
+
+out vec4 FragColor;
+in vec2 TexCoord;
+
+uniform sampler2DArray ourTextures;
+uniform float layer;
+
+/*
+    Все изображения лежат в слоях одного массива текстур (см. include/texture_packer.h), поэтому
+    текстура привязывается один раз на кадр, а материал выбирается номером слоя. Третья координата
+    выборки из sampler2DArray - номер слоя, он округляется до ближайшего целого.
+*/
+
+void main()
+{
+    FragColor = texture(ourTextures, vec3(TexCoord, layer));
+}
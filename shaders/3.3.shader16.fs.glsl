@@ -0,0 +1,19 @@
+#version 330 core
+
+out vec4 FragColor;
+in vec2 TexCoord;
+
+uniform sampler2D atlas;
+uniform vec4 region;
+
+/*
+    Все изображения лежат в одном атласе (см. include/texture_packer.h). Материал задает
+    прямоугольник своего изображения: region.xy - смещение, region.zw - размер в координатах атласа.
+    Повтор текстуры в атласе невозможен, поэтому координаты ограничиваются отрезком [0, 1];
+    на краях выборка попадает в рамку из повторенных крайних текселей, а не в соседнее изображение.
+*/
+
+void main()
+{
+    FragColor = texture(atlas, region.xy + clamp(TexCoord, 0.0, 1.0) * region.zw);
+}
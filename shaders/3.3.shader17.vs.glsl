@@ -0,0 +1,19 @@
+#version 330 core
+layout (location = 0) in vec2 position;
+layout (location = 2) in vec3 texCoord;
+
+out vec3 TexCoord;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+/*
+    Плитки огромного изображения (см. include/tiled_image.h) лежат в плоскости z = 0. Текстурные
+    координаты уже указывают внутрь плитки, а третья - номер ее слоя в кэше плиток.
+*/
+
+void main()
+{
+    gl_Position = projection * view * vec4(position, 0.0, 1.0);
+    TexCoord = texCoord;
+}
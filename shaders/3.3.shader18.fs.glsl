@@ -0,0 +1,34 @@
+#version 330 core
+
+out vec4 FragColor;
+in vec3 ourColor;
+in vec2 TexCoord;
+
+uniform sampler2D lumaTexture;
+uniform sampler2D chromaU;
+uniform sampler2D chromaV;
+uniform bool fullRange;
+
+/*
+    Кадр видео приходит тремя плоскостями YUV (см. include/video_texture.h): яркость во весь
+    размер и цветность, обычно вдвое меньше по каждой стороне. Текстурные координаты у всех
+    плоскостей одни и те же, поэтому цветность растягивается билинейной фильтрацией сама.
+
+    Цвета переводятся по BT.601, как их записывает writeY4MFrame (см. include/image_write.h).
+    В ограниченном диапазоне яркость занимает 16..235, а цветность 16..240 (из 0..255),
+    в полном - весь диапазон.
+*/
+
+// столбцы матрицы: вклад Y, U и V в R, G и B
+const mat3 YUV_TO_RGB = mat3(1.0,       1.0,        1.0,
+                             0.0,      -0.344136,   1.772,
+                             1.402,    -0.714136,   0.0);
+
+void main()
+{
+    vec3 yuv = vec3(texture(lumaTexture, TexCoord).r, texture(chromaU, TexCoord).r,
+                    texture(chromaV, TexCoord).r) - vec3(0.0, 128.0 / 255.0, 128.0 / 255.0);
+    if (!fullRange)
+        yuv = (yuv - vec3(16.0 / 255.0, 0.0, 0.0)) * vec3(255.0 / 219.0, 255.0 / 224.0, 255.0 / 224.0);
+    FragColor = vec4(clamp(YUV_TO_RGB * yuv, 0.0, 1.0), 1.0);
+}
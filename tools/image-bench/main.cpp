@@ -0,0 +1,236 @@
+/*
+ * Сравнение декодеров изображений (см. include/image_decoder.h).
+ *
+ * Использование:
+ *
+ *   image-bench [--channels N] [--runs N] каталог|файл...
+ *   image-bench --cache каталог_кэша [--channels N] каталог|файл...
+ *
+ *   --channels N   декодировать в N каналов (по умолчанию 4, как TexturePacker)
+ *   --runs N       прогонов на файл, берется лучший (по умолчанию 5)
+ *   --cache DIR    сравнить холодный и теплый запуск с кэшем изображений (см. image_cache.h)
+ *
+ * Каждый файл декодируется каждой библиотекой, которая понимает его формат, в один и тот же
+ * буфер. Выводится скорость в мегабайтах файла и мегапикселях в секунду и PSNR относительно
+ * stb_image (декодеры JPEG по-разному округляют IDCT и интерполяцию цветности), а в конце -
+ * итог по всем файлам и порядок, в котором imageDecoders() выбирает библиотеки.
+ *
+ * С --cache все файлы загружаются через loadCachedImage трижды, как их загрузил бы
+ * TextureManager при запуске: без кэша (только декодирование уровня 0, mip-уровни строил бы
+ * glGenerateMipmap), с пустым кэшем (декодирование, mip-уровни и запись) и с заполненным
+ * (отображение файлов кэша). Пиксели всех уровней каждый раз прочитываются, как их прочитал бы
+ * glTexImage2D.
+ *
+ *   cd bin && ./image-bench ../textures
+ *   cd bin && ./image-bench --cache image-cache ../textures
+ */
+
+#include "image_cache.h"
+#include "image_decoder.h"
+#include "vfs.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static double secondsSince(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void usage() {
+    std::cout << "Usage: image-bench [--channels N] [--runs N] directory|file..." << std::endl
+              << "       image-bench --cache cache-directory [--channels N] directory|file..." << std::endl;
+}
+
+static void collect(const std::string& path, std::vector<std::string>& files) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return;
+    if (S_ISREG(st.st_mode)) {
+        files.push_back(path);
+        return;
+    }
+    DIR* dir = S_ISDIR(st.st_mode) ? opendir(path.c_str()) : nullptr;
+    if (!dir)
+        return;
+    std::vector<std::string> names;
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.')
+            names.push_back(entry->d_name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    for (size_t i = 0; i < names.size(); i++)
+        collect(path + "/" + names[i], files);
+}
+
+static double psnr(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b) {
+    double sum = 0.0;
+    for (size_t i = 0; i < a.size(); i++) {
+        double d = (double)a[i] - b[i];
+        sum += d * d;
+    }
+    if (sum == 0.0)
+        return INFINITY;
+    return 10.0 * log10(255.0 * 255.0 * a.size() / sum);
+}
+
+// сумма всех байт всех уровней: заставляет прочитать каждую страницу отображения
+static unsigned long checksum(const CachedImage& image) {
+    unsigned long sum = 0;
+    for (size_t i = 0; i < image.getLevelCount(); i++) {
+        const CachedLevel& level = image.getLevel(i);
+        for (size_t j = 0; j < level.size; j += 64)
+            sum += level.data[j];
+    }
+    return sum;
+}
+
+// сумма нужна только затем, чтобы оптимизатор не выбросил чтение
+static volatile unsigned long s_sink;
+
+// загрузка всех файлов, как при запуске примера; false, если какой-то файл не загрузился
+static bool loadAll(const std::vector<std::string>& files, int channels, double& seconds, size_t& bytes) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    unsigned long sum = 0;
+    bytes = 0;
+    for (size_t f = 0; f < files.size(); f++) {
+        CachedImage image;
+        if (!loadCachedImage(files[f].c_str(), channels, image)) {
+            std::cout << "Failed loading of the image " << files[f] << std::endl;
+            return false;
+        }
+        sum += checksum(image);
+        for (size_t i = 0; i < image.getLevelCount(); i++)
+            bytes += image.getLevel(i).size;
+    }
+    seconds = secondsSince(start);
+    s_sink = sum;
+    return true;
+}
+
+static int benchCache(const std::string& directory, const std::vector<std::string>& files, int channels) {
+    ImageCache& cache = ImageCache::current();
+    double none, cold, warm;
+    size_t noneBytes, cacheBytes;
+    cache.setDirectory("");
+    if (!loadAll(files, channels, none, noneBytes))
+        return 1;
+    // холодный запуск: записи этих файлов удаляются, даже если они есть
+    cache.setDirectory(directory);
+    for (size_t f = 0; f < files.size(); f++) {
+        VfsFile file;
+        if (Vfs::current().read(files[f].c_str(), file))
+            unlink(cache.getPath(hashBytes(file.data(), file.size()), file.size(), channels).c_str());
+    }
+    if (!loadAll(files, channels, cold, cacheBytes) || !loadAll(files, channels, warm, cacheBytes))
+        return 1;
+    ImageCacheStats stats = cache.getStats();
+    std::cout << files.size() << " files, " << channels << " channels" << std::endl
+              << "  no cache:   " << none * 1000.0 << " ms (level 0 only, " << noneBytes / 1024 << " KB)" << std::endl
+              << "  cold cache: " << cold * 1000.0 << " ms (decode, mipmaps and store)" << std::endl
+              << "  warm cache: " << warm * 1000.0 << " ms (" << cacheBytes / 1024 << " KB with mipmaps), "
+              << none / warm << "x faster than no cache" << std::endl
+              << "  hits " << stats.hits << ", misses " << stats.misses << ", stored " << stats.stores
+              << " files, " << stats.bytesStored / 1024 << " KB in " << directory << std::endl;
+    return 0;
+} // benchCache
+
+struct Total {
+    double  seconds;
+    double  megabytes;
+    double  megapixels;
+};
+
+int main(int argc, char** argv) {
+    int channels = 4, runs = 5;
+    const char* cacheDirectory = nullptr;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+            cacheDirectory = argv[++i];
+        else if (strcmp(argv[i], "--channels") == 0 && i + 1 < argc)
+            channels = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+            runs = std::max(1, atoi(argv[++i]));
+        else
+            collect(argv[i], files);
+    }
+    if (files.empty() || channels < 1 || channels > 4) {
+        usage();
+        return 1;
+    }
+    if (cacheDirectory)
+        return benchCache(cacheDirectory, files, channels);
+
+    const std::vector<ImageDecoder*>& decoders = imageDecoders();
+    std::map<std::string, Total> totals;
+    std::vector<unsigned char> reference, pixels;
+    for (size_t f = 0; f < files.size(); f++) {
+        VfsFile file;
+        ImageInfo info;
+        if (!Vfs::current().read(files[f].c_str(), file) || !getImageInfo(file.data(), file.size(), info))
+            continue;
+        double megabytes = file.size() / 1e6, megapixels = (double)info.width * info.height / 1e6;
+        std::cout << files[f] << ": " << info.width << " x " << info.height << ", " << file.size() / 1024 << " KB"
+                  << std::endl;
+        size_t bytes = (size_t)info.width * info.height * channels;
+        reference.clear();
+        for (size_t d = 0; d < decoders.size(); d++) {
+            ImageInfo own;
+            if (!decoders[d]->getInfo(file.data(), file.size(), own))
+                continue;
+            pixels.assign(bytes, 0);
+            double best = INFINITY;
+            bool ok = true;
+            for (int run = 0; ok && run < runs; run++) {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                ok = decoders[d]->decode(file.data(), file.size(), channels, pixels.data());
+                best = std::min(best, secondsSince(start));
+            }
+            std::cout << "  " << decoders[d]->getName() << ": ";
+            if (!ok) {
+                std::cout << "failed" << std::endl;
+                continue;
+            }
+            std::cout << best * 1000.0 << " ms, " << megabytes / best << " MB/s, " << megapixels / best << " MP/s";
+            if (strcmp(decoders[d]->getName(), "stb_image") == 0)
+                reference = pixels;
+            std::cout << std::endl;
+            Total& total = totals[decoders[d]->getName()];
+            total.seconds += best;
+            total.megabytes += megabytes;
+            total.megapixels += megapixels;
+        }
+        // PSNR считается, когда эталон stb_image уже есть
+        for (size_t d = 0; !reference.empty() && d < decoders.size(); d++) {
+            if (strcmp(decoders[d]->getName(), "stb_image") == 0 || !decoders[d]->getInfo(file.data(), file.size(), info))
+                continue;
+            pixels.assign(bytes, 0);
+            if (decoders[d]->decode(file.data(), file.size(), channels, pixels.data()))
+                std::cout << "  " << decoders[d]->getName() << " vs stb_image: PSNR " << psnr(reference, pixels) << " dB"
+                          << std::endl;
+        }
+    }
+
+    std::cout << "total:" << std::endl;
+    for (std::map<std::string, Total>::const_iterator it = totals.begin(); it != totals.end(); ++it) {
+        std::cout << "  " << it->first << ": " << it->second.megabytes / it->second.seconds << " MB/s, "
+                  << it->second.megapixels / it->second.seconds << " MP/s" << std::endl;
+    }
+    std::cout << "selection order:";
+    for (size_t d = 0; d < decoders.size(); d++)
+        std::cout << (d ? ", " : " ") << decoders[d]->getName();
+    std::cout << std::endl;
+    return 0;
+} // main
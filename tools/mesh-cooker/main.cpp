@@ -0,0 +1,245 @@
+/*
+ * Утилита подготовки мешей: переводит OBJ/glTF в двоичный формат .mesh (см. include/mesh_file.h).
+ *
+ * Использование:
+ *
+ *   mesh-cooker [--quantize] [--no-optimize] [--lods N] [--threads N] [--bench] input.obj|input.gltf|input.glb output.mesh
+ *   mesh-cooker --torus N output.obj
+ *
+ *   --quantize     сжать вершины: позиция Half3, нормаль SNorm10x3, координаты UNorm16x2
+ *                  (16 байт на вершину вместо 32, см. include/vertex_layout.h); если координаты
+ *                  выходят за [0, 1] (повторяющаяся текстура), они сохраняются в Half2
+
+ *   --no-optimize  не переставлять вершины и треугольники (meshopt::optimizeMesh)
+ *   --lods N       построить цепочку из N уровней детализации, каждый вдвое проще предыдущего
+ *                  (см. include/mesh_simplify.h; не больше MESH_MAX_LODS)
+ *   --threads N    разбирать OBJ в N потоков (по умолчанию - по числу ядер)
+ *   --bench        после записи сравнить время импорта исходника и загрузки .mesh,
+ *                  а для OBJ еще и скорость импорта в 1, 2, 4... потока
+ *   --torus N      записать тор с N x N сегментами (2 * N * N треугольников) в OBJ,
+ *                  чтобы было на чем проверять большие меши
+ *
+ * Загрузка .mesh здесь измеряется без GPU: отображение файла и чтение всех его страниц.
+ * Загрузку вместе с glBufferData показывает пример 18-mesh-file.
+ */
+
+#include "mesh_file.h"
+#include "mesh_import.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplify.h"
+#include "vertex_layout.h"
+#include "model_torus.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include <iostream>
+#include <thread>
+
+// формат сжатых вершин
+typedef VertexLayout< VertexAttr<0, vfmt::Half3>,
+                      VertexAttr<1, vfmt::SNorm10x3>,
+                      VertexAttr<2, vfmt::UNorm16x2> > PackedLayout;
+// то же для координат вне [0, 1]: UNorm16x2 обрезал бы их, а Half2 занимает те же 4 байта
+typedef VertexLayout< VertexAttr<0, vfmt::Half3>,
+                      VertexAttr<1, vfmt::SNorm10x3>,
+                      VertexAttr<2, vfmt::Half2> > PackedWrapLayout;
+
+// собирает атрибуты формата для MeshData
+struct AttributeList {
+    std::vector<MeshAttribute> attributes;
+    void setAttribute(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei offset) {
+        MeshAttribute a = { index, size, type, normalized, (GLuint)offset };
+        attributes.push_back(a);
+    }
+};
+
+// текстурные координаты вершин importMesh (8 чисел на вершину, координаты - последние два)
+static bool texCoordsInUnitRange(const MeshData& mesh) {
+    const GLfloat* v = (const GLfloat*)mesh.vertices.data();
+    for (size_t i = 0; i < mesh.vertexCount() * 8; i += 8)
+        if (!(v[i + 6] >= 0.0f && v[i + 6] <= 1.0f && v[i + 7] >= 0.0f && v[i + 7] <= 1.0f))
+            return false;
+    return true;
+}
+
+static double secondsSince(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static size_t fileSize(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return 0;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size > 0 ? size : 0;
+}
+
+static void usage() {
+    std::cout << "Usage: mesh-cooker [--quantize] [--no-optimize] [--lods N] [--threads N] [--bench] input output.mesh" << std::endl
+              << "       mesh-cooker --torus N output.obj" << std::endl;
+}
+
+static int writeTorus(int segments, const char* path) {
+    std::vector<GLfloat> vertices;
+    std::vector<GLuint> indices;
+    models::make_torus(segments, segments, 1.0f, 0.3f, vertices, indices);
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        std::cout << "Failed writing of " << path << std::endl;
+        return 1;
+    }
+    for (size_t i = 0; i < vertices.size(); i += 8)
+        fprintf(file, "v %f %f %f\n", vertices[i], vertices[i + 1], vertices[i + 2]);
+    for (size_t i = 0; i < vertices.size(); i += 8)
+        fprintf(file, "vt %f %f\n", vertices[i + 6], vertices[i + 7]);
+    for (size_t i = 0; i < vertices.size(); i += 8)
+        fprintf(file, "vn %f %f %f\n", vertices[i + 3], vertices[i + 4], vertices[i + 5]);
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        GLuint a = indices[i] + 1, b = indices[i + 1] + 1, c = indices[i + 2] + 1;
+        fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+    }
+    fclose(file);
+    std::cout << path << ": " << indices.size() / 3 << " triangles" << std::endl;
+    return 0;
+} // writeTorus
+
+int main(int argc, char** argv) {
+    bool quantize = false, optimize = true, bench = false;
+    unsigned threads = 0, lods = 1;
+    const char* input = nullptr;
+    const char* output = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quantize") == 0)
+            quantize = true;
+        else if (strcmp(argv[i], "--no-optimize") == 0)
+            optimize = false;
+        else if (strcmp(argv[i], "--bench") == 0)
+            bench = true;
+        else if (strcmp(argv[i], "--lods") == 0 && i + 1 < argc)
+            lods = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--torus") == 0 && i + 2 < argc)
+            return writeTorus(atoi(argv[i + 1]), argv[i + 2]);
+        else if (!input)
+            input = argv[i];
+        else if (!output)
+            output = argv[i];
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (!input || !output) {
+        usage();
+        return 1;
+    }
+
+    //---------------------------
+    // Импорт
+    //---------------------------
+    MeshData mesh;
+    MeshImportStats stats;
+    if (!importMesh(input, mesh, threads, &stats))
+        return 1;
+    double importTime = stats.seconds;
+    size_t sourceSize = stats.bytes;
+    std::cout << input << ": " << mesh.vertexCount() << " vertices, " << mesh.indices.size() / 3 << " triangles, "
+              << "import " << importTime * 1000.0 << " ms (" << stats.megabytesPerSecond() << " MB/s, "
+              << stats.threads << (stats.threads == 1 ? " thread)" : " threads)") << std::endl;
+
+    //---------------------------
+    // Обработка
+    //---------------------------
+    std::chrono::steady_clock::time_point start;
+    if (optimize) {
+        start = std::chrono::steady_clock::now();
+        meshopt::OptimizeReport report = meshopt::optimizeMesh(mesh.vertices, mesh.vertexStride, mesh.indices);
+        std::cout << "optimize " << secondsSince(start) * 1000.0 << " ms: vertices "
+                  << report.vertexCountBefore << " -> " << report.vertexCountAfter
+                  << ", ACMR " << report.before.acmr << " -> " << report.after.acmr
+                  << ", ATVR " << report.before.atvr << " -> " << report.after.atvr << std::endl;
+    }
+    if (lods > 1) {
+        start = std::chrono::steady_clock::now();
+        size_t levels = meshopt::generateLods(mesh, lods);
+        std::cout << "LOD chain " << secondsSince(start) * 1000.0 << " ms:" << std::endl;
+        for (size_t i = 0; i < levels; i++) {
+            std::cout << "  LOD " << i << ": " << mesh.lods[i].indexCount / 3 << " triangles, error "
+                      << mesh.lods[i].error << std::endl;
+        }
+    }
+    mesh.computeBounds();
+    if (quantize) {
+        std::vector<unsigned char> packed;
+        AttributeList list;
+        if (texCoordsInUnitRange(mesh)) {
+            PackedLayout::pack((const GLfloat*)mesh.vertices.data(), mesh.vertexCount(), packed);
+            PackedLayout::describe(list);
+            mesh.vertexStride = PackedLayout::stride;
+        }
+        else {
+            std::cout << "texture coordinates outside [0, 1]: stored as Half2" << std::endl;
+            PackedWrapLayout::pack((const GLfloat*)mesh.vertices.data(), mesh.vertexCount(), packed);
+            PackedWrapLayout::describe(list);
+            mesh.vertexStride = PackedWrapLayout::stride;
+        }
+        mesh.vertices.swap(packed);
+        mesh.attributes = list.attributes;
+    }
+
+    start = std::chrono::steady_clock::now();
+    if (!writeMeshFile(output, mesh))
+        return 1;
+    size_t cookedSize = fileSize(output);
+    std::cout << output << ": " << cookedSize / 1024 << " KB (source " << sourceSize / 1024 << " KB), "
+              << "write " << secondsSince(start) * 1000.0 << " ms" << std::endl;
+
+    //---------------------------
+    // Сравнение времени загрузки
+    //---------------------------
+    if (bench) {
+        // файл уже в кэше страниц, так что измеряется именно разбор
+        const char* ext = strrchr(input, '.');
+        if (ext && strcasecmp(ext, ".obj") == 0) {
+            unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+            double single = 0.0;
+            std::cout << "import scaling:" << std::endl;
+            for (unsigned n = 1; ; n = std::min(n * 2, cores)) {
+                MeshData copy;
+                MeshImportStats run;
+                if (!importMesh(input, copy, n, &run))
+                    return 1;
+                if (n == 1)
+                    single = run.seconds;
+                std::cout << "  " << run.threads << (run.threads == 1 ? " thread:  " : " threads: ")
+                          << run.seconds * 1000.0 << " ms (" << run.megabytesPerSecond() << " MB/s, "
+                          << single / run.seconds << "x)" << std::endl;
+                if (n == cores || run.threads < n)
+                    break;
+            }
+        }
+        start = std::chrono::steady_clock::now();
+        MeshFile file;
+        if (!file.open(output))
+            return 1;
+        // читаем по байту с каждой страницы, как это сделал бы glBufferData
+        const unsigned char* bytes = (const unsigned char*)file.vertexData() - file.header().vertexOffset;
+        volatile unsigned checksum = 0;
+        for (size_t offset = 0; offset < file.fileSize(); offset += 4096)
+            checksum += bytes[offset];
+        double loadTime = secondsSince(start);
+        const double MB = 1024.0 * 1024.0;
+        std::cout << "source import: " << importTime * 1000.0 << " ms (" << sourceSize / MB / importTime << " MB/s)" << std::endl
+                  << "cooked load:   " << loadTime * 1000.0 << " ms (" << cookedSize / MB / loadTime << " MB/s)"
+                  << ", " << importTime / loadTime << "x faster" << std::endl
+                  << "(the cooked file is likely still in the page cache; drop caches for a cold measurement)" << std::endl;
+    }
+    return 0;
+} // main
@@ -0,0 +1,145 @@
+/*
+ * Замер программного отсечения невидимых объектов (см. include/occlusion_culler.h) без окна и GPU.
+ *
+ * Сцена - "город": сетка высоких зданий-заслонителей и множество маленьких кубов между ними.
+ * Камера едет по кругу на высоте человеческого роста, поэтому большая часть кубов закрыта домами.
+ * Для каждого числа потоков (1, 2, 4... по числу ядер) выводится время рисования заслонителей,
+ * время проверки кубов и доля отброшенных кубов - отдельно только за краями экрана
+ * и с учетом заслонителей.
+ *
+ * Использование:
+ *
+ *   occlusion-bench [--frames N] [--boxes N] [--size WxH]
+ */
+
+#include "occlusion_culler.h"
+#include "model_cube.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#define CITY_SIZE       8           // зданий по каждой оси
+#define CITY_SPACING    12.0f
+
+struct Result {
+    double  rasterizeMs;
+    double  testMs;
+    double  culled;                 // доля отброшенных
+    size_t  occluderTriangles;
+};
+
+static std::vector<glm::mat4> makeBuildings() {
+    std::vector<glm::mat4> buildings;
+    for (int z = 0; z < CITY_SIZE; z++) {
+        for (int x = 0; x < CITY_SIZE; x++) {
+            glm::vec3 center((x - CITY_SIZE / 2 + 0.5f) * CITY_SPACING, 4.0f, (z - CITY_SIZE / 2 + 0.5f) * CITY_SPACING);
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), center);
+            buildings.push_back(glm::scale(model, glm::vec3(7.0f, 8.0f, 7.0f)));
+        }
+    }
+    return buildings;
+}
+
+// маленькие кубы на улицах, min и max подряд
+static std::vector<GLfloat> makeBoxes(size_t count) {
+    std::vector<GLfloat> bounds;
+    srand(1);
+    const GLfloat half = CITY_SIZE * CITY_SPACING * 0.5f;
+    while (bounds.size() < count * 6) {
+        GLfloat x = (rand() / (GLfloat)RAND_MAX * 2.0f - 1.0f) * half;
+        GLfloat z = (rand() / (GLfloat)RAND_MAX * 2.0f - 1.0f) * half;
+        GLfloat y = rand() / (GLfloat)RAND_MAX * 3.0f;
+        // внутри здания куб не нужен
+        GLfloat fx = fmodf(x + half, CITY_SPACING) - CITY_SPACING * 0.5f;
+        GLfloat fz = fmodf(z + half, CITY_SPACING) - CITY_SPACING * 0.5f;
+        if (fabsf(fx) < 4.0f && fabsf(fz) < 4.0f)
+            continue;
+        GLfloat box[6] = { x - 0.25f, y, z - 0.25f, x + 0.25f, y + 0.5f, z + 0.25f };
+        bounds.insert(bounds.end(), box, box + 6);
+    }
+    return bounds;
+}
+
+static glm::mat4 cameraAt(int frame, int frames, int width, int height) {
+    // по кругу вдоль улицы между зданиями
+    float angle = 6.2831853f * frame / frames;
+    float radius = CITY_SPACING * 2.0f;
+    glm::vec3 eye(radius * cosf(angle), 1.7f, radius * sinf(angle));
+    glm::vec3 forward(-sinf(angle), 0.0f, cosf(angle));
+    glm::mat4 view = glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), (float)width / height, 0.1f, 200.0f);
+    return projection * view;
+}
+
+static Result run(unsigned threads, int frames, int width, int height, bool occluders,
+                  const std::vector<glm::mat4>& buildings, const std::vector<GLfloat>& bounds) {
+    OcclusionCuller culler(width, height, threads);
+    std::vector<unsigned char> visible(bounds.size() / 6);
+    Result result = { 0.0, 0.0, 0.0, 0 };
+    for (int frame = 0; frame < frames; frame++) {
+        culler.beginFrame(cameraAt(frame, frames, width, height));
+        if (occluders) {
+            for (size_t i = 0; i < buildings.size(); i++) {
+                culler.addOccluder(models::cube_indexed_vertices, 5 * sizeof(GLfloat), models::cube_indices,
+                                   models::cube_index_count, buildings[i]);
+            }
+        }
+        culler.rasterize();
+        culler.testBoxes(bounds.data(), visible.size(), visible.data());
+        const OcclusionStats& stats = culler.getStats();
+        result.rasterizeMs += stats.rasterizeMs;
+        result.testMs += stats.testMs;
+        result.culled += (double)stats.culled / stats.tested;
+        result.occluderTriangles += stats.occluderTriangles;
+    }
+    result.rasterizeMs /= frames;
+    result.testMs /= frames;
+    result.culled /= frames;
+    result.occluderTriangles /= frames;
+    return result;
+} // run
+
+int main(int argc, char** argv) {
+    int frames = 200, width = 256, height = 128;
+    size_t boxCount = 20000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            frames = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--boxes") == 0 && i + 1 < argc)
+            boxCount = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%dx%d", &width, &height) == 2)
+            i++;
+        else {
+            std::cout << "Usage: occlusion-bench [--frames N] [--boxes N] [--size WxH]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<glm::mat4> buildings = makeBuildings();
+    std::vector<GLfloat> bounds = makeBoxes(boxCount);
+    std::cout << buildings.size() << " occluders, " << boxCount << " boxes, depth buffer " << width << "x" << height
+              << ", " << (OcclusionCuller::hasAvx2() ? "AVX2" : "scalar") << " rasterizer, " << frames << " frames"
+              << std::endl;
+
+    Result frustum = run(1, frames, width, height, false, buildings, bounds);
+    std::cout << "frustum only: " << frustum.culled * 100.0 << "% culled" << std::endl;
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1; ; threads = std::min(threads * 2, cores)) {
+        Result r = run(threads, frames, width, height, true, buildings, bounds);
+        printf("%2u thread(s): %zu occluder triangles, rasterize %.3f ms, test %.3f ms, total %.3f ms/frame, "
+               "%.1f%% culled\n", threads, r.occluderTriangles, r.rasterizeMs, r.testMs,
+               r.rasterizeMs + r.testMs, r.culled * 100.0);
+        if (threads == cores)
+            break;
+    }
+    return 0;
+} // main
@@ -0,0 +1,174 @@
+/*
+ * Утилита сборки пакетов ресурсов .pak (см. include/pak_file.h и include/vfs.h).
+ *
+ * Использование:
+ *
+ *   pak-builder [--bench] output.pak каталог|файл...
+ *   pak-builder --list input.pak
+ *
+ *   --bench    после записи прочитать все файлы россыпью и из пакета, сравнить время и
+ *              проверить, что содержимое совпадает
+ *   --list     вывести оглавление пакета
+ *
+ * Каталоги обходятся рекурсивно, скрытые файлы пропускаются. Имя файла в пакете - его
+ * логическое имя (Vfs::logicalName), то есть путь без начальных "./" и "../":
+ *
+ *   cd bin && ./pak-builder assets.pak ../shaders ../textures
+ *
+ * кладет в пакет "shaders/..." и "textures/...", а примеры, запущенные из bin, подключают
+ * bin/assets.pak сами (см. include/application.h).
+ */
+
+#include "pak_file.h"
+#include "vfs.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+static double secondsSince(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void usage() {
+    std::cout << "Usage: pak-builder [--bench] output.pak directory|file..." << std::endl
+              << "       pak-builder --list input.pak" << std::endl;
+}
+
+// добавляет файл или все файлы каталога; имена в каталоге сортируются, чтобы пакет не зависел от ФС
+static bool collect(const std::string& path, std::vector<PakInput>& inputs) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        std::cout << "Failed loading of the file " << path << std::endl;
+        return false;
+    }
+    if (S_ISREG(st.st_mode)) {
+        std::string name = Vfs::logicalName(path.c_str());
+        if (name.empty()) {
+            std::cout << "Absolute path has no logical name: " << path << std::endl;
+            return false;
+        }
+        inputs.push_back(PakInput(name, path));
+        return true;
+    }
+    if (!S_ISDIR(st.st_mode))
+        return true;
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        std::cout << "Failed loading of the directory " << path << std::endl;
+        return false;
+    }
+    std::vector<std::string> names;
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.')
+            names.push_back(entry->d_name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    for (size_t i = 0; i < names.size(); i++) {
+        if (!collect(path + "/" + names[i], inputs))
+            return false;
+    }
+    return true;
+} // collect
+
+static int list(const char* path) {
+    PakFile pak;
+    if (!pak.open(path))
+        return 1;
+    size_t bytes = 0;
+    for (GLuint i = 0; i < pak.getEntryCount(); i++) {
+        const PakEntry& entry = pak.getEntry(i);
+        std::cout << "  " << pak.getName(i) << ": " << entry.size << " bytes at " << entry.offset << std::endl;
+        bytes += entry.size;
+    }
+    std::cout << path << ": " << pak.getEntryCount() << " files, " << bytes / 1024 << " KB" << std::endl;
+    return 0;
+}
+
+// сумма всех байт: заставляет прочитать каждую страницу отображения
+static unsigned long checksum(const VfsFile& file) {
+    unsigned long sum = 0;
+    for (size_t i = 0; i < file.size(); i++)
+        sum = sum * 31 + file.data()[i];
+    return sum;
+}
+
+/*
+ * Все файлы читаются через Vfs дважды: россыпью (open и mmap на каждый файл) и из пакета
+ * (поиск в оглавлении). Кэш ФС при этом уже прогрет записью пакета, так что разница - это
+ * стоимость открытия файлов, а не диска.
+ */
+static int bench(const char* output, const std::vector<PakInput>& inputs) {
+    Vfs& vfs = Vfs::current();
+    std::vector<unsigned long> sums(inputs.size());
+    double loose = INFINITY, packed = INFINITY;
+    for (int run = 0; run < 5; run++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < inputs.size(); i++) {
+            VfsFile file;
+            if (!vfs.read(inputs[i].path.c_str(), file))
+                return 1;
+            sums[i] = checksum(file);
+        }
+        loose = std::min(loose, secondsSince(start));
+    }
+    if (!vfs.mountPak(output))
+        return 1;
+    for (int run = 0; run < 5; run++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < inputs.size(); i++) {
+            VfsFile file;
+            if (!vfs.read(inputs[i].name.c_str(), file) || !file.isPacked() || checksum(file) != sums[i]) {
+                std::cout << "MISMATCH: " << inputs[i].name << std::endl;
+                return 1;
+            }
+        }
+        packed = std::min(packed, secondsSince(start));
+    }
+    std::cout << "loose files: " << loose * 1000.0 << " ms, pak: " << packed * 1000.0 << " ms ("
+              << inputs.size() << " files, contents match)" << std::endl;
+    return 0;
+} // bench
+
+int main(int argc, char** argv) {
+    bool benchmark = false;
+    const char* output = nullptr;
+    std::vector<PakInput> inputs;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--list") == 0 && i + 1 < argc)
+            return list(argv[i + 1]);
+        else if (strcmp(argv[i], "--bench") == 0)
+            benchmark = true;
+        else if (!output)
+            output = argv[i];
+        else if (!collect(argv[i], inputs))
+            return 1;
+    }
+    if (!output || inputs.empty()) {
+        usage();
+        return 1;
+    }
+    // сам пакет мог попасть в один из каталогов
+    std::string outputName = Vfs::logicalName(output);
+    inputs.erase(std::remove_if(inputs.begin(), inputs.end(), [&](const PakInput& input) {
+        return input.name == outputName;
+    }), inputs.end());
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (!writePakFile(output, inputs))
+        return 1;
+    struct stat st;
+    stat(output, &st);
+    std::cout << output << ": " << inputs.size() << " files, " << st.st_size / 1024 << " KB, "
+              << secondsSince(start) * 1000.0 << " ms" << std::endl;
+    return benchmark ? bench(output, inputs) : 0;
+} // main
@@ -0,0 +1,184 @@
+/*
+ * Отрисовка сцены примера 13-advanced-camera-with-class-camera без окна и GPU программным
+ * растеризатором (см. include/soft_rasterizer.h).
+ *
+ * Кадр рисуется с тем же положением камеры, матрицами и текстурой, что и первый кадр примера,
+ * и записывается в PPM. Для каждого числа потоков (1, 2, 4... по числу ядер) выводится время
+ * кадра и проверяется, что изображение совпадает побайтно с кадром в один поток. С ключом
+ * --compare кадр сравнивается с эталоном (например, снимком окна примера): выводятся
+ * наибольшее отличие канала и PSNR.
+ *
+ * Использование:
+ *
+ *   soft-render [--frames N] [--size WxH] [--out frame.ppm] [--compare reference.ppm]
+ */
+
+#include "soft_rasterizer.h"
+#include "model_cube.h"
+#include "camera.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#define TEXTURE_PATH_PREFIX   "../textures"
+
+// те же позиции ящиков, что и в примере
+static const glm::vec3 cubePositions[] = {
+    glm::vec3( 0.0f,  0.0f,  0.0f),
+    glm::vec3( 2.0f,  5.0f, -15.0f),
+    glm::vec3(-0.5f, -0.2f, -1.5f),
+    glm::vec3(-2.8f, -0.0f, -2.3f),
+    glm::vec3( 2.4f, -0.4f, -1.5f),
+    glm::vec3(-1.7f,  1.0f, -4.5f),
+    glm::vec3( 0.3f, -2.0f, -1.5f),
+    glm::vec3( 0.5f,  2.0f, -2.5f),
+    glm::vec3( 0.5f,  0.2f, -1.5f),
+    glm::vec3(-1.3f,  1.0f, -1.5f)
+};
+
+static void renderScene(SoftRasterizer& rasterizer, const SoftTexture& texture) {
+    Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
+                                            (float)rasterizer.getWidth() / rasterizer.getHeight(), 0.1f, 100.0f);
+    rasterizer.clear(0.2f, 0.3f, 0.3f, 1.0f);
+    rasterizer.setTexture(&texture);
+    rasterizer.setView(camera.GetViewMatrix(), projection);
+    // как и в примере, матрица модели накапливается от ящика к ящику
+    glm::mat4 model(1.0f);
+    for (unsigned i = 0; i < sizeof cubePositions / sizeof *cubePositions; i++) {
+        model = glm::translate(model, cubePositions[i]);
+        model = glm::rotate(model, glm::radians(20.0f * i), glm::vec3(0.3f, 1.0f, 0.5f));
+        rasterizer.drawElements(models::cube_indexed_vertices, 5 * sizeof(GLfloat), 3 * sizeof(GLfloat),
+                                models::cube_indices, models::cube_index_count, model);
+    }
+    rasterizer.flush();
+} // renderScene
+
+// двоичный PPM (P6), строки сверху вниз
+static bool readPPM(const char* path, int& width, int& height, std::vector<unsigned char>& rgb) {
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return false;
+    int maxValue = 0;
+    bool ok = fscanf(file, "P6 %d %d %d", &width, &height, &maxValue) == 3 && maxValue == 255
+              && width > 0 && height > 0 && fgetc(file) != EOF;
+    if (ok) {
+        rgb.resize((size_t)width * height * 3);
+        ok = fread(rgb.data(), 1, rgb.size(), file) == rgb.size();
+    }
+    fclose(file);
+    return ok;
+}
+
+static int compare(const SoftRasterizer& rasterizer, const char* path) {
+    int width, height;
+    std::vector<unsigned char> reference;
+    if (!readPPM(path, width, height, reference)) {
+        std::cout << "Failed loading of the image " << path << std::endl;
+        return 1;
+    }
+    if (width != rasterizer.getWidth() || height != rasterizer.getHeight()) {
+        std::cout << "reference is " << width << "x" << height << ", frame is "
+                  << rasterizer.getWidth() << "x" << rasterizer.getHeight() << std::endl;
+        return 1;
+    }
+    int maxDiff = 0;
+    double squared = 0.0;
+    for (int y = 0; y < height; y++) {
+        // буфер растеризатора идет снизу вверх
+        const unsigned char* frame = rasterizer.getColor() + (size_t)(height - 1 - y) * width * 4;
+        const unsigned char* ref = &reference[(size_t)y * width * 3];
+        for (int x = 0; x < width; x++) {
+            for (int c = 0; c < 3; c++) {
+                int diff = abs(frame[x * 4 + c] - ref[x * 3 + c]);
+                maxDiff = std::max(maxDiff, diff);
+                squared += diff * diff;
+            }
+        }
+    }
+    double mse = squared / ((double)width * height * 3);
+    if (mse == 0.0)
+        printf("compare with %s: identical\n", path);
+    else
+        printf("compare with %s: max difference %d, PSNR %.2f dB\n", path, maxDiff, 10.0 * log10(255.0 * 255.0 / mse));
+    return 0;
+} // compare
+
+int main(int argc, char** argv) {
+    int frames = 50, width = 800, height = 600;
+    const char* outPath = "soft-render.ppm";
+    const char* comparePath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            frames = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%dx%d", &width, &height) == 2
+                 && width > 0 && height > 0)
+            i++;
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            outPath = argv[++i];
+        else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc)
+            comparePath = argv[++i];
+        else {
+            std::cout << "Usage: soft-render [--frames N] [--size WxH] [--out frame.ppm] [--compare reference.ppm]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    SoftTexture texture;
+    int texWidth, texHeight, channels;
+    unsigned char* data = stbi_load(TEXTURE_PATH_PREFIX"/box.jpg", &texWidth, &texHeight, &channels, 0);
+    if (data) {
+        texture.assign(data, texWidth, texHeight, channels);
+        stbi_image_free(data);
+    }
+    else {
+        std::cout << "Failed loading of the texture" << std::endl;
+    }
+
+    std::cout << width << "x" << height << ", " << (SoftRasterizer::hasAvx2() ? "AVX2" : "scalar")
+              << " rasterizer, " << frames << " frames" << std::endl;
+
+    // эталон для сравнения кадров при разном числе потоков
+    SoftRasterizer single(width, height, 1);
+    renderScene(single, texture);
+    std::vector<unsigned char> expected(single.getColor(), single.getColor() + (size_t)width * height * 4);
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1; ; threads = std::min(threads * 2, cores)) {
+        SoftRasterizer rasterizer(width, height, threads);
+        double vertexMs = 0.0, rasterMs = 0.0;
+        for (int frame = 0; frame < frames; frame++) {
+            renderScene(rasterizer, texture);
+            vertexMs += rasterizer.getStats().vertexMs;
+            rasterMs += rasterizer.getStats().rasterMs;
+        }
+        bool same = memcmp(rasterizer.getColor(), expected.data(), expected.size()) == 0;
+        const SoftRasterizerStats& stats = rasterizer.getStats();
+        printf("%2u thread(s): %zu triangles, %zu in tiles, vertices %.3f ms, tiles %.3f ms, total %.3f ms/frame, %s\n",
+               threads, stats.rasterized, stats.binned, vertexMs / frames, rasterMs / frames,
+               (vertexMs + rasterMs) / frames, same ? "same image" : "IMAGE DIFFERS");
+        if (!same)
+            return 1;
+        if (threads == cores)
+            break;
+    }
+
+    if (!single.writePPM(outPath)) {
+        std::cout << "Failed writing of the image " << outPath << std::endl;
+        return 1;
+    }
+    std::cout << "frame written to " << outPath << std::endl;
+    return comparePath ? compare(single, comparePath) : 0;
+} // main
@@ -0,0 +1,255 @@
+/*
+ * Утилита подготовки текстур: сжимает JPEG/PNG в блочный формат и записывает в KTX
+ * (см. include/texture_compress.h и include/ktx_file.h) вместе со всеми mip-уровнями.
+ *
+ * Использование:
+ *
+ *   texture-cook [--format bc1|bc3|bc7|etc2] [--fast] [--no-mipmaps] [--threads N] input.jpg|input.png output.ktx
+ *   texture-cook --bench [--format bc1|bc3] input.jpg|input.png
+ *
+ *   --format       формат сжатия; по умолчанию bc1, а для изображений с альфа-каналом bc3
+ *   --fast         сжимать кодировщиком реального времени (compressImageFast, только bc1 и bc3)
+ *   --no-mipmaps   записать только уровень 0
+ *   --threads N    сжимать в N потоков (по умолчанию - по числу ядер)
+ *   --bench        сравнить кодировщики на уровне 0: скорость в мегапикселях в секунду в 1, 2,
+ *                  4... потока и PSNR; для быстрого - с AVX2 и без
+ *
+ * Mip-уровни строятся усреднением 2 x 2 в исходном пространстве цветов, как glGenerateMipmap.
+ * Для каждого уровня выводится PSNR сжатого изображения относительно несжатого.
+ */
+
+#include "texture_compress.h"
+#include "ktx_file.h"
+#include "thread_pool.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+struct FormatName {
+    const char* name;
+    GLenum      format;
+    GLenum      baseFormat;
+};
+
+static const FormatName formatNames[] = {
+    { "bc1",    GL_COMPRESSED_RGB_S3TC_DXT1_EXT,    GL_RGB },
+    { "bc3",    GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,   GL_RGBA },
+    { "bc7",    GL_COMPRESSED_RGBA_BPTC_UNORM,      GL_RGBA },
+    { "etc2",   GL_COMPRESSED_RGB8_ETC2,            GL_RGB }
+};
+
+static double secondsSince(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void usage() {
+    std::cout << "Usage: texture-cook [--format bc1|bc3|bc7|etc2] [--fast] [--no-mipmaps] [--threads N] input output.ktx"
+              << std::endl
+              << "       texture-cook --bench [--format bc1|bc3] input" << std::endl;
+}
+
+// следующий mip-уровень: среднее 2 x 2, у нечетного размера последний столбец или строка повторяются
+static void downsample(const std::vector<unsigned char>& src, int width, int height, std::vector<unsigned char>& dst) {
+    int w = std::max(1, width / 2), h = std::max(1, height / 2);
+    dst.resize((size_t)w * h * 4);
+    for (int y = 0; y < h; y++) {
+        int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+        for (int x = 0; x < w; x++) {
+            int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+            for (int c = 0; c < 4; c++) {
+                int sum = src[((size_t)y0 * width + x0) * 4 + c] + src[((size_t)y0 * width + x1) * 4 + c] +
+                          src[((size_t)y1 * width + x0) * 4 + c] + src[((size_t)y1 * width + x1) * 4 + c];
+                dst[((size_t)y * w + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+} // downsample
+
+// PSNR по каналам RGB (и A, если формат его хранит)
+static double psnr(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b, bool alpha) {
+    double sum = 0.0;
+    size_t count = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (!alpha && i % 4 == 3)
+            continue;
+        double d = (double)a[i] - b[i];
+        sum += d * d;
+        count++;
+    }
+    if (sum == 0.0)
+        return INFINITY;
+    return 10.0 * log10(255.0 * 255.0 * count / sum);
+}
+
+/*
+ * Скорость и качество кодировщиков на одном изображении. Каждый замер - лучший из нескольких
+ * прогонов, чтобы не мерить прогрев кэшей и запуск потоков.
+ */
+static int bench(const FormatName& format, const std::vector<unsigned char>& rgba, int width, int height) {
+    struct Encoder {
+        const char* name;
+        bool        fast;
+        bool        avx2;
+    };
+    const Encoder encoders[] = {
+        { "offline",      false,  false },
+        { "fast scalar",  true,   false },
+        { "fast AVX2",    true,   true }
+    };
+    bool alpha = format.baseFormat == GL_RGBA;
+    double megapixels = (double)width * height / 1e6;
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned char> blocks(compressedSize(format.format, width, height)), scalarBlocks;
+    std::vector<unsigned char> decoded(rgba.size());
+    for (size_t e = 0; e < sizeof(encoders) / sizeof(encoders[0]); e++) {
+        const Encoder& encoder = encoders[e];
+        if (encoder.avx2 && !compressHasAvx2()) {
+            std::cout << encoder.name << ": no AVX2 on this CPU" << std::endl;
+            continue;
+        }
+        std::cout << encoder.name << ":" << std::endl;
+        for (unsigned n = 1; ; n = std::min(n * 2, cores)) {
+            ThreadPool pool(n);
+            double best = INFINITY;
+            for (int run = 0; run < (encoder.fast ? 10 : 2); run++) {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                if (encoder.fast)
+                    compressImageFast(format.format, rgba.data(), width, height, blocks.data(), &pool, encoder.avx2);
+                else
+                    compressImage(format.format, rgba.data(), width, height, blocks.data(), &pool);
+                best = std::min(best, secondsSince(start));
+            }
+            decompressImage(format.format, blocks.data(), width, height, decoded.data());
+            std::cout << "  " << n << (n == 1 ? " thread:  " : " threads: ") << best * 1000.0 << " ms, "
+                      << megapixels / best << " MP/s, PSNR " << psnr(rgba, decoded, alpha) << " dB" << std::endl;
+            if (n == cores)
+                break;
+        }
+        // AVX2 должен давать те же байты, что и обычный цикл
+        if (encoder.fast && !encoder.avx2) {
+            scalarBlocks = blocks;
+        }
+        else if (encoder.fast && blocks != scalarBlocks) {
+            std::cout << "  MISMATCH with the scalar encoder" << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+} // bench
+
+int main(int argc, char** argv) {
+    const FormatName* format = nullptr;
+    bool mipmaps = true, fast = false, benchmark = false;
+    unsigned threads = 0;
+    const char* input = nullptr;
+    const char* output = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            ++i;
+            for (size_t k = 0; k < sizeof(formatNames) / sizeof(formatNames[0]); k++) {
+                if (strcmp(argv[i], formatNames[k].name) == 0)
+                    format = &formatNames[k];
+            }
+            if (!format) {
+                usage();
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--no-mipmaps") == 0)
+            mipmaps = false;
+        else if (strcmp(argv[i], "--fast") == 0)
+            fast = true;
+        else if (strcmp(argv[i], "--bench") == 0)
+            benchmark = true;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (!input)
+            input = argv[i];
+        else if (!output)
+            output = argv[i];
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (!input || (!output && !benchmark)) {
+        usage();
+        return 1;
+    }
+
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(input, &width, &height, &channels, 4);
+    if (!pixels) {
+        std::cout << "Failed loading of the texture " << input << std::endl;
+        return 1;
+    }
+    std::vector<unsigned char> level(pixels, pixels + (size_t)width * height * 4);
+    stbi_image_free(pixels);
+    if (!format)
+        format = channels == 4 || channels == 2 ? &formatNames[1] : &formatNames[0];
+    bool alpha = format->baseFormat == GL_RGBA;
+    std::cout << input << ": " << width << " x " << height << ", " << channels << " channels -> "
+              << format->name << std::endl;
+    if ((fast || benchmark) && format->format != GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                            && format->format != GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) {
+        std::cout << "The fast encoder supports only bc1 and bc3" << std::endl;
+        return 1;
+    }
+    if (benchmark)
+        return bench(*format, level, width, height);
+
+    ThreadPool pool(threads);
+    KtxImage image;
+    image.internalFormat = format->format;
+    image.baseFormat = format->baseFormat;
+    std::vector<unsigned char> decoded, next;
+    size_t rgbaBytes = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int w = width, h = height; ; ) {
+        KtxLevel compressed;
+        compressed.width = w;
+        compressed.height = h;
+        compressed.data.resize(compressedSize(format->format, w, h));
+        std::chrono::steady_clock::time_point levelStart = std::chrono::steady_clock::now();
+        if (fast)
+            compressImageFast(format->format, level.data(), w, h, compressed.data.data(), &pool);
+        else
+            compressImage(format->format, level.data(), w, h, compressed.data.data(), &pool);
+        double seconds = secondsSince(levelStart);
+
+        decoded.resize(level.size());
+        decompressImage(format->format, compressed.data.data(), w, h, decoded.data());
+        std::cout << "  level " << image.levels.size() << ": " << w << " x " << h << ", "
+                  << seconds * 1000.0 << " ms, PSNR " << psnr(level, decoded, alpha) << " dB" << std::endl;
+        image.levels.push_back(compressed);
+        rgbaBytes += level.size();
+
+        if (!mipmaps || (w == 1 && h == 1))
+            break;
+        downsample(level, w, h, next);
+        level.swap(next);
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+    }
+    double total = secondsSince(start);
+
+    if (!writeKtxFile(output, image))
+        return 1;
+    size_t bytes = 0;
+    for (size_t i = 0; i < image.levels.size(); i++)
+        bytes += image.levels[i].data.size();
+    std::cout << output << ": " << image.levels.size() << " levels, " << bytes / 1024 << " KB (RGBA8 "
+              << rgbaBytes / 1024 << " KB), " << total * 1000.0 << " ms, "
+              << pool.size() << (pool.size() == 1 ? " thread" : " threads") << std::endl;
+    return 0;
+} // main
@@ -0,0 +1,95 @@
+/*
+ * Утилита подготовки огромных изображений: строит пирамиду плиток (см. include/tile_pyramid.h),
+ * которую показывает TiledImage (см. include/tiled_image.h и пример 24-tiled-image).
+ *
+ * Использование:
+ *
+ *   tile-cook [--alpha] [--tile N] [--threads N] input.jpg|input.png output.tiles
+ *
+ *   --alpha        сохранить альфа-канал (RGBA); по умолчанию RGB
+ *   --tile N       сторона плитки вместе с рамкой, кратна 4 (по умолчанию 256)
+ *   --threads N    строить плитки в N потоков (по умолчанию - по числу ядер)
+ *
+ * Исходное изображение декодируется целиком (см. include/image_decoder.h), поэтому должно
+ * помещаться в память; сама пирамида строится в отображенном файле. Изображения, которых нет
+ * целиком нигде, можно строить прямо из программы, передав buildTilePyramid свой источник
+ * пикселей, как это делает пример 24-tiled-image.
+ *
+ *   cd bin && ./tile-cook scan.jpg tiled-image.tiles
+ */
+
+#include "tile_pyramid.h"
+#include "image_decoder.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+static void usage() {
+    std::cout << "Usage: tile-cook [--alpha] [--tile N] [--threads N] input output.tiles" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int channels = 3, tileSize = TILE_PYRAMID_TILE_SIZE;
+    unsigned threads = 0;
+    const char* input = nullptr;
+    const char* output = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--alpha") == 0)
+            channels = 4;
+        else if (strcmp(argv[i], "--tile") == 0 && i + 1 < argc)
+            tileSize = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = (unsigned)atoi(argv[++i]);
+        else if (!input)
+            input = argv[i];
+        else if (!output)
+            output = argv[i];
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (!output || tileSize % 4 != 0 || tileSize <= 2 * TILE_PYRAMID_BORDER) {
+        usage();
+        return 1;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<unsigned char> pixels;
+    ImageInfo info;
+    if (!loadImage(input, channels, pixels, info)) {
+        std::cout << "Failed loading of the image " << input << std::endl;
+        return 1;
+    }
+    double decoded = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const unsigned char* image = pixels.data();
+    int width = info.width;
+    TileSource source = [image, width, channels](int x, int y, int w, int h, unsigned char* dst) {
+        for (int row = 0; row < h; row++)
+            memcpy(dst + (size_t)row * w * channels, image + ((size_t)(y + row) * width + x) * channels,
+                   (size_t)w * channels);
+    };
+    if (!buildTilePyramid(output, info.width, info.height, channels, source, tileSize, threads))
+        return 1;
+    double built = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() - decoded;
+
+    TilePyramid pyramid;
+    if (!pyramid.open(output)) {
+        std::cout << "Failed loading of the tile pyramid " << output << std::endl;
+        return 1;
+    }
+    size_t tiles = 0;
+    for (GLuint i = 0; i < pyramid.getLevelCount(); i++) {
+        const TilePyramidLevel& level = pyramid.getLevel(i);
+        std::cout << "level " << i << ": " << level.width << " x " << level.height << ", " << level.columns
+                  << " x " << level.rows << " tiles" << std::endl;
+        tiles += (size_t)level.columns * level.rows;
+    }
+    std::cout << output << ": " << tiles << " tiles, " << tiles * pyramid.getTileBytes() / (1 << 20)
+              << " MB; decoded in " << decoded << " s, built in " << built << " s" << std::endl;
+    return 0;
+} // main
@@ -0,0 +1,178 @@
+/*
+ * Проверка скорости чтения видео Y4M (см. include/y4m_file.h и include/video_texture.h).
+ *
+ * Использование:
+ *
+ *   video-bench [--ring N] [--threads N] [--cold] input.y4m
+ *   video-bench --generate WIDTH HEIGHT FRAMES [--fps N] output.y4m
+ *
+ *   --ring N       буферов в кольце, кадров читается наперед (по умолчанию VIDEO_TEXTURE_RING)
+ *   --threads N    потоков чтения (по умолчанию VIDEO_TEXTURE_THREADS)
+ *   --cold         убрать файл из кэша страниц перед чтением, чтобы читался диск, а не память
+ *   --generate     записать синтетическое видео 4:2:0 (плоскости пишутся напрямую, без перевода из RGB)
+ *   --fps N        частота в заголовке созданного видео (по умолчанию 60)
+ *
+ * Файл читается целиком так же, как его читает VideoTexture, только без OpenGL: кадры по
+ * порядку, сразу VIDEO_TEXTURE_RING наперед в пуле потоков, каждый одним pread в свой буфер
+ * кольца. Выводится скорость чтения в МБ/с и кадрах в секунду и во сколько раз она больше
+ * частоты видео: если меньше единицы, VideoTexture на этом диске будет пропускать кадры.
+ *
+ *   cd bin && ./video-bench --generate 3840 2160 300 4k.y4m && ./video-bench --cold 4k.y4m
+ */
+
+#include "y4m_file.h"
+#include "image_write.h"
+#include "thread_pool.h"
+#include "video_texture.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+static void usage() {
+    std::cout << "Usage: video-bench [--ring N] [--threads N] [--cold] input.y4m" << std::endl
+              << "       video-bench --generate width height frames [--fps N] output.y4m" << std::endl;
+}
+
+// синтетический 4:2:0: яркость - бегущий градиент, цветность меняется от кадра к кадру
+static bool generate(const char* path, int width, int height, int frames, int fps) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        std::cout << "Failed writing of the video " << path << std::endl;
+        return false;
+    }
+    int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    std::vector<unsigned char> luma((size_t)width * height), chroma((size_t)chromaWidth * chromaHeight);
+    bool ok = writeY4MHeader(file, width, height, fps);
+    for (int frame = 0; ok && frame < frames; frame++) {
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                luma[(size_t)y * width + x] = (unsigned char)(16 + (x + y + frame * 8) % 220);
+        fputs("FRAME\n", file);
+        fwrite(luma.data(), 1, luma.size(), file);
+        for (int plane = 0; plane < 2; plane++) {
+            memset(chroma.data(), 64 + (frame * (plane ? 3 : 5)) % 128, chroma.size());
+            fwrite(chroma.data(), 1, chroma.size(), file);
+        }
+        ok = !ferror(file);
+    }
+    if (fclose(file) != 0 || !ok) {
+        std::cout << "Failed writing of the video " << path << std::endl;
+        return false;
+    }
+    return true;
+} // generate
+
+// грязные страницы система не выбрасывает, поэтому файл сначала сбрасывается на диск
+static void dropFromCache(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+int main(int argc, char** argv) {
+    size_t ring = VIDEO_TEXTURE_RING;
+    unsigned threads = VIDEO_TEXTURE_THREADS;
+    int fps = 60;
+    int size[3] = { 0, 0, 0 };
+    bool cold = false, generating = false;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ring") == 0 && i + 1 < argc)
+            ring = (size_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = (unsigned)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--cold") == 0)
+            cold = true;
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+            fps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--generate") == 0 && i + 3 < argc) {
+            generating = true;
+            for (int k = 0; k < 3; k++)
+                size[k] = atoi(argv[++i]);
+        }
+        else if (!path)
+            path = argv[i];
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (!path || ring == 0 || threads == 0 || fps <= 0
+        || (generating && (size[0] <= 0 || size[1] <= 0 || size[2] <= 0))) {
+        usage();
+        return 1;
+    }
+    if (generating) {
+        if (!generate(path, size[0], size[1], size[2], fps))
+            return 1;
+        std::cout << path << ": " << size[0] << " x " << size[1] << ", " << size[2] << " frames at " << fps
+                  << " fps" << std::endl;
+        return 0;
+    }
+
+    if (cold)
+        dropFromCache(path);
+    Y4MFile video;
+    if (!video.open(path))
+        return 1;
+    size_t frameBytes = video.getFrameBytes(), count = video.getFrameCount();
+    std::cout << path << ": " << video.getWidth() << " x " << video.getHeight() << ", " << video.getFps()
+              << " fps, " << count << " frames of " << frameBytes / 1024 << " KB" << std::endl;
+
+    // кольцо как в VideoTexture: кадр i читается в буфер i % ring, пока читаются следующие
+    std::vector< std::vector<unsigned char> > buffers(ring, std::vector<unsigned char>(frameBytes));
+    std::vector<int> states(ring, 0);       // 0 - читается, 1 - прочитан, -1 - ошибка
+    std::mutex mutex;
+    std::condition_variable ready;
+    ThreadPool pool(threads);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t next = 0, failed = 0;
+    auto startRead = [&](size_t frame) {
+        size_t slot = frame % ring;
+        states[slot] = 0;
+        unsigned char* planes = buffers[slot].data();
+        pool.submit([&, frame, slot, planes]() {
+            bool ok = video.readFrame(frame, planes);
+            std::lock_guard<std::mutex> lock(mutex);
+            states[slot] = ok ? 1 : -1;
+            ready.notify_all();
+        });
+    };
+    for (; next < count && next < ring; next++)
+        startRead(next);
+    for (size_t frame = 0; frame < count; frame++) {
+        size_t slot = frame % ring;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (states[slot] == 0)
+                ready.wait(lock);
+            if (states[slot] < 0)
+                failed++;
+        }
+        // здесь VideoTexture загрузил бы кадр в текстуры
+        video.readAhead(next);
+        if (next < count)
+            startRead(next++);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double megabytes = (double)count * frameBytes / 1048576.0;
+    std::cout << "read " << megabytes << " MB in " << seconds << " s: " << megabytes / seconds << " MB/s, "
+              << count / seconds << " fps (" << count / seconds / video.getFps() << "x realtime), ring "
+              << ring << ", threads " << threads << std::endl;
+    if (failed)
+        std::cout << failed << " frames failed" << std::endl;
+    return failed ? 1 : 0;
+} // main